@@ -101,16 +101,15 @@ static gboolean bar_pane_histogram_update_cb(gpointer data)
 		{
 		const HistMap *histmap = histmap_get(phd->fd);
 
+		/* a quick histogram may be ready at once */
+		if (!histmap && histmap_start(phd->fd)) histmap = histmap_get(phd->fd);
+
 		if (histmap)
 			{
 			phd->pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, phd->histogram_width, phd->histogram_height);
 			gdk_pixbuf_fill(phd->pixbuf, 0xffffffff);
 			phd->histogram.draw(histmap, phd->pixbuf, 0, 0, phd->histogram_width, phd->histogram_height);
 			}
-		else
-			{
-			histmap_start_idle(phd->fd);
-			}
 		}
 
 	return G_SOURCE_REMOVE;
@@ -25,9 +25,12 @@
 #include <cstring>
 
 #include <glib-object.h>
+#include <glib/gstdio.h>
 #include <gtk/gtk.h>
 
 #include "cache-loader.h"
+#include "cache-meta-db.h"
+#include "cache-sim-db.h"
 #include "cache.h"
 #include "filedata.h"
 #include "intl.h"
@@ -111,8 +114,95 @@ struct CacheOpsData
 	guint idle_id; /* event source id */
 };
 
+struct CacheDbJob
+{
+	gboolean clear;
+	gboolean metadata; /**< The metadata index, else the similarity database and the other thumbnail cache files */
+};
+
 constexpr gint PURGE_DIALOG_WIDTH = 400;
 
+constexpr gint64 CACHE_FILE_MAX_AGE = 30 * 24 * 60 * 60; /**< seconds a file of cache_dir_prune() may stay unused */
+
+GThreadPool *cache_db_pool = nullptr;
+
+/**
+ * @brief Removes the files of dir ending in suffix, all of them or those unused for CACHE_FILE_MAX_AGE
+ *
+ * For cached files that have no source file to check against. Their
+ * users update the modification time when they use them.
+ */
+void cache_dir_prune(const gchar *dir, const gchar *suffix, gboolean clear)
+{
+	g_autofree gchar *dirl = path_from_utf8(dir);
+
+	g_autoptr(GDir) d = g_dir_open(dirl, 0, nullptr);
+	if (!d) return;
+
+	const gint64 now = g_get_real_time() / G_USEC_PER_SEC;
+
+	const gchar *name;
+	while ((name = g_dir_read_name(d)))
+		{
+		if (!g_str_has_suffix(name, suffix)) continue;
+
+		g_autofree gchar *path = g_build_filename(dirl, name, NULL);
+
+		GStatBuf st;
+		if (!clear && (g_stat(path, &st) != 0 || now - st.st_mtime < CACHE_FILE_MAX_AGE)) continue;
+
+		g_unlink(path);
+		}
+}
+
+/**
+ * @brief Clears or compacts the metadata index, or the similarity database and prunes the color lookup tables and duplicates checkpoints
+ *
+ * Compaction stats the source of every entry, so it runs on a worker.
+ * The pool has a single thread, jobs run in the order queued.
+ */
+void cache_db_job_run(gpointer data, gpointer)
+{
+	auto *job = static_cast<CacheDbJob *>(data);
+
+	if (job->metadata)
+		{
+		CacheMetaDb *db = cache_meta_db_get();
+		if (db)
+			{
+			if (job->clear) db->clear();
+			else db->compact(true);
+			}
+		}
+	else
+		{
+		CacheSimDb *db = cache_sim_db_get();
+		if (db)
+			{
+			if (job->clear) db->clear();
+			else db->compact(true);
+			}
+
+		cache_dir_prune(get_color_lut_cache_dir(), ".lut", job->clear);
+		cache_dir_prune(get_duplicates_cache_dir(), ".dupes", job->clear);
+		}
+
+	g_free(job);
+}
+
+void cache_db_job_queue(gboolean clear, gboolean metadata)
+{
+	if (!cache_db_pool)
+		{
+		cache_db_pool = g_thread_pool_new(cache_db_job_run, nullptr, 1, FALSE, nullptr);
+		}
+
+	auto *job = g_new0(CacheDbJob, 1);
+	job->clear = clear;
+	job->metadata = metadata;
+	g_thread_pool_push(cache_db_pool, job, nullptr);
+}
+
 /* sorry for complexity (cm->done_list), but need it to remove empty dirs */
 CMData *cache_maintain_data_new(gboolean clear, gboolean metadata, gboolean remote)
 {
@@ -128,6 +218,8 @@ CMData *cache_maintain_data_new(gboolean clear, gboolean metadata, gboolean remo
 
 	dlist = g_list_append(dlist, dir_fd);
 
+	cache_db_job_queue(clear, metadata);
+
 	auto *cm = g_new0(CMData, 1);
 	cm->list = dlist;
 	cm->done_list = nullptr;
@@ -452,6 +544,17 @@ void cache_maintain_home_remote(GtkApplication *app, gboolean metadata, gboolean
 	cm->idle_id = g_idle_add_full(G_PRIORITY_LOW, cache_maintain_home_cb, cm, func);
 }
 
+/**
+ * @brief Waits for database maintenance still running on the worker
+ */
+void cache_maintain_db_finish()
+{
+	if (!cache_db_pool) return;
+
+	g_thread_pool_free(cache_db_pool, FALSE, TRUE);
+	cache_db_pool = nullptr;
+}
+
 static void cache_maint_moved(FileData *fd)
 {
 	const gchar *src = fd->change->source;
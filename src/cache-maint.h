@@ -33,6 +33,7 @@ void cache_notify_cb(FileData *fd, NotifyType type, gpointer data);
 void cache_manager_show();
 
 void cache_maintain_home_remote(GtkApplication *app, gboolean metadata, gboolean clear, GDestroyNotify func);
+void cache_maintain_db_finish();
 void cache_manager_standard_process_remote(gboolean clear);
 void cache_manager_render_remote(GtkApplication *app, const gchar *path, gboolean recurse, gboolean local, GSourceFunc destroy_func);
 void cache_maintenance(GtkApplication *app, const gchar *path);
@@ -0,0 +1,625 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "cache-meta-db.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+#include "cache-sim-db.h"
+#include "cache.h"
+#include "debug.h"
+#include "options.h"
+#include "ui-fileops.h"
+
+/**
+ * @file
+ *-------------------------------------------------------------------
+ * Metadata index file format:
+ *-------------------------------------------------------------------
+ *
+ * A header of HEADER_SIZE bytes, followed by records.
+ *
+ * Each record is a CacheMetaDbRecord, followed by the source path, the
+ * keywords separated by newlines, the comment, the camera and the lens,
+ * padded to 8 bytes. A record with FLAG_REMOVED has no strings but the
+ * path. All values are in host byte order, the file is a local cache
+ * only.
+ *
+ * Records are appended at the end of the last valid record, anything
+ * after it is left from an interrupted write and is cut off on open.
+ */
+
+namespace
+{
+
+constexpr gchar HEADER_MAGIC[8] = {'G', 'Q', 'M', 'E', 'T', 'A', 'D', 'B'};
+constexpr guint32 HEADER_VERSION = 1;
+constexpr gsize HEADER_SIZE = 16;
+
+constexpr guint32 RECORD_MAGIC = 0x524d4d47; // "GMMR"
+
+constexpr gsize COMPACT_MIN_DEAD = 4 * 1024 * 1024;
+
+enum CacheMetaDbFlags : guint32 {
+	FLAG_REMOVED = 1 << 0,
+	FLAG_GPS     = 1 << 1
+};
+
+struct CacheMetaDbRecord
+{
+	guint32 magic;
+	guint32 length;    /**< whole record, including strings and padding */
+	guint64 checksum;  /**< of everything following this field */
+	gint64 mtime;
+	gint64 size;
+	gint64 date;
+	gdouble latitude;
+	gdouble longitude;
+	gint32 width;
+	gint32 height;
+	gint32 rating;
+	guint32 flags;
+	guint32 path_len;
+	guint32 keywords_len;
+	guint32 comment_len;
+	guint32 camera_len;
+	guint32 lens_len;
+	guint32 reserved;
+};
+
+static_assert(sizeof(CacheMetaDbRecord) % 8 == 0);
+
+constexpr gsize align8(gsize n)
+{
+	return (n + 7) & ~static_cast<gsize>(7);
+}
+
+guint64 record_checksum(const guint8 *record, gsize length)
+{
+	constexpr gsize skip = offsetof(CacheMetaDbRecord, mtime);
+
+	return cache_db_checksum(record + skip, length - skip, length);
+}
+
+std::vector<guint8> record_build(const gchar *source, const CacheMetaEntry *entry)
+{
+	std::string keywords;
+	if (entry)
+		{
+		for (const std::string &keyword : entry->keywords)
+			{
+			if (!keywords.empty()) keywords += '\n';
+			keywords += keyword;
+			}
+		}
+
+	const gsize path_len = strlen(source);
+	const gsize strings_len = entry ? keywords.size() + entry->comment.size() + entry->camera.size() + entry->lens.size() : 0;
+	std::vector<guint8> data(align8(sizeof(CacheMetaDbRecord) + path_len + strings_len), 0);
+
+	auto *record = reinterpret_cast<CacheMetaDbRecord *>(data.data());
+	record->length = data.size();
+	record->path_len = path_len;
+
+	guint8 *p = data.data() + sizeof(CacheMetaDbRecord);
+	memcpy(p, source, path_len);
+	p += path_len;
+
+	if (entry)
+		{
+		record->mtime = entry->mtime;
+		record->size = entry->size;
+		record->date = entry->date;
+		record->width = entry->dimensions.width;
+		record->height = entry->dimensions.height;
+		record->rating = entry->rating;
+		if (entry->has_gps)
+			{
+			record->flags |= FLAG_GPS;
+			record->latitude = entry->latitude;
+			record->longitude = entry->longitude;
+			}
+
+		const auto append = [&p](const std::string &text, guint32 &len)
+		{
+			len = text.size();
+			memcpy(p, text.data(), len);
+			p += len;
+		};
+		append(keywords, record->keywords_len);
+		append(entry->comment, record->comment_len);
+		append(entry->camera, record->camera_len);
+		append(entry->lens, record->lens_len);
+		}
+	else
+		{
+		record->flags = FLAG_REMOVED;
+		}
+
+	record->checksum = record_checksum(data.data(), data.size());
+	record->magic = RECORD_MAGIC;
+
+	return data;
+}
+
+/* returns the record length, or 0 if there is no valid record at offset */
+gsize record_valid(const guint8 *data, gsize size, guint64 offset)
+{
+	if (offset + sizeof(CacheMetaDbRecord) > size) return 0;
+
+	const auto *record = reinterpret_cast<const CacheMetaDbRecord *>(data + offset);
+	if (record->magic != RECORD_MAGIC) return 0;
+
+	const gsize length = record->length;
+	if (length < sizeof(CacheMetaDbRecord) || length % 8 != 0 || length > size - offset) return 0;
+
+	const gsize strings_len = static_cast<gsize>(record->path_len) + record->keywords_len +
+	                          record->comment_len + record->camera_len + record->lens_len;
+	if (sizeof(CacheMetaDbRecord) + strings_len > length) return 0;
+
+	if (record_checksum(data + offset, length) != record->checksum) return 0;
+
+	return length;
+}
+
+void record_read(const CacheMetaDbRecord *record, CacheMetaEntry &entry)
+{
+	entry.mtime = record->mtime;
+	entry.size = record->size;
+	entry.date = record->date;
+	entry.dimensions = {record->width, record->height};
+	entry.rating = record->rating;
+	entry.has_gps = (record->flags & FLAG_GPS) != 0;
+	entry.latitude = record->latitude;
+	entry.longitude = record->longitude;
+
+	const auto *p = reinterpret_cast<const gchar *>(record + 1) + record->path_len;
+
+	entry.keywords.clear();
+	const gchar *end = p + record->keywords_len;
+	while (p < end)
+		{
+		const gchar *next = static_cast<const gchar *>(memchr(p, '\n', end - p));
+		if (!next) next = end;
+
+		entry.keywords.emplace_back(p, next);
+		p = next + 1;
+		}
+	p = end;
+
+	entry.comment.assign(p, record->comment_len);
+	p += record->comment_len;
+	entry.camera.assign(p, record->camera_len);
+	p += record->camera_len;
+	entry.lens.assign(p, record->lens_len);
+}
+
+bool write_all(gint fd, const guint8 *data, gsize size, guint64 offset)
+{
+	while (size > 0)
+		{
+		const gssize n = pwrite(fd, data, size, offset);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return false;
+
+		data += n;
+		size -= n;
+		offset += n;
+		}
+
+	return true;
+}
+
+bool header_write(gint fd)
+{
+	guint8 header[HEADER_SIZE] = {};
+	memcpy(header, HEADER_MAGIC, sizeof(HEADER_MAGIC));
+	memcpy(header + sizeof(HEADER_MAGIC), &HEADER_VERSION, sizeof(HEADER_VERSION));
+
+	return write_all(fd, header, sizeof(header), 0);
+}
+
+} // namespace
+
+CacheMetaDb::CacheMetaDb()
+{
+	g_mutex_init(&mutex);
+}
+
+CacheMetaDb::~CacheMetaDb()
+{
+	close();
+	g_mutex_clear(&mutex);
+}
+
+bool CacheMetaDb::reset()
+{
+	index.clear();
+	bytes_dead = 0;
+	committed = HEADER_SIZE;
+
+	return ftruncate(fd, 0) == 0 && header_write(fd);
+}
+
+void CacheMetaDb::scan(const guint8 *data, gsize size)
+{
+	guint64 offset = HEADER_SIZE;
+	while (const gsize length = record_valid(data, size, offset))
+		{
+		const auto *record = reinterpret_cast<const CacheMetaDbRecord *>(data + offset);
+		std::string source(reinterpret_cast<const gchar *>(record + 1), record->path_len);
+
+		auto it = index.find(source);
+		if (it != index.end())
+			{
+			bytes_dead += it->second.length;
+			index.erase(it);
+			}
+
+		if (record->flags & FLAG_REMOVED)
+			{
+			bytes_dead += length;
+			}
+		else
+			{
+			Item &item = index[std::move(source)];
+			record_read(record, item.entry);
+			item.length = length;
+			}
+
+		offset += length;
+		}
+
+	committed = offset;
+
+	if (offset < size)
+		{
+		DEBUG_1("metadata index %s: discarding damaged records after %" G_GUINT64_FORMAT, path, offset);
+		if (ftruncate(fd, offset) != 0)
+			{
+			log_printf("Unable to truncate metadata index %s: %s\n", path, g_strerror(errno));
+			}
+		}
+}
+
+/**
+ * @brief Opens or creates the index at path
+ * @param path Index file name, utf8
+ * @returns true if the index is usable
+ *
+ * An unreadable file is replaced by an empty index. If more than half
+ * the file is superseded records it is compacted.
+ */
+bool CacheMetaDb::open(const gchar *path)
+{
+	close();
+
+	g_mutex_lock(&mutex);
+
+	this->path = g_strdup(path);
+	g_autofree gchar *pathl = path_from_utf8(path);
+
+	fd = ::open(pathl, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+	if (fd < 0)
+		{
+		log_printf("Unable to open metadata index %s: %s\n", path, g_strerror(errno));
+		g_mutex_unlock(&mutex);
+		close();
+		return false;
+		}
+
+	bool ok;
+	g_autofree gchar *contents = nullptr;
+	gsize size = 0;
+	if (!g_file_get_contents(pathl, &contents, &size, nullptr) || size < HEADER_SIZE ||
+	    memcmp(contents, HEADER_MAGIC, sizeof(HEADER_MAGIC)) != 0 ||
+	    memcmp(contents + sizeof(HEADER_MAGIC), &HEADER_VERSION, sizeof(HEADER_VERSION)) != 0)
+		{
+		if (size > 0) log_printf("Metadata index %s is damaged, starting a new one\n", path);
+		ok = reset();
+		}
+	else
+		{
+		scan(reinterpret_cast<const guint8 *>(contents), size);
+		ok = true;
+		}
+
+	const bool need_compact = ok && bytes_dead > COMPACT_MIN_DEAD && bytes_dead > committed / 2;
+
+	DEBUG_1("metadata index %s: %zu entries, %" G_GUINT64_FORMAT " bytes, %zu superseded",
+	        path, index.size(), committed, bytes_dead);
+
+	g_mutex_unlock(&mutex);
+
+	if (!ok)
+		{
+		close();
+		return false;
+		}
+
+	if (need_compact) compact(false);
+
+	return is_open();
+}
+
+void CacheMetaDb::close()
+{
+	g_mutex_lock(&mutex);
+
+	if (fd >= 0) ::close(fd);
+	fd = -1;
+
+	g_clear_pointer(&path, g_free);
+	index.clear();
+	committed = 0;
+	bytes_dead = 0;
+
+	g_mutex_unlock(&mutex);
+}
+
+/**
+ * @brief Copies the entry for source
+ * @returns true if an entry for the current mtime and size exists
+ */
+bool CacheMetaDb::lookup(const gchar *source, time_t mtime, gint64 size, CacheMetaEntry &entry)
+{
+	g_mutex_lock(&mutex);
+
+	auto it = index.find(source);
+	const bool found = it != index.end() && it->second.entry.mtime == mtime && it->second.entry.size == size;
+	if (found) entry = it->second.entry;
+
+	g_mutex_unlock(&mutex);
+	return found;
+}
+
+bool CacheMetaDb::append(const gchar *source, const CacheMetaEntry *entry)
+{
+	if (!source) return false;
+
+	const std::vector<guint8> record = record_build(source, entry);
+
+	g_mutex_lock(&mutex);
+
+	if (fd < 0 || !write_all(fd, record.data(), record.size(), committed))
+		{
+		g_mutex_unlock(&mutex);
+		return false;
+		}
+
+	committed += record.size();
+
+	auto it = index.find(source);
+	if (it != index.end())
+		{
+		bytes_dead += it->second.length;
+		index.erase(it);
+		}
+
+	if (entry)
+		{
+		index[source] = {*entry, record.size()};
+		}
+	else
+		{
+		bytes_dead += record.size();
+		}
+
+	g_mutex_unlock(&mutex);
+	return true;
+}
+
+/**
+ * @brief Appends an entry for source, superseding any previous one
+ */
+bool CacheMetaDb::store(const gchar *source, const CacheMetaEntry &entry)
+{
+	return append(source, &entry);
+}
+
+/**
+ * @brief Drops the entry for source, when its metadata was changed
+ */
+bool CacheMetaDb::remove(const gchar *source)
+{
+	g_mutex_lock(&mutex);
+	const bool known = source && index.find(source) != index.end();
+	g_mutex_unlock(&mutex);
+
+	return !known || append(source, nullptr);
+}
+
+/**
+ * @brief Rewrites the index without superseded entries
+ * @param check_files Also drop entries whose source is gone or has changed
+ * @returns true on success
+ *
+ * The new file is written next to the old one and renamed over it, so
+ * the old data stays valid until the new file is complete. The sources
+ * are checked without holding the lock. The new file replaces the old
+ * one under the lock, so no store goes to the replaced file.
+ */
+bool CacheMetaDb::compact(bool check_files)
+{
+	std::unordered_map<std::string, std::pair<time_t, gint64>> stale; /* source path -> mtime and size checked */
+
+	if (check_files)
+		{
+		struct Source
+		{
+			std::string path;
+			time_t mtime;
+			gint64 size;
+		};
+		std::vector<Source> sources;
+
+		g_mutex_lock(&mutex);
+		sources.reserve(index.size());
+		for (const auto &entry : index)
+			{
+			sources.push_back({entry.first, entry.second.entry.mtime, entry.second.entry.size});
+			}
+		g_mutex_unlock(&mutex);
+
+		for (const Source &source : sources)
+			{
+			/* the mtime may be that of a newer sidecar */
+			struct stat st;
+			if (!stat_utf8(source.path.c_str(), &st) ||
+			    st.st_mtime > source.mtime || st.st_size != source.size)
+				{
+				stale.emplace(source.path, std::make_pair(source.mtime, source.size));
+				}
+			}
+		}
+
+	g_mutex_lock(&mutex);
+
+	if (fd < 0)
+		{
+		g_mutex_unlock(&mutex);
+		return false;
+		}
+
+	/* an entry stored since the check supersedes the stale one */
+	for (const auto &source : stale)
+		{
+		auto it = index.find(source.first);
+		if (it != index.end() && it->second.entry.mtime == source.second.first && it->second.entry.size == source.second.second)
+			{
+			index.erase(it);
+			}
+		}
+
+	g_autofree gchar *tmp_path = g_strconcat(path, ".tmp", nullptr);
+	g_autofree gchar *tmp_pathl = path_from_utf8(tmp_path);
+	g_autofree gchar *pathl = path_from_utf8(path);
+
+	const gint tmp_fd = ::open(tmp_pathl, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	bool ok = tmp_fd >= 0;
+
+	guint64 new_committed = HEADER_SIZE;
+	ok = ok && header_write(tmp_fd);
+
+	for (auto it = index.begin(); ok && it != index.end(); ++it)
+		{
+		const std::vector<guint8> record = record_build(it->first.c_str(), &it->second.entry);
+		ok = write_all(tmp_fd, record.data(), record.size(), new_committed);
+		it->second.length = record.size();
+		new_committed += record.size();
+		}
+
+	ok = ok && fsync(tmp_fd) == 0;
+	ok = ok && rename(tmp_pathl, pathl) == 0;
+
+	if (!ok)
+		{
+		log_printf("Unable to compact metadata index %s: %s\n", path, g_strerror(errno));
+		if (tmp_fd >= 0) ::close(tmp_fd);
+		unlink(tmp_pathl);
+		g_mutex_unlock(&mutex);
+
+		/* the lengths and entries may no longer match the file */
+		g_autofree gchar *db_path = g_strdup(path);
+		open(db_path);
+		return false;
+		}
+
+	DEBUG_1("metadata index %s: compacted %" G_GUINT64_FORMAT " to %" G_GUINT64_FORMAT " bytes, %zu entries",
+	        path, committed, new_committed, index.size());
+
+	/* the index now is what was written */
+	::close(fd);
+	fd = tmp_fd;
+	committed = new_committed;
+	bytes_dead = 0;
+
+	g_mutex_unlock(&mutex);
+	return true;
+}
+
+/**
+ * @brief Removes all entries
+ */
+bool CacheMetaDb::clear()
+{
+	g_mutex_lock(&mutex);
+
+	const bool ok = fd >= 0 && reset();
+
+	g_mutex_unlock(&mutex);
+	return ok;
+}
+
+/*
+ *-------------------------------------------------------------------
+ * shared instance
+ *-------------------------------------------------------------------
+ */
+
+namespace
+{
+
+std::unique_ptr<CacheMetaDb> meta_db;
+bool meta_db_failed = false;
+GMutex meta_db_mutex; /**< guards opening and closing meta_db, workers open it too */
+
+} // namespace
+
+/**
+ * @brief Returns the metadata index, opening it on first use
+ * @returns nullptr if the index is disabled or cannot be opened
+ */
+CacheMetaDb *cache_meta_db_get()
+{
+	if (!options || !options->metadata.use_index) return nullptr;
+
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&meta_db_mutex);
+
+	if (meta_db) return meta_db.get();
+	if (meta_db_failed) return nullptr;
+
+	const gchar *db_path = get_metadata_index_path();
+	g_autofree gchar *dir = remove_level_from_path(db_path);
+
+	auto db = std::make_unique<CacheMetaDb>();
+	if (!recursive_mkdir_if_not_exists(dir, 0755) || !db->open(db_path))
+		{
+		meta_db_failed = true;
+		return nullptr;
+		}
+
+	meta_db = std::move(db);
+	return meta_db.get();
+}
+
+void cache_meta_db_close()
+{
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&meta_db_mutex);
+
+	meta_db.reset();
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef CACHE_META_DB_H
+#define CACHE_META_DB_H
+
+#include <sys/types.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glib.h>
+
+#include "geometry.h"
+
+/**
+ * @brief The metadata of one file that searches and sorts use
+ */
+struct CacheMetaEntry
+{
+	time_t mtime = 0;               /**< of the file or its newest sidecar */
+	gint64 size = 0;
+	std::vector<std::string> keywords;
+	std::string comment;
+	gint rating = 0;
+	time_t date = 0;                /**< Exif.Photo.DateTimeOriginal, 0 if unknown */
+	std::string camera;
+	std::string lens;
+	gboolean has_gps = FALSE;
+	gdouble latitude = 0.0;
+	gdouble longitude = 0.0;
+	GqSize dimensions{0, 0};
+};
+
+/**
+ * @brief Single file index of the metadata of all files read so far
+ *
+ * The file is only ever appended to, and read into memory as a whole on
+ * open, so that lookups do not touch the disk. Each entry is keyed by
+ * the source path and is valid only while the mtime and size match. A
+ * newer record for the same path supersedes the older one, a removal is
+ * recorded as a record without data. Both are dropped on the next
+ * compaction.
+ *
+ * Every record carries a checksum, a crash while writing loses at most
+ * the last record.
+ */
+class CacheMetaDb
+{
+public:
+	CacheMetaDb();
+	~CacheMetaDb();
+
+	CacheMetaDb(const CacheMetaDb &) = delete;
+	CacheMetaDb &operator=(const CacheMetaDb &) = delete;
+
+	bool open(const gchar *path);
+	void close();
+	bool is_open() const { return fd >= 0; }
+
+	bool lookup(const gchar *source, time_t mtime, gint64 size, CacheMetaEntry &entry);
+	bool store(const gchar *source, const CacheMetaEntry &entry);
+	bool remove(const gchar *source);
+
+	bool compact(bool check_files);
+	bool clear();
+
+	gsize count() const { return index.size(); }
+	gsize dead_bytes() const { return bytes_dead; }
+
+private:
+	struct Item
+	{
+		CacheMetaEntry entry;
+		gsize length;           /**< of the record in the file */
+	};
+
+	bool append(const gchar *source, const CacheMetaEntry *entry);
+	void scan(const guint8 *data, gsize size);
+	bool reset();
+
+	GMutex mutex;
+	gchar *path = nullptr;
+	gint fd = -1;
+	guint64 committed = 0;          /**< end of the last valid record */
+	gsize bytes_dead = 0;           /**< size of superseded and removal records */
+	std::unordered_map<std::string, Item> index; /**< source path -> entry */
+};
+
+CacheMetaDb *cache_meta_db_get();
+void cache_meta_db_close();
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,738 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "cache-sim-db.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "cache.h"
+#include "debug.h"
+#include "options.h"
+#include "similar.h"
+#include "ui-fileops.h"
+
+/**
+ * @file
+ *-------------------------------------------------------------------
+ * Similarity database file format:
+ *-------------------------------------------------------------------
+ *
+ * Two header slots of HEADER_SLOT_SIZE bytes, followed by records.
+ * The slot with a valid checksum and the highest sequence is current;
+ * updates always go to the other slot.
+ *
+ * Each record is a CacheSimDbRecord, followed by the 3 x 1024 byte
+ * similarity grid (r, g, b planes) if present, followed by the source
+ * path, padded to 8 bytes. All values are in host byte order, the file
+ * is a local cache only.
+ *
+ * The file is grown in steps and zero filled, so the first slot without
+ * a valid record marks the end of the data.
+ */
+
+namespace
+{
+
+constexpr gchar HEADER_MAGIC[8] = {'G', 'Q', 'S', 'I', 'M', 'D', 'B', '\n'};
+constexpr guint32 HEADER_VERSION = 1;
+constexpr gsize HEADER_SLOT_SIZE = 64;
+constexpr gsize DATA_START = 2 * HEADER_SLOT_SIZE;
+
+constexpr guint32 RECORD_MAGIC = 0x52534d47; // "GMSR"
+constexpr gsize GRID_SIZE = 3 * 1024;
+
+constexpr gsize GROW_MIN = 4 * 1024 * 1024;
+constexpr gsize COMPACT_MIN_DEAD = 16 * 1024 * 1024;
+
+enum CacheSimDbFlags : guint32 {
+	FLAG_DIMENSIONS = 1 << 0,
+	FLAG_DATE       = 1 << 1,
+	FLAG_MD5SUM     = 1 << 2,
+	FLAG_SIMILARITY = 1 << 3
+};
+
+struct CacheSimDbHeader
+{
+	gchar magic[8];
+	guint32 version;
+	guint32 slot_size;
+	guint64 sequence;
+	guint64 committed;
+	guint64 checksum;
+};
+
+static_assert(sizeof(CacheSimDbHeader) <= HEADER_SLOT_SIZE);
+
+struct CacheSimDbRecord
+{
+	guint32 magic;
+	guint32 length;    /**< whole record, including grid, path and padding */
+	guint64 checksum;  /**< of everything following this field */
+	gint64 mtime;
+	gint64 size;
+	gint64 date;
+	gint32 width;
+	gint32 height;
+	guint32 flags;
+	guint32 path_len;
+	guint8 md5sum[16];
+};
+
+static_assert(sizeof(CacheSimDbRecord) % 8 == 0);
+static_assert(sizeof(Md5Digest) == sizeof(CacheSimDbRecord::md5sum));
+
+constexpr gsize align8(gsize n)
+{
+	return (n + 7) & ~static_cast<gsize>(7);
+}
+
+} // namespace
+
+/**
+ * @brief Word-at-a-time hash of a record, records and headers are 8 byte aligned
+ */
+guint64 cache_db_checksum(const guint8 *data, gsize len, guint64 seed)
+{
+	guint64 h = 0xcbf29ce484222325ULL ^ seed;
+
+	gsize i = 0;
+	for (; i + 8 <= len; i += 8)
+		{
+		guint64 w;
+		memcpy(&w, data + i, sizeof(w));
+		h = (h ^ w) * 0x100000001b3ULL;
+		h ^= h >> 29;
+		}
+	for (; i < len; i++)
+		{
+		h = (h ^ data[i]) * 0x100000001b3ULL;
+		}
+
+	return h ^ (h >> 32);
+}
+
+namespace
+{
+
+guint64 header_checksum(const CacheSimDbHeader &header)
+{
+	return cache_db_checksum(reinterpret_cast<const guint8 *>(&header),
+	                         offsetof(CacheSimDbHeader, checksum), 0);
+}
+
+guint64 record_checksum(const guint8 *record, gsize length)
+{
+	constexpr gsize skip = offsetof(CacheSimDbRecord, mtime);
+
+	return cache_db_checksum(record + skip, length - skip, length);
+}
+
+const gchar *record_path(const CacheSimDbRecord *record)
+{
+	const auto *p = reinterpret_cast<const gchar *>(record + 1);
+	if (record->flags & FLAG_SIMILARITY) p += GRID_SIZE;
+
+	return p;
+}
+
+/* returns the record length, or 0 if there is no valid record at offset */
+gsize record_valid(const guint8 *map, gsize map_size, guint64 offset)
+{
+	if (offset + sizeof(CacheSimDbRecord) > map_size) return 0;
+
+	const auto *record = reinterpret_cast<const CacheSimDbRecord *>(map + offset);
+	if (record->magic != RECORD_MAGIC) return 0;
+
+	const gsize length = record->length;
+	if (length < sizeof(CacheSimDbRecord) || length % 8 != 0 || length > map_size - offset) return 0;
+
+	const gsize grid = (record->flags & FLAG_SIMILARITY) ? GRID_SIZE : 0;
+	if (sizeof(CacheSimDbRecord) + grid + record->path_len > length) return 0;
+
+	if (record_checksum(map + offset, length) != record->checksum) return 0;
+
+	return length;
+}
+
+} // namespace
+
+CacheSimDb::CacheSimDb()
+{
+	g_mutex_init(&mutex);
+}
+
+CacheSimDb::~CacheSimDb()
+{
+	close();
+	g_mutex_clear(&mutex);
+}
+
+bool CacheSimDb::map_file(gsize size)
+{
+	if (map) munmap(map, map_size);
+
+	map = static_cast<guint8 *>(mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+	if (map == MAP_FAILED)
+		{
+		log_printf("Unable to map similarity database %s: %s\n", path, g_strerror(errno));
+		map = nullptr;
+		map_size = 0;
+		return false;
+		}
+
+	map_size = size;
+	return true;
+}
+
+bool CacheSimDb::grow(gsize needed)
+{
+	if (committed + needed <= map_size) return true;
+
+	const gsize size = align8(std::max(committed + needed, map_size + std::max(map_size / 4, GROW_MIN)));
+
+	if (ftruncate(fd, size) != 0)
+		{
+		log_printf("Unable to grow similarity database %s: %s\n", path, g_strerror(errno));
+		return false;
+		}
+
+	return map_file(size);
+}
+
+void CacheSimDb::write_header()
+{
+	CacheSimDbHeader header{};
+
+	memcpy(header.magic, HEADER_MAGIC, sizeof(header.magic));
+	header.version = HEADER_VERSION;
+	header.slot_size = HEADER_SLOT_SIZE;
+	header.sequence = ++sequence;
+	header.committed = committed;
+	header.checksum = header_checksum(header);
+
+	/* the current slot stays intact until the other one is complete */
+	memcpy(map + (sequence % 2) * HEADER_SLOT_SIZE, &header, sizeof(header));
+}
+
+bool CacheSimDb::reset()
+{
+	index.clear();
+	bytes_dead = 0;
+	committed = DATA_START;
+	sequence = 0;
+
+	if (map)
+		{
+		munmap(map, map_size);
+		map = nullptr;
+		map_size = 0;
+		}
+
+	if (ftruncate(fd, 0) != 0 || ftruncate(fd, GROW_MIN) != 0) return false;
+	if (!map_file(GROW_MIN)) return false;
+
+	write_header();
+	write_header();
+
+	return true;
+}
+
+void CacheSimDb::scan()
+{
+	const CacheSimDbHeader *current = nullptr;
+
+	for (gsize slot = 0; slot < 2; slot++)
+		{
+		const auto *header = reinterpret_cast<const CacheSimDbHeader *>(map + slot * HEADER_SLOT_SIZE);
+
+		if (memcmp(header->magic, HEADER_MAGIC, sizeof(header->magic)) != 0 ||
+		    header->version != HEADER_VERSION ||
+		    header->checksum != header_checksum(*header)) continue;
+
+		if (!current || header->sequence > current->sequence) current = header;
+		}
+
+	if (!current)
+		{
+		log_printf("Similarity database %s is damaged, starting a new one\n", path);
+		reset();
+		return;
+		}
+
+	sequence = current->sequence;
+
+	/* records written after the last header update are kept if their checksum is good */
+	guint64 offset = DATA_START;
+	while (const gsize length = record_valid(map, map_size, offset))
+		{
+		const auto *record = reinterpret_cast<const CacheSimDbRecord *>(map + offset);
+		std::string source(record_path(record), record->path_len);
+
+		auto it = index.find(source);
+		if (it != index.end())
+			{
+			bytes_dead += reinterpret_cast<const CacheSimDbRecord *>(map + it->second)->length;
+			it->second = offset;
+			}
+		else
+			{
+			index.emplace(std::move(source), offset);
+			}
+
+		offset += length;
+		}
+
+	if (offset < current->committed)
+		{
+		DEBUG_1("similarity database %s: discarding damaged records after %" G_GUINT64_FORMAT, path, offset);
+		}
+
+	committed = offset;
+	if (committed != current->committed) write_header();
+}
+
+/**
+ * @brief Opens or creates the database at path
+ * @param path Database file name, utf8
+ * @returns true if the database is usable
+ *
+ * An unreadable file is replaced by an empty database. If more than half
+ * the file is superseded records it is compacted.
+ */
+bool CacheSimDb::open(const gchar *path)
+{
+	close();
+
+	g_mutex_lock(&mutex);
+
+	this->path = g_strdup(path);
+	g_autofree gchar *pathl = path_from_utf8(path);
+
+	fd = ::open(pathl, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+	if (fd < 0)
+		{
+		log_printf("Unable to open similarity database %s: %s\n", path, g_strerror(errno));
+		g_mutex_unlock(&mutex);
+		close();
+		return false;
+		}
+
+	struct stat st;
+	bool ok;
+	if (fstat(fd, &st) != 0 || static_cast<gsize>(st.st_size) < DATA_START)
+		{
+		ok = reset();
+		}
+	else
+		{
+		ok = map_file(st.st_size);
+		if (ok) scan();
+		ok = ok && map;
+		}
+
+	const bool need_compact = ok && bytes_dead > COMPACT_MIN_DEAD && bytes_dead > committed / 2;
+
+	DEBUG_1("similarity database %s: %zu entries, %" G_GUINT64_FORMAT " bytes, %zu superseded",
+	        path, index.size(), committed, bytes_dead);
+
+	g_mutex_unlock(&mutex);
+
+	if (!ok)
+		{
+		close();
+		return false;
+		}
+
+	if (need_compact) compact(false);
+
+	return is_open();
+}
+
+void CacheSimDb::close()
+{
+	g_mutex_lock(&mutex);
+
+	if (map)
+		{
+		msync(map, map_size, MS_ASYNC);
+		munmap(map, map_size);
+		}
+	map = nullptr;
+	map_size = 0;
+
+	if (fd >= 0) ::close(fd);
+	fd = -1;
+
+	g_clear_pointer(&path, g_free);
+	index.clear();
+	committed = 0;
+	sequence = 0;
+	bytes_dead = 0;
+
+	g_mutex_unlock(&mutex);
+}
+
+/**
+ * @brief Reads the entry for source into cd
+ * @returns true if an entry for the current mtime and size exists
+ *
+ * The fields are copied straight from the mapping, there is no parsing.
+ */
+bool CacheSimDb::lookup(const gchar *source, time_t mtime, gint64 size, CacheData &cd)
+{
+	g_mutex_lock(&mutex);
+
+	auto it = map ? index.find(source) : index.end();
+	if (it == index.end())
+		{
+		g_mutex_unlock(&mutex);
+		return false;
+		}
+
+	const guint8 *base = map + it->second;
+	const auto *record = reinterpret_cast<const CacheSimDbRecord *>(base);
+
+	if (record->mtime != mtime || record->size != size || !record->flags)
+		{
+		g_mutex_unlock(&mutex);
+		return false;
+		}
+
+	if (record->flags & FLAG_DIMENSIONS) cd.dimensions = GqSize{record->width, record->height};
+	if (record->flags & FLAG_DATE) cd.date = static_cast<time_t>(record->date);
+	if (record->flags & FLAG_MD5SUM)
+		{
+		Md5Digest digest;
+		memcpy(digest.data(), record->md5sum, digest.size());
+		cd.md5sum = digest;
+		}
+	if (record->flags & FLAG_SIMILARITY)
+		{
+		auto sd = std::make_unique<ImageSimilarityData>();
+		const guint8 *grid = base + sizeof(CacheSimDbRecord);
+
+		memcpy(sd->avg_r.data(), grid, sd->avg_r.size());
+		memcpy(sd->avg_g.data(), grid + 1024, sd->avg_g.size());
+		memcpy(sd->avg_b.data(), grid + 2048, sd->avg_b.size());
+		sd->filled = true;
+
+		cd.similarity = std::move(sd);
+		}
+
+	g_mutex_unlock(&mutex);
+	return true;
+}
+
+/**
+ * @brief Appends an entry for source, superseding any previous one
+ */
+bool CacheSimDb::store(const gchar *source, time_t mtime, gint64 size, const CacheData &cd)
+{
+	if (!source) return false;
+
+	const gsize path_len = strlen(source);
+	const bool has_sim = image_sim_filled(cd.similarity.get());
+	const gsize length = align8(sizeof(CacheSimDbRecord) + (has_sim ? GRID_SIZE : 0) + path_len);
+
+	g_mutex_lock(&mutex);
+
+	if (!map || !grow(length))
+		{
+		g_mutex_unlock(&mutex);
+		return false;
+		}
+
+	guint8 *base = map + committed;
+	memset(base, 0, length);
+
+	auto *record = reinterpret_cast<CacheSimDbRecord *>(base);
+	record->length = length;
+	record->mtime = mtime;
+	record->size = size;
+	record->path_len = path_len;
+
+	if (cd.dimensions)
+		{
+		record->flags |= FLAG_DIMENSIONS;
+		record->width = cd.dimensions->width;
+		record->height = cd.dimensions->height;
+		}
+	if (cd.date)
+		{
+		record->flags |= FLAG_DATE;
+		record->date = *cd.date;
+		}
+	if (cd.md5sum)
+		{
+		record->flags |= FLAG_MD5SUM;
+		memcpy(record->md5sum, cd.md5sum->data(), sizeof(record->md5sum));
+		}
+
+	guint8 *p = base + sizeof(CacheSimDbRecord);
+	if (has_sim)
+		{
+		record->flags |= FLAG_SIMILARITY;
+		memcpy(p, cd.similarity->avg_r.data(), 1024);
+		memcpy(p + 1024, cd.similarity->avg_g.data(), 1024);
+		memcpy(p + 2048, cd.similarity->avg_b.data(), 1024);
+		p += GRID_SIZE;
+		}
+	memcpy(p, source, path_len);
+
+	record->checksum = record_checksum(base, length);
+	/* the magic goes last, a half written record is never valid */
+	record->magic = RECORD_MAGIC;
+
+	auto it = index.find(source);
+	if (it != index.end())
+		{
+		bytes_dead += reinterpret_cast<const CacheSimDbRecord *>(map + it->second)->length;
+		it->second = committed;
+		}
+	else
+		{
+		index.emplace(source, committed);
+		}
+
+	committed += length;
+	write_header();
+
+	g_mutex_unlock(&mutex);
+	return true;
+}
+
+/**
+ * @brief Rewrites the database without superseded entries
+ * @param check_files Also drop entries whose source is gone or has changed
+ * @returns true on success
+ *
+ * The new file is written next to the old one and renamed over it, so
+ * the old data stays valid until the new file is complete. The sources
+ * are checked without holding the lock, lookups and stores are blocked
+ * only while the records are copied and the new file replaces the open
+ * one, so no store goes to the replaced file.
+ */
+bool CacheSimDb::compact(bool check_files)
+{
+	std::unordered_map<std::string, guint64> stale; /* source path -> record offset checked */
+
+	if (check_files)
+		{
+		struct Source
+		{
+			std::string path;
+			guint64 offset;
+			gint64 mtime;
+			gint64 size;
+		};
+		std::vector<Source> sources;
+
+		g_mutex_lock(&mutex);
+		if (map)
+			{
+			sources.reserve(index.size());
+			for (const auto &entry : index)
+				{
+				const auto *record = reinterpret_cast<const CacheSimDbRecord *>(map + entry.second);
+				sources.push_back({entry.first, entry.second, record->mtime, record->size});
+				}
+			}
+		g_mutex_unlock(&mutex);
+
+		for (const Source &source : sources)
+			{
+			struct stat st;
+
+			if (!stat_utf8(source.path.c_str(), &st) ||
+			    st.st_mtime != source.mtime || st.st_size != source.size)
+				{
+				stale.emplace(source.path, source.offset);
+				}
+			}
+		}
+
+	g_mutex_lock(&mutex);
+
+	if (!map)
+		{
+		g_mutex_unlock(&mutex);
+		return false;
+		}
+
+	/* an entry stored since the check supersedes the stale one */
+	for (const auto &source : stale)
+		{
+		auto it = index.find(source.first);
+		if (it != index.end() && it->second == source.second) index.erase(it);
+		}
+
+	std::vector<std::pair<guint64, guint64 *>> offsets; /* record offset, index entry to update */
+	offsets.reserve(index.size());
+	for (auto &entry : index) offsets.emplace_back(entry.second, &entry.second);
+	std::sort(offsets.begin(), offsets.end());
+
+	g_autofree gchar *tmp_path = g_strconcat(path, ".tmp", nullptr);
+	g_autofree gchar *tmp_pathl = path_from_utf8(tmp_path);
+	g_autofree gchar *pathl = path_from_utf8(path);
+
+	const gint tmp_fd = ::open(tmp_pathl, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	bool ok = tmp_fd >= 0;
+
+	guint64 new_committed = DATA_START;
+	if (ok)
+		{
+		CacheSimDbHeader header{};
+		memcpy(header.magic, HEADER_MAGIC, sizeof(header.magic));
+		header.version = HEADER_VERSION;
+		header.slot_size = HEADER_SLOT_SIZE;
+		header.sequence = 1;
+
+		for (const auto &offset : offsets) new_committed += reinterpret_cast<const CacheSimDbRecord *>(map + offset.first)->length;
+		header.committed = new_committed;
+		header.checksum = header_checksum(header);
+
+		guint8 slots[DATA_START] = {};
+		memcpy(slots + HEADER_SLOT_SIZE, &header, sizeof(header));
+
+		ok = write(tmp_fd, slots, sizeof(slots)) == static_cast<gssize>(sizeof(slots));
+		for (auto it = offsets.begin(); ok && it != offsets.end(); ++it)
+			{
+			const gsize length = reinterpret_cast<const CacheSimDbRecord *>(map + it->first)->length;
+			ok = write(tmp_fd, map + it->first, length) == static_cast<gssize>(length);
+			}
+
+		ok = ok && fsync(tmp_fd) == 0;
+		}
+
+	ok = ok && rename(tmp_pathl, pathl) == 0;
+
+	if (!ok)
+		{
+		log_printf("Unable to compact similarity database %s: %s\n", path, g_strerror(errno));
+		if (tmp_fd >= 0) ::close(tmp_fd);
+		unlink(tmp_pathl);
+		g_mutex_unlock(&mutex);
+
+		/* the stale entries are no longer indexed */
+		g_autofree gchar *db_path = g_strdup(path);
+		open(db_path);
+		return false;
+		}
+
+	DEBUG_1("similarity database %s: compacted %" G_GUINT64_FORMAT " to %" G_GUINT64_FORMAT " bytes, %zu entries",
+	        path, committed, new_committed, offsets.size());
+
+	/* the index now points into the new file, an append goes there too */
+	guint64 offset = DATA_START;
+	for (const auto &entry : offsets)
+		{
+		const gsize length = reinterpret_cast<const CacheSimDbRecord *>(map + entry.first)->length;
+		*entry.second = offset;
+		offset += length;
+		}
+
+	munmap(map, map_size);
+	map = nullptr;
+	map_size = 0;
+	::close(fd);
+	fd = tmp_fd;
+	committed = new_committed;
+	sequence = 1;
+	bytes_dead = 0;
+
+	ok = map_file(new_committed);
+
+	g_mutex_unlock(&mutex);
+
+	if (!ok) close();
+	return ok;
+}
+
+/**
+ * @brief Removes all entries
+ */
+bool CacheSimDb::clear()
+{
+	g_mutex_lock(&mutex);
+
+	const bool ok = map && reset();
+
+	g_mutex_unlock(&mutex);
+	return ok;
+}
+
+/*
+ *-------------------------------------------------------------------
+ * shared instance
+ *-------------------------------------------------------------------
+ */
+
+namespace
+{
+
+std::unique_ptr<CacheSimDb> sim_db;
+bool sim_db_failed = false;
+GMutex sim_db_mutex; /**< guards opening and closing sim_db, loaders open it too */
+
+} // namespace
+
+/**
+ * @brief Returns the similarity database, opening it on first use
+ * @returns nullptr if the database is disabled or cannot be opened
+ */
+CacheSimDb *cache_sim_db_get()
+{
+	if (!options || !options->thumbnails.similarity_database) return nullptr;
+
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&sim_db_mutex);
+
+	if (sim_db) return sim_db.get();
+	if (sim_db_failed) return nullptr;
+
+	const gchar *db_path = get_similarity_database_path();
+	g_autofree gchar *dir = remove_level_from_path(db_path);
+
+	auto db = std::make_unique<CacheSimDb>();
+	if (!recursive_mkdir_if_not_exists(dir, 0755) || !db->open(db_path))
+		{
+		sim_db_failed = true;
+		return nullptr;
+		}
+
+	sim_db = std::move(db);
+	return sim_db.get();
+}
+
+void cache_sim_db_close()
+{
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&sim_db_mutex);
+
+	sim_db.reset();
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
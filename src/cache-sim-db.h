@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef CACHE_SIM_DB_H
+#define CACHE_SIM_DB_H
+
+#include <sys/types.h>
+
+#include <string>
+#include <unordered_map>
+
+#include <glib.h>
+
+struct CacheData;
+
+/**
+ * @brief Single file store for the data otherwise kept in per-image .sim files
+ *
+ * The file is memory mapped and only ever appended to. Each record is keyed
+ * by the source path and is valid only while the source mtime and size
+ * match. A newer record for the same path supersedes the older one, which
+ * is dropped on the next compaction.
+ *
+ * Two header slots are written alternately, and every record carries a
+ * checksum, so a crash while writing loses at most the last record.
+ */
+class CacheSimDb
+{
+public:
+	CacheSimDb();
+	~CacheSimDb();
+
+	CacheSimDb(const CacheSimDb &) = delete;
+	CacheSimDb &operator=(const CacheSimDb &) = delete;
+
+	bool open(const gchar *path);
+	void close();
+	bool is_open() const { return map != nullptr; }
+
+	bool lookup(const gchar *source, time_t mtime, gint64 size, CacheData &cd);
+	bool store(const gchar *source, time_t mtime, gint64 size, const CacheData &cd);
+
+	bool compact(bool check_files);
+	bool clear();
+
+	gsize count() const { return index.size(); }
+	gsize dead_bytes() const { return bytes_dead; }
+
+private:
+	bool map_file(gsize size);
+	bool grow(gsize needed);
+	void scan();
+	void write_header();
+	bool reset();
+
+	GMutex mutex;
+	gchar *path = nullptr;
+	gint fd = -1;
+	guint8 *map = nullptr;
+	gsize map_size = 0;
+	guint64 committed = 0;          /**< end of the last valid record */
+	guint64 sequence = 0;           /**< generation of the newest header slot */
+	gsize bytes_dead = 0;           /**< size of superseded records */
+	std::unordered_map<std::string, guint64> index; /**< source path -> record offset */
+};
+
+guint64 cache_db_checksum(const guint8 *data, gsize len, guint64 seed);
+
+CacheSimDb *cache_sim_db_get();
+void cache_sim_db_close();
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -32,6 +32,7 @@
 
 #include <config.h>
 
+#include "cache-sim-db.h"
 #include "main-defines.h"
 #include "md5-util.h"
 #include "options.h"
@@ -211,7 +212,23 @@ bool CacheData::write_similarity(GString *gstring) const
 	return true;
 }
 
+/**
+ * @brief Saves the data for source
+ *
+ * With the similarity database enabled the data goes there instead of
+ * to a .sim file.
+ */
 void CacheData::save(const gchar *source) const
+{
+	CacheSimDb *db = cache_sim_db_get();
+	struct stat st;
+
+	if (db && stat_utf8(source, &st) && db->store(source, st.st_mtime, st.st_size, *this)) return;
+
+	save_file(source);
+}
+
+void CacheData::save_file(const gchar *source) const
 {
 	g_autofree gchar *base = cache_create_location(CacheType::SIM, source);
 	if (!base) return;
@@ -376,7 +393,29 @@ bool CacheData::read_similarity(FILE *f, const gchar *buffer, gint s)
 	return true;
 }
 
+/**
+ * @brief Loads the data for source
+ *
+ * With the similarity database enabled it is looked up there first. A
+ * valid .sim file found on a miss is imported into the database.
+ */
 bool CacheData::load(const gchar *source)
+{
+	CacheSimDb *db = cache_sim_db_get();
+	struct stat st;
+
+	if (!db || !stat_utf8(source, &st)) return load_file(source);
+
+	if (db->lookup(source, st.st_mtime, st.st_size, *this)) return true;
+
+	if (!load_file(source)) return false;
+
+	db->store(source, st.st_mtime, st.st_size, *this);
+
+	return true;
+}
+
+bool CacheData::load_file(const gchar *source)
 {
 	g_autofree gchar *path = cache_find_location(CacheType::SIM, source);
 	if (!path) return false;
@@ -581,4 +620,48 @@ const gchar *get_metadata_cache_dir()
 	return metadata_cache_dir;
 }
 
+const gchar *get_similarity_database_path()
+{
+#if USE_XDG
+	static gchar *similarity_database_path = g_build_filename(xdg_cache_home_get(), GQ_APPNAME_LC, GQ_CACHE_SIM_DATABASE, NULL);
+#else
+	static gchar *similarity_database_path = g_build_filename(get_rc_dir(), GQ_CACHE_SIM_DATABASE, NULL);
+#endif
+
+	return similarity_database_path;
+}
+
+const gchar *get_metadata_index_path()
+{
+#if USE_XDG
+	static gchar *metadata_index_path = g_build_filename(xdg_cache_home_get(), GQ_APPNAME_LC, GQ_CACHE_METADATA_INDEX, NULL);
+#else
+	static gchar *metadata_index_path = g_build_filename(get_rc_dir(), GQ_CACHE_METADATA_INDEX, NULL);
+#endif
+
+	return metadata_index_path;
+}
+
+const gchar *get_color_lut_cache_dir()
+{
+#if USE_XDG
+	static gchar *color_lut_cache_dir = g_build_filename(xdg_cache_home_get(), GQ_APPNAME_LC, GQ_CACHE_COLOR_LUT, NULL);
+#else
+	static gchar *color_lut_cache_dir = g_build_filename(get_rc_dir(), GQ_CACHE_COLOR_LUT, NULL);
+#endif
+
+	return color_lut_cache_dir;
+}
+
+const gchar *get_duplicates_cache_dir()
+{
+#if USE_XDG
+	static gchar *duplicates_cache_dir = g_build_filename(xdg_cache_home_get(), GQ_APPNAME_LC, GQ_CACHE_DUPLICATES, NULL);
+#else
+	static gchar *duplicates_cache_dir = g_build_filename(get_rc_dir(), GQ_CACHE_DUPLICATES, NULL);
+#endif
+
+	return duplicates_cache_dir;
+}
+
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
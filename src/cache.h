@@ -45,6 +45,11 @@
 #define GQ_CACHE_EXT_METADATA   ".meta"
 #define GQ_CACHE_EXT_XMP_METADATA   ".gq.xmp"
 
+#define GQ_CACHE_SIM_DATABASE   "similarity.db"
+#define GQ_CACHE_METADATA_INDEX "metadata-index.db"
+#define GQ_CACHE_COLOR_LUT      "color-lut"
+#define GQ_CACHE_DUPLICATES     "duplicates"
+
 
 enum class CacheType {
 	THUMB,
@@ -71,6 +76,9 @@ struct CacheData
 	std::unique_ptr<ImageSimilarityData> similarity;
 
 private:
+	bool load_file(const gchar *source);
+	void save_file(const gchar *source) const;
+
 	bool write_dimensions(GString *gstring) const;
 	bool write_date(GString *gstring) const;
 	bool write_md5sum(GString *gstring) const;
@@ -91,6 +99,10 @@ gchar *cache_find_location(CacheType type, const gchar *source);
 const gchar *get_thumbnails_cache_dir();
 const gchar *get_thumbnails_standard_cache_dir();
 const gchar *get_metadata_cache_dir();
+const gchar *get_similarity_database_path();
+const gchar *get_metadata_index_path();
+const gchar *get_color_lut_cache_dir();
+const gchar *get_duplicates_cache_dir();
 
 #endif
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,370 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "color-lut.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#  include <immintrin.h>
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#  define GQ_LUT_HAVE_AVX2 1
+#else
+#  define GQ_LUT_HAVE_AVX2 0
+#endif
+
+/**
+ * @file
+ *-------------------------------------------------------------------
+ * Lookup table file format:
+ *-------------------------------------------------------------------
+ *
+ * FILE_MAGIC, the grid size as a guint32, then the table as
+ * GRID_SIZE^3 x 3 guint16 values. All values are in host byte order,
+ * the file is a local cache only.
+ */
+
+namespace
+{
+
+constexpr gchar FILE_MAGIC[8] = {'G', 'Q', 'C', 'L', 'U', 'T', '1', '\n'};
+
+constexpr gint GRID_SIZE = ColorLut::GRID_SIZE;
+constexpr gsize TABLE_SIZE = GRID_SIZE * GRID_SIZE * GRID_SIZE * 3;
+
+/* offsets of the next grid point along each channel */
+constexpr gint STEP_R = GRID_SIZE * GRID_SIZE * 3;
+constexpr gint STEP_G = GRID_SIZE * 3;
+constexpr gint STEP_B = 3;
+
+/* interpolation weights are in 1/WEIGHT_ONE */
+constexpr guint32 WEIGHT_ONE = 256;
+
+struct GridPosition
+{
+	gint offset;    /**< of the lower grid point, for one channel */
+	guint32 weight; /**< towards the upper grid point */
+};
+
+/**
+ * @brief Grid position of each 8 bit value, so that no division is left per pixel
+ */
+std::array<GridPosition, 256> grid_positions(gint step)
+{
+	std::array<GridPosition, 256> positions;
+
+	for (gint v = 0; v < 256; v++)
+		{
+		const guint32 pos = ((v * (GRID_SIZE - 1) * WEIGHT_ONE) + 127) / 255;
+		const gint index = std::min<gint>(pos / WEIGHT_ONE, GRID_SIZE - 2);
+
+		positions[v] = {index * step, pos - (index * WEIGHT_ONE)};
+		}
+
+	return positions;
+}
+
+const std::array<GridPosition, 256> position_r = grid_positions(STEP_R);
+const std::array<GridPosition, 256> position_g = grid_positions(STEP_G);
+const std::array<GridPosition, 256> position_b = grid_positions(STEP_B);
+
+/**
+ * @brief Transforms a row of pixels in place, alpha is left as it is
+ * @param channels 3 for RGB, 4 for RGBA
+ *
+ * The grid cube around a color is split into six tetrahedra along its
+ * diagonal. Ordering the three weights selects the tetrahedron, and the
+ * color is the weighted sum of its four corners, all in integers.
+ */
+void apply_scalar(const guint16 *lut, guchar *pixels, gint width, gint channels)
+{
+	for (gint x = 0; x < width; x++, pixels += channels)
+		{
+		const GridPosition &pos_r = position_r[pixels[0]];
+		const GridPosition &pos_g = position_g[pixels[1]];
+		const GridPosition &pos_b = position_b[pixels[2]];
+
+		/* the corners in between first move along the channel with the largest weight */
+		guint32 w1;
+		guint32 w2;
+		guint32 w3;
+		gint step1;
+		gint step2;
+
+		if (pos_r.weight >= pos_g.weight)
+			{
+			if (pos_g.weight >= pos_b.weight)
+				{
+				w1 = pos_r.weight; w2 = pos_g.weight; w3 = pos_b.weight; step1 = STEP_R; step2 = STEP_G;
+				}
+			else if (pos_r.weight >= pos_b.weight)
+				{
+				w1 = pos_r.weight; w2 = pos_b.weight; w3 = pos_g.weight; step1 = STEP_R; step2 = STEP_B;
+				}
+			else
+				{
+				w1 = pos_b.weight; w2 = pos_r.weight; w3 = pos_g.weight; step1 = STEP_B; step2 = STEP_R;
+				}
+			}
+		else
+			{
+			if (pos_r.weight >= pos_b.weight)
+				{
+				w1 = pos_g.weight; w2 = pos_r.weight; w3 = pos_b.weight; step1 = STEP_G; step2 = STEP_R;
+				}
+			else if (pos_g.weight >= pos_b.weight)
+				{
+				w1 = pos_g.weight; w2 = pos_b.weight; w3 = pos_r.weight; step1 = STEP_G; step2 = STEP_B;
+				}
+			else
+				{
+				w1 = pos_b.weight; w2 = pos_g.weight; w3 = pos_r.weight; step1 = STEP_B; step2 = STEP_G;
+				}
+			}
+
+		const guint16 *c0 = lut + pos_r.offset + pos_g.offset + pos_b.offset;
+		const guint16 *c1 = c0 + step1;
+		const guint16 *c2 = c1 + step2;
+		const guint16 *c3 = c0 + STEP_R + STEP_G + STEP_B;
+
+		const guint32 k0 = WEIGHT_ONE - w1;
+		const guint32 k1 = w1 - w2;
+		const guint32 k2 = w2 - w3;
+		const guint32 k3 = w3;
+
+		for (gint c = 0; c < 3; c++)
+			{
+			const guint32 sum = (k0 * c0[c]) + (k1 * c1[c]) + (k2 * c2[c]) + (k3 * c3[c]);
+
+			/* from 16 bit in 1/WEIGHT_ONE to 8 bit, rounded */
+			pixels[c] = (sum + (WEIGHT_ONE * 257 / 2)) / (WEIGHT_ONE * 257);
+			}
+		}
+}
+
+#if GQ_LUT_HAVE_AVX2
+/**
+ * @brief apply_scalar() on eight pixels at a time
+ *
+ * The grid positions are still looked up per channel. The tetrahedron is
+ * then selected with compares: its second corner moves along the channel
+ * with the largest weight, the third along all but the one with the
+ * smallest. The corners are fetched with gathers, two 16 bit values each.
+ * Where weights are equal, the corner picked differently than by
+ * apply_scalar() has a weight of 0, so the results are the same.
+ */
+__attribute__((target("avx2")))
+void apply_avx2(const guint16 *lut, guchar *pixels, gint width, gint channels)
+{
+	const __m256i step_r = _mm256_set1_epi32(STEP_R);
+	const __m256i step_g = _mm256_set1_epi32(STEP_G);
+	const __m256i step_b = _mm256_set1_epi32(STEP_B);
+	const __m256i step_all = _mm256_set1_epi32(STEP_R + STEP_G + STEP_B);
+	const __m256i weight_one = _mm256_set1_epi32(WEIGHT_ONE);
+	const __m256i low16 = _mm256_set1_epi32(0xffff);
+	const __m256i half = _mm256_set1_epi32(WEIGHT_ONE * 257 / 2);
+	const __m256i div257 = _mm256_set1_epi32(65281);
+	const auto *base = reinterpret_cast<const int *>(lut);
+
+	alignas(32) gint32 offset[8];
+	alignas(32) gint32 weight[3][8];
+	alignas(32) gint32 out[3][8];
+
+	gint x = 0;
+	for (; x + 8 <= width; x += 8)
+		{
+		guchar *p = pixels + (static_cast<gsize>(x) * channels);
+
+		for (gint i = 0; i < 8; i++, p += channels)
+			{
+			const GridPosition &pos_r = position_r[p[0]];
+			const GridPosition &pos_g = position_g[p[1]];
+			const GridPosition &pos_b = position_b[p[2]];
+
+			offset[i] = pos_r.offset + pos_g.offset + pos_b.offset;
+			weight[0][i] = pos_r.weight;
+			weight[1][i] = pos_g.weight;
+			weight[2][i] = pos_b.weight;
+			}
+
+		const __m256i c0 = _mm256_load_si256(reinterpret_cast<const __m256i *>(offset));
+		const __m256i wr = _mm256_load_si256(reinterpret_cast<const __m256i *>(weight[0]));
+		const __m256i wg = _mm256_load_si256(reinterpret_cast<const __m256i *>(weight[1]));
+		const __m256i wb = _mm256_load_si256(reinterpret_cast<const __m256i *>(weight[2]));
+
+		const __m256i g_gt_r = _mm256_cmpgt_epi32(wg, wr);
+		const __m256i b_gt_r = _mm256_cmpgt_epi32(wb, wr);
+		const __m256i b_gt_g = _mm256_cmpgt_epi32(wb, wg);
+
+		const __m256i step_max = _mm256_blendv_epi8(step_r, _mm256_blendv_epi8(step_g, step_b, b_gt_g), _mm256_or_si256(g_gt_r, b_gt_r));
+		const __m256i step_min = _mm256_blendv_epi8(step_b, _mm256_blendv_epi8(step_g, step_r, g_gt_r), _mm256_or_si256(b_gt_g, b_gt_r));
+
+		const __m256i w1 = _mm256_max_epi32(wr, _mm256_max_epi32(wg, wb));
+		const __m256i w3 = _mm256_min_epi32(wr, _mm256_min_epi32(wg, wb));
+		const __m256i w2 = _mm256_sub_epi32(_mm256_add_epi32(wr, _mm256_add_epi32(wg, wb)), _mm256_add_epi32(w1, w3));
+
+		const __m256i corners[4] = {
+			c0,
+			_mm256_add_epi32(c0, step_max),
+			_mm256_add_epi32(c0, _mm256_sub_epi32(step_all, step_min)),
+			_mm256_add_epi32(c0, step_all)
+		};
+		const __m256i k[4] = {
+			_mm256_sub_epi32(weight_one, w1),
+			_mm256_sub_epi32(w1, w2),
+			_mm256_sub_epi32(w2, w3),
+			w3
+		};
+
+		__m256i sum_r = _mm256_setzero_si256();
+		__m256i sum_g = _mm256_setzero_si256();
+		__m256i sum_b = _mm256_setzero_si256();
+
+		for (gint i = 0; i < 4; i++)
+			{
+			/* red and green, then green and blue, so no read is past the table */
+			const __m256i rg = _mm256_i32gather_epi32(base, corners[i], 2);
+			const __m256i gb = _mm256_i32gather_epi32(base, _mm256_add_epi32(corners[i], _mm256_set1_epi32(1)), 2);
+
+			sum_r = _mm256_add_epi32(sum_r, _mm256_mullo_epi32(k[i], _mm256_and_si256(rg, low16)));
+			sum_g = _mm256_add_epi32(sum_g, _mm256_mullo_epi32(k[i], _mm256_srli_epi32(rg, 16)));
+			sum_b = _mm256_add_epi32(sum_b, _mm256_mullo_epi32(k[i], _mm256_srli_epi32(gb, 16)));
+			}
+
+		/* (sum + half) / (WEIGHT_ONE * 257) as a shift, then a multiply by 2^24 / 257 */
+		const __m256i *sums[3] = {&sum_r, &sum_g, &sum_b};
+		for (gint c = 0; c < 3; c++)
+			{
+			const __m256i scaled = _mm256_srli_epi32(_mm256_add_epi32(*sums[c], half), 8);
+			_mm256_store_si256(reinterpret_cast<__m256i *>(out[c]), _mm256_srli_epi32(_mm256_mullo_epi32(scaled, div257), 24));
+			}
+
+		p = pixels + (static_cast<gsize>(x) * channels);
+		for (gint i = 0; i < 8; i++, p += channels)
+			{
+			p[0] = out[0][i];
+			p[1] = out[1][i];
+			p[2] = out[2][i];
+			}
+		}
+
+	apply_scalar(lut, pixels + (static_cast<gsize>(x) * channels), width - x, channels);
+}
+#endif
+
+using ApplyFunc = void (*)(const guint16 *, guchar *, gint, gint);
+
+/**
+ * @brief Selects the kernel once, at first use
+ *
+ * Most of the time goes to fetching twelve table values per pixel from
+ * data dependent places. SSE2 and NEON have no gather to do that, they
+ * use the scalar code.
+ */
+ApplyFunc apply_func()
+{
+	static const ApplyFunc func = []() -> ApplyFunc
+	{
+#if GQ_LUT_HAVE_AVX2
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2")) return apply_avx2;
+#endif
+		return apply_scalar;
+	}();
+
+	return func;
+}
+
+} // namespace
+
+/**
+ * @brief Fills the table by running transform on all grid points at once
+ */
+void ColorLut::build(const TransformFunc &transform)
+{
+	std::vector<guint16> grid(TABLE_SIZE);
+
+	gsize i = 0;
+	for (gint r = 0; r < GRID_SIZE; r++)
+		{
+		for (gint g = 0; g < GRID_SIZE; g++)
+			{
+			for (gint b = 0; b < GRID_SIZE; b++)
+				{
+				grid[i++] = r * 65535 / (GRID_SIZE - 1);
+				grid[i++] = g * 65535 / (GRID_SIZE - 1);
+				grid[i++] = b * 65535 / (GRID_SIZE - 1);
+				}
+			}
+		}
+
+	table.assign(TABLE_SIZE, 0);
+	transform(grid.data(), table.data(), GRID_SIZE * GRID_SIZE * GRID_SIZE);
+}
+
+bool ColorLut::load(const gchar *path)
+{
+	g_autofree gchar *data = nullptr;
+	gsize size;
+
+	if (!g_file_get_contents(path, &data, &size, nullptr)) return false;
+
+	const gsize header_size = sizeof(FILE_MAGIC) + sizeof(guint32);
+	if (size != header_size + (TABLE_SIZE * sizeof(guint16)) ||
+	    memcmp(data, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0) return false;
+
+	guint32 grid_size;
+	memcpy(&grid_size, data + sizeof(FILE_MAGIC), sizeof(grid_size));
+	if (grid_size != GRID_SIZE) return false;
+
+	table.resize(TABLE_SIZE);
+	memcpy(table.data(), data + header_size, TABLE_SIZE * sizeof(guint16));
+
+	return true;
+}
+
+bool ColorLut::save(const gchar *path) const
+{
+	if (!is_valid()) return false;
+
+	const guint32 grid_size = GRID_SIZE;
+
+	std::vector<gchar> data(sizeof(FILE_MAGIC) + sizeof(grid_size) + (TABLE_SIZE * sizeof(guint16)));
+	memcpy(data.data(), FILE_MAGIC, sizeof(FILE_MAGIC));
+	memcpy(data.data() + sizeof(FILE_MAGIC), &grid_size, sizeof(grid_size));
+	memcpy(data.data() + sizeof(FILE_MAGIC) + sizeof(grid_size), table.data(), TABLE_SIZE * sizeof(guint16));
+
+	return g_file_set_contents(path, data.data(), data.size(), nullptr);
+}
+
+/**
+ * @brief Transforms a row of pixels in place, alpha is left as it is
+ * @param channels 3 for RGB, 4 for RGBA
+ *
+ * Uses AVX2 when the CPU has it.
+ */
+void ColorLut::apply(guchar *pixels, gint width, gint channels) const
+{
+	apply_func()(table.data(), pixels, width, channels);
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef COLOR_LUT_H
+#define COLOR_LUT_H
+
+#include <functional>
+#include <vector>
+
+#include <glib.h>
+
+/**
+ * @brief A color transform sampled on a grid of RGB values
+ *
+ * The transform is evaluated once for each of the GRID_SIZE^3 grid points,
+ * and pixels are then mapped by tetrahedral interpolation between the four
+ * nearest points, a handful of integer operations per pixel.
+ */
+class ColorLut
+{
+public:
+	static constexpr gint GRID_SIZE = 33;
+
+	/** @brief Transforms count 16 bit RGB triplets from in to out */
+	using TransformFunc = std::function<void(const guint16 *in, guint16 *out, gint count)>;
+
+	void build(const TransformFunc &transform);
+	bool load(const gchar *path);
+	bool save(const gchar *path) const;
+
+	void apply(guchar *pixels, gint width, gint channels) const;
+
+	bool is_valid() const { return !table.empty(); }
+
+private:
+	std::vector<guint16> table; /**< RGB of each grid point, blue varies fastest */
+};
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -28,10 +28,15 @@
 
 #include <algorithm>
 #include <cstring>
+#include <vector>
 
 #include <glib-object.h>
+#include <glib/gstdio.h>
 #include <lcms2.h>
 
+#include "cache.h"
+#include "color-lut.h"
+#include "debug.h"
 #include "intl.h"
 #include "layout.h"
 #include "options.h"
@@ -51,6 +56,7 @@ struct ColorMan::Cache {
 	cmsHPROFILE   profile_in;
 	cmsHPROFILE   profile_out;
 	cmsHTRANSFORM transform;
+	ColorLut lut; /**< used instead of transform when built */
 
 	ColorManProfileType profile_in_type;
 	gchar *profile_in_file;
@@ -114,6 +120,64 @@ gint scale_factor()
 std::vector<ColorManCachePtr> cm_cache_list;
 
 
+/**
+ * @brief Lookup tables are stored by a hash of both profiles and the intent
+ */
+gchar *color_man_lut_path(cmsHPROFILE profile_in, cmsHPROFILE profile_out)
+{
+	g_autoptr(GChecksum) checksum = g_checksum_new(G_CHECKSUM_SHA256);
+
+	for (cmsHPROFILE profile : {profile_in, profile_out})
+		{
+		cmsUInt32Number len = 0;
+		if (!cmsSaveProfileToMem(profile, nullptr, &len) || len == 0) return nullptr;
+
+		std::vector<guchar> data(len);
+		if (!cmsSaveProfileToMem(profile, data.data(), &len)) return nullptr;
+
+		g_checksum_update(checksum, data.data(), len);
+		}
+
+	const gint intent = options->color_profile.render_intent;
+	g_checksum_update(checksum, reinterpret_cast<const guchar *>(&intent), sizeof(intent));
+
+	g_autofree gchar *name = g_strconcat(g_checksum_get_string(checksum), ".lut", NULL);
+
+	return g_build_filename(get_color_lut_cache_dir(), name, NULL);
+}
+
+void color_man_lut_build(ColorLut &lut, cmsHPROFILE profile_in, cmsHPROFILE profile_out)
+{
+	g_autofree gchar *path = color_man_lut_path(profile_in, profile_out);
+	if (path && lut.load(path))
+		{
+		/* cache maintenance removes tables unused for a while */
+		g_utime(path, nullptr);
+		DEBUG_1("loaded color lookup table: %s", path);
+		return;
+		}
+
+	g_auto(cmsHTRANSFORM) transform = cmsCreateTransform(profile_in, TYPE_RGB_16,
+	                                                     profile_out, TYPE_RGB_16,
+	                                                     options->color_profile.render_intent, 0);
+	if (!transform)
+		{
+		DEBUG_1("failed to create color profile transform for lookup table");
+		return;
+		}
+
+	lut.build([&transform](const guint16 *in, guint16 *out, gint count)
+	{
+		cmsDoTransform(transform, in, out, count);
+	});
+
+	if (path && recursive_mkdir_if_not_exists(get_color_lut_cache_dir(), 0755) && !lut.save(path))
+		{
+		log_printf("Failed to save color lookup table: %s\n", path);
+		}
+}
+
+
 cmsHPROFILE color_man_cache_load_profile(ColorManProfileType type, const gchar *file, const ColorManMemData &data)
 {
 	cmsHPROFILE profile = nullptr;
@@ -190,6 +254,11 @@ ColorManCachePtr color_man_cache_new(ColorManProfileType in_type, const gchar *i
 
 	cc->has_alpha = has_alpha;
 
+	if (options->color_profile.use_lut)
+		{
+		color_man_lut_build(cc->lut, cc->profile_in, cc->profile_out);
+		}
+
 	if (cc->profile_in_type != COLOR_PROFILE_MEM && cc->profile_out_type != COLOR_PROFILE_MEM)
 		{
 		cm_cache_list.push_back(cc);
@@ -257,6 +326,11 @@ void ColorMan::correct_region(GdkPixbuf *pixbuf, GdkRectangle region) const
 	profile->correct_region(pixbuf, region);
 }
 
+bool ColorMan::is_slow() const
+{
+	return !profile->lut.is_valid();
+}
+
 void ColorMan::Cache::correct_region(GdkPixbuf *pixbuf, GdkRectangle region) const
 {
 	/** @FIXME: region x,y expected to be = 0. Maybe this is not the right place for scaling */
@@ -273,7 +347,14 @@ void ColorMan::Cache::correct_region(GdkPixbuf *pixbuf, GdkRectangle region) con
 		{
 		guchar *pbuf = pix + ((region.y + i) * rs);
 
-		cmsDoTransform(transform, pbuf, pbuf, region.width);
+		if (lut.is_valid())
+			{
+			lut.apply(pbuf, region.width, step);
+			}
+		else
+			{
+			cmsDoTransform(transform, pbuf, pbuf, region.width);
+			}
 		}
 }
 
@@ -399,6 +480,11 @@ void ColorMan::correct_region(GdkPixbuf *, GdkRectangle) const
 	/* no op */
 }
 
+bool ColorMan::is_slow() const
+{
+	return true;
+}
+
 std::optional<ColorManStatus> ColorMan::get_status() const
 {
 	/* no op */
@@ -51,6 +51,7 @@ struct ColorMan {
 	{}
 
 	void correct_region(GdkPixbuf *pixbuf, GdkRectangle region) const;
+	bool is_slow() const;
 	std::optional<ColorManStatus> get_status() const;
 
 private:
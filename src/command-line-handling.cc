@@ -955,6 +955,11 @@ void gq_pixel_info(GtkApplication *, GApplicationCommandLine *app_command_line,
 	pixbuf_renderer_get_mouse_position(pr, pixel);
 	if (pixel.x < 0 || pixel.y < 0) return;
 
+	/* positions in the image file, the pixbuf may have been decoded at reduced size */
+	const gdouble ratio = image_pixbuf_reduced_ratio(pr->pixbuf);
+	const gint x = static_cast<gint>(pixel.x * ratio);
+	const gint y = static_cast<gint>(pixel.y * ratio);
+
 	g_autofree gchar *pixel_info = nullptr;
 	if (const auto color = pixbuf_renderer_get_pixel_colors(pr, pixel);
 	    color.has_value())
@@ -962,20 +967,20 @@ void gq_pixel_info(GtkApplication *, GApplicationCommandLine *app_command_line,
 		if (gdk_pixbuf_get_has_alpha(pr->pixbuf))
 			{
 			pixel_info = g_strdup_printf(_("[%d,%d]: RGBA(%3d,%3d,%3d,%3d)"),
-			                             pixel.x, pixel.y,
+			                             x, y,
 			                             color->r, color->g, color->b, color->a);
 			}
 		else
 			{
 			pixel_info = g_strdup_printf(_("[%d,%d]: RGB(%3d,%3d,%3d)"),
-			                             pixel.x, pixel.y,
+			                             x, y,
 			                             color->r, color->g, color->b);
 			}
 		}
 	else
 		{
 		pixel_info = g_strdup_printf(_("[%d,%d]: RGB(---,---,---)"),
-		                             pixel.x, pixel.y);
+		                             x, y);
 		}
 
 	g_application_command_line_print(app_command_line, "%s\n", pixel_info);
@@ -1456,34 +1461,15 @@ void gq_cm_quit(GtkApplication *app, GApplicationCommandLine *, GVariantDict *,
 	g_application_quit(G_APPLICATION(app));
 }
 
-void gq_cm_dir(GtkApplication *app, GApplicationCommandLine *app_command_line, GVariantDict *command_line_options_dict, GList *)
+/**
+ * @brief Loads the <global> section of the configuration file, exits if it cannot be read
+ */
+void cm_load_global_config(GtkApplication *app, GApplicationCommandLine *app_command_line)
 {
-	gboolean remote_instance;
 	gint diff_count;
 	gsize i = 0;
 	gsize size;
 
-	remote_instance = g_application_command_line_get_is_remote(app_command_line);
-
-	if (remote_instance)
-		{
-		g_application_command_line_print(app_command_line, _("Cache Maintenance is already running\n"));
-		return;
-		}
-
-	const gchar *path;
-	g_variant_dict_lookup(command_line_options_dict, "cache-maintenance", "&s", &path);
-
-	g_autofree gchar *folder_path = expand_tilde(path);
-	if (!isdir(folder_path))
-		{
-		g_autofree gchar *notification_message = g_strdup_printf("\"%s\"%s", folder_path, _(" is not a folder"));
-		cache_maintenance_notification(app, notification_message, FALSE);
-		g_application_command_line_print(app_command_line, "%s\n", notification_message);
-
-		exit(EXIT_FAILURE);
-		}
-
 	g_autofree gchar *rc_path = g_build_filename(get_rc_dir(), RC_FILE_NAME, nullptr);
 	if (!isfile(rc_path))
 		{
@@ -1515,6 +1501,34 @@ void gq_cm_dir(GtkApplication *app, GApplicationCommandLine *app_command_line, G
 		i++;
 		}
 	load_config_from_buf(buf_config_file, i + 9, FALSE);
+}
+
+void gq_cm_dir(GtkApplication *app, GApplicationCommandLine *app_command_line, GVariantDict *command_line_options_dict, GList *)
+{
+	gboolean remote_instance;
+
+	remote_instance = g_application_command_line_get_is_remote(app_command_line);
+
+	if (remote_instance)
+		{
+		g_application_command_line_print(app_command_line, _("Cache Maintenance is already running\n"));
+		return;
+		}
+
+	const gchar *path;
+	g_variant_dict_lookup(command_line_options_dict, "cache-maintenance", "&s", &path);
+
+	g_autofree gchar *folder_path = expand_tilde(path);
+	if (!isdir(folder_path))
+		{
+		g_autofree gchar *notification_message = g_strdup_printf("\"%s\"%s", folder_path, _(" is not a folder"));
+		cache_maintenance_notification(app, notification_message, FALSE);
+		g_application_command_line_print(app_command_line, "%s\n", notification_message);
+
+		exit(EXIT_FAILURE);
+		}
+
+	cm_load_global_config(app, app_command_line);
 
 	if (!options->thumbnails.enable_caching)
 		{
@@ -1528,11 +1542,84 @@ void gq_cm_dir(GtkApplication *app, GApplicationCommandLine *app_command_line, G
 	cache_maintenance(app, folder_path);
 }
 
+/**
+ * @brief Prints the duplicates found in a folder and its subfolders
+ *
+ * --mode selects the match type (default sum), --format csv or json (default csv)
+ * and --threads the number of threads (default the number of cores).
+ * Errors are printed to stderr, so that stdout has only the result.
+ */
+void gq_cm_find_duplicates(GtkApplication *app, GApplicationCommandLine *app_command_line, GVariantDict *command_line_options_dict, GList *)
+{
+	const auto fail = [app_command_line](const gchar *message)
+	{
+		g_application_command_line_printerr(app_command_line, "%s\n", message);
+
+		exit(EXIT_FAILURE);
+	};
+
+	if (g_application_command_line_get_is_remote(app_command_line))
+		{
+		g_application_command_line_printerr(app_command_line, _("A duplicates search or cache maintenance is already running\n"));
+		return;
+		}
+
+	const gchar *path;
+	g_variant_dict_lookup(command_line_options_dict, "find-duplicates", "&s", &path);
+
+	g_autofree gchar *folder_path = expand_tilde(path);
+	if (!isdir(folder_path))
+		{
+		g_autofree gchar *message = g_strdup_printf("\"%s\"%s", folder_path, _(" is not a folder"));
+		fail(message);
+		}
+
+	cm_load_global_config(app, app_command_line);
+
+	const gchar *mode = "sum";
+	g_variant_dict_lookup(command_line_options_dict, "mode", "&s", &mode);
+
+	DupeMatchType match_mask = DUPE_MATCH_SUM;
+	if (!dupe_match_type_from_name(mode, match_mask))
+		{
+		g_autofree gchar *message = g_strdup_printf(_("Unknown duplicates mode: %s"), mode);
+		fail(message);
+		}
+
+	const gchar *format_name = "csv";
+	g_variant_dict_lookup(command_line_options_dict, "format", "&s", &format_name);
+
+	DupeOutputFormat format = DupeOutputFormat::CSV;
+	if (g_strcmp0(format_name, "csv") == 0)
+		{
+		format = DupeOutputFormat::CSV;
+		}
+	else if (g_strcmp0(format_name, "json") == 0)
+		{
+		format = DupeOutputFormat::JSON;
+		}
+	else
+		{
+		g_autofree gchar *message = g_strdup_printf(_("Unknown output format: %s"), format_name);
+		fail(message);
+		}
+
+	/* GApplication does not pass on an integer option of 0, which leaves the default */
+	gint threads = get_cpu_cores();
+	if (g_variant_dict_lookup(command_line_options_dict, "threads", "i", &threads) && threads < 1)
+		{
+		fail(_("The number of threads must be at least 1"));
+		}
+
+	dupe_find_duplicates(app, app_command_line, folder_path, match_mask, threads, format);
+}
+
 CommandLineOptionEntry command_line_options_cache_maintenance[] =
 {
-	{ "cache-maintenance", gq_cm_dir,  REMOTE, N_A },
-	{ "quit",              gq_cm_quit, REMOTE, N_A },
-	{ nullptr,             nullptr,    NA,     N_A }
+	{ "cache-maintenance", gq_cm_dir,             REMOTE, N_A },
+	{ "find-duplicates",   gq_cm_find_duplicates, REMOTE, N_A },
+	{ "quit",              gq_cm_quit,            REMOTE, N_A },
+	{ nullptr,             nullptr,               NA,     N_A }
 };
 
 } // namespace
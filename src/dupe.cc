@@ -21,12 +21,19 @@
 
 #include "dupe.h"
 
+#include <algorithm>
 #include <array>
 #include <chrono>
 #include <cinttypes>
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include <gdk/gdk.h>
 #include <gio/gio.h>
@@ -34,6 +41,7 @@
 
 #include "accelerators.h"
 #include "actions.h"
+#include "cache-sim-db.h"
 #include "cache.h"
 #include "cellrenderericon.h"
 #include "collect.h"
@@ -42,6 +50,7 @@
 #include "filedata.h"
 #include "history-list.h"
 #include "image-load.h"
+#include "image-probe.h"
 #include "img-view.h"
 #include "intl.h"
 #include "layout-image.h"
@@ -62,12 +71,11 @@
 #include "ui-misc.h"
 #include "ui-tree-edit.h"
 #include "ui-utildlg.h"
+#include "union-find.h"
 #include "uri-utils.h"
 #include "utilops.h"
 #include "window.h"
 
-using namespace std::string_literals;
-
 namespace {
 
 /** column assignment order (simply change them here)
@@ -92,15 +100,14 @@ enum DUPE_CHECK_RESULT {
 	DUPE_NAME_MATCH
 };
 
-/** Used for similarity checks. One for each item pushed
+/** Used for similarity checks. One for each block of needles pushed
  * onto the thread pool.
  */
 struct DupeQueueItem
 {
-	DupeItem *needle;
 	DupeWindow *dw;
-	GList *work; /**< pointer into \a dw->list or \a dw->second_list (#DupeItem) */
-	gint index; /**< The order items pushed onto thread pool. Used to sort returned matches */
+	std::vector<guint> needles; /**< \a dw->sim_store indices of the needles, in queue order */
+	gint index; /**< The order the first needle was pushed onto thread pool. Used to sort returned matches */
 };
 
 /** Used for similarity checks thread. One for each pair match found.
@@ -118,6 +125,13 @@ constexpr gint DUPE_DEF_HEIGHT = 400;
 
 constexpr gdouble DUPE_PROGRESS_PULSE_STEP = 0.0001;
 
+constexpr guint DUPE_SIM_BLOCK_SIZE = 32; /**< Needles per similarity thread pool item */
+constexpr guint DUPE_SIM_TILE_SIZE = 256; /**< Candidates compared against every needle of a block in turn */
+
+constexpr gint64 DUPE_STREAM_SHOW_INTERVAL = G_USEC_PER_SEC; /**< Least time between updates of the groups found so far */
+constexpr gint64 DUPE_CHECKPOINT_INTERVAL = 60 * G_USEC_PER_SEC;
+constexpr auto DUPE_CHECKPOINT_MAGIC = "GQDUPES1";
+
 constexpr auto DUPE_WINDOW_DATA_KEY = "dupe-window";
 
 DupeMatchType param_match_mask;
@@ -125,6 +139,37 @@ GList *dupe_window_list = nullptr;	/**< list of open DupeWindow *s */
 
 } // namespace
 
+/** The row of an item in the list of groups found so far.
+ */
+struct DupeStreamRow
+{
+	GtkTreeIter iter; /**< valid while \a shown, list store iters persist */
+	gboolean shown;
+	guint parent; /**< \a dw->sim_items index of the item heading the group, itself for the head */
+	gint rank; /**< as shown, 0 for the head */
+	gint set; /**< DUPE_COLUMN_SET as shown */
+};
+
+/** Similarity matches found so far. The indices are those of \a dw->sim_items.
+ */
+struct DupeStream
+{
+	UnionFind groups;
+	std::vector<gdouble> rank; /**< best match found for each item, 0.0 for none */
+	std::vector<gboolean> done; /**< needles compared in full */
+	std::vector<guint> done_new; /**< needles completed by the threads, guarded by \a dw->search_matches_mutex */
+	GList *found = nullptr; /**< #DupeSearchMatch-es moved from \a dw->search_matches */
+	gboolean changed = FALSE; /**< groups changed since they were shown */
+
+	std::vector<DupeStreamRow> rows; /**< one for each item */
+	gboolean list_reset = FALSE; /**< the results of earlier searches are removed from the list */
+	gint64 show_time = 0;
+	gint64 show_interval = DUPE_STREAM_SHOW_INTERVAL;
+
+	std::string checkpoint_path; /**< empty when not cached */
+	gint64 save_time = 0;
+};
+
 /*
  * Well, after adding the 'compare two sets' option things got a little sloppy in here
  * because we have to account for two 'modes' everywhere. (be careful).
@@ -137,6 +182,8 @@ static gint dupe_match(DupeItem *a, DupeItem *b, DupeMatchType mask, gdouble *ra
 
 static void dupe_thumb_step(DupeWindow *dw);
 static gint dupe_check_cb(gpointer data);
+static void dupe_read_job_free(DupeWindow *dw);
+static void dupe_headless_done(DupeWindow *dw);
 
 static void dupe_second_add(DupeWindow *dw, DupeItem *di);
 static void dupe_second_remove(DupeWindow *dw, DupeItem *di);
@@ -155,68 +202,152 @@ static gboolean dupe_insert_in_list_cache(DupeWindow *dw, FileData *fd);
 static void dupe_match_link(DupeItem *a, DupeItem *b, gdouble rank);
 static gint dupe_match_link_exists(DupeItem *child, DupeItem *parent);
 
+static gdouble dupe_match_sim_threshold(DupeMatchType mask)
+{
+	if (mask & DUPE_MATCH_SIM_HIGH) return 0.95;
+	if (mask & DUPE_MATCH_SIM_MED) return 0.90;
+	if (mask & DUPE_MATCH_SIM_CUSTOM) return static_cast<gdouble>(options->duplicates_similarity_threshold) / 100.0;
+
+	return 0.85;
+}
+
 /**
  * @brief The function run in threads for similarity checks
  * @param d1 #DupeQueueItem
  * @param d2 #DupeWindow
  *
  * Used only for similarity checks.\n
- * Search \a dqi->list for \a dqi->needle and if a match is
+ * Search \a dw->sim_store for each needle of \a dqi and if a match is
  * found, create a #DupeSearchMatch and add to \a dw->search_matches list\n
+ * The candidates are walked in tiles, and each tile is compared against all
+ * needles of the block before moving on, so that it is read from the cache.\n
+ * When \a dw->sim_store has an index, only the candidates it returns are compared.\n
+ * Completed needles are recorded in \a dw->stream.\n
  * If \a dw->abort is set, just increment \a dw->thread_count
  */
 static void dupe_comparison_func(gpointer d1, gpointer d2)
 {
 	auto dqi = static_cast<DupeQueueItem *>(d1);
 	auto dw = static_cast<DupeWindow *>(d2);
-	DupeSearchMatch *dsm;
-	DupeItem *di;
-	GList *matches = nullptr;
-	gdouble rank = 0;
+	const gdouble m = dupe_match_sim_threshold(dw->match_mask);
+	std::vector<GList *> needle_matches(dqi->needles.size(), nullptr);
+
+	gint64 pairs_compared = 0;
+	gint64 pairs_matched = 0;
+	gint64 pairs_prefiltered = 0;
+
+	const auto check_candidate = [dw, m, &needle_matches, &pairs_compared, &pairs_matched, &pairs_prefiltered, dqi](gsize n, guint candidate)
+	{
+		const guint needle_index = dqi->needles[n];
+		auto *needle = static_cast<DupeItem *>(g_ptr_array_index(dw->sim_items, needle_index));
+		auto *di = static_cast<DupeItem *>(g_ptr_array_index(dw->sim_items, candidate));
+
+		if (!needle || !di || di->fd->path == needle->fd->path) return;
+
+		pairs_compared++;
+		if (dw->sim_store->prefilter_reject(candidate, needle_index, m))
+			{
+			pairs_prefiltered++;
+			return;
+			}
+
+		const gdouble f = dw->sim_store->compare_fast(candidate, needle_index, m);
+		if (f < m) return;
+
+		auto *dsm = g_new0(DupeSearchMatch, 1);
+		dsm->a = di;
+		dsm->b = needle;
+		dsm->rank = f * 100.0;
+		dsm->index = dqi->index + n;
+		needle_matches[n] = g_list_prepend(needle_matches[n], dsm);
+		pairs_matched++;
+	};
 
 	if (!dw->abort)
 		{
-		GList *work = dqi->work;
-		while (work)
+		if (dw->sim_store->index_built())
 			{
-			di = static_cast<DupeItem *>(work->data);
+			/* only the candidates returned by the index, in the same order as below */
+			std::vector<guint> candidates;
 
-			/* forward for second set, back for simple compare */
-			if (dw->second_set)
+			for (gsize n = 0; n < dqi->needles.size() && !dw->abort; n++)
 				{
-				work = work->next;
+				dw->sim_store->index_query(dqi->needles[n], m, candidates);
+
+				if (dw->second_set)
+					{
+					for (guint candidate : candidates)
+						{
+						check_candidate(n, candidate);
+						}
+					}
+				else
+					{
+					for (auto it = candidates.crbegin(); it != candidates.crend(); ++it)
+						{
+						if (*it < dqi->needles[n]) check_candidate(n, *it);
+						}
+					}
 				}
-			else
+			}
+		else if (dw->second_set)
+			{
+			/* forward through the second set */
+			for (guint tile = dw->sim_second_start; tile < dw->sim_items->len && !dw->abort; tile += DUPE_SIM_TILE_SIZE)
 				{
-				work = work->prev;
-				}
+				const guint tile_end = std::min(tile + DUPE_SIM_TILE_SIZE, dw->sim_items->len);
 
-			if (dupe_match(di, dqi->needle, dqi->dw->match_mask, &rank, TRUE))
-				{
-				dsm = g_new0(DupeSearchMatch, 1);
-				dsm->a = di;
-				dsm->b = dqi->needle;
-				dsm->rank = rank;
-				matches = g_list_prepend(matches, dsm);
-				dsm->index = dqi->index;
+				for (gsize n = 0; n < dqi->needles.size(); n++)
+					{
+					for (guint candidate = tile; candidate < tile_end; candidate++)
+						{
+						check_candidate(n, candidate);
+						}
+					}
 				}
+			}
+		else
+			{
+			/* back from each needle for simple compare */
+			const guint top = *std::max_element(dqi->needles.cbegin(), dqi->needles.cend());
 
-			if (dw->abort)
+			for (guint tile_end = top; tile_end > 0 && !dw->abort; tile_end -= std::min(tile_end, DUPE_SIM_TILE_SIZE))
 				{
-				break;
+				const guint tile = tile_end - std::min(tile_end, DUPE_SIM_TILE_SIZE);
+
+				for (gsize n = 0; n < dqi->needles.size(); n++)
+					{
+					for (guint candidate = std::min(tile_end, dqi->needles[n]); candidate > tile; candidate--)
+						{
+						check_candidate(n, candidate - 1);
+						}
+					}
 				}
 			}
 
-		matches = g_list_reverse(matches);
+		GList *matches = nullptr;
+		for (auto it = needle_matches.rbegin(); it != needle_matches.rend(); ++it)
+			{
+			matches = g_list_concat(g_list_reverse(*it), matches);
+			}
+
 		g_mutex_lock(&dw->search_matches_mutex);
 		dw->search_matches = g_list_concat(dw->search_matches, matches);
+		if (!dw->abort)
+			{
+			/* not cut short, so these needles need not be compared again on resume */
+			dw->stream->done_new.insert(dw->stream->done_new.end(), dqi->needles.cbegin(), dqi->needles.cend());
+			}
 		g_mutex_unlock(&dw->search_matches_mutex);
 		}
 
 	g_mutex_lock(&dw->thread_count_mutex);
-	dw->thread_count++;
+	dw->thread_count += dqi->needles.size();
+	dw->sim_pairs_compared += pairs_compared;
+	dw->sim_pairs_matched += pairs_matched;
+	dw->sim_pairs_prefiltered += pairs_prefiltered;
 	g_mutex_unlock(&dw->thread_count_mutex);
-	g_free(dqi);
+	delete dqi;
 }
 
 /*
@@ -236,6 +367,8 @@ static void dupe_window_update_count(DupeWindow *dw, gboolean count_only)
 {
 	g_autofree gchar *text = nullptr;
 
+	if (dw->headless) return;
+
 	if (!dw->list)
 		{
 		text = g_strdup(_("Drop files to compare them."));
@@ -290,6 +423,8 @@ static void dupe_window_update_progress(DupeWindow *dw, const gchar *status, gdo
 {
 	const gchar *status_text;
 
+	if (dw->headless) return;
+
 	if (status)
 		{
 		guint64 new_time = 0;
@@ -457,7 +592,7 @@ static void dupe_item_read_cache(DupeItem *di)
 
 	if (!di->md5sum && cd.md5sum)
 		{
-		di->md5sum = md5_digest_to_text(cd.md5sum.value());
+		di->md5sum = cd.md5sum;
 		}
 }
 
@@ -468,11 +603,7 @@ static void dupe_item_write_cache(DupeItem *di)
 	CacheData cd{};
 
 	if (!di->dimensions.empty()) cd.set_dimensions(di->dimensions);
-	if (di->md5sum)
-		{
-		Md5Digest digest;
-		if (md5_digest_from_text(di->md5sum->c_str(), digest)) cd.set_md5sum(digest);
-		}
+	if (di->md5sum) cd.set_md5sum(*di->md5sum);
 	if (di->simd) cd.set_similarity(*di->simd);
 
 	cd.save(di->fd->path);
@@ -503,14 +634,64 @@ static gint dupe_listview_find_item(GtkListStore *store, DupeItem *item, GtkTree
 	return -1;
 }
 
-static void dupe_listview_add(DupeWindow *dw, DupeItem *parent, DupeItem *child)
+/**
+ * @brief Sets all columns of a row but the thumbnail
+ * @param parent TRUE if \a di heads its group
+ * @param rank Shown if not \a parent
+ */
+static void dupe_listview_set_row(DupeWindow *dw, GtkListStore *store, GtkTreeIter *iter, DupeItem *di,
+                                  gboolean parent, gint rank, gboolean color_set, gint set)
+{
+	g_autofree gchar *rank_text = nullptr;
+	if (parent && dw->second_set)
+		{
+		rank_text = g_strdup("[1]");
+		}
+	else if (parent || rank == 0)
+		{
+		rank_text = g_strdup((di->second) ? "(2)" : "");
+		}
+	else
+		{
+		rank_text = g_strdup_printf("%d%s", rank, (di->second) ? " (2)" : "");
+		}
+
+	g_autofree gchar *size_text = text_from_size(di->fd->size);
+
+	g_autofree gchar *dimensions_text = nullptr;
+	if (di->dimensions.width > 0 && di->dimensions.height > 0)
+		{
+		dimensions_text = g_strdup_printf("%d x %d", di->dimensions.width, di->dimensions.height);
+		}
+	else
+		{
+		dimensions_text = g_strdup("");
+		}
+
+	gtk_list_store_set(store, iter,
+	                   DUPE_COLUMN_POINTER, di,
+	                   DUPE_COLUMN_RANK, rank_text,
+	                   DUPE_COLUMN_NAME, di->fd->name,
+	                   DUPE_COLUMN_SIZE, size_text,
+	                   DUPE_COLUMN_DATE, text_from_time(di->fd->date),
+	                   DUPE_COLUMN_DIMENSIONS, dimensions_text,
+	                   DUPE_COLUMN_PATH, di->fd->path,
+	                   DUPE_COLUMN_COLOR, color_set,
+	                   DUPE_COLUMN_SET, set,
+	                   -1);
+}
+
+/**
+ * @brief Inserts \a child below \a parent, or \a parent at the top if \a child is NULL
+ * @param rank Shown for \a child
+ */
+static void dupe_listview_add_rank(DupeWindow *dw, DupeItem *parent, DupeItem *child, gint rank)
 {
 	DupeItem *di;
 	gint row;
 	GtkListStore *store;
 	GtkTreeIter iter;
 	gboolean color_set = FALSE;
-	gint rank;
 
 	if (!parent) return;
 
@@ -518,23 +699,10 @@ static void dupe_listview_add(DupeWindow *dw, DupeItem *parent, DupeItem *child)
 
 	if (child)
 		{
-		DupeMatch *dm;
-
 		row = dupe_listview_find_item(store, parent, &iter);
 		gtk_tree_model_get(GTK_TREE_MODEL(store), &iter, DUPE_COLUMN_COLOR, &color_set, -1);
 
 		row++;
-
-		if (child->group)
-			{
-			dm = static_cast<DupeMatch *>(child->group->data);
-			rank = static_cast<gint>(floor(dm->rank));
-			}
-		else
-			{
-			rank = 1;
-			log_printf("NULL group in item!\n");
-			}
 		}
 	else
 		{
@@ -554,45 +722,29 @@ static void dupe_listview_add(DupeWindow *dw, DupeItem *parent, DupeItem *child)
 
 	di = (child) ? child : parent;
 
-	g_autofree gchar *rank_text = nullptr;
-	if (!child && dw->second_set)
-		{
-		rank_text = g_strdup("[1]");
-		}
-	else if (rank == 0)
-		{
-		rank_text = g_strdup((di->second) ? "(2)" : "");
-		}
-	else
-		{
-		rank_text = g_strdup_printf("%d%s", rank, (di->second) ? " (2)" : "");
-		}
+	gtk_list_store_insert(store, &iter, row);
+	dupe_listview_set_row(dw, store, &iter, di, !child, rank, color_set, dw->set_count);
+}
 
-	g_autofree gchar *size_text = text_from_size(di->fd->size);
+static void dupe_listview_add(DupeWindow *dw, DupeItem *parent, DupeItem *child)
+{
+	gint rank = 0;
 
-	g_autofree gchar *dimensions_text = nullptr;
-	if (di->dimensions.width > 0 && di->dimensions.height > 0)
-		{
-		dimensions_text = g_strdup_printf("%d x %d", di->dimensions.width, di->dimensions.height);
-		}
-	else
+	if (child)
 		{
-		dimensions_text = g_strdup("");
+		if (child->group)
+			{
+			auto *dm = static_cast<DupeMatch *>(child->group->data);
+			rank = static_cast<gint>(floor(dm->rank));
+			}
+		else
+			{
+			rank = 1;
+			log_printf("NULL group in item!\n");
+			}
 		}
 
-	gtk_list_store_insert(store, &iter, row);
-	gtk_list_store_set(store, &iter,
-	                   DUPE_COLUMN_POINTER, di,
-	                   DUPE_COLUMN_RANK, rank_text,
-	                   DUPE_COLUMN_THUMB, NULL,
-	                   DUPE_COLUMN_NAME, di->fd->name,
-	                   DUPE_COLUMN_SIZE, size_text,
-	                   DUPE_COLUMN_DATE, text_from_time(di->fd->date),
-	                   DUPE_COLUMN_DIMENSIONS, dimensions_text,
-	                   DUPE_COLUMN_PATH, di->fd->path,
-	                   DUPE_COLUMN_COLOR, color_set,
-	                   DUPE_COLUMN_SET, dw->set_count,
-	                   -1);
+	dupe_listview_add_rank(dw, parent, child, rank);
 }
 
 static void dupe_listview_select_dupes(DupeWindow *dw, DupeSelectType parents);
@@ -1287,14 +1439,36 @@ static void dupe_match_rank(DupeWindow *dw)
  * ------------------------------------------------------------------
  */
 
+/**
+ * @brief Reads the checksum of a single item, unless it is known already
+ *
+ * A file that cannot be read matches no other file.
+ */
+static void dupe_item_read_md5sum(DupeItem *di)
+{
+	if (di->md5sum || di->content_unique) return;
+
+	g_autofree gchar *path = path_from_utf8(di->fd->path);
+	Md5Digest digest;
+
+	if (md5_get_digest_from_file(path, digest))
+		{
+		di->md5sum = digest;
+		}
+	else
+		{
+		di->content_unique = TRUE;
+		}
+}
+
 static gboolean dupe_match_md5sum(DupeItem *a, DupeItem *b)
 {
-	if (!a->md5sum) a->md5sum = md5_text_from_file_utf8(a->fd->path);
-	if (!b->md5sum) b->md5sum = md5_text_from_file_utf8(b->fd->path);
+	if (a->content_unique || b->content_unique) return FALSE;
+
+	dupe_item_read_md5sum(a);
+	dupe_item_read_md5sum(b);
 
-	return !a->md5sum->empty()
-	    && !b->md5sum->empty()
-	    && a->md5sum == b->md5sum;
+	return a->md5sum && b->md5sum && *a->md5sum == *b->md5sum;
 }
 
 /**
@@ -1364,12 +1538,7 @@ static gboolean dupe_match(DupeItem *a, DupeItem *b, DupeMatchType mask, gdouble
 	if (mask & DUPE_MATCH_SIM)
 		{
 		gdouble f;
-		gdouble m;
-
-		if (mask & DUPE_MATCH_SIM_HIGH) m = 0.95;
-		else if (mask & DUPE_MATCH_SIM_MED) m = 0.90;
-		else if (mask & DUPE_MATCH_SIM_CUSTOM) m = static_cast<gdouble>(options->duplicates_similarity_threshold) / 100.0;
-		else m = 0.85;
+		const gdouble m = dupe_match_sim_threshold(mask);
 
 		if (fast)
 			{
@@ -1475,7 +1644,7 @@ static DUPE_CHECK_RESULT dupe_match_check(DupeItem *di1, DupeItem *di2, gpointer
 		}
 	if (mask & DUPE_MATCH_SUM)
 		{
-		if (di1->md5sum != di2->md5sum)
+		if (!di1->md5sum || !di2->md5sum || *di1->md5sum != *di2->md5sum)
 			{
 			return DUPE_NO_MATCH;
 			}
@@ -1606,13 +1775,10 @@ static gint dupe_match_sort_cb(gconstpointer a, gconstpointer b, gpointer data)
 		}
 	if (mask & DUPE_MATCH_SUM)
 		{
-		if (!di1->md5sum || di1->md5sum->empty() ||
-		    !di2->md5sum || di2->md5sum->empty())
-			{
-			return -1;
-			}
-
-		return di1->md5sum->compare(di2->md5sum.value());
+		/* items without a checksum sort first, they match nothing */
+		if (di1->md5sum < di2->md5sum) return -1;
+		if (di1->md5sum > di2->md5sum) return 1;
+		return 0;
 		}
 	if (mask & DUPE_MATCH_DIM)
 		{
@@ -1759,97 +1925,636 @@ static void dupe_array_check(DupeWindow *dw)
 	g_array_free(array_set1, TRUE);
 }
 
+/*
+ * ------------------------------------------------------------------
+ * Similarity matches found so far, and the checkpoint
+ * ------------------------------------------------------------------
+ */
+
 /**
- * @brief Look for similarity match
- * @param dw
- * @param needle
- * @param start
+ * @brief Returns the checkpoint file of the items in \a dw->sim_store
  *
- * Only used for similarity checks.\n
- * Called from dupe_check_cb.
- * Called for each entry in the list.
- * Steps through the list looking for matches against needle.
- * Pushes a #DupeQueueItem onto thread pool queue.
+ * The name is a hash of the match settings and of the path, size and date
+ * of every item in store order, so a checkpoint is only ever used for
+ * the same search of unchanged files.
  */
-static void dupe_list_check_match(DupeWindow *dw, DupeItem *needle, GList *start)
+static std::string dupe_stream_checkpoint_path(DupeWindow *dw)
 {
-	GList *work;
-	DupeQueueItem *dqi;
+	g_autoptr(GChecksum) checksum = g_checksum_new(G_CHECKSUM_SHA256);
 
-	if (dw->second_set)
-		{
-		work = dw->second_list;
-		}
-	else if (start)
-		{
-		work = start;
-		}
-	else
+	g_autofree gchar *settings = g_strdup_printf("%d %d %d %d %u", dw->match_mask, dw->second_set,
+	                                             static_cast<gint>(dupe_match_sim_threshold(dw->match_mask) * 1000),
+	                                             options->rot_invariant_sim, dw->sim_second_start);
+	g_checksum_update(checksum, reinterpret_cast<const guchar *>(settings), -1);
+
+	for (guint i = 0; i < dw->sim_items->len; i++)
 		{
-		work = g_list_last(dw->list);
+		auto *di = static_cast<DupeItem *>(g_ptr_array_index(dw->sim_items, i));
+		const gint64 stat[2] = {di->fd->size, static_cast<gint64>(di->fd->date)};
+
+		g_checksum_update(checksum, reinterpret_cast<const guchar *>(di->fd->path), strlen(di->fd->path) + 1);
+		g_checksum_update(checksum, reinterpret_cast<const guchar *>(stat), sizeof(stat));
 		}
 
-	dqi = g_new0(DupeQueueItem, 1);
-	dqi->needle = needle;
-	dqi->dw = dw;
-	dqi->work = work;
-	dqi->index = dw->queue_count;
-	g_thread_pool_push(dw->dupe_comparison_thread_pool, dqi, nullptr);
+	g_autofree gchar *name = g_strconcat(g_checksum_get_string(checksum), ".dupes", NULL);
+	g_autofree gchar *path = g_build_filename(get_duplicates_cache_dir(), name, NULL);
+
+	return path;
 }
 
-/*
- * ------------------------------------------------------------------
- * Thumbnail handling
- * ------------------------------------------------------------------
- */
+static void dupe_stream_add(DupeStream *stream, const DupeSearchMatch *dsm)
+{
+	const guint a = dsm->a->sim_index;
+	const guint b = dsm->b->sim_index;
 
-static GdkPixbuf *dupe_scale_thumb(GdkPixbuf *pixbuf)
+	stream->groups.unite(a, b);
+	stream->rank[a] = std::max(stream->rank[a], dsm->rank);
+	stream->rank[b] = std::max(stream->rank[b], dsm->rank);
+	stream->changed = TRUE;
+}
+
+/**
+ * @brief Reads the needles done and the matches found from the checkpoint file
+ *
+ * The file is text:\n
+ * DUPE_CHECKPOINT_MAGIC and the number of items\n
+ * "done" first last, for each range of needles that is complete\n
+ * "match" a b rank index, for each #DupeSearchMatch of a completed needle b
+ */
+static void dupe_stream_load(DupeWindow *dw)
 {
-	if (!pixbuf) return nullptr;
+	DupeStream *stream = dw->stream;
+	g_autofree gchar *contents = nullptr;
 
-	gint width;
-	gint height;
-	pixbuf_scale_aspect(options->thumbnails.size.width,
-	                    options->thumbnails.size.height,
-	                    gdk_pixbuf_get_width(pixbuf),
-	                    gdk_pixbuf_get_height(pixbuf),
-	                    width, height);
+	if (!g_file_get_contents(stream->checkpoint_path.c_str(), &contents, nullptr, nullptr)) return;
 
-	if (width == gdk_pixbuf_get_width(pixbuf) && height == gdk_pixbuf_get_height(pixbuf))
-		{
-		return GDK_PIXBUF(g_object_ref(pixbuf));
-		}
+	const guint count = dw->sim_items->len;
+	if (count == 0) return;
 
-	return gdk_pixbuf_scale_simple(pixbuf, width, height, options->thumbnails.quality);
-}
+	g_auto(GStrv) lines = g_strsplit(contents, "\n", -1);
+	g_autofree gchar *header = g_strdup_printf("%s %u", DUPE_CHECKPOINT_MAGIC, dw->sim_items->len);
+	if (!lines[0] || g_strcmp0(lines[0], header) != 0) return;
 
-static void dupe_listview_set_thumb(DupeWindow *dw, DupeItem *di, GtkTreeIter *iter)
-{
-	GtkListStore *store;
-	GtkTreeIter iter_n;
+	guint done = 0;
+	guint found = 0;
 
-	store = GTK_LIST_STORE(gtk_tree_view_get_model(GTK_TREE_VIEW(dw->listview)));
-	if (!iter)
+	for (gchar **line = lines + 1; *line; line++)
 		{
-		if (dupe_listview_find_item(store, di, &iter_n) >= 0)
+		g_auto(GStrv) fields = g_strsplit(*line, " ", -1);
+		const guint n = g_strv_length(fields);
+
+		if (n == 3 && strcmp(fields[0], "done") == 0)
 			{
-			iter = &iter_n;
+			const guint first = strtoul(fields[1], nullptr, 10);
+			const guint last = std::min<guint>(strtoul(fields[2], nullptr, 10), count - 1);
+
+			for (guint i = first; i <= last; i++)
+				{
+				stream->done[i] = TRUE;
+				done++;
+				}
+			}
+		else if (n == 5 && strcmp(fields[0], "match") == 0)
+			{
+			const guint a = strtoul(fields[1], nullptr, 10);
+			const guint b = strtoul(fields[2], nullptr, 10);
+			if (a >= count || b >= count || !stream->done[b]) continue;
+
+			auto *dsm = g_new0(DupeSearchMatch, 1);
+			dsm->a = static_cast<DupeItem *>(g_ptr_array_index(dw->sim_items, a));
+			dsm->b = static_cast<DupeItem *>(g_ptr_array_index(dw->sim_items, b));
+			dsm->rank = g_ascii_strtod(fields[3], nullptr);
+			dsm->index = atoi(fields[4]);
+
+			dupe_stream_add(stream, dsm);
+			stream->found = g_list_prepend(stream->found, dsm);
+			found++;
 			}
 		}
 
-	if (iter)
-		{
-		g_autoptr(GdkPixbuf) thumb = dupe_scale_thumb(di->pixbuf);
-		gtk_list_store_set(store, iter, DUPE_COLUMN_THUMB, thumb, -1);
-		}
+	DEBUG_1("Duplicates: resuming from %s, %u of %u needles done, %u matches", stream->checkpoint_path.c_str(), done, count, found);
 }
 
-static void dupe_thumb_do(DupeWindow *dw)
+/**
+ * @brief Writes the needles done and the matches found to the checkpoint file
+ *
+ * Matches of needles that were cut short are left out, those needles
+ * are compared again on resume.
+ */
+static void dupe_stream_save(DupeWindow *dw)
 {
-	DupeItem *di;
+	DupeStream *stream = dw->stream;
 
-	if (!dw->thumb_loader || !dw->thumb_item) return;
-	di = dw->thumb_item;
+	if (stream->checkpoint_path.empty() ||
+	    std::find(stream->done.cbegin(), stream->done.cend(), TRUE) == stream->done.cend()) return;
+
+	g_autoptr(GString) out = g_string_new(nullptr);
+	g_string_append_printf(out, "%s %u\n", DUPE_CHECKPOINT_MAGIC, dw->sim_items->len);
+
+	const guint count = stream->done.size();
+	for (guint i = 0; i < count; i++)
+		{
+		if (!stream->done[i]) continue;
+
+		const guint first = i;
+		while (i + 1 < count && stream->done[i + 1]) i++;
+		g_string_append_printf(out, "done %u %u\n", first, i);
+		}
+
+	for (GList *work = stream->found; work; work = work->next)
+		{
+		auto *dsm = static_cast<DupeSearchMatch *>(work->data);
+		if (!stream->done[dsm->b->sim_index]) continue;
+
+		gchar rank[G_ASCII_DTOSTR_BUF_SIZE];
+		g_ascii_formatd(rank, sizeof(rank), "%.6f", dsm->rank);
+		g_string_append_printf(out, "match %u %u %s %d\n", dsm->a->sim_index, dsm->b->sim_index, rank, dsm->index);
+		}
+
+	if (!recursive_mkdir_if_not_exists(get_duplicates_cache_dir(), 0755) ||
+	    !g_file_set_contents(stream->checkpoint_path.c_str(), out->str, out->len, nullptr))
+		{
+		log_printf("Duplicates: failed to write checkpoint %s\n", stream->checkpoint_path.c_str());
+		}
+}
+
+/**
+ * @brief Starts grouping the matches of the items in \a dw->sim_store
+ *
+ * If a checkpoint of the same search exists, the needles it has done
+ * are skipped and its matches are shown at once.
+ */
+static void dupe_stream_new(DupeWindow *dw)
+{
+	auto *stream = new DupeStream();
+	const guint count = dw->sim_items->len;
+
+	stream->groups.reset(count);
+	stream->rank.assign(count, 0.0);
+	stream->done.assign(count, FALSE);
+	stream->rows.assign(count, {});
+	stream->save_time = g_get_monotonic_time();
+
+	dw->stream = stream;
+
+	if (options->thumbnails.enable_caching)
+		{
+		stream->checkpoint_path = dupe_stream_checkpoint_path(dw);
+		dupe_stream_load(dw);
+		}
+}
+
+static void dupe_stream_free(DupeWindow *dw)
+{
+	if (!dw->stream) return;
+
+	g_list_free_full(dw->stream->found, g_free);
+	delete dw->stream;
+	dw->stream = nullptr;
+}
+
+/**
+ * @brief Moves the matches and completed needles returned by the threads into \a dw->stream
+ */
+static void dupe_stream_drain(DupeWindow *dw)
+{
+	DupeStream *stream = dw->stream;
+	std::vector<guint> done_new;
+
+	g_mutex_lock(&dw->search_matches_mutex);
+	GList *matches = dw->search_matches;
+	dw->search_matches = nullptr;
+	std::swap(done_new, stream->done_new);
+	g_mutex_unlock(&dw->search_matches_mutex);
+
+	for (guint needle : done_new)
+		{
+		stream->done[needle] = TRUE;
+		}
+
+	for (GList *work = matches; work; work = work->next)
+		{
+		dupe_stream_add(stream, static_cast<DupeSearchMatch *>(work->data));
+		}
+
+	stream->found = g_list_concat(matches, stream->found);
+}
+
+/**
+ * @brief Shows the groups found so far, in store order
+ *
+ * Each group is headed by its first item. The rank of the other items is
+ * the best match found for them yet, the final ranking replaces this list
+ * when all comparisons are complete.
+ *
+ * The list is updated in place: rows of items that left their group are
+ * removed, new rows are inserted, and rows are moved and changed only
+ * where they differ. If the user sorted the list by a column, rows stay
+ * where the sort puts them.
+ */
+static void dupe_stream_show(DupeWindow *dw)
+{
+	DupeStream *stream = dw->stream;
+	std::vector<guint> roots;
+	std::unordered_map<guint, std::vector<guint>> members;
+
+	for (guint i = 0; i < stream->rank.size(); i++)
+		{
+		if (stream->rank[i] <= 0.0 || !g_ptr_array_index(dw->sim_items, i)) continue;
+
+		const guint root = stream->groups.find(i);
+		std::vector<guint> &group = members[root];
+		if (group.empty()) roots.push_back(root);
+		group.push_back(i);
+		}
+
+	std::vector<const std::vector<guint> *> groups;
+	std::vector<guint> parent(stream->rows.size(), G_MAXUINT);
+	for (guint root : roots)
+		{
+		const std::vector<guint> &group = members[root];
+		if (group.size() < 2) continue;
+
+		groups.push_back(&group);
+		for (guint i : group) parent[i] = group.front();
+		}
+
+	GtkListStore *store = GTK_LIST_STORE(gtk_tree_view_get_model(GTK_TREE_VIEW(dw->listview)));
+	GtkTreeModel *model = GTK_TREE_MODEL(store);
+
+	if (!stream->list_reset)
+		{
+		gtk_list_store_clear(store);
+		stream->list_reset = TRUE;
+		}
+
+	/* re-parented items are inserted again, the rank column of a head differs */
+	for (guint i = 0; i < stream->rows.size(); i++)
+		{
+		DupeStreamRow &row = stream->rows[i];
+		if (!row.shown || row.parent == parent[i]) continue;
+
+		gtk_list_store_remove(store, &row.iter);
+		row.shown = FALSE;
+		}
+
+	gint sort_column_id;
+	GtkSortType sort_order;
+	const gboolean sorted = gtk_tree_sortable_get_sort_column_id(GTK_TREE_SORTABLE(store), &sort_column_id, &sort_order);
+
+	/* the top group has the highest set number, as when rows are inserted at the top */
+	const gint set_count = groups.size();
+	dw->set_count = std::max(set_count - 1, 0);
+
+	GtkTreeIter prev;
+	gint position = 0;
+	for (gint k = 0; k < set_count; k++)
+		{
+		const gint set = set_count - 1 - k;
+
+		for (guint i : *groups[k])
+			{
+			DupeStreamRow &row = stream->rows[i];
+			auto *di = static_cast<DupeItem *>(g_ptr_array_index(dw->sim_items, i));
+			const gboolean head = (i == parent[i]);
+			const gint rank = head ? 0 : static_cast<gint>(floor(stream->rank[i]));
+
+			if (!row.shown)
+				{
+				gtk_list_store_insert(store, &row.iter, position);
+				dupe_listview_set_row(dw, store, &row.iter, di, head, rank, set % 2, set);
+				row = {row.iter, TRUE, parent[i], rank, set};
+				}
+			else
+				{
+				if (!sorted)
+					{
+					/* list store iters compare equal by their user_data */
+					GtkTreeIter expected;
+					gboolean valid;
+					if (position == 0)
+						{
+						valid = gtk_tree_model_get_iter_first(model, &expected);
+						}
+					else
+						{
+						expected = prev;
+						valid = gtk_tree_model_iter_next(model, &expected);
+						}
+
+					if (!valid || expected.user_data != row.iter.user_data)
+						{
+						gtk_list_store_move_after(store, &row.iter, position == 0 ? nullptr : &prev);
+						}
+					}
+
+				if (row.rank != rank || row.set != set)
+					{
+					dupe_listview_set_row(dw, store, &row.iter, di, head, rank, set % 2, set);
+					row.rank = rank;
+					row.set = set;
+					}
+				}
+
+			prev = row.iter;
+			position++;
+			}
+		}
+}
+
+/**
+ * @brief Called while comparing, shows new groups and writes the checkpoint from time to time
+ *
+ * The list is updated at most once per DUPE_STREAM_SHOW_INTERVAL, and less
+ * often if updating it takes long.
+ */
+static void dupe_stream_update(DupeWindow *dw)
+{
+	DupeStream *stream = dw->stream;
+	if (!stream) return;
+
+	dupe_stream_drain(dw);
+
+	const gint64 now = g_get_monotonic_time();
+
+	if (!dw->headless && stream->changed && now - stream->show_time >= stream->show_interval)
+		{
+		dupe_stream_show(dw);
+		stream->changed = FALSE;
+		stream->show_time = g_get_monotonic_time();
+		stream->show_interval = std::max(DUPE_STREAM_SHOW_INTERVAL, 10 * (stream->show_time - now));
+		}
+
+	if (now - stream->save_time >= DUPE_CHECKPOINT_INTERVAL)
+		{
+		dupe_stream_save(dw);
+		stream->save_time = g_get_monotonic_time();
+		}
+}
+
+/**
+ * @brief Called when the comparison is interrupted, so that it can be resumed
+ */
+static void dupe_stream_stop(DupeWindow *dw)
+{
+	if (!dw->stream) return;
+
+	dupe_stream_drain(dw);
+	dupe_stream_save(dw);
+	dupe_stream_free(dw);
+}
+
+/**
+ * @brief Called when all comparisons are complete
+ *
+ * Hands all matches back to \a dw->search_matches for linking, and
+ * removes the checkpoint.
+ */
+static void dupe_stream_finish(DupeWindow *dw)
+{
+	DupeStream *stream = dw->stream;
+	if (!stream) return;
+
+	dupe_stream_drain(dw);
+
+	dw->search_matches = stream->found;
+	stream->found = nullptr;
+
+	if (!stream->checkpoint_path.empty()) unlink_file(stream->checkpoint_path.c_str());
+
+	dupe_stream_free(dw);
+}
+
+/**
+ * @brief Forgets the matches of an item that is removed while comparing
+ */
+static void dupe_stream_remove(DupeWindow *dw, DupeItem *di)
+{
+	DupeStream *stream = dw->stream;
+	if (!stream) return;
+
+	dupe_stream_drain(dw);
+
+	GList *work = stream->found;
+	while (work)
+		{
+		auto *dsm = static_cast<DupeSearchMatch *>(work->data);
+		GList *next = work->next;
+
+		if (dsm->a == di || dsm->b == di)
+			{
+			stream->found = g_list_delete_link(stream->found, work);
+			g_free(dsm);
+			}
+		work = next;
+		}
+
+	stream->rank[di->sim_index] = 0.0;
+	stream->changed = TRUE;
+
+	/* before dupe_listview_remove() looks for it */
+	DupeStreamRow &row = stream->rows[di->sim_index];
+	if (row.shown)
+		{
+		gtk_list_store_remove(GTK_LIST_STORE(gtk_tree_view_get_model(GTK_TREE_VIEW(dw->listview))), &row.iter);
+		row.shown = FALSE;
+		}
+}
+
+/**
+ * @brief Look for similarity match
+ * @param dw
+ *
+ * Only used for similarity checks.\n
+ * Called from dupe_check_cb.
+ * Takes up to #DUPE_SIM_BLOCK_SIZE needles from \a dw->working, stepping
+ * back through the list, and pushes them as one #DupeQueueItem onto
+ * thread pool queue. Needles done before an interrupted search are skipped.
+ */
+static void dupe_list_check_match(DupeWindow *dw)
+{
+	auto *dqi = new DupeQueueItem();
+	dqi->dw = dw;
+	dqi->index = dw->queue_count;
+	gint skipped = 0;
+
+	while (dw->working && dqi->needles.size() < DUPE_SIM_BLOCK_SIZE)
+		{
+		const guint needle = static_cast<DupeItem *>(dw->working->data)->sim_index;
+
+		if (dw->stream->done[needle])
+			{
+			/* done before the checkpoint, the block is cut so that match indices stay the same */
+			if (!dqi->needles.empty()) break;
+
+			skipped++;
+			dqi->index++;
+			}
+		else
+			{
+			dqi->needles.push_back(needle);
+			}
+
+		dw->working = dw->working->prev; /* Is NULL when complete */
+		dw->setup_n++;
+		dw->queue_count++;
+		}
+
+	if (skipped > 0)
+		{
+		g_mutex_lock(&dw->thread_count_mutex);
+		dw->thread_count += skipped;
+		g_mutex_unlock(&dw->thread_count_mutex);
+		}
+
+	if (dqi->needles.empty())
+		{
+		delete dqi;
+		return;
+		}
+
+	g_thread_pool_push(dw->dupe_comparison_thread_pool, dqi, nullptr);
+}
+
+static void dupe_sim_store_free(DupeWindow *dw)
+{
+	if (dw->sim_store && dw->sim_items)
+		{
+		const gint64 n = dw->sim_second_start;
+		const gint64 pairs = dw->second_set ? n * (dw->sim_items->len - n) : n * (n - 1) / 2;
+
+		DEBUG_1("Duplicates: %s similarity search compared %" G_GINT64_FORMAT " of %" G_GINT64_FORMAT " pairs (%.2f%%), %" G_GINT64_FORMAT " matches",
+		        dw->sim_store->index_built() ? "indexed" : "exhaustive",
+		        dw->sim_pairs_compared, pairs, pairs > 0 ? 100.0 * dw->sim_pairs_compared / pairs : 0.0,
+		        dw->sim_pairs_matched);
+
+		if (dw->sim_store->prefilter_enabled())
+			{
+			DEBUG_1("Duplicates: similarity prefilter rejected %" G_GINT64_FORMAT " of %" G_GINT64_FORMAT " compares (%.2f%%)",
+			        dw->sim_pairs_prefiltered, dw->sim_pairs_compared,
+			        dw->sim_pairs_compared > 0 ? 100.0 * dw->sim_pairs_prefiltered / dw->sim_pairs_compared : 0.0);
+			}
+		}
+
+	dupe_stream_free(dw);
+
+	delete dw->sim_store;
+	dw->sim_store = nullptr;
+
+	if (dw->sim_items)
+		{
+		g_ptr_array_free(dw->sim_items, TRUE);
+		dw->sim_items = nullptr;
+		}
+}
+
+/**
+ * @brief Packs the similarity data of set 1 (and set 2) into \a dw->sim_store
+ * @param dw
+ *
+ * Set 1 is stored in list order, followed by set 2, so that the comparison
+ * threads walk the store sequentially.
+ */
+static void dupe_sim_store_build(DupeWindow *dw)
+{
+	const auto append_list = [dw](GList *list)
+	{
+		for (GList *work = list; work; work = work->next)
+			{
+			auto *di = static_cast<DupeItem *>(work->data);
+
+			di->sim_index = dw->sim_store->append(di->simd.get());
+			g_ptr_array_add(dw->sim_items, di);
+			}
+	};
+
+	dupe_sim_store_free(dw);
+
+	dw->sim_store = new ImageSimilarityStore(options->duplicates_sim_prefilter);
+	dw->sim_store->reserve(g_list_length(dw->list) + (dw->second_set ? g_list_length(dw->second_list) : 0));
+	dw->sim_items = g_ptr_array_new();
+
+	append_list(dw->list);
+	dw->sim_second_start = dw->sim_items->len;
+	if (dw->second_set) append_list(dw->second_list);
+
+	if (!options->duplicates_sim_exhaustive)
+		{
+		/* needles are from set 1, candidates from set 2 if there is one */
+		if (dw->second_set)
+			{
+			dw->sim_store->index_build(dw->sim_second_start, dw->sim_items->len);
+			}
+		else
+			{
+			dw->sim_store->index_build(0, dw->sim_second_start);
+			}
+		}
+
+	dw->sim_pairs_compared = 0;
+	dw->sim_pairs_matched = 0;
+	dw->sim_pairs_prefiltered = 0;
+
+	dupe_stream_new(dw);
+
+	DEBUG_1("Duplicates: %u similarity signatures packed in %" G_GSIZE_FORMAT " KiB, %s kernel, %s%s", dw->sim_items->len,
+	        dw->sim_store->memory_size() / 1024, image_sim_sad_implementation(),
+	        dw->sim_store->index_built() ? "indexed" : "exhaustive", dw->sim_store->prefilter_enabled() ? ", prefiltered" : "");
+}
+
+/*
+ * ------------------------------------------------------------------
+ * Thumbnail handling
+ * ------------------------------------------------------------------
+ */
+
+static GdkPixbuf *dupe_scale_thumb(GdkPixbuf *pixbuf)
+{
+	if (!pixbuf) return nullptr;
+
+	gint width;
+	gint height;
+	pixbuf_scale_aspect(options->thumbnails.size.width,
+	                    options->thumbnails.size.height,
+	                    gdk_pixbuf_get_width(pixbuf),
+	                    gdk_pixbuf_get_height(pixbuf),
+	                    width, height);
+
+	if (width == gdk_pixbuf_get_width(pixbuf) && height == gdk_pixbuf_get_height(pixbuf))
+		{
+		return GDK_PIXBUF(g_object_ref(pixbuf));
+		}
+
+	return gdk_pixbuf_scale_simple(pixbuf, width, height, options->thumbnails.quality);
+}
+
+static void dupe_listview_set_thumb(DupeWindow *dw, DupeItem *di, GtkTreeIter *iter)
+{
+	GtkListStore *store;
+	GtkTreeIter iter_n;
+
+	store = GTK_LIST_STORE(gtk_tree_view_get_model(GTK_TREE_VIEW(dw->listview)));
+	if (!iter)
+		{
+		if (dupe_listview_find_item(store, di, &iter_n) >= 0)
+			{
+			iter = &iter_n;
+			}
+		}
+
+	if (iter)
+		{
+		g_autoptr(GdkPixbuf) thumb = dupe_scale_thumb(di->pixbuf);
+		gtk_list_store_set(store, iter, DUPE_COLUMN_THUMB, thumb, -1);
+		}
+}
+
+static void dupe_thumb_do(DupeWindow *dw)
+{
+	DupeItem *di;
+
+	if (!dw->thumb_loader || !dw->thumb_item) return;
+	di = dw->thumb_item;
 
 	if (di->pixbuf) g_object_unref(di->pixbuf);
 	di->pixbuf = thumb_loader_get_pixbuf(dw->thumb_loader);
@@ -1951,14 +2656,21 @@ static void dupe_check_stop(DupeWindow *dw)
 
 	dw->abort = TRUE;
 
+	dupe_read_job_free(dw);
+
 	while (dw->thread_count < dw->queue_count) // Wait for the queue to empty
 		{
 		dupe_window_update_progress(dw, nullptr, 0.0, FALSE);
 		gtk_widget_set_cursor_from_name(dw->listview, nullptr);
 		}
 
-	g_list_free(dw->search_matches);
+	dupe_stream_stop(dw);
+
+	g_list_free_full(dw->search_matches, g_free);
 	dw->search_matches = nullptr;
+	dw->search_matches_sorted = nullptr;
+
+	dupe_sim_store_free(dw);
 
 	if (dw->idle_id || dw->img_loader || dw->thumb_loader)
 		{
@@ -1969,86 +2681,511 @@ static void dupe_check_stop(DupeWindow *dw)
 
 	if (dw->add_files_queue_id)
 		{
-		g_clear_handle_id(&dw->add_files_queue_id, g_source_remove);
-		dupe_destroy_list_cache(dw);
-		gtk_widget_set_sensitive(dw->controls_box, TRUE);
-		if (g_list_length(dw->add_files_queue) > 0)
+		g_clear_handle_id(&dw->add_files_queue_id, g_source_remove);
+		dupe_destroy_list_cache(dw);
+		gtk_widget_set_sensitive(dw->controls_box, TRUE);
+		if (g_list_length(dw->add_files_queue) > 0)
+			{
+			file_data_list_free(dw->add_files_queue);
+			}
+		dw->add_files_queue = nullptr;
+		dupe_window_update_progress(dw, nullptr, 0.0, FALSE);
+		gtk_widget_set_cursor_from_name(dw->listview, nullptr);
+		}
+
+	thumb_loader_free(dw->thumb_loader);
+	dw->thumb_loader = nullptr;
+
+	image_loader_free(dw->img_loader);
+	dw->img_loader = nullptr;
+}
+
+static void dupe_check_stop_cb(GtkWidget *, gpointer data)
+{
+	auto dw = static_cast<DupeWindow *>(data);
+
+	dupe_check_stop(dw);
+}
+
+static void dupe_loader_done_cb(ImageLoader *il, gpointer data)
+{
+	auto dw = static_cast<DupeWindow *>(data);
+	GdkPixbuf *pixbuf;
+
+	pixbuf = image_loader_get_pixbuf(il);
+
+	if (dw->setup_point)
+		{
+		auto di = static_cast<DupeItem *>(dw->setup_point->data);
+
+		if (!di->simd)
+			{
+			di->simd = std::make_unique<ImageSimilarityData>();
+			}
+
+		di->simd->fill_data(pixbuf);
+
+		if (di->dimensions.empty() && pixbuf)
+			{
+			di->dimensions.width = gdk_pixbuf_get_width(pixbuf);
+			di->dimensions.height = gdk_pixbuf_get_height(pixbuf);
+			}
+		if (options->thumbnails.enable_caching)
+			{
+			dupe_item_write_cache(di);
+			}
+
+		di->simd->alternate_processing();
+		}
+
+	image_loader_free(dw->img_loader);
+	dw->img_loader = nullptr;
+
+	dw->idle_id = g_idle_add(dupe_check_cb, dw);
+}
+
+static void dupe_setup_reset(DupeWindow *dw)
+{
+	dw->setup_point = nullptr;
+	dw->setup_n = 0;
+	dw->setup_time = msec_time();
+	dw->setup_time_count = 0;
+}
+
+static GList *dupe_setup_point_step(DupeWindow *dw, GList *p)
+{
+	if (!p) return nullptr;
+
+	if (p->next) return p->next;
+
+	if (dw->second_set && g_list_first(p) == dw->list) return dw->second_list;
+
+	return nullptr;
+}
+
+/*
+ * ------------------------------------------------------------------
+ * Checksums and dimensions, read on threads
+ * ------------------------------------------------------------------
+ */
+
+/*
+ * Files with equal content are found in three steps, each on fewer files:
+ * - files with a size no other file has are unique;
+ * - of the remaining files, the first and last DUPE_SUM_PARTIAL_SIZE bytes
+ *   are hashed, and files with a unique partial checksum are unique too;
+ * - only the files left are read in full.
+ *
+ * Dimensions are read from the file headers, and the few files the probe
+ * does not know are left to the image loader on the main thread.
+ *
+ * The files are read on dw->read_thread_pool, which also adds what was read
+ * to the cache of each file. The result is applied to the DupeItems on the
+ * main thread when all of them are done.
+ */
+
+namespace
+{
+
+constexpr gsize DUPE_SUM_PARTIAL_SIZE = 65536;
+
+enum class DupeReadStage {
+	SUM_PARTIAL,
+	SUM_FULL,
+	DIMENSIONS
+};
+
+} // namespace
+
+struct DupeReadEntry
+{
+	DupeReadJob *job;
+	DupeItem *di;                     /**< NULL once the item is removed, not read by the worker */
+	FileData *fd;                     /**< ref held by the job, the worker reads only this */
+	std::optional<Md5Digest> partial;
+	std::optional<Md5Digest> full;
+	GqSize dimensions;
+	gboolean cached;                  /**< full checksum or dimensions read from the cache */
+	gint cancel;                      /**< set to abandon the entry, atomic */
+};
+
+struct DupeReadJob
+{
+	std::vector<DupeReadEntry> entries;
+	std::unordered_set<gint64> full_sizes; /**< sizes for which a full checksum is known */
+	DupeReadStage stage;
+	GMutex mutex;                     /**< guards pending and signals cond */
+	GCond cond;                       /**< signalled when pending drops to 0 */
+	gint pending = 0;                 /**< entries queued or being read */
+	gint done = 0;                    /**< entries read in this stage, atomic */
+	gint total = 0;                   /**< entries queued in this stage */
+};
+
+static void dupe_read_sum(DupeReadEntry *entry)
+{
+	DupeReadJob *job = entry->job;
+	g_autofree gchar *path = path_from_utf8(entry->fd->path);
+	Md5Digest digest;
+
+	if (job->stage == DupeReadStage::SUM_FULL)
+		{
+		if (md5_get_digest_from_file(path, digest, &entry->cancel)) entry->full = digest;
+		return;
+		}
+
+	if (options->thumbnails.enable_caching)
+		{
+		CacheData cd{};
+		if (cd.load(entry->fd->path) && cd.md5sum)
+			{
+			entry->full = cd.md5sum;
+			entry->cached = TRUE;
+			return;
+			}
+		}
+
+	if (entry->fd->size <= static_cast<gint64>(2 * DUPE_SUM_PARTIAL_SIZE))
+		{
+		/* the partial checksum would read the whole file anyway */
+		if (md5_get_digest_from_file(path, digest, &entry->cancel)) entry->full = digest;
+		}
+	else if (md5_get_partial_digest_from_file(path, DUPE_SUM_PARTIAL_SIZE, digest))
+		{
+		entry->partial = digest;
+		}
+}
+
+static void dupe_read_dimensions(DupeReadEntry *entry)
+{
+	if (options->thumbnails.enable_caching)
+		{
+		CacheData cd{};
+		if (cd.load(entry->fd->path) && cd.dimensions)
+			{
+			entry->dimensions = *cd.dimensions;
+			entry->cached = TRUE;
+			return;
+			}
+		}
+
+	image_probe_dimensions(entry->fd->path, entry->dimensions);
+}
+
+/**
+ * @brief Adds the full checksum or dimensions read to the cache of the file, keeping its other data
+ */
+static void dupe_read_cache_update(DupeReadEntry *entry)
+{
+	if (entry->cached || !options->thumbnails.enable_caching) return;
+	if (!entry->full && entry->dimensions.empty()) return;
+
+	CacheData cd{};
+	cd.load(entry->fd->path);
+
+	if (entry->full) cd.set_md5sum(*entry->full);
+	if (!entry->dimensions.empty()) cd.set_dimensions(entry->dimensions);
+
+	cd.save(entry->fd->path);
+}
+
+static void dupe_read_func(gpointer data, gpointer)
+{
+	auto entry = static_cast<DupeReadEntry *>(data);
+	DupeReadJob *job = entry->job;
+
+	if (!g_atomic_int_get(&entry->cancel))
+		{
+		if (job->stage == DupeReadStage::DIMENSIONS)
+			{
+			dupe_read_dimensions(entry);
+			}
+		else
+			{
+			dupe_read_sum(entry);
+			}
+
+		if (!g_atomic_int_get(&entry->cancel)) dupe_read_cache_update(entry);
+		}
+
+	g_atomic_int_inc(&job->done);
+
+	g_mutex_lock(&job->mutex);
+	if (--job->pending == 0) g_cond_signal(&job->cond);
+	g_mutex_unlock(&job->mutex);
+}
+
+static DupeReadJob *dupe_read_job_new(DupeWindow *dw, DupeReadStage stage)
+{
+	/* the workers may read the similarity database, open it here */
+	if (options->thumbnails.enable_caching) cache_sim_db_get();
+
+	auto job = new DupeReadJob();
+	job->stage = stage;
+	g_mutex_init(&job->mutex);
+	g_cond_init(&job->cond);
+
+	dw->read_job = job;
+
+	return job;
+}
+
+static void dupe_read_job_add(DupeReadJob *job, DupeItem *di)
+{
+	job->entries.push_back({job, di, file_data_ref(di->fd), {}, {}, {0, 0}, FALSE, FALSE});
+}
+
+static void dupe_read_job_queue(DupeWindow *dw, DupeReadEntry *entry)
+{
+	DupeReadJob *job = entry->job;
+
+	g_mutex_lock(&job->mutex);
+	job->pending++;
+	g_mutex_unlock(&job->mutex);
+	job->total++;
+
+	g_thread_pool_push(dw->read_thread_pool, entry, nullptr);
+}
+
+static void dupe_read_job_queue_all(DupeWindow *dw)
+{
+	for (DupeReadEntry &entry : dw->read_job->entries)
+		{
+		dupe_read_job_queue(dw, &entry);
+		}
+}
+
+/**
+ * @brief Abandons the files being read
+ *
+ * Waits for the files being read, which stop at the next buffer.
+ */
+static void dupe_read_job_free(DupeWindow *dw)
+{
+	DupeReadJob *job = dw->read_job;
+	if (!job) return;
+
+	for (DupeReadEntry &entry : job->entries)
+		{
+		g_atomic_int_set(&entry.cancel, TRUE);
+		}
+
+	g_mutex_lock(&job->mutex);
+	while (job->pending > 0)
+		{
+		g_cond_wait(&job->cond, &job->mutex);
+		}
+	g_mutex_unlock(&job->mutex);
+
+	for (DupeReadEntry &entry : job->entries)
+		{
+		file_data_unref(entry.fd);
+		}
+
+	g_cond_clear(&job->cond);
+	g_mutex_clear(&job->mutex);
+	delete job;
+	dw->read_job = nullptr;
+}
+
+/**
+ * @brief Abandons the file of a removed item, the others are still read
+ */
+static void dupe_read_job_remove(DupeWindow *dw, DupeItem *di)
+{
+	for (DupeReadEntry &entry : dw->read_job->entries)
+		{
+		if (entry.di != di) continue;
+
+		g_atomic_int_set(&entry.cancel, TRUE);
+		entry.di = nullptr;
+		}
+}
+
+/**
+ * @brief Shows the progress of the job
+ * @returns TRUE while files are being read
+ */
+static gboolean dupe_read_job_pending(DupeWindow *dw, const gchar *status)
+{
+	DupeReadJob *job = dw->read_job;
+
+	g_mutex_lock(&job->mutex);
+	const gint pending = job->pending;
+	g_mutex_unlock(&job->mutex);
+
+	if (pending == 0) return FALSE;
+
+	const gdouble value = job->total == 0 ? 0.0 : static_cast<gdouble>(g_atomic_int_get(&job->done)) / job->total;
+	dupe_window_update_progress(dw, status, value, FALSE);
+
+	return TRUE;
+}
+
+/**
+ * @brief Groups the items by size, and starts the partial checksums
+ *
+ * Items with a unique size are marked content_unique and not read at all.
+ */
+static void dupe_sum_start(DupeWindow *dw)
+{
+	std::unordered_map<gint64, std::vector<DupeItem *>> sizes;
+
+	for (GList *work = dw->list; work; work = dupe_setup_point_step(dw, work))
+		{
+		auto di = static_cast<DupeItem *>(work->data);
+		sizes[di->fd->size].push_back(di);
+		}
+
+	DupeReadJob *job = dupe_read_job_new(dw, DupeReadStage::SUM_PARTIAL);
+
+	for (const auto &[size, items] : sizes)
+		{
+		for (DupeItem *di : items)
+			{
+			if (items.size() == 1)
+				{
+				if (!di->md5sum) di->content_unique = TRUE;
+				}
+			else if (di->md5sum)
+				{
+				job->full_sizes.insert(size);
+				}
+			else
+				{
+				dupe_read_job_add(job, di);
+				}
+			}
+		}
+
+	dupe_read_job_queue_all(dw);
+}
+
+/**
+ * @brief Queues the full checksum of items not ruled out by their partial checksum
+ * @returns FALSE when there is nothing to read
+ *
+ * A file is read in full if another file of its size has the same partial
+ * checksum, or has a known full checksum.
+ */
+static gboolean dupe_sum_start_full(DupeWindow *dw)
+{
+	DupeReadJob *job = dw->read_job;
+	std::map<std::pair<gint64, Md5Digest>, gint> partials;
+
+	for (const DupeReadEntry &entry : job->entries)
+		{
+		if (!entry.di) continue;
+
+		if (entry.full) job->full_sizes.insert(entry.fd->size);
+		if (entry.partial) partials[{entry.fd->size, *entry.partial}]++;
+		}
+
+	job->stage = DupeReadStage::SUM_FULL;
+	job->done = 0;
+	job->total = 0;
+
+	for (DupeReadEntry &entry : job->entries)
+		{
+		if (!entry.di || !entry.partial) continue;
+
+		if (job->full_sizes.count(entry.fd->size) > 0 ||
+		    partials[{entry.fd->size, *entry.partial}] > 1)
 			{
-			file_data_list_free(dw->add_files_queue);
+			dupe_read_job_queue(dw, &entry);
 			}
-		dw->add_files_queue = nullptr;
-		dupe_window_update_progress(dw, nullptr, 0.0, FALSE);
-		gtk_widget_set_cursor_from_name(dw->listview, nullptr);
 		}
 
-	thumb_loader_free(dw->thumb_loader);
-	dw->thumb_loader = nullptr;
-
-	image_loader_free(dw->img_loader);
-	dw->img_loader = nullptr;
+	return job->total > 0;
 }
 
-static void dupe_check_stop_cb(GtkWidget *, gpointer data)
+static void dupe_sum_apply(DupeWindow *dw)
 {
-	auto dw = static_cast<DupeWindow *>(data);
+	for (const DupeReadEntry &entry : dw->read_job->entries)
+		{
+		DupeItem *di = entry.di;
+		if (!di) continue;
 
-	dupe_check_stop(dw);
+		if (!entry.full)
+			{
+			/* unreadable, or ruled out by the partial checksum */
+			di->content_unique = TRUE;
+			continue;
+			}
+
+		di->md5sum = entry.full;
+		}
 }
 
-static void dupe_loader_done_cb(ImageLoader *il, gpointer data)
+/**
+ * @brief Reads the checksums of set 1 and set 2
+ * @returns TRUE/FALSE = not completed/completed
+ *
+ * Re-enters while the files are read.
+ */
+static gboolean dupe_sum_check(DupeWindow *dw)
 {
-	auto dw = static_cast<DupeWindow *>(data);
-	GdkPixbuf *pixbuf;
+	if (!dw->read_job)
+		{
+		dupe_sum_start(dw);
+		}
 
-	pixbuf = image_loader_get_pixbuf(il);
+	DupeReadJob *job = dw->read_job;
 
-	if (dw->setup_point)
+	if (dupe_read_job_pending(dw, job->stage == DupeReadStage::SUM_PARTIAL ? _("Reading checksums…") : _("Reading files…")))
 		{
-		auto di = static_cast<DupeItem *>(dw->setup_point->data);
+		return TRUE;
+		}
 
-		if (!di->simd)
-			{
-			di->simd = std::make_unique<ImageSimilarityData>();
-			}
+	if (job->stage == DupeReadStage::SUM_PARTIAL && dupe_sum_start_full(dw))
+		{
+		return TRUE;
+		}
 
-		di->simd->fill_data(pixbuf);
+	DEBUG_1("duplicates: %u files, %u read in full", static_cast<guint>(job->entries.size()), static_cast<guint>(job->total));
 
-		if (di->dimensions.empty() && pixbuf)
-			{
-			di->dimensions.width = gdk_pixbuf_get_width(pixbuf);
-			di->dimensions.height = gdk_pixbuf_get_height(pixbuf);
-			}
-		if (options->thumbnails.enable_caching)
+	dupe_sum_apply(dw);
+	dupe_read_job_free(dw);
+
+	return FALSE;
+}
+
+/**
+ * @brief Reads the dimensions of set 1 and set 2 from the cache or the file headers
+ * @returns TRUE/FALSE = not completed/completed
+ *
+ * Re-enters while the files are read. Items left without dimensions are
+ * for the image loader.
+ */
+static gboolean dupe_dimensions_check(DupeWindow *dw)
+{
+	if (!dw->read_job)
+		{
+		DupeReadJob *job = dupe_read_job_new(dw, DupeReadStage::DIMENSIONS);
+
+		for (GList *work = dw->list; work; work = dupe_setup_point_step(dw, work))
 			{
-			dupe_item_write_cache(di);
+			auto di = static_cast<DupeItem *>(work->data);
+			if (di->dimensions.empty()) dupe_read_job_add(job, di);
 			}
 
-		di->simd->alternate_processing();
+		dupe_read_job_queue_all(dw);
 		}
 
-	image_loader_free(dw->img_loader);
-	dw->img_loader = nullptr;
-
-	dw->idle_id = g_idle_add(dupe_check_cb, dw);
-}
+	if (dupe_read_job_pending(dw, _("Reading dimensions…"))) return TRUE;
 
-static void dupe_setup_reset(DupeWindow *dw)
-{
-	dw->setup_point = nullptr;
-	dw->setup_n = 0;
-	dw->setup_time = msec_time();
-	dw->setup_time_count = 0;
-}
+	for (const DupeReadEntry &entry : dw->read_job->entries)
+		{
+		DupeItem *di = entry.di;
 
-static GList *dupe_setup_point_step(DupeWindow *dw, GList *p)
-{
-	if (!p) return nullptr;
+		if (!di || entry.dimensions.empty()) continue;
 
-	if (p->next) return p->next;
+		di->dimensions = entry.dimensions;
+		di->dimensions_sum = (di->dimensions.width << 16) + di->dimensions.height;
+		}
 
-	if (dw->second_set && g_list_first(p) == dw->list) return dw->second_list;
+	dupe_read_job_free(dw);
 
-	return nullptr;
+	return FALSE;
 }
 
 /**
@@ -2066,9 +3203,17 @@ static gboolean create_checksums_dimensions(DupeWindow *dw, GList *list)
 		return (dw->setup_count == 0) ? 0.0 : static_cast<gdouble>(dw->setup_n - 1) / dw->setup_count;
 	};
 
-	if ((dw->match_mask & DUPE_MATCH_SUM) ||
-	    (dw->match_mask & DUPE_MATCH_NAME_CONTENT) ||
-	    (dw->match_mask & DUPE_MATCH_NAME_CI_CONTENT))
+	if (dw->match_mask & DUPE_MATCH_SUM)
+		{
+		/* Checksums of both sets at once, files of a unique size are not read */
+		if (!(dw->setup_mask & DUPE_MATCH_SUM))
+			{
+			if (dupe_sum_check(dw)) return TRUE;
+			dw->setup_mask = static_cast<DupeMatchType>(dw->setup_mask | DUPE_MATCH_SUM);
+			}
+		}
+	else if ((dw->match_mask & DUPE_MATCH_NAME_CONTENT) ||
+	         (dw->match_mask & DUPE_MATCH_NAME_CI_CONTENT))
 		{
 		/* MD5SUM only */
 		if (!dw->setup_point) dw->setup_point = list; // setup_point clear on 1st entry
@@ -2080,7 +3225,7 @@ static gboolean create_checksums_dimensions(DupeWindow *dw, GList *list)
 			dw->setup_point = dupe_setup_point_step(dw, dw->setup_point);
 			dw->setup_n++;
 
-			if (!di->md5sum)
+			if (!di->md5sum && !di->content_unique)
 				{
 				dupe_window_update_progress(dw, _("Reading checksums…"), setup_progress(dw), FALSE);
 
@@ -2090,8 +3235,8 @@ static gboolean create_checksums_dimensions(DupeWindow *dw, GList *list)
 					if (di->md5sum) return TRUE;
 					}
 
-				di->md5sum = md5_text_from_file_utf8(di->fd->path);
-				if (options->thumbnails.enable_caching)
+				dupe_item_read_md5sum(di);
+				if (di->md5sum && options->thumbnails.enable_caching)
 					{
 					dupe_item_write_cache(di);
 					}
@@ -2103,7 +3248,13 @@ static gboolean create_checksums_dimensions(DupeWindow *dw, GList *list)
 
 	if (dw->match_mask & DUPE_MATCH_DIM)
 		{
-		/* Dimensions only */
+		/* Dimensions of both sets from the file headers, then the rest one at a time */
+		if (!(dw->setup_mask & DUPE_MATCH_DIM))
+			{
+			if (dupe_dimensions_check(dw)) return TRUE;
+			dw->setup_mask = static_cast<DupeMatchType>(dw->setup_mask | DUPE_MATCH_DIM);
+			}
+
 		if (!dw->setup_point) dw->setup_point = list;
 
 		while (dw->setup_point)
@@ -2236,6 +3387,11 @@ static gboolean dupe_check_cb(gpointer data)
 			}
 
 		/* End of setup not done */
+		if (dw->match_mask & DUPE_MATCH_SIM)
+			{
+			dupe_sim_store_build(dw);
+			}
+
 		dupe_window_update_progress(dw, _("Comparing…"), 0.0, FALSE);
 		dw->setup_done = TRUE;
 		dupe_setup_reset(dw);
@@ -2256,13 +3412,16 @@ static gboolean dupe_check_cb(gpointer data)
 				g_autofree gchar *progress_text = g_strdup_printf("%s %d/%d", _("Comparing"), dw->thread_count, dw->queue_count);
 
 				dupe_window_update_progress(dw, progress_text, (gdouble)dw->thread_count / dw->queue_count, TRUE);
+				dupe_stream_update(dw);
 
 				return G_SOURCE_CONTINUE;
 				}
 
 			if (dw->search_matches_sorted == nullptr)
 				{
-				dw->search_matches_sorted = g_list_sort(dw->search_matches, sort_func);
+				dupe_stream_finish(dw);
+				dw->search_matches = g_list_sort(dw->search_matches, sort_func);
+				dw->search_matches_sorted = dw->search_matches;
 				dupe_setup_reset(dw);
 				}
 
@@ -2284,10 +3443,11 @@ static gboolean dupe_check_cb(gpointer data)
 					return G_SOURCE_CONTINUE;
 					}
 				}
-			g_list_free(dw->search_matches); // FIXME dw->search_matches doesn't point at the start of the list after g_list_sort() call
+			g_list_free_full(dw->search_matches, g_free);
 			dw->search_matches = nullptr;
 			dw->search_matches_sorted = nullptr;
 			dw->setup_count = 0;
+			dupe_sim_store_free(dw);
 			}
 		else
 			{
@@ -2303,6 +3463,13 @@ static gboolean dupe_check_cb(gpointer data)
 		dupe_window_update_progress(dw, nullptr, 0.0, FALSE);
 
 		dupe_match_rank(dw);
+
+		if (dw->headless)
+			{
+			dupe_headless_done(dw);
+			return G_SOURCE_REMOVE;
+			}
+
 		dupe_window_update_count(dw, FALSE);
 
 		dupe_listview_populate(dw);
@@ -2320,12 +3487,9 @@ static gboolean dupe_check_cb(gpointer data)
 	if (dw->match_mask & DUPE_MATCH_SIM)
 		{
 		/* This is the similarity comparison */
-		dupe_list_check_match(dw, static_cast<DupeItem *>(dw->working->data), dw->working);
 		dupe_window_update_progress(dw, _("Queuing…"), dw->setup_count == 0 ? 0.0 : static_cast<gdouble>(dw->setup_n) / dw->setup_count, FALSE);
-		dw->setup_n++;
-		dw->queue_count++;
-
-		dw->working = dw->working->prev; /* Is NULL when complete */
+		dupe_list_check_match(dw);
+		dupe_stream_update(dw);
 		}
 	else
 		{
@@ -2350,10 +3514,16 @@ static void dupe_check_start(DupeWindow *dw)
 	dw->setup_mask = DUPE_MATCH_NONE;
 	dupe_setup_reset(dw);
 
+	/* a file unique last time may have a match among files added since */
+	for (GList *work = dw->list; work; work = dupe_setup_point_step(dw, work))
+		{
+		static_cast<DupeItem *>(work->data)->content_unique = FALSE;
+		}
+
 	dw->working = g_list_last(dw->list);
 
 	dupe_window_update_count(dw, TRUE);
-	gtk_widget_set_cursor_from_name(dw->listview, "wait");
+	if (!dw->headless) gtk_widget_set_cursor_from_name(dw->listview, "wait");
 	dw->queue_count = 0;
 	dw->thread_count = 0;
 	dw->search_matches_sorted = nullptr;
@@ -2390,6 +3560,15 @@ static void dupe_item_remove(DupeWindow *dw, DupeItem *di)
 		{
 		dupe_thumb_step(dw);
 		}
+	if (dw->sim_items && di->sim_index < dw->sim_items->len && g_ptr_array_index(dw->sim_items, di->sim_index) == di)
+		{
+		g_ptr_array_index(dw->sim_items, di->sim_index) = nullptr;
+		dupe_stream_remove(dw, di);
+		}
+	if (dw->read_job)
+		{
+		dupe_read_job_remove(dw, di);
+		}
 	if (dw->setup_point && dw->setup_point->data == di)
 		{
 		dw->setup_point = dupe_setup_point_step(dw, dw->setup_point);
@@ -2448,6 +3627,7 @@ static void dupe_item_remove(DupeWindow *dw, DupeItem *di)
 		{
 		/* not a dupe, or not sorted yet, simply reset */
 		dupe_match_link_clear(di, TRUE);
+		dupe_listview_remove(dw, di);
 		}
 
 	if (dw->second_list && g_list_find(dw->second_list, di))
@@ -2467,7 +3647,7 @@ static gboolean dupe_files_add_queue_cb(gpointer data)
 {
 	auto *dw = static_cast<DupeWindow *>(data);
 
-	gtk_progress_bar_pulse(GTK_PROGRESS_BAR(dw->extra_label));
+	if (!dw->headless) gtk_progress_bar_pulse(GTK_PROGRESS_BAR(dw->extra_label));
 
 	if (dw->add_files_queue != nullptr)
 		{
@@ -2537,7 +3717,7 @@ static gboolean dupe_files_add_queue_cb(gpointer data)
 	dw->add_files_queue_id = 0;
 	dupe_destroy_list_cache(dw);
 	g_idle_add(dupe_check_start_cb, dw);
-	gtk_widget_set_sensitive(dw->controls_box, TRUE);
+	if (!dw->headless) gtk_widget_set_sensitive(dw->controls_box, TRUE);
 	return G_SOURCE_REMOVE;
 }
 
@@ -2726,13 +3906,16 @@ void dupe_window_add_files(DupeWindow *dw, GList *list, gboolean recurse)
 		}
 	if (dw->add_files_queue_id == 0)
 		{
-		gtk_progress_bar_pulse(GTK_PROGRESS_BAR(dw->extra_label));
-		gtk_progress_bar_set_pulse_step(GTK_PROGRESS_BAR(dw->extra_label), DUPE_PROGRESS_PULSE_STEP);
-		gtk_progress_bar_set_text(GTK_PROGRESS_BAR(dw->extra_label), _("Loading file list"));
+		if (!dw->headless)
+			{
+			gtk_progress_bar_pulse(GTK_PROGRESS_BAR(dw->extra_label));
+			gtk_progress_bar_set_pulse_step(GTK_PROGRESS_BAR(dw->extra_label), DUPE_PROGRESS_PULSE_STEP);
+			gtk_progress_bar_set_text(GTK_PROGRESS_BAR(dw->extra_label), _("Loading file list"));
+			gtk_widget_set_sensitive(dw->controls_box, FALSE);
+			}
 
 		dupe_init_list_cache(dw);
 		dw->add_files_queue_id = g_idle_add(dupe_files_add_queue_cb, dw);
-		gtk_widget_set_sensitive(dw->controls_box, FALSE);
 		}
 }
 
@@ -2864,7 +4047,7 @@ static void dupe_display_stats(DupeWindow *dw, DupeItem *di)
 	g_autofree gchar *dimensions_buf = g_strdup_printf("%d x %d", di->dimensions.width, di->dimensions.height);
 	dupe_display_label(gd->vbox, "dimensions:", dimensions_buf);
 
-	dupe_display_label(gd->vbox, "md5sum:", di->md5sum.value_or("not generated"s).c_str());
+	dupe_display_label(gd->vbox, "md5sum:", di->md5sum ? md5_digest_to_text(*di->md5sum).c_str() : "not generated");
 
 	dupe_display_label(gd->vbox, "thumbprint:", (di->simd) ? "" : "not generated");
 	if (di->simd)
@@ -3811,6 +4994,14 @@ static void dupe_window_rotation_invariant_cb(GtkWidget *widget, gpointer data)
 	dupe_window_recompare(dw);
 }
 
+static void dupe_window_sim_exhaustive_cb(GtkWidget *widget, gpointer data)
+{
+	auto dw = static_cast<DupeWindow *>(data);
+
+	options->duplicates_sim_exhaustive = gtk_check_button_get_active(GTK_CHECK_BUTTON(widget));
+	dupe_window_recompare(dw);
+}
+
 static void dupe_window_custom_threshold_cb(GtkSpinButton *custom_threshold, gpointer data)
 {
 	auto dw = static_cast<DupeWindow *>(data);
@@ -3857,6 +5048,22 @@ static void dupe_window_get_geometry(DupeWindow *dw)
 	lw->options.dupe_window.vdivider_pos = gtk_paned_get_position(GTK_PANED(dw->paned));
 }
 
+/**
+ * @brief Frees the items and threads of a search that is stopped or done, and \a dw
+ */
+static void dupe_window_free(DupeWindow *dw)
+{
+	g_list_free(dw->dupes);
+	g_list_free_full(dw->list, reinterpret_cast<GDestroyNotify>(dupe_item_free));
+
+	g_list_free_full(dw->second_list, reinterpret_cast<GDestroyNotify>(dupe_item_free));
+
+	g_thread_pool_free(dw->dupe_comparison_thread_pool, TRUE, TRUE);
+	g_thread_pool_free(dw->read_thread_pool, TRUE, TRUE);
+
+	g_free(dw);
+}
+
 void dupe_window_close(DupeWindow *dw)
 {
 	dupe_check_stop(dw);
@@ -3867,16 +5074,9 @@ void dupe_window_close(DupeWindow *dw)
 	g_object_set_data(G_OBJECT(dw->window), DUPE_WINDOW_DATA_KEY, nullptr);
 	gtk_window_destroy(GTK_WINDOW(dw->window));
 
-	g_list_free(dw->dupes);
-	g_list_free_full(dw->list, reinterpret_cast<GDestroyNotify>(dupe_item_free));
-
-	g_list_free_full(dw->second_list, reinterpret_cast<GDestroyNotify>(dupe_item_free));
-
 	file_data_unregister_notify_func(dupe_notify_cb, dw);
 
-	g_thread_pool_free(dw->dupe_comparison_thread_pool, TRUE, TRUE);
-
-	g_free(dw);
+	dupe_window_free(dw);
 }
 
 static void dupe_window_close_cb(GSimpleAction *, GVariant *, gpointer data)
@@ -4166,6 +5366,15 @@ static void dupe_pop_menu_export_cb(GSimpleAction *, GVariant *, gpointer data)
 #include "dupe-actions.inc"
 
 /* collection and files can be NULL */
+static void dupe_window_threads_init(DupeWindow *dw, gint threads)
+{
+	g_mutex_init(&dw->thread_count_mutex);
+	g_mutex_init(&dw->search_matches_mutex);
+	dw->dupe_comparison_thread_pool = g_thread_pool_new(dupe_comparison_func, dw, threads, FALSE, nullptr);
+	/* reading files, so no more threads than cores even when the comparison is unlimited */
+	dw->read_thread_pool = g_thread_pool_new(dupe_read_func, dw, threads > 0 ? threads : get_cpu_cores(), FALSE, nullptr);
+}
+
 DupeWindow *dupe_window_new()
 {
 	DupeWindow *dw;
@@ -4423,6 +5632,21 @@ DupeWindow *dupe_window_new()
 		}
 	gtk_box_append(GTK_BOX(controls_box), dw->button_rotation_invariant);
 
+	button = gtk_check_button_new_with_label(_("Exhaustive"));
+	gtk_widget_set_tooltip_text(button, _("Compare every pair of images for similarity,\ninstead of only the candidates found by the similarity index"));
+	gtk_check_button_set_active(GTK_CHECK_BUTTON(button), options->duplicates_sim_exhaustive);
+	g_signal_connect(G_OBJECT(button), "toggled",
+			 G_CALLBACK(dupe_window_sim_exhaustive_cb), dw);
+	if (gtk_orientable_get_orientation(GTK_ORIENTABLE(GTK_BOX(controls_box))) == GTK_ORIENTATION_HORIZONTAL)
+		{
+		gtk_widget_set_margin_end(button, PREF_PAD_SPACE);
+		}
+	else
+		{
+		gtk_widget_set_margin_bottom(button, PREF_PAD_SPACE);
+		}
+	gtk_box_append(GTK_BOX(controls_box), button);
+
 	button = gtk_check_button_new_with_label(_("Compare two file sets"));
 	gtk_check_button_set_active(GTK_CHECK_BUTTON(button), dw->second_set);
 	g_signal_connect(G_OBJECT(button), "toggled",
@@ -4498,9 +5722,7 @@ DupeWindow *dupe_window_new()
 
 	file_data_register_notify_func(dupe_notify_cb, dw, NOTIFY_PRIORITY_MEDIUM);
 
-	g_mutex_init(&dw->thread_count_mutex);
-	g_mutex_init(&dw->search_matches_mutex);
-	dw->dupe_comparison_thread_pool = g_thread_pool_new(dupe_comparison_func, dw, options->threads.duplicates, FALSE, nullptr);
+	dupe_window_threads_init(dw, options->threads.duplicates);
 
 	GApplication *app = g_application_get_default();
 
@@ -4513,6 +5735,213 @@ DupeWindow *dupe_window_new()
 	return dw;
 }
 
+/*
+ *-------------------------------------------------------------------
+ * Search from the command line, without widgets
+ *-------------------------------------------------------------------
+ */
+
+struct DupeHeadless
+{
+	GtkApplication *app;
+	GApplicationCommandLine *app_command_line; /**< ref held until the search is done */
+	DupeOutputFormat format;
+	gint64 start_time;
+};
+
+namespace
+{
+
+struct DupeMatchName
+{
+	const gchar *name;
+	DupeMatchType match_mask;
+};
+
+constexpr DupeMatchName dupe_match_names[] = {
+	{ "name",            DUPE_MATCH_NAME },
+	{ "name-ci",         DUPE_MATCH_NAME_CI },
+	{ "name-content",    DUPE_MATCH_NAME_CONTENT },
+	{ "name-ci-content", DUPE_MATCH_NAME_CI_CONTENT },
+	{ "size",            DUPE_MATCH_SIZE },
+	{ "date",            DUPE_MATCH_DATE },
+	{ "dimensions",      DUPE_MATCH_DIM },
+	{ "sum",             DUPE_MATCH_SUM },
+	{ "path",            DUPE_MATCH_PATH },
+	{ "sim-high",        DUPE_MATCH_SIM_HIGH },
+	{ "sim-med",         DUPE_MATCH_SIM_MED },
+	{ "sim-low",         DUPE_MATCH_SIM_LOW },
+	{ "sim-custom",      DUPE_MATCH_SIM_CUSTOM },
+};
+
+void append_json_string(GString *out, const gchar *text)
+{
+	g_string_append_c(out, '"');
+
+	for (const gchar *p = text; *p; p++)
+		{
+		const auto c = static_cast<guchar>(*p);
+
+		if (c == '"' || c == '\\')
+			{
+			g_string_append_c(out, '\\');
+			g_string_append_c(out, c);
+			}
+		else if (c < 0x20)
+			{
+			g_string_append_printf(out, "\\u%04x", c);
+			}
+		else
+			{
+			g_string_append_c(out, c);
+			}
+		}
+
+	g_string_append_c(out, '"');
+}
+
+void append_csv_string(GString *out, const gchar *text)
+{
+	if (!strpbrk(text, ",\"\r\n"))
+		{
+		g_string_append(out, text);
+		return;
+		}
+
+	g_string_append_c(out, '"');
+	for (const gchar *p = text; *p; p++)
+		{
+		if (*p == '"') g_string_append_c(out, '"');
+		g_string_append_c(out, *p);
+		}
+	g_string_append_c(out, '"');
+}
+
+/**
+ * @brief Appends one file of a group
+ * @param rank Similarity to the first file of the group, < 0 if not shown
+ */
+void append_dupe_item(GString *out, DupeOutputFormat format, gint group, const DupeItem *di, gint rank)
+{
+	if (format == DupeOutputFormat::CSV)
+		{
+		g_string_append_printf(out, "%d,", group);
+		if (rank >= 0) g_string_append_printf(out, "%d", rank);
+		g_string_append_printf(out, ",%" PRId64 ",%" PRId64 ",%d,%d,", di->fd->size, static_cast<gint64>(di->fd->date),
+		                       di->dimensions.width, di->dimensions.height);
+		append_csv_string(out, di->fd->path);
+		g_string_append_c(out, '\n');
+		return;
+		}
+
+	g_string_append(out, "{\"path\":");
+	append_json_string(out, di->fd->path);
+	if (rank >= 0) g_string_append_printf(out, ",\"rank\":%d", rank);
+	g_string_append_printf(out, ",\"size\":%" PRId64 ",\"date\":%" PRId64 ",\"width\":%d,\"height\":%d}",
+	                       di->fd->size, static_cast<gint64>(di->fd->date), di->dimensions.width, di->dimensions.height);
+}
+
+} // namespace
+
+/**
+ * @brief Prints the groups found, one at a time, frees \a dw and quits
+ *
+ * CSV has a header line and one line per file. JSON has one object per
+ * line for each group, so that the output can be read as it arrives.
+ */
+static void dupe_headless_done(DupeWindow *dw)
+{
+	DupeHeadless *headless = dw->headless;
+	const gboolean show_rank = (dw->match_mask & DUPE_MATCH_SIM) != 0;
+	g_autoptr(GString) out = g_string_new(nullptr);
+	gint group = 0;
+
+	if (headless->format == DupeOutputFormat::CSV)
+		{
+		g_application_command_line_print(headless->app_command_line, "group,rank,size,date,width,height,path\n");
+		}
+
+	for (GList *work = dw->dupes; work; work = work->next)
+		{
+		auto *parent = static_cast<DupeItem *>(work->data);
+		group++;
+
+		g_string_truncate(out, 0);
+		if (headless->format == DupeOutputFormat::JSON)
+			{
+			g_string_append_printf(out, "{\"group\":%d,\"files\":[", group);
+			}
+
+		append_dupe_item(out, headless->format, group, parent, -1);
+
+		for (GList *temp = parent->group; temp; temp = temp->next)
+			{
+			auto *dm = static_cast<DupeMatch *>(temp->data);
+
+			if (headless->format == DupeOutputFormat::JSON) g_string_append_c(out, ',');
+			append_dupe_item(out, headless->format, group, dm->di, show_rank ? static_cast<gint>(floor(dm->rank)) : -1);
+			}
+
+		if (headless->format == DupeOutputFormat::JSON) g_string_append(out, "]}\n");
+
+		g_application_command_line_print(headless->app_command_line, "%s", out->str);
+		}
+
+	const gdouble seconds = static_cast<gdouble>(g_get_monotonic_time() - headless->start_time) / G_USEC_PER_SEC;
+	const guint files = g_list_length(dw->list);
+	g_application_command_line_printerr(headless->app_command_line, _("%d groups of duplicates in %u files, %.1f s, %.0f files/s\n"),
+	                                    group, files, seconds, seconds > 0.0 ? files / seconds : 0.0);
+
+	g_object_unref(headless->app_command_line);
+	g_application_quit(G_APPLICATION(headless->app));
+
+	delete headless;
+	dupe_window_free(dw);
+}
+
+/**
+ * @brief Converts a match name used on the command line, such as "sum" or "sim-high"
+ * @returns FALSE if \a name is unknown
+ */
+gboolean dupe_match_type_from_name(const gchar *name, DupeMatchType &match_mask)
+{
+	for (const DupeMatchName &match_name : dupe_match_names)
+		{
+		if (g_strcmp0(name, match_name.name) == 0)
+			{
+			match_mask = match_name.match_mask;
+			return TRUE;
+			}
+		}
+
+	return FALSE;
+}
+
+/**
+ * @brief Searches \a path recursively for duplicates and prints them to stdout
+ * @param threads Maximum number of threads reading and comparing files
+ *
+ * The same steps are run as in a duplicates window, in idle callbacks of
+ * the main loop of \a app, which quits when the result has been printed.
+ */
+void dupe_find_duplicates(GtkApplication *app, GApplicationCommandLine *app_command_line, const gchar *path,
+                          DupeMatchType match_mask, gint threads, DupeOutputFormat format)
+{
+	auto *dw = g_new0(DupeWindow, 1);
+
+	dw->match_mask = match_mask;
+	dw->headless = new DupeHeadless{app, G_APPLICATION_COMMAND_LINE(g_object_ref(app_command_line)), format, g_get_monotonic_time()};
+
+	dupe_window_threads_init(dw, threads);
+
+	FileData *fd = file_data_new_dir(path);
+	g_autoptr(GList) list = g_list_append(nullptr, fd);
+
+	dupe_window_add_files(dw, list, TRUE);
+
+	file_data_unref(fd);
+}
+
 /*
  *-------------------------------------------------------------------
  * dnd confirm dir
@@ -24,13 +24,13 @@
 
 #include <memory>
 #include <optional>
-#include <string>
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <glib.h>
 #include <gtk/gtk.h>
 
 #include "geometry.h"
+#include "md5-util.h"
 #include "ui-menu.h"
 
 struct CollectInfo;
@@ -38,6 +38,7 @@ struct CollectionData;
 class FileData;
 struct ImageLoader;
 struct ImageSimilarityData;
+class ImageSimilarityStore;
 struct ThumbLoader;
 
 /** @enum DupeMatchType
@@ -63,6 +64,15 @@ enum DupeMatchType
 	DUPE_MATCH_ALL = 1 << 13 /**< N.B. this is used as a clamp value in rcfile.cc */
 };
 
+/** @enum DupeOutputFormat
+ *  output of a search run from the command line
+ */
+enum class DupeOutputFormat
+{
+	CSV,
+	JSON
+};
+
 enum DupeSelectType : guint
 {
 	DUPE_SELECT_NONE,
@@ -77,11 +87,13 @@ struct DupeItem
 
 	FileData *fd;
 
-	std::optional<std::string> md5sum;
+	std::optional<Md5Digest> md5sum;
+	gboolean content_unique; /**< No other item has the same size or partial checksum, so \a md5sum is not needed. Set for unreadable files */
 	GqSize dimensions;
 	gint dimensions_sum; /**< Computed as (#DupeItem->dimensions.width << 16) + #DupeItem->dimensions.height */
 
 	std::unique_ptr<ImageSimilarityData> simd;
+	guint sim_index; /**< Position in #DupeWindow->sim_store */
 
 	GdkPixbuf *pixbuf; /**< thumb */
 
@@ -97,6 +109,10 @@ struct DupeMatch
 	gdouble rank;
 };
 
+struct DupeHeadless;
+struct DupeReadJob;
+struct DupeStream;
+
 struct DupeWindow
 {
 	GList *list;	/**< one entry for each dropped file in 1st set window (#DupeItem) */
@@ -160,6 +176,19 @@ struct DupeWindow
 	gint thread_count; /**< Incremented each time a similarity check thread item is completed */
 	GMutex thread_count_mutex;
 	gboolean abort; /**< Stop the similarity check thread queue */
+	ImageSimilarityStore *sim_store; /**< Packed copy of the similarity data of all items, built when comparing starts */
+	GPtrArray *sim_items; /**< The #DupeItem of each \a sim_store entry, NULL once removed */
+	guint sim_second_start; /**< Index of the first set 2 entry in \a sim_store */
+	gint64 sim_pairs_compared; /**< Number of full similarity compares, to measure the index pruning */
+	gint64 sim_pairs_matched; /**< Number of similarity matches, to compare the index against an exhaustive search */
+	gint64 sim_pairs_prefiltered; /**< Number of compares rejected by the similarity prefilter */
+	DupeStream *stream; /**< Groups of the similarity matches found so far, and the checkpoint file */
+
+	/* required for checksum and dimension threads */
+	GThreadPool *read_thread_pool;
+	DupeReadJob *read_job; /**< Checksums or dimensions being read, NULL when idle */
+
+	DupeHeadless *headless; /**< Set when run from the command line, there are no widgets */
 };
 
 
@@ -173,5 +202,9 @@ void dupe_window_add_files(DupeWindow *dw, GList *list, gboolean recurse);
 void dupe_window_add_folder(const gchar *path, gboolean recurse);
 
 GString *export_duplicates_data_command_line();
+
+gboolean dupe_match_type_from_name(const gchar *name, DupeMatchType &match_mask);
+void dupe_find_duplicates(GtkApplication *app, GApplicationCommandLine *app_command_line, const gchar *path,
+                          DupeMatchType match_mask, gint threads, DupeOutputFormat format);
 #endif
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
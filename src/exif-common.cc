@@ -862,7 +862,8 @@ ExifData *exif_read_fd(FileData *fd)
 {
 	if (!fd) return nullptr;
 
-	static FileCache *exif_cache = file_cache_new(exif_release_cb, 4);
+	static FileCache *exif_cache = file_cache_new(exif_release_cb, 4, "exif");
+	static const FileCache::CostClass exif_cost_class = FileCache::register_cost_class("exif read ms", 5.0);
 
 	if (file_cache_get(exif_cache, fd)) return fd->exif;
 	g_assert(fd->exif == nullptr);
@@ -878,12 +879,50 @@ ExifData *exif_read_fd(FileData *fd)
 	if (!sidecar_path) sidecar_path = file_data_get_sidecar_path(fd, TRUE);
 #endif
 
+	const gint64 start = g_get_monotonic_time();
 	fd->exif = exif_read(fd->path, sidecar_path, fd->modified_xmp);
 
-	file_cache_put(exif_cache, fd, 1);
+	file_cache_put_with_cost(exif_cache, fd, 1, exif_cost_class, (g_get_monotonic_time() - start) / 1000.0);
 	return fd->exif;
 }
 
+/**
+ * @brief Whether the Exif dates of @a fd can be read from the file itself
+ *
+ * Not when an XMP sidecar or unwritten changes are merged into the
+ * Exif data by exif_read_fd(), those may set other dates.
+ */
+gboolean exif_dates_in_file(FileData *fd)
+{
+	return exif_dates_in_file_listed(fd) && exif_dates_in_file_cached(fd->path);
+}
+
+/**
+ * @brief The part of exif_dates_in_file() that does not touch the disk
+ *
+ * No unwritten changes, and no XMP sidecar grouped with the file.
+ */
+gboolean exif_dates_in_file_listed(FileData *fd)
+{
+	if (!fd || fd->modified_xmp) return FALSE;
+
+	g_autofree gchar *sidecar_path = file_data_get_sidecar_path(fd, TRUE);
+
+	return sidecar_path == nullptr;
+}
+
+/**
+ * @brief The part of exif_dates_in_file() that looks for an XMP sidecar in the metadata cache
+ *
+ * Only reads @a path and the options, so that a worker can call it.
+ */
+gboolean exif_dates_in_file_cached(const gchar *path)
+{
+	g_autofree gchar *sidecar_path = cache_find_location(CacheType::XMP_METADATA, path);
+
+	return sidecar_path == nullptr;
+}
+
 
 void exif_free_fd(FileData *fd, ExifData *exif)
 {
@@ -126,6 +126,9 @@ gchar *exif_get_description_by_key(const gchar *key);
 gchar *exif_get_data_as_text(ExifData *exif, const gchar *key);
 
 ExifData *exif_read_fd(FileData *fd);
+gboolean exif_dates_in_file(FileData *fd);
+gboolean exif_dates_in_file_listed(FileData *fd);
+gboolean exif_dates_in_file_cached(const gchar *path);
 void exif_free_fd(FileData *fd, ExifData *exif);
 
 ColorManMemData exif_get_color_profile(FileData *fd, ColorManProfileType &color_profile_from_image);
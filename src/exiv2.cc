@@ -420,6 +420,9 @@ void exif_init()
 {
 	Exiv2::LogMsg::setHandler(exiv2_log_handler);
 
+	/* before any worker thread reads XMP, e.g. from a Lua script */
+	Exiv2::XmpParser::initialize();
+
 #ifdef EXV_ENABLE_NLS
 	bind_textdomain_codeset (EXV_PACKAGE, "UTF-8");
 #endif
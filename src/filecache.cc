@@ -20,14 +20,59 @@
 
 #include "filecache.h"
 
+#include <unistd.h>
+
 #include <algorithm>
 #include <config.h>
-#include <list>
-#include <optional>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 #include "filedata.h"
 
-/* this implements a simple LRU algorithm */
+/* this implements GreedyDual-Size-Frequency, see filecache.h */
+
+namespace
+{
+
+struct CostClassData
+{
+	std::string name;
+	gdouble cost; /**< running average, in whatever unit the class uses */
+};
+
+constexpr gdouble COST_AVERAGE_WEIGHT = 0.2; /**< weight of a new measurement */
+
+GMutex cost_classes_mutex; /**< loader threads report costs too */
+
+std::vector<CostClassData> &cost_classes()
+{
+	static std::vector<CostClassData> classes{{"default", 1.0}};
+	return classes;
+}
+
+std::vector<FileCache *> &cache_list()
+{
+	static std::vector<FileCache *> caches;
+	return caches;
+}
+
+gdouble cost_class_cost(FileCache::CostClass cost_class, gdouble cost)
+{
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&cost_classes_mutex);
+
+	auto &classes = cost_classes();
+	if (cost_class >= classes.size()) cost_class = FileCache::COST_CLASS_DEFAULT;
+
+	CostClassData &data = classes[cost_class];
+	if (cost <= 0.0) return data.cost;
+
+	data.cost += (cost - data.cost) * COST_AVERAGE_WEIGHT;
+	return cost;
+}
+
+} // namespace
 
 #ifdef DEBUG
 constexpr bool debug_file_cache = false; /* Set to true to add file cache dumps to the debug output */
@@ -39,9 +84,9 @@ void FileCache::dump()
 	DEBUG_1("cache dump: fc=%p max size:%lu size:%lu", (void *)this, max_size_, size_);
 
 	size_t n = 0;
-	for (const auto &entry : contents_)
+	for (const auto &[priority, fd] : queue_)
 		{
-		DEBUG_1("cache entry: fc=%p [%lu] %s %lu", (void *)this, ++n, entry.fd->path, entry.size);
+		DEBUG_1("cache entry: fc=%p [%lu] %s %lu %g", (void *)this, ++n, fd->path, contents_.at(fd).size, priority);
 		}
 }
 #else
@@ -50,36 +95,40 @@ void FileCache::dump() {}
 // #  define file_cache_dump(fc)
 #endif
 
-bool FileCache::remove_entry(FileCache::ListIterT entry_iter)
+bool FileCache::remove_entry(FileData *fd)
 {
-	auto &entry = *entry_iter;
+	const auto entry_iter = contents_.find(fd);
+	if (entry_iter == contents_.end()) return false;
 
 	// Avoid evicting a FileCacheEntry that implicitly triggered this removal attempt.
-	if (entry.checking_if_changed)
+	if (entry_iter->second.checking_if_changed)
 		{
-		DEBUG_1("deferring cache remove: fc=%p %s", (void *)this, entry.fd->path);
+		DEBUG_1("deferring cache remove: fc=%p %s", (void *)this, fd->path);
 		return false;
 		}
 
-	DEBUG_1("cache remove: fc=%p %s", (void *)this, entry.fd->path);
+	DEBUG_1("cache remove: fc=%p %s", (void *)this, fd->path);
 
-	size_ -= entry.size;
-	release_(entry.fd);
-	file_data_unref(entry.fd);
+	size_ -= entry_iter->second.size;
+	queue_.erase(entry_iter->second.queue_pos);
 	contents_.erase(entry_iter);
+	if (last_used_ == fd) last_used_ = nullptr;
+
+	// The entry is gone before calling out, in case the callbacks re-enter the cache.
+	release_(fd);
+	file_data_unref(fd);
 
 	return true;
 }
 
-std::optional<FileCache::ListIterT> FileCache::find_by_fd(FileData *fd)
+void FileCache::touch(FileData *fd, Entry &entry)
 {
-	const auto entry_iter = std::find_if(
-		contents_.begin(),
-		contents_.end(),
-		[fd](const Entry &entry) { return entry.fd == fd; });
+	const gdouble priority = inflation_ + entry.hits * entry.cost / static_cast<gdouble>(std::max<size_t>(entry.size, 1));
 
-	if (entry_iter != contents_.end()) return entry_iter;
-	return std::nullopt;
+	if (entry.queue_pos != queue_.end()) queue_.erase(entry.queue_pos);
+	entry.queue_pos = queue_.emplace(priority, fd);
+
+	last_used_ = fd;
 }
 
 // static
@@ -93,10 +142,7 @@ void FileCache::notify_cb(FileData *fd, NotifyType type, gpointer data)
 	auto *fc = static_cast<FileCache *>(data);
 	fc->dump();
 
-	const auto maybe_iter = fc->find_by_fd(fd);
-	if (!maybe_iter) return;
-
-	fc->remove_entry(*maybe_iter);
+	fc->remove_entry(fd);
 }
 
 void FileCache::shrink_to_max_size()
@@ -105,39 +151,52 @@ void FileCache::shrink_to_max_size()
 
 	g_assert((size_ == 0) == contents_.empty());  // Assert that size is consistent with emptiness.
 
-	if (contents_.empty()) return;
-	auto entry_iter = std::prev(contents_.end());
-	while(size_ > max_size_ && entry_iter != contents_.begin())
+	const guint64 evictions = evictions_;
+
+	while (size_ > max_size_)
 		{
-		// This is valid since the list is guaranteed non-empty.
-		auto evict_iter = entry_iter;
-		--entry_iter;
-
-		// This may fail to remove the specified entry if this resize was implicitly
-		// triggered during a file_cache_get call.  Any file_cache_put after the
-		// file_cache_get will re-trigger the shrink and correct the cache size, if needed.
-		remove_entry(evict_iter);
-		}
+		// Rescan from the start each time, since removal may re-enter the cache.
+		const auto victim = std::find_if(queue_.begin(), queue_.end(), [this](const auto &item)
+			{
+			return item.second != last_used_ && !contents_.at(item.second).checking_if_changed;
+			});
+		if (victim == queue_.end()) break;
 
-	g_assert((size_ == 0) == contents_.empty());  // Assert that size is consistent with emptiness.
+		const gdouble priority = victim->first;
+		if (!remove_entry(victim->second)) break;
 
-	// At this point, the loop won't have been able to evict the begin() entry.  Maybe do so now.
-	if (size_ > max_size_ && !contents_.empty())
+		inflation_ = std::max(inflation_, priority);
+		evictions_++;
+		}
+
+	// At this point, only the most recently used entry may be left to evict.
+	if (size_ > max_size_ && last_used_ && remove_entry(last_used_))
 		{
-		remove_entry(contents_.begin());
+		evictions_++;
 		}
 
 	g_assert((size_ == 0) == contents_.empty());  // Assert that size is consistent with emptiness.
+
+	if (evictions_ != evictions)
+		{
+		DEBUG_1("cache stats: %s hits:%" G_GUINT64_FORMAT " misses:%" G_GUINT64_FORMAT " evictions:%" G_GUINT64_FORMAT " size:%zu/%zu entries:%zu",
+		        name_ ? name_ : "-", hits_, misses_, evictions_, size_, max_size_, contents_.size());
+		}
 }
 
-FileCache::FileCache(ReleaseFunc release, size_t max_size) : release_(release), max_size_(max_size)
+FileCache::FileCache(ReleaseFunc release, size_t max_size, const gchar *name)
+	: release_(release), name_(name), max_size_(max_size)
 {
 	file_data_register_notify_func(FileCache::notify_cb, this, NOTIFY_PRIORITY_HIGH);
+	cache_list().push_back(this);
 }
 
 FileCache::~FileCache()
 {
 	file_data_unregister_notify_func(FileCache::notify_cb, this);
+
+	auto &caches = cache_list();
+	caches.erase(std::remove(caches.begin(), caches.end(), this), caches.end());
 }
 
 bool FileCache::get(FileData *fd)
@@ -166,60 +225,75 @@ bool FileCache::get(FileData *fd)
 	// a "before" scope, so that the iters will be undefined by the time we make the
 	// invalidating call
 	{
-		const auto maybe_entry_iter = find_by_fd(fd);
-		if (!maybe_entry_iter)
+		const auto entry_iter = contents_.find(fd);
+		if (entry_iter == contents_.end())
 			{
 			DEBUG_2("cache miss: fc=%p %s", (void *)this, fd->path);
+			misses_++;
 			return FALSE;
 			}
-		auto entry_iter = *maybe_entry_iter;
 
 		// Entry exists.
 		DEBUG_2("cache hit: fc=%p %s", (void *)this, fd->path);
-
-		// Move it to the beginning, if needed.
-		if (entry_iter != contents_.begin())
-			{
-			DEBUG_2("cache move to front: fc=%p %s", (void *)this, fd->path);
-			// Moves entry_iter from somewhere in contents_ to before contents_.begin();
-			contents_.splice(contents_.begin(), contents_, entry_iter);
-			}
+		Entry &entry = entry_iter->second;
 
 		// Most of the following code is defending against the case where
 		// file_data_check_changed_files triggers a re-entrant call back into this file_cache_get.
-		if (entry_iter->checking_if_changed) return true;  // Avoid infinite recursion.
-		entry_iter->checking_if_changed = TRUE;
+		if (entry.checking_if_changed) return true;  // Avoid infinite recursion.
+
+		entry.hits++;
+		touch(fd, entry);
+		entry.checking_if_changed = TRUE;
 	}
 
 	// We assume that file_data_check_changed_files may invalidate fc iterators.
 	const bool fd_changed = file_data_check_changed_files(fd);
 
 	// Now we re-acquire entry_iter to take the appropriate action, if it still exists.
-	const auto maybe_entry_iter = find_by_fd(fd);
-	if (!maybe_entry_iter) return false;
-	auto &entry_iter = *maybe_entry_iter;
+	const auto entry_iter = contents_.find(fd);
+	if (entry_iter == contents_.end())
+		{
+		misses_++;
+		return false;
+		}
 
 	// Doing this here for correctness, even though we might immediately evict the entry.
-	entry_iter->checking_if_changed = false;
+	entry_iter->second.checking_if_changed = false;
 
 	if (fd_changed)
 		{
 		// Underlying file has been changed.  Evict the cache entry.
 		dump();
-		remove_entry(entry_iter);
+		remove_entry(fd);
+		misses_++;
 		return false;
 		}
 
+	hits_++;
 	dump();
 	return true;
 }
 
-void FileCache::put(FileData *fd, size_t size)
+/**
+ * @brief Adds fd to the cache
+ * @param size Size of the cached data, in the unit of the cache maximum
+ * @param cost_class Cost class of the data, from register_cost_class()
+ * @param cost Measured cost of creating the data, or 0 to use the class average
+ */
+void FileCache::put(FileData *fd, size_t size, CostClass cost_class, gdouble cost)
 {
-	if (get(fd)) return;
+	if (contents_.count(fd) && get(fd)) return;
 
 	DEBUG_2("cache add: fc=%p %s", (void *)this, fd->path);
-	contents_.emplace_front(file_data_ref(fd), size);
+
+	const auto [entry_iter, inserted] = contents_.emplace(std::piecewise_construct,
+	                                                      std::forward_as_tuple(fd),
+	                                                      std::forward_as_tuple(size, cost_class_cost(cost_class, cost)));
+	if (!inserted) return;
+
+	file_data_ref(fd);
+	entry_iter->second.queue_pos = queue_.end();
+	touch(fd, entry_iter->second);
 	size_ += size;
 
 	shrink_to_max_size();
@@ -231,10 +305,42 @@ void FileCache::set_max_size(size_t size)
 	shrink_to_max_size();
 }
 
+FileCache::Stats FileCache::get_stats() const
+{
+	return {name_, hits_, misses_, evictions_, size_, max_size_, contents_.size()};
+}
+
+/**
+ * @brief Registers a cost class for cached data
+ * @param name Name of the class, for debugging
+ * @param default_cost Cost used until costs are reported with put()
+ * @returns The class, to pass to put()
+ *
+ * Costs of different classes are only compared within a cache, so each
+ * class just needs a unit that is consistent within the caches it is used in.
+ */
+FileCache::CostClass FileCache::register_cost_class(const gchar *name, gdouble default_cost)
+{
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new(&cost_classes_mutex);
+
+	auto &classes = cost_classes();
+	classes.push_back({name, default_cost});
+
+	return classes.size() - 1;
+}
+
+void FileCache::foreach(const std::function<void(const FileCache &)> &func)
+{
+	for (const FileCache *fc : cache_list())
+		{
+		func(*fc);
+		}
+}
+
 // Trampoline implementation of C-style API.
-FileCache *file_cache_new(FileCacheReleaseFunc release, size_t max_size)
+FileCache *file_cache_new(FileCacheReleaseFunc release, size_t max_size, const gchar *name)
 {
-	return new FileCache(release, max_size);
+	return new FileCache(release, max_size, name);
 }
 
 bool file_cache_get(FileCache *fc, FileData *fd)
@@ -247,9 +353,40 @@ void file_cache_put(FileCache *fc, FileData *fd, size_t size)
 	fc->put(fd, size);
 }
 
+void file_cache_put_with_cost(FileCache *fc, FileData *fd, size_t size, FileCache::CostClass cost_class, gdouble cost)
+{
+	fc->put(fd, size, cost_class, cost);
+}
+
 void file_cache_set_max_size(FileCache *fc, size_t size)
 {
 	fc->set_max_size(size);
 }
 
+size_t file_cache_get_max_size(FileCache *fc)
+{
+	return fc->get_max_size();
+}
+
+/**
+ * @brief Memory budget for decoded images, derived from the installed memory
+ * @returns An eighth of the physical memory, at least 128 MiB
+ */
+size_t file_cache_memory_budget()
+{
+	static size_t budget = []()
+	{
+		constexpr size_t min_budget = 128 * 1048576;
+		size_t physical = 0;
+#if defined(_SC_PHYS_PAGES) && defined(_SC_PAGESIZE)
+		const long pages = sysconf(_SC_PHYS_PAGES);
+		const long page_size = sysconf(_SC_PAGESIZE);
+		if (pages > 0 && page_size > 0) physical = static_cast<size_t>(pages) * static_cast<size_t>(page_size);
+#endif
+		return std::max(physical / 8, min_budget);
+	}();
+
+	return budget;
+}
+
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -23,18 +23,44 @@
 
 #include <glib.h>
 
-#include <list>
-#include <optional>
+#include <functional>
+#include <map>
+#include <unordered_map>
 
 // From filedata.h
 class FileData;
 enum NotifyType : gint;
 
+/**
+ * @brief Size bounded cache of data attached to FileData
+ *
+ * Entries are evicted by GreedyDual-Size-Frequency: an entry's priority
+ * grows with the cost of recreating it and the number of hits, and shrinks
+ * with its size. Every eviction raises the base priority given to new and
+ * hit entries, so entries that are no longer used age out.
+ *
+ * The cost comes from a cost class. Consumers register a class with a
+ * default cost, and can report measured costs that then update the
+ * class average.
+ */
 class FileCache {
     public:
 	using ReleaseFunc = void (*)(FileData *);
+	using CostClass = guint;
+
+	static constexpr CostClass COST_CLASS_DEFAULT = 0; /**< cost 1, for caches that count entries */
+
+	struct Stats {
+		const gchar *name;
+		guint64 hits;
+		guint64 misses;
+		guint64 evictions;
+		size_t size;
+		size_t max_size;
+		size_t count;
+	};
 
-	FileCache(ReleaseFunc release, size_t max_size);
+	FileCache(ReleaseFunc release, size_t max_size, const gchar *name = nullptr);
 	~FileCache();
 
 	// Not copyable.
@@ -43,41 +69,61 @@ class FileCache {
 
 	// TODO[xsdg]: The name "get" here is really misleading.  Rename.
 	bool get(FileData *fd);
-	void put(FileData *fd, size_t size);
+	void put(FileData *fd, size_t size, CostClass cost_class = COST_CLASS_DEFAULT, gdouble cost = 0.0);
 	void set_max_size(size_t size);
+	size_t get_max_size() const { return max_size_; }
+	Stats get_stats() const;
+
+	static CostClass register_cost_class(const gchar *name, gdouble default_cost);
+	static void foreach(const std::function<void(const FileCache &)> &func);
 
     private:
+	using QueueT = std::multimap<gdouble, FileData *>;
+
 	struct Entry {
-		Entry(FileData *fd, size_t size) : fd(fd), size(size) {}
+		Entry(size_t size, gdouble cost) : size(size), cost(cost) {}
 
 		// Not copyable.
 		Entry(const Entry &other) = delete;
 		Entry &operator=(const Entry &other) = delete;
 
-		FileData *fd;
 		size_t size;
+		gdouble cost;
+		guint hits = 1;
+		QueueT::iterator queue_pos;
 		bool checking_if_changed = false;
 	};
-	using ListIterT = std::list<Entry>::iterator;
+	using MapT = std::unordered_map<FileData *, Entry>;
 
 	void dump();
-	bool remove_entry(ListIterT entry_iter);
-	std::optional<ListIterT> find_by_fd(FileData *fd);
+	bool remove_entry(FileData *fd);
+	void touch(FileData *fd, Entry &entry);
 	static void notify_cb(FileData *fd, NotifyType type, gpointer data);
 	void shrink_to_max_size();
 
 	ReleaseFunc release_;
-	std::list<Entry> contents_;
+	const gchar *name_;
+	MapT contents_;
+	QueueT queue_;          /**< entries by eviction priority, lowest first */
+	FileData *last_used_ = nullptr; /**< evicted only as a last resort */
+	gdouble inflation_ = 0.0;
 	size_t max_size_;
 	size_t size_ = 0;
+
+	guint64 hits_ = 0;
+	guint64 misses_ = 0;
+	guint64 evictions_ = 0;
 };
 
 using FileCacheReleaseFunc = FileCache::ReleaseFunc;
 
-FileCache *file_cache_new(FileCacheReleaseFunc release, size_t max_size);
+FileCache *file_cache_new(FileCacheReleaseFunc release, size_t max_size, const gchar *name = nullptr);
 bool file_cache_get(FileCache *fc, FileData *fd);
 void file_cache_put(FileCache *fc, FileData *fd, size_t size);
+void file_cache_put_with_cost(FileCache *fc, FileData *fd, size_t size, FileCache::CostClass cost_class, gdouble cost = 0.0);
 void file_cache_set_max_size(FileCache *fc, size_t size);
+size_t file_cache_get_max_size(FileCache *fc);
+size_t file_cache_memory_budget();
 
 #endif
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
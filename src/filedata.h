@@ -254,6 +254,8 @@ public:
 	GList *cached_metadata;
 	gint rating;
 	gboolean metadata_in_idle_loaded;
+	gchar *lua_sort_value;   /**< of the Lua sort script, nullptr until it ran */
+	gdouble lua_sort_number; /**< lua_sort_value as a number, NAN if it is not one */
 
 	SelectionType selected;  /**< Used by view-file-icon. */
 
@@ -390,6 +392,7 @@ public:
 
 	gboolean file_data_register_real_time_monitor(FileData *fd);
 	gboolean file_data_unregister_real_time_monitor(FileData *fd);
+	static FileData *file_data_lookup(const gchar *path_utf8);
 
 	void read_exif_time_data(FileData *file);
 	void read_exif_time_digitized_data(FileData *file);
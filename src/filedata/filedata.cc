@@ -33,15 +33,18 @@
 #include <cstring>
 #include <ctime>
 
+#include <gio/gio.h>
 #include <glib-object.h>
 #include <pwd.h>
 
 #include <config.h>
 
+#include "cache-meta-db.h"
 #include "cache.h"
 #include "exif.h"
 #include "filefilter.h"
 #include "histogram.h"
+#include "image-probe.h"
 #include "intl.h"
 #include "main-defines.h"
 #include "metadata.h"
@@ -452,6 +455,22 @@ FileDataRef FileData::new_simple(const gchar *path_utf8, FileDataContext *contex
 	return make_new(path_utf8, &st, TRUE, context);
 }
 
+/**
+ * @brief Reads both Exif dates from the file headers, without exiv2
+ * @returns FALSE if exiv2 has to read them
+ */
+static gboolean read_exif_dates_fast(FileData *file)
+{
+	if (file->exif || !exif_dates_in_file(file)) return FALSE;
+
+	ImageProbeExif exif;
+	if (!image_probe_exif(file->path, exif)) return FALSE;
+
+	file->exifdate = exif.date_original;
+	file->exifdate_digitized = exif.date_digitized;
+	return TRUE;
+}
+
 void FileData::read_exif_time_data(FileData *file)
 {
 	if (file->exifdate > 0)
@@ -460,6 +479,14 @@ void FileData::read_exif_time_data(FileData *file)
 		return;
 		}
 
+	if (read_exif_dates_fast(file)) return;
+
+	if (CacheMetaEntry entry; metadata_index_lookup(file, entry))
+		{
+		file->exifdate = entry.date;
+		return;
+		}
+
 	if (!file->exif)
 		{
 		exif_read_fd(file);
@@ -488,6 +515,8 @@ void FileData::read_exif_time_digitized_data(FileData *file)
 		return;
 		}
 
+	if (read_exif_dates_fast(file)) return;
+
 	if (!file->exif)
 		{
 		exif_read_fd(file);
@@ -510,6 +539,12 @@ void FileData::read_exif_time_digitized_data(FileData *file)
 
 void FileData::read_rating_data(FileData *file)
 {
+	if (CacheMetaEntry entry; metadata_index_lookup(file, entry))
+		{
+		file->rating = entry.rating;
+		return;
+		}
+
 	g_autofree gchar *rating_str = metadata_read_string(file, RATING_KEY, METADATA_PLAIN);
 
 	if (rating_str)
@@ -648,6 +683,7 @@ void FileData::file_data_free(FileData *fd)
 	if (fd->thumb_pixbuf) g_object_unref(fd->thumb_pixbuf);
 	histmap_free(fd->histmap);
 	g_free(fd->format_name);
+	g_free(fd->lua_sort_value);
 	g_assert(fd->sidecar_files == nullptr); /* sidecar files must be freed before calling this */
 
 	::file_data_change_info_free(nullptr, fd);
@@ -2756,12 +2792,41 @@ void FileData::file_data_send_notification(FileData *fd, NotifyType type)
 		}
 }
 
-static GHashTable *file_data_monitor_pool = nullptr;
+/*
+ * Each monitored FileData is watched by a GFileMonitor on its folder (the
+ * folder itself for a directory), shared by all monitored FileData in
+ * that folder. Events are collected until none arrived for
+ * FILE_DATA_MONITOR_DELAY_MS, but no longer than FILE_DATA_MONITOR_MAX_DELAY_MS,
+ * and checked together, so that a burst of changes such as a camera import
+ * results in one update, and a folder that keeps changing is still updated. Folders on remote filesystems, where changes made
+ * by other machines are not reported, are polled instead.
+ */
+constexpr guint FILE_DATA_MONITOR_DELAY_MS = 500;
+constexpr guint FILE_DATA_MONITOR_MAX_DELAY_MS = 3000;
+constexpr guint FILE_DATA_MONITOR_POLL_MS = 5000;
+
+struct FileDataMonitorDir
+{
+	gchar *path;
+	GFileMonitor *monitor; /**< NULL if the folder is polled */
+	GList *fds; /**< Monitored FileData in the folder */
+};
+
+static GHashTable *file_data_monitor_pool = nullptr; /* FileData -> registration count */
+static GHashTable *file_data_monitor_dirs = nullptr; /* folder path -> FileDataMonitorDir */
+static GHashTable *file_data_monitor_fd_dir = nullptr; /* FileData -> FileDataMonitorDir */
+static GHashTable *file_data_monitor_pending = nullptr; /* FileData -> force reread, holds a reference */
+static guint file_data_monitor_pending_id = 0; /* event source id */
+static gint64 file_data_monitor_pending_since = 0; /* monotonic time of the first event of the batch */
 static guint realtime_monitor_id = 0; /* event source id */
+static gint realtime_monitor_polled = 0; /* monitored FileData in polled folders */
 
 static void realtime_monitor_check_cb(gpointer key, gpointer, gpointer)
 {
 	auto fd = static_cast<FileData *>(key);
+	auto dir = static_cast<FileDataMonitorDir *>(g_hash_table_lookup(file_data_monitor_fd_dir, fd));
+
+	if (dir && dir->monitor) return; /* changes are reported by events */
 
 	file_data_check_changed_files(fd);
 
@@ -2775,6 +2840,202 @@ static gboolean realtime_monitor_cb(gpointer)
 	return G_SOURCE_CONTINUE;
 }
 
+static gboolean file_data_monitor_pending_cb(gpointer)
+{
+	GHashTable *pending = file_data_monitor_pending;
+	GHashTableIter iter;
+	gpointer key;
+	gpointer value;
+
+	/* changes reported while checking go into the next batch */
+	file_data_monitor_pending = nullptr;
+	file_data_monitor_pending_id = 0;
+
+	DEBUG_1("monitor: checking %u changed files", g_hash_table_size(pending));
+
+	g_hash_table_iter_init(&iter, pending);
+	while (g_hash_table_iter_next(&iter, &key, &value))
+		{
+		auto fd = static_cast<FileData *>(key);
+
+		/* the folder date has a resolution of one second, and may not show that files were added */
+		if (!file_data_check_changed_files(fd) && GPOINTER_TO_INT(value))
+			{
+			file_data_increment_version(fd);
+			file_data_send_notification(fd, NOTIFY_REREAD);
+			}
+
+		::file_data_unref(fd);
+		}
+
+	g_hash_table_destroy(pending);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void file_data_monitor_pending_add(FileData *fd, gboolean reread)
+{
+	if (!file_data_monitor_pending)
+		{
+		file_data_monitor_pending = g_hash_table_new(g_direct_hash, g_direct_equal);
+		file_data_monitor_pending_since = g_get_monotonic_time();
+		}
+
+	gpointer value;
+	if (g_hash_table_lookup_extended(file_data_monitor_pending, fd, nullptr, &value))
+		{
+		reread |= GPOINTER_TO_INT(value);
+		}
+	else
+		{
+		::file_data_ref(fd);
+		}
+	g_hash_table_insert(file_data_monitor_pending, fd, GINT_TO_POINTER(reread));
+
+	/* each event restarts the delay, until the batch is as old as the maximum */
+	const gint64 waited_ms = (g_get_monotonic_time() - file_data_monitor_pending_since) / 1000;
+	if (file_data_monitor_pending_id && waited_ms + FILE_DATA_MONITOR_DELAY_MS > FILE_DATA_MONITOR_MAX_DELAY_MS) return;
+
+	if (file_data_monitor_pending_id) g_source_remove(file_data_monitor_pending_id);
+	file_data_monitor_pending_id = g_timeout_add(FILE_DATA_MONITOR_DELAY_MS, file_data_monitor_pending_cb, nullptr);
+}
+
+static void file_data_monitor_changed_cb(GFileMonitor *, GFile *file, GFile *other_file, GFileMonitorEvent event_type, gpointer data)
+{
+	auto dir = static_cast<FileDataMonitorDir *>(data);
+
+	if (!options->update_on_time_change || !dir->fds) return;
+
+	const gboolean listing_changed = (event_type == G_FILE_MONITOR_EVENT_CREATED ||
+	                                  event_type == G_FILE_MONITOR_EVENT_DELETED ||
+	                                  event_type == G_FILE_MONITOR_EVENT_MOVED_IN ||
+	                                  event_type == G_FILE_MONITOR_EVENT_MOVED_OUT ||
+	                                  event_type == G_FILE_MONITOR_EVENT_RENAMED);
+
+	for (GList *work = dir->fds; work; work = work->next)
+		{
+		auto fd = static_cast<FileData *>(work->data);
+		const gboolean is_dir = (strcmp(fd->path, dir->path) == 0);
+
+		file_data_monitor_pending_add(fd, is_dir && listing_changed);
+		}
+
+	/* files that are not monitored themselves, but known, for example shown in the file list */
+	for (GFile *changed : {file, other_file})
+		{
+		if (!changed) continue;
+
+		g_autofree gchar *path = g_file_get_path(changed);
+		if (!path) continue;
+
+		g_autofree gchar *path_utf8 = path_to_utf8(path);
+		FileData *fd = FileData::file_data_lookup(path_utf8);
+		if (fd) file_data_monitor_pending_add(fd, FALSE);
+		}
+}
+
+/**
+ * @brief Watches the folder \a path for changes
+ * @returns NULL if the folder must be polled
+ *
+ * Remote filesystems only report changes made by this machine.
+ */
+static GFileMonitor *file_data_monitor_new(const gchar *path)
+{
+	g_autofree gchar *pathl = path_from_utf8(path);
+	g_autoptr(GFile) file = g_file_new_for_path(pathl);
+	g_autoptr(GFileInfo) info = g_file_query_filesystem_info(file, G_FILE_ATTRIBUTE_FILESYSTEM_REMOTE, nullptr, nullptr);
+
+	if (!info || g_file_info_get_attribute_boolean(info, G_FILE_ATTRIBUTE_FILESYSTEM_REMOTE))
+		{
+		DEBUG_1("monitor: polling %s", path);
+		return nullptr;
+		}
+
+	g_autoptr(GError) error = nullptr;
+	GFileMonitor *monitor = g_file_monitor_directory(file, G_FILE_MONITOR_WATCH_MOVES, nullptr, &error);
+
+	if (!monitor)
+		{
+		DEBUG_1("monitor: polling %s: %s", path, error->message);
+		}
+
+	return monitor;
+}
+
+static void file_data_monitor_add(FileData *fd)
+{
+	if (!file_data_monitor_dirs)
+		{
+		file_data_monitor_dirs = g_hash_table_new(g_str_hash, g_str_equal);
+		file_data_monitor_fd_dir = g_hash_table_new(g_direct_hash, g_direct_equal);
+		}
+
+	g_autofree gchar *path = S_ISDIR(fd->mode) ? g_strdup(fd->path) : remove_level_from_path(fd->path);
+	auto dir = static_cast<FileDataMonitorDir *>(g_hash_table_lookup(file_data_monitor_dirs, path));
+
+	if (!dir)
+		{
+		dir = g_new0(FileDataMonitorDir, 1);
+		dir->path = g_strdup(path);
+		dir->monitor = file_data_monitor_new(path);
+		if (dir->monitor)
+			{
+			g_signal_connect(dir->monitor, "changed", G_CALLBACK(file_data_monitor_changed_cb), dir);
+			}
+		g_hash_table_insert(file_data_monitor_dirs, dir->path, dir);
+		}
+
+	dir->fds = g_list_prepend(dir->fds, fd);
+	g_hash_table_insert(file_data_monitor_fd_dir, fd, dir);
+
+	if (!dir->monitor)
+		{
+		realtime_monitor_polled++;
+		if (!realtime_monitor_id)
+			{
+			realtime_monitor_id = g_timeout_add(FILE_DATA_MONITOR_POLL_MS, realtime_monitor_cb, nullptr);
+			}
+		}
+}
+
+static void file_data_monitor_remove(FileData *fd)
+{
+	auto dir = static_cast<FileDataMonitorDir *>(g_hash_table_lookup(file_data_monitor_fd_dir, fd));
+	g_assert(dir);
+
+	g_hash_table_remove(file_data_monitor_fd_dir, fd);
+	dir->fds = g_list_remove(dir->fds, fd);
+
+	if (!dir->monitor)
+		{
+		realtime_monitor_polled--;
+		if (realtime_monitor_polled == 0)
+			{
+			g_clear_handle_id(&realtime_monitor_id, g_source_remove);
+			}
+		}
+
+	if (dir->fds) return;
+
+	g_hash_table_remove(file_data_monitor_dirs, dir->path);
+	if (dir->monitor)
+		{
+		g_file_monitor_cancel(dir->monitor);
+		g_object_unref(dir->monitor);
+		}
+	g_free(dir->path);
+	g_free(dir);
+}
+
+/**
+ * @brief Returns the FileData of \a path_utf8 if there is one, without creating it
+ */
+FileData *FileData::file_data_lookup(const gchar *path_utf8)
+{
+	return static_cast<FileData *>(g_hash_table_lookup(DefaultFileDataContext()->file_data_pool, path_utf8));
+}
+
 gboolean FileData::file_data_register_real_time_monitor(FileData *fd)
 {
 	gint count;
@@ -2791,10 +3052,7 @@ gboolean FileData::file_data_register_real_time_monitor(FileData *fd)
 	count++;
 	g_hash_table_insert(file_data_monitor_pool, fd, GINT_TO_POINTER(count));
 
-	if (!realtime_monitor_id)
-		{
-		realtime_monitor_id = g_timeout_add(5000, realtime_monitor_cb, nullptr);
-		}
+	if (count == 1) file_data_monitor_add(fd);
 
 	return TRUE;
 }
@@ -2814,19 +3072,16 @@ gboolean FileData::file_data_unregister_real_time_monitor(FileData *fd)
 	count--;
 
 	if (count == 0)
+		{
 		g_hash_table_remove(file_data_monitor_pool, fd);
+		file_data_monitor_remove(fd);
+		}
 	else
 		g_hash_table_insert(file_data_monitor_pool, fd, GINT_TO_POINTER(count));
 
 	::file_data_unref(fd);
 
-	if (g_hash_table_size(file_data_monitor_pool) == 0)
-		{
-		g_clear_handle_id(&realtime_monitor_id, g_source_remove);
-		return FALSE;
-		}
-
-	return TRUE;
+	return g_hash_table_size(file_data_monitor_pool) > 0;
 }
 
 /*
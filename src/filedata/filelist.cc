@@ -29,6 +29,7 @@
 #include <sys/stat.h>
 
 #include <cerrno>
+#include <cmath>
 #include <cstdio>
 #include <cstring>
 #include <utility>
@@ -238,6 +239,26 @@ gboolean FileData::FileList::read_list_real(const gchar *dir_path, GList **files
  *-----------------------------------------------------------------------------
  */
 
+/**
+ * @brief Numbers first, then text, then files the Lua sort script did not run for
+ */
+static gint sort_compare_lua_value(const FileData *fa, const FileData *fb)
+{
+	const auto kind = [](const FileData *fd) { return fd->lua_sort_value ? (std::isnan(fd->lua_sort_number) ? 1 : 0) : 2; };
+	const gint ka = kind(fa);
+	const gint kb = kind(fb);
+
+	if (ka != kb) return (ka < kb) ? -1 : 1;
+
+	if (ka == 0)
+		{
+		if (fa->lua_sort_number < fb->lua_sort_number) return -1;
+		if (fa->lua_sort_number > fb->lua_sort_number) return 1;
+		return 0;
+		}
+
+	return (ka == 1) ? g_utf8_collate(fa->lua_sort_value, fb->lua_sort_value) : 0;
+}
 
 gint FileData::FileList::sort_compare_filedata(
 	const FileData *fa, const FileData *fb, SortSettings *settings)
@@ -287,6 +308,11 @@ gint FileData::FileList::sort_compare_filedata(
 			if (fa->format_class > fb->format_class) return 1;
 			/* fall back to name */
 			break;
+		case SORT_LUA:
+			ret = sort_compare_lua_value(fa, fb);
+			if (ret != 0) return ret;
+			/* fall back to name */
+			break;
 		case SORT_NUMBER:
 			if (settings->case_sensitive)
 				{
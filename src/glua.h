@@ -21,13 +21,44 @@
 #ifndef GLUA_H
 #define GLUA_H
 
+#include <ctime>
+#include <functional>
+#include <string>
+#include <vector>
+
 #include <glib.h>
 
 class FileData;
+struct LuaListJob;
+
+/**
+ * @brief What Image: returns in a script run on a worker thread
+ *
+ * Copied from the FileData on the main thread, which may change it while
+ * the script runs.
+ */
+struct LuaImageInfo
+{
+	explicit LuaImageInfo(const FileData *fd);
+
+	std::string path;
+	std::string name;
+	std::string extension;
+	time_t date;
+	gint64 size;
+	guint marks;
+};
+
+using LuaListDoneFunc = std::function<void(GList *list, const std::vector<const gchar *> &values)>;
 
 void lua_init();
+void lua_exit();
 
 gchar *lua_callvalue(FileData *fd, const gchar *file, const gchar *function);
+gchar *lua_callvalue_thread(const LuaImageInfo &image, const gchar *file);
+
+LuaListJob *lua_callvalue_list(GList *list, const gchar *file, const LuaListDoneFunc &done_func);
+void lua_callvalue_list_cancel(LuaListJob *job);
 
 #endif /* GLUA_H */
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -21,6 +21,7 @@
 #include "histogram.h"
 
 #include <algorithm>
+#include <array>
 #include <cmath>
 
 #include <gdk/gdk.h>
@@ -29,6 +30,7 @@
 #include "filedata.h"
 #include "geometry.h"
 #include "intl.h"
+#include "options.h"
 #include "pixbuf-util.h"
 
 /*
@@ -42,6 +44,12 @@ namespace
 
 constexpr gint HISTMAP_SIZE = 256;
 
+/* about this many pixels are read for the quick histogram */
+constexpr gint HISTMAP_PREVIEW_PIXELS = 1 << 18;
+
+/* the tables are filled in turn, so that neighbouring pixels of the same value do not wait on one counter */
+constexpr gint HISTMAP_COPIES = 4;
+
 void histogram_vgrid(const Histogram::Grid &grid, GdkPixbuf *pixbuf, GdkRectangle rect)
 {
 	if (grid.v == 0) return;
@@ -70,17 +78,34 @@ void histogram_hgrid(const Histogram::Grid &grid, GdkPixbuf *pixbuf, GdkRectangl
 		}
 }
 
-} // namespace
-
-struct HistMap {
+struct HistCounts {
 	gulong r[HISTMAP_SIZE];
 	gulong g[HISTMAP_SIZE];
 	gulong b[HISTMAP_SIZE];
 	gulong max[HISTMAP_SIZE];
+};
+
+} // namespace
 
-	guint idle_id; /* event source id */
+struct HistMapJob;
+
+struct HistMap : HistCounts {
+	HistMapJob *job; /**< Computing the histogram of all pixels, NULL when done */
+	gboolean preview; /**< The counts are of a sample of the pixels */
+};
+
+/**
+ * @brief The histogram of all pixels, computed on a worker thread
+ *
+ * The job is owned by the worker until it is done, and then by the main
+ * loop. Freeing the #HistMap clears \a histmap and sets \a cancel.
+ */
+struct HistMapJob {
+	FileData *fd;
+	HistMap *histmap; /**< Only accessed from the main loop */
 	GdkPixbuf *pixbuf;
-	gint y;
+	HistCounts counts;
+	gint cancel;
 };
 
 
@@ -153,90 +178,159 @@ static HistMap *histmap_new()
 void histmap_free(HistMap *histmap)
 {
 	if (!histmap) return;
-	if (histmap->idle_id) g_source_remove(histmap->idle_id);
-	if (histmap->pixbuf) g_object_unref(histmap->pixbuf);
+	if (histmap->job)
+		{
+		histmap->job->histmap = nullptr;
+		g_atomic_int_set(&histmap->job->cancel, TRUE);
+		}
 	g_free(histmap);
 }
 
-static gboolean histmap_read(HistMap *histmap, gboolean whole)
+/**
+ * @brief Counts the pixels of every \a sample th row and column of \a pixbuf
+ * @param pixbuf
+ * @param sample 1 for all pixels
+ * @param cancel Checked once per row, may be NULL
+ * @param[out] counts
+ * @returns FALSE if cancelled
+ *
+ * The pixels are counted into #HISTMAP_COPIES copies of each table in
+ * turn, and the copies are added up at the end.
+ */
+static gboolean histmap_read(GdkPixbuf *pixbuf, gint sample, const gint *cancel, HistCounts &counts)
 {
-	gint w;
-	gint h;
-	gint i;
-	gint j;
-	gint srs;
-	gint has_alpha;
-	gint step;
-	gint end_line;
-	guchar *s_pix;
-	GdkPixbuf *imgpixbuf = histmap->pixbuf;
-
-	w = gdk_pixbuf_get_width(imgpixbuf);
-	h = gdk_pixbuf_get_height(imgpixbuf);
-	srs = gdk_pixbuf_get_rowstride(imgpixbuf);
-	s_pix = gdk_pixbuf_get_pixels(imgpixbuf);
-	has_alpha = gdk_pixbuf_get_has_alpha(imgpixbuf);
-
-	if (whole)
+	const gint w = gdk_pixbuf_get_width(pixbuf);
+	const gint h = gdk_pixbuf_get_height(pixbuf);
+	const gint srs = gdk_pixbuf_get_rowstride(pixbuf);
+	const guchar *s_pix = gdk_pixbuf_get_pixels(pixbuf);
+	const gint step = (3 + !!gdk_pixbuf_get_has_alpha(pixbuf)) * sample;
+
+	using Tables = std::array<std::array<guint32, HISTMAP_SIZE>, HISTMAP_COPIES>;
+	Tables r{};
+	Tables g{};
+	Tables b{};
+	Tables max{};
+
+	const auto add = [&r, &g, &b, &max](gint copy, const guchar *sp)
+	{
+		r[copy][sp[0]]++;
+		g[copy][sp[1]]++;
+		b[copy][sp[2]]++;
+		max[copy][std::max({sp[0], sp[1], sp[2]})]++;
+	};
+
+	for (gint i = 0; i < h; i += sample)
 		{
-		end_line = h;
-		}
-	else
-		{
-		gint lines = 1 + (16384 / w);
-		end_line = histmap->y + lines;
-		end_line = std::min(end_line, h);
-		}
+		if (cancel && g_atomic_int_get(cancel)) return FALSE;
 
-	step = 3 + !!(has_alpha);
-	for (i = histmap->y; i < end_line; i++)
-		{
-		guchar *sp = s_pix + (i * srs); /* 8bit */
-		for (j = 0; j < w; j++)
-			{
-			guint max = std::max({sp[0], sp[1], sp[2]});
+		const guchar *sp = s_pix + (static_cast<gsize>(i) * srs); /* 8bit */
+		gint j = 0;
 
-			histmap->r[sp[0]]++;
-			histmap->g[sp[1]]++;
-			histmap->b[sp[2]]++;
-			histmap->max[max]++;
+		for (; j + ((HISTMAP_COPIES - 1) * sample) < w; j += HISTMAP_COPIES * sample)
+			{
+			add(0, sp);
+			add(1, sp + step);
+			add(2, sp + (2 * step));
+			add(3, sp + (3 * step));
+			sp += HISTMAP_COPIES * step;
+			}
 
+		for (; j < w; j += sample)
+			{
+			add(0, sp);
 			sp += step;
 			}
 		}
-	histmap->y = end_line;
-	return end_line >= h;
+
+	for (gint v = 0; v < HISTMAP_SIZE; v++)
+		{
+		counts.r[v] = counts.g[v] = counts.b[v] = counts.max[v] = 0;
+
+		for (gint copy = 0; copy < HISTMAP_COPIES; copy++)
+			{
+			counts.r[v] += r[copy][v];
+			counts.g[v] += g[copy][v];
+			counts.b[v] += b[copy][v];
+			counts.max[v] += max[copy][v];
+			}
+		}
+
+	return TRUE;
 }
 
 const HistMap *histmap_get(FileData *fd)
 {
-	if (fd->histmap && !fd->histmap->idle_id) return fd->histmap; /* histmap exists and is finished */
+	if (fd->histmap && (!fd->histmap->job || fd->histmap->preview)) return fd->histmap; /* histmap exists and is finished, or a preview */
 
 	return nullptr;
 }
 
-static gboolean histmap_idle_cb(gpointer data)
+static gboolean histmap_job_done_cb(gpointer data)
 {
-	auto fd = static_cast<FileData *>(data);
-	if (histmap_read(fd->histmap, FALSE))
+	auto job = static_cast<HistMapJob *>(data);
+
+	if (job->histmap)
 		{
 		/* finished */
-		g_object_unref(fd->histmap->pixbuf); /*pixbuf is no longer needed */
-		fd->histmap->pixbuf = nullptr;
-		fd->histmap->idle_id = 0;
-		file_data_send_notification(fd, NOTIFY_HISTMAP);
-		return G_SOURCE_REMOVE;
+		static_cast<HistCounts &>(*job->histmap) = job->counts;
+		job->histmap->preview = FALSE;
+		job->histmap->job = nullptr;
+		file_data_send_notification(job->fd, NOTIFY_HISTMAP);
 		}
-	return G_SOURCE_CONTINUE;
+
+	g_object_unref(job->pixbuf); /* pixbuf is no longer needed */
+	file_data_unref(job->fd);
+	delete job;
+
+	return G_SOURCE_REMOVE;
 }
 
-gboolean histmap_start_idle(FileData *fd)
+static void histmap_job_run(gpointer data, gpointer)
 {
+	auto job = static_cast<HistMapJob *>(data);
+
+	histmap_read(job->pixbuf, 1, &job->cancel, job->counts);
+
+	g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, histmap_job_done_cb, job, nullptr);
+}
+
+/**
+ * @brief Starts computing the histogram of \a fd->pixbuf
+ * @returns TRUE if started
+ *
+ * All pixels are counted on a worker thread. With \a options->image.histogram_preview
+ * a large image first gets a histogram of a sample of its pixels, which
+ * histmap_get() returns as soon as this returns.
+ */
+gboolean histmap_start(FileData *fd)
+{
+	static GThreadPool *pool = nullptr;
+
 	if (fd->histmap || !fd->pixbuf) return FALSE;
 
+	if (!pool)
+		{
+		pool = g_thread_pool_new(histmap_job_run, nullptr, 1, FALSE, nullptr);
+		}
+
 	fd->histmap = histmap_new();
-	fd->histmap->pixbuf = g_object_ref(fd->pixbuf);
-	fd->histmap->idle_id = g_idle_add_full(G_PRIORITY_DEFAULT_IDLE, histmap_idle_cb, fd, nullptr);
+
+	const gdouble pixels = static_cast<gdouble>(gdk_pixbuf_get_width(fd->pixbuf)) * gdk_pixbuf_get_height(fd->pixbuf);
+	if (options->image.histogram_preview && pixels > 4 * HISTMAP_PREVIEW_PIXELS)
+		{
+		const auto sample = static_cast<gint>(std::sqrt(pixels / HISTMAP_PREVIEW_PIXELS));
+
+		histmap_read(fd->pixbuf, sample, nullptr, *fd->histmap);
+		fd->histmap->preview = TRUE;
+		}
+
+	auto job = new HistMapJob();
+	job->fd = file_data_ref(fd);
+	job->histmap = fd->histmap;
+	job->pixbuf = g_object_ref(fd->pixbuf);
+	fd->histmap->job = job;
+
+	g_thread_pool_push(pool, job, nullptr);
 
 	return TRUE;
 }
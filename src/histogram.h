@@ -71,7 +71,7 @@ struct Histogram {
 
 void histmap_free(HistMap *histmap);
 const HistMap *histmap_get(FileData *fd);
-gboolean histmap_start_idle(FileData *fd);
+gboolean histmap_start(FileData *fd);
 
 void histogram_notify_cb(FileData *fd, NotifyType type, gpointer data);
 
@@ -20,10 +20,18 @@
 
 #include "image-load-external.h"
 
+#include <unistd.h>
+
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
 #include <gdk-pixbuf/gdk-pixbuf.h>
+#include <gio/gio.h>
 #include <glib-object.h>
 #include <glib.h>
 
+#include "debug.h"
 #include "filedata.h"
 #include "image-load.h"
 #include "misc.h"
@@ -33,6 +41,194 @@
 namespace
 {
 
+/*
+ *-------------------------------------------------------------------
+ * persistent tools
+ *-------------------------------------------------------------------
+ */
+
+/* With external_preview.persistent set, each tool is started once without
+ * arguments and then gets one request per line on stdin, answering each
+ * with one line on stdout:
+ *   identification: "<path>"            -> "0" for a match, anything else for none
+ *   extraction:     "<path>\t<output>"  -> any line once <output> is written
+ * Requests come from the loader threads and are serialized per tool. When
+ * a tool can not be started, stops answering or takes longer than
+ * TOOL_TIMEOUT, it is stopped and each request runs the tool as a separate
+ * command again.
+ */
+
+constexpr guint TOOL_TIMEOUT = 30; /**< seconds */
+
+struct ExternalPreviewTool
+{
+	GMutex mutex;
+	gchar *command;         /**< expanded path of the running tool */
+	GSubprocess *process;
+	GOutputStream *input;
+	GDataInputStream *output;
+	gboolean failed;        /**< do not restart command */
+};
+
+ExternalPreviewTool select_tool;
+ExternalPreviewTool extract_tool;
+
+void external_preview_tool_stop(ExternalPreviewTool &tool)
+{
+	if (tool.process)
+		{
+		g_subprocess_force_exit(tool.process);
+		g_clear_object(&tool.process);
+		}
+	tool.input = nullptr;
+	g_clear_object(&tool.output);
+}
+
+gboolean external_preview_tool_start(ExternalPreviewTool &tool, const gchar *command)
+{
+	if (g_strcmp0(tool.command, command) != 0)
+		{
+		external_preview_tool_stop(tool);
+		g_free(tool.command);
+		tool.command = g_strdup(command);
+		tool.failed = FALSE;
+		}
+
+	if (tool.process) return TRUE;
+	if (tool.failed) return FALSE;
+
+	g_autoptr(GError) error = nullptr;
+	tool.process = g_subprocess_new(static_cast<GSubprocessFlags>(G_SUBPROCESS_FLAGS_STDIN_PIPE | G_SUBPROCESS_FLAGS_STDOUT_PIPE),
+	                                &error, command, nullptr);
+	if (!tool.process)
+		{
+		log_printf("Cannot start external preview tool %s: %s\n", command, error->message);
+		tool.failed = TRUE;
+		return FALSE;
+		}
+
+	tool.input = g_subprocess_get_stdin_pipe(tool.process);
+	tool.output = g_data_input_stream_new(g_subprocess_get_stdout_pipe(tool.process));
+
+	DEBUG_1("External preview tool started: %s", command);
+	return TRUE;
+}
+
+struct ExternalPreviewReply
+{
+	GDataInputStream *output;
+	GCancellable *cancellable;
+	gchar *answer;
+	GError *error;
+	gboolean done;
+};
+
+void external_preview_tool_read_cb(GObject *source, GAsyncResult *res, gpointer data)
+{
+	auto *reply = static_cast<ExternalPreviewReply *>(data);
+
+	reply->answer = g_data_input_stream_read_line_finish(G_DATA_INPUT_STREAM(source), res, nullptr, &reply->error);
+	reply->done = TRUE;
+}
+
+void external_preview_tool_write_cb(GObject *source, GAsyncResult *res, gpointer data)
+{
+	auto *reply = static_cast<ExternalPreviewReply *>(data);
+
+	if (!g_output_stream_write_all_finish(G_OUTPUT_STREAM(source), res, nullptr, &reply->error))
+		{
+		reply->done = TRUE;
+		return;
+		}
+
+	g_data_input_stream_read_line_async(reply->output, G_PRIORITY_DEFAULT, reply->cancellable,
+	                                    external_preview_tool_read_cb, reply);
+}
+
+gboolean external_preview_tool_timeout_cb(gpointer data)
+{
+	g_cancellable_cancel(static_cast<GCancellable *>(data));
+
+	return G_SOURCE_REMOVE;
+}
+
+/**
+ * @brief Sends one request line to a persistent tool and waits for the answer
+ * @returns The answer, or nullptr when the tool is not usable
+ *
+ * The request and answer go through the streams asynchronously, on a main
+ * context of the calling loader thread, so that a tool which hangs is
+ * given up after TOOL_TIMEOUT rather than blocking the loaders for good.
+ */
+gchar *external_preview_tool_request(ExternalPreviewTool &tool, const gchar *command, const gchar *request)
+{
+	g_mutex_lock(&tool.mutex);
+
+	gchar *answer = nullptr;
+	if (external_preview_tool_start(tool, command))
+		{
+		g_autofree gchar *line = g_strconcat(request, "\n", nullptr);
+		g_autoptr(GCancellable) cancellable = g_cancellable_new();
+		ExternalPreviewReply reply{tool.output, cancellable, nullptr, nullptr, FALSE};
+
+		GMainContext *context = g_main_context_new();
+		g_main_context_push_thread_default(context);
+
+		GSource *timeout = g_timeout_source_new_seconds(TOOL_TIMEOUT);
+		g_source_set_callback(timeout, external_preview_tool_timeout_cb, cancellable, nullptr);
+		g_source_attach(timeout, context);
+
+		g_output_stream_write_all_async(tool.input, line, strlen(line), G_PRIORITY_DEFAULT, cancellable,
+		                                external_preview_tool_write_cb, &reply);
+
+		while (!reply.done) g_main_context_iteration(context, TRUE);
+
+		g_source_destroy(timeout);
+		g_source_unref(timeout);
+		g_main_context_pop_thread_default(context);
+		g_main_context_unref(context);
+
+		answer = reply.answer;
+		if (!answer)
+			{
+			if (g_cancellable_is_cancelled(cancellable))
+				{
+				log_printf("External preview tool %s did not answer within %u s\n", command, TOOL_TIMEOUT);
+				}
+			else
+				{
+				log_printf("External preview tool %s stopped answering%s%s\n", command,
+				           reply.error ? ": " : "", reply.error ? reply.error->message : "");
+				}
+			external_preview_tool_stop(tool);
+			tool.failed = TRUE;
+			}
+		g_clear_error(&reply.error);
+		}
+
+	g_mutex_unlock(&tool.mutex);
+
+	return answer;
+}
+
+/* requests are single lines with tab separated fields */
+gboolean external_preview_path_is_plain(const gchar *path)
+{
+	return !strpbrk(path, "\n\t");
+}
+
+struct ExternalPreviewSelection
+{
+	time_t date;
+	gint64 size;
+	gboolean match;
+};
+
+constexpr gsize SELECTION_CACHE_MAX = 50000;
+
+GMutex selection_mutex;
+std::unordered_map<std::string, ExternalPreviewSelection> selection_cache; /**< path -> decision of the identification tool */
+
 struct ImageLoaderExternal : public ImageLoaderBackend
 {
 public:
@@ -58,15 +254,29 @@ gboolean ImageLoaderExternal::write(const guchar *, gsize &chunk_size, gsize cou
 	g_autofree gchar *tilde_filename = expand_tilde(options->external_preview.extract);
 
 	g_autofree gchar *randname = g_strdup("/tmp/geeqie_external_preview_XXXXXX");
-	g_mkstemp(randname);
+	const gint tmp_fd = g_mkstemp(randname);
+	if (tmp_fd >= 0) close(tmp_fd);
+
+	g_autofree gchar *answer = nullptr;
+	if (options->external_preview.persistent && external_preview_path_is_plain(il->fd->path))
+		{
+		g_autofree gchar *request = g_strdup_printf("%s\t%s", il->fd->path, randname);
+		answer = external_preview_tool_request(extract_tool, tilde_filename, request);
+		}
 
-	g_autofree gchar *cmd_line = g_strdup_printf("\"%s\" \"%s\" \"%s\"", tilde_filename, il->fd->path, randname);
+	if (!answer)
+		{
+		g_autofree gchar *cmd_line = g_strdup_printf("\"%s\" \"%s\" \"%s\"", tilde_filename, il->fd->path, randname);
 
-	runcmd(cmd_line);
+		runcmd(cmd_line);
+		}
 
 	pixbuf = gdk_pixbuf_new_from_file(randname, nullptr);
 
-	area_updated_cb(nullptr, 0, 0, gdk_pixbuf_get_width(pixbuf), gdk_pixbuf_get_height(pixbuf), data);
+	if (pixbuf)
+		{
+		area_updated_cb(nullptr, 0, 0, gdk_pixbuf_get_width(pixbuf), gdk_pixbuf_get_height(pixbuf), data);
+		}
 
 	unlink_file(randname);
 
@@ -108,4 +318,50 @@ std::unique_ptr<ImageLoaderBackend> get_image_loader_backend_external()
 	return std::make_unique<ImageLoaderExternal>();
 }
 
+/**
+ * @brief Asks the identification tool whether the external loader should be used for fd
+ *
+ * The decision is kept until the file changes, so the tool runs once per
+ * file, not for each thumbnail, read ahead and view of it.
+ */
+gboolean image_loader_external_select(FileData *fd)
+{
+	if (!fd || !options->external_preview.enable) return FALSE;
+
+	g_mutex_lock(&selection_mutex);
+	auto it = selection_cache.find(fd->path);
+	const gboolean cached = it != selection_cache.end() && it->second.date == fd->date && it->second.size == fd->size;
+	const gboolean cached_match = cached && it->second.match;
+	g_mutex_unlock(&selection_mutex);
+
+	if (cached) return cached_match;
+
+	g_autofree gchar *tilde_filename = expand_tilde(options->external_preview.select);
+
+	g_autofree gchar *answer = nullptr;
+	if (options->external_preview.persistent && external_preview_path_is_plain(fd->path))
+		{
+		answer = external_preview_tool_request(select_tool, tilde_filename, fd->path);
+		}
+
+	gboolean match;
+	if (answer)
+		{
+		match = g_strcmp0(g_strstrip(answer), "0") == 0;
+		}
+	else
+		{
+		g_autofree gchar *cmd_line = g_strdup_printf("\"%s\" \"%s\"", tilde_filename, fd->path);
+
+		match = runcmd(cmd_line) == 0;
+		}
+
+	g_mutex_lock(&selection_mutex);
+	if (selection_cache.size() >= SELECTION_CACHE_MAX) selection_cache.clear();
+	selection_cache[fd->path] = {fd->date, fd->size, match};
+	g_mutex_unlock(&selection_mutex);
+
+	return match;
+}
+
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -38,6 +38,7 @@ public:
 	~ImageLoaderHEIF() override;
 
 	void init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, gpointer data) override;
+	void set_size(int width, int height) override;
 	gboolean write(const guchar *buf, gsize &chunk_size, gsize count, GError **error) override;
 	GdkPixbuf *get_pixbuf() override;
 	gchar *get_format_name() override;
@@ -47,11 +48,14 @@ public:
 
 private:
 	AreaUpdatedCb area_updated_cb;
+	SizePreparedCb size_prepared_cb;
 	gpointer data;
 
 	GdkPixbuf *pixbuf;
 	gint page_num;
 	gint page_total;
+	gint requested_width;
+	gint requested_height;
 };
 
 void free_buffer(guchar *, gpointer data)
@@ -74,11 +78,46 @@ gboolean ImageLoaderHEIF::write(const guchar *buf, gsize &chunk_size, gsize coun
 
 		heif::ImageHandle handle = ctx.get_image_handle(IDs[page_num]);
 
+		/* may ask for a smaller image, see set_size() */
+		size_prepared_cb(nullptr, handle.get_width(), handle.get_height(), data);
+
+		/* libheif cannot decode at reduced size, an embedded thumbnail
+		 * still covering the requested size is used instead if there is one
+		 */
+		const gboolean reduced = requested_width > 0 && requested_height > 0 &&
+		                         (handle.get_width() > requested_width || handle.get_height() > requested_height);
+		heif::ImageHandle source = handle;
+		if (reduced)
+			{
+			for (const heif_item_id id : handle.get_list_of_thumbnail_IDs())
+				{
+				heif::ImageHandle thumbnail = handle.get_thumbnail(id);
+				if (thumbnail.get_width() >= requested_width && thumbnail.get_height() >= requested_height &&
+				    thumbnail.get_width() < source.get_width())
+					{
+					source = thumbnail;
+					}
+				}
+			}
+
 		// decode the image and convert colorspace to RGB, saved as 24bit interleaved
 		heif_image *img;
-		heif_error error = heif_decode_image(handle.get_raw_image_handle(), &img, heif_colorspace_RGB, heif_chroma_interleaved_24bit, nullptr);
+		heif_error error = heif_decode_image(source.get_raw_image_handle(), &img, heif_colorspace_RGB, heif_chroma_interleaved_24bit, nullptr);
 		if (error.code) throw heif::Error(error);
 
+		/* the decode takes as long, but the pixbuf kept in the caches is much smaller */
+		if (reduced && (heif_image_get_width(img, heif_channel_interleaved) > requested_width ||
+		                heif_image_get_height(img, heif_channel_interleaved) > requested_height))
+			{
+			heif_image *scaled;
+			error = heif_image_scale_image(img, &scaled, requested_width, requested_height, nullptr);
+			if (!error.code)
+				{
+				heif_image_release(img);
+				img = scaled;
+				}
+			}
+
 		gint stride;
 		guint8* pixels = heif_image_get_plane(img, heif_channel_interleaved, &stride);
 		gint width = heif_image_get_width(img,heif_channel_interleaved);
@@ -99,11 +138,20 @@ gboolean ImageLoaderHEIF::write(const guchar *buf, gsize &chunk_size, gsize coun
 	return TRUE;
 }
 
-void ImageLoaderHEIF::init(AreaUpdatedCb area_updated_cb, SizePreparedCb, gpointer data)
+void ImageLoaderHEIF::init(AreaUpdatedCb area_updated_cb, SizePreparedCb size_prepared_cb, gpointer data)
 {
 	this->area_updated_cb = area_updated_cb;
+	this->size_prepared_cb = size_prepared_cb;
 	this->data = data;
 	page_num = 0;
+	requested_width = 0;
+	requested_height = 0;
+}
+
+void ImageLoaderHEIF::set_size(int width, int height)
+{
+	requested_width = width;
+	requested_height = height;
 }
 
 GdkPixbuf *ImageLoaderHEIF::get_pixbuf()
@@ -75,8 +75,8 @@
 #endif
 #include "image-load-webp.h"
 #include "image-load-zxscr.h"
+#include "image-probe.h"
 #include "jpeg-parser.h"
-#include "misc.h"
 #include "options.h"
 #include "pixbuf-renderer.h"
 #include "pixbuf-util.h"
@@ -147,12 +147,17 @@ static void image_loader_init(GTypeInstance *instance, gpointer)
 	il->read_buffer_size = IMAGE_LOADER_READ_BUFFER_SIZE_DEFAULT;
 	il->mapped_file = nullptr;
 	il->preview = IMAGE_LOADER_PREVIEW_NONE;
+	il->preview_only = FALSE;
 
 	il->requested_width = 0;
 	il->requested_height = 0;
 	il->actual_width = 0;
 	il->actual_height = 0;
 	il->shrunk = FALSE;
+	il->full_width = 0;
+	il->full_height = 0;
+	il->decode_time = 0;
+	il->decode_step_start = 0;
 
 	il->can_destroy = TRUE;
 
@@ -370,12 +375,12 @@ static gboolean image_loader_emit_size_prepared_cb(gpointer data)
 
 static void image_loader_emit_done(ImageLoader *il)
 {
-	g_idle_add_full(il->idle_priority, image_loader_emit_done_cb, il, nullptr);
+	g_idle_add_full(g_atomic_int_get(&il->idle_priority), image_loader_emit_done_cb, il, nullptr);
 }
 
 static void image_loader_emit_error(ImageLoader *il)
 {
-	g_idle_add_full(il->idle_priority, image_loader_emit_error_cb, il, nullptr);
+	g_idle_add_full(g_atomic_int_get(&il->idle_priority), image_loader_emit_error_cb, il, nullptr);
 }
 
 static void image_loader_emit_percent(ImageLoader *il)
@@ -500,6 +505,13 @@ static void image_loader_sync_pixbuf(ImageLoader *il)
 		g_object_set_data(G_OBJECT(pb), "stereo_data", GINT_TO_POINTER(STEREO_PIXBUF_CROSS));
 		}
 
+	if (il->shrunk && pb && gdk_pixbuf_get_width(pb) < il->full_width)
+		{
+		auto *full_size = g_new(GqSize, 1);
+		*full_size = {il->full_width, il->full_height};
+		g_object_set_data_full(G_OBJECT(pb), "full_size", full_size, g_free);
+		}
+
 	if (il->pixbuf) g_object_unref(il->pixbuf);
 
 	il->pixbuf = pb;
@@ -561,7 +573,8 @@ static void image_loader_size_prepared_cb(gpointer, gint width, gint height, gpo
 		gint n = 0;
 		while (mime_types[n] && !scale)
 			{
-			if (strstr(mime_types[n], "jpeg")) scale = TRUE;
+			/* the backends that decode at reduced size when asked */
+			if (strstr(mime_types[n], "jpeg") || g_strcmp0(mime_types[n], "image/heic") == 0) scale = TRUE;
 			n++;
 			}
 		}
@@ -580,12 +593,37 @@ static void image_loader_size_prepared_cb(gpointer, gint width, gint height, gpo
 
 		il->backend->set_size(il->actual_width, il->actual_height);
 		il->shrunk = TRUE;
+		il->full_width = width;
+		il->full_height = height;
 		}
 
 	g_mutex_unlock(il->data_mutex);
 	image_loader_emit_size_prepared(il);
 }
 
+/* call with data_mutex locked */
+static void image_loader_decode_step_end_unlocked(ImageLoader *il)
+{
+	if (!il->decode_step_start) return;
+
+	il->decode_time += g_get_monotonic_time() - il->decode_step_start;
+	il->decode_step_start = 0;
+}
+
+static void image_loader_decode_step_begin(ImageLoader *il)
+{
+	g_mutex_lock(il->data_mutex);
+	il->decode_step_start = g_get_monotonic_time();
+	g_mutex_unlock(il->data_mutex);
+}
+
+static void image_loader_decode_step_end(ImageLoader *il)
+{
+	g_mutex_lock(il->data_mutex);
+	image_loader_decode_step_end_unlocked(il);
+	g_mutex_unlock(il->data_mutex);
+}
+
 static void image_loader_stop_loader(ImageLoader *il)
 {
 	if (!il) return;
@@ -599,24 +637,19 @@ static void image_loader_stop_loader(ImageLoader *il)
 		}
 	g_mutex_lock(il->data_mutex);
 	il->done = TRUE;
+	/* done is emitted before the decode step returns, account for it now */
+	image_loader_decode_step_end_unlocked(il);
 	g_mutex_unlock(il->data_mutex);
 }
 
 static void image_loader_setup_loader(ImageLoader *il)
 {
-	gint external_preview = 1;
+	/* asked before locking, the identification tool may take a while */
+	const gboolean external_preview = image_loader_external_select(il->fd);
 
 	g_mutex_lock(il->data_mutex);
 
-	if (options->external_preview.enable)
-		{
-		g_autofree gchar *tilde_filename = expand_tilde(options->external_preview.select);
-		g_autofree gchar *cmd_line = g_strdup_printf("\"%s\" \"%s\"", tilde_filename, il->fd->path);
-
-		external_preview = runcmd(cmd_line);
-		}
-
-	if (external_preview == 0)
+	if (external_preview)
 		{
 		DEBUG_1("Using custom external loader");
 		il->backend = get_image_loader_backend_external();
@@ -926,7 +959,27 @@ static gboolean image_loader_setup_source(ImageLoader *il)
 		{
 		ExifData *exif = exif_read_fd(il->fd);
 
-		if (options->thumbnails.use_exif)
+		if (il->preview_only)
+			{
+			/* the smallest preview covering the requested size, else the largest of a raw file */
+			il->mapped_file = exif_get_preview(exif, reinterpret_cast<guint *>(&il->bytes_total), il->requested_width, il->requested_height);
+			if (!il->mapped_file)
+				{
+				il->mapped_file = exif_get_preview(exif, reinterpret_cast<guint *>(&il->bytes_total), 0, 0);
+				}
+
+			if (il->mapped_file && !is_jpeg_container(il->mapped_file, il->bytes_total))
+				{
+				exif_free_preview(il->mapped_file);
+				il->mapped_file = nullptr;
+				}
+
+			if (il->mapped_file)
+				{
+				il->preview = IMAGE_LOADER_PREVIEW_EXIF;
+				}
+			}
+		else if (options->thumbnails.use_exif)
 			{
 			il->mapped_file = exif_get_preview(exif, reinterpret_cast<guint *>(&il->bytes_total), il->requested_width, il->requested_height);
 
@@ -946,7 +999,7 @@ static gboolean image_loader_setup_source(ImageLoader *il)
 			}
 
 		/* If libraw does not find a thumbnail, try exiv2 */
-		if (!il->mapped_file)
+		if (!il->mapped_file && !il->preview_only)
 			{
 			il->mapped_file = exif_get_preview(exif, reinterpret_cast<guint *>(&il->bytes_total), 0, 0); /* get the largest available preview image or NULL for normal images*/
 
@@ -972,6 +1025,11 @@ static gboolean image_loader_setup_source(ImageLoader *il)
 		exif_free_fd(il->fd, exif);
 		}
 
+	if (!il->mapped_file && il->preview_only)
+		{
+		return FALSE;
+		}
+
 	if (!il->mapped_file)
 		{
 		/* normal file */
@@ -1127,10 +1185,15 @@ static void image_loader_thread_leave_high()
 	g_mutex_unlock(image_loader_prio_mutex);
 }
 
-static void image_loader_thread_wait_high()
+static gboolean image_loader_thread_is_low(ImageLoader *il)
+{
+	return g_atomic_int_get(&il->idle_priority) > G_PRIORITY_DEFAULT_IDLE;
+}
+
+static void image_loader_thread_wait_high(ImageLoader *il)
 {
 	g_mutex_lock(image_loader_prio_mutex);
-	while (image_loader_prio_num)
+	while (image_loader_prio_num && image_loader_thread_is_low(il))
 		{
 		g_cond_wait(image_loader_prio_cond, image_loader_prio_mutex);
 		}
@@ -1144,19 +1207,32 @@ static void image_loader_thread_run(gpointer data, gpointer)
 	auto il = static_cast<ImageLoader *>(data);
 	gboolean cont;
 	gboolean err;
+	gboolean high = FALSE;
 
-	if (il->idle_priority > G_PRIORITY_DEFAULT_IDLE)
+	/* the priority may be raised while the loader runs, never lowered */
+	const auto wait_or_enter_high = [il, &high]()
 		{
-		/* low prio, wait until high prio tasks finishes */
-		image_loader_thread_wait_high();
-		}
-	else
-		{
-		/* high prio */
-		image_loader_thread_enter_high();
-		}
+		if (high) return;
 
+		if (image_loader_thread_is_low(il))
+			{
+			/* low prio, wait until high prio tasks finishes */
+			image_loader_thread_wait_high(il);
+			}
+
+		if (!image_loader_thread_is_low(il))
+			{
+			/* high prio */
+			image_loader_thread_enter_high();
+			high = TRUE;
+			}
+		};
+
+	wait_or_enter_high();
+
+	image_loader_decode_step_begin(il);
 	err = !image_loader_begin(il);
+	image_loader_decode_step_end(il);
 
 	if (err)
 		{
@@ -1172,18 +1248,15 @@ static void image_loader_thread_run(gpointer data, gpointer)
 
 	while (cont && !image_loader_get_is_done(il) && !image_loader_get_stopping(il))
 		{
-		if (il->idle_priority > G_PRIORITY_DEFAULT_IDLE)
-			{
-			/* low prio, wait until high prio tasks finishes */
-			image_loader_thread_wait_high();
-			}
+		wait_or_enter_high();
+		image_loader_decode_step_begin(il);
 		cont = image_loader_continue(il);
+		image_loader_decode_step_end(il);
 		}
 	image_loader_stop_loader(il);
 
-	if (il->idle_priority <= G_PRIORITY_DEFAULT_IDLE)
+	if (high)
 		{
-		/* high prio */
 		image_loader_thread_leave_high();
 		}
 
@@ -1251,7 +1324,7 @@ GdkPixbuf *image_loader_get_pixbuf(ImageLoader *il)
 
 /**
  * @brief Speed up loading when you only need at most width x height size image,
- * only the jpeg GdkPixbuf loader benefits from it - so there is no
+ * only the jpeg and heif loaders benefit from it - so there is no
  * guarantee that the image will scale down to the requested size..
  */
 void image_loader_set_requested_size(ImageLoader *il, gint width, gint height)
@@ -1285,6 +1358,47 @@ void image_loader_set_priority(ImageLoader *il, gint priority)
 	il->idle_priority = priority;
 }
 
+/**
+ * @brief Raises the priority of a loader that may already run
+ *
+ * Used when a low priority prefetch becomes the displayed image, it then
+ * no longer waits for the high priority loaders.
+ */
+void image_loader_raise_priority(ImageLoader *il, gint priority)
+{
+	if (!il || priority >= il->idle_priority) return;
+
+	if (!il->thread)
+		{
+		il->idle_priority = priority;
+		if (il->idle_id)
+			{
+			GSource *source = g_main_context_find_source_by_id(nullptr, il->idle_id);
+			if (source) g_source_set_priority(source, priority);
+			}
+		return;
+		}
+
+	g_mutex_lock(image_loader_prio_mutex);
+	g_atomic_int_set(&il->idle_priority, priority);
+	g_cond_broadcast(image_loader_prio_cond);
+	g_mutex_unlock(image_loader_prio_mutex);
+}
+
+/**
+ * @brief Restricts the loader to a preview embedded in the file
+ *
+ * The smallest preview at least the requested size is used, or the
+ * smallest one when none is that large. image_loader_start() fails when
+ * the file has no usable preview.
+ */
+void image_loader_set_preview_only(ImageLoader *il, gboolean preview_only)
+{
+	if (!il) return;
+
+	il->preview_only = preview_only;
+}
+
 
 gdouble image_loader_get_percent(ImageLoader *il)
 {
@@ -1316,6 +1430,23 @@ gboolean image_loader_get_is_done(ImageLoader *il)
 	return ret;
 }
 
+/**
+ * @brief Time spent decoding, in milliseconds
+ *
+ * Time spent waiting for higher priority loaders is not counted.
+ * Only valid when the loader has finished.
+ */
+gdouble image_loader_get_decode_time(ImageLoader *il)
+{
+	if (!il) return 0.0;
+
+	g_mutex_lock(il->data_mutex);
+	const gint64 ret = il->decode_time;
+	g_mutex_unlock(il->data_mutex);
+
+	return ret / 1000.0;
+}
+
 FileData *image_loader_get_fd(ImageLoader *il)
 {
 	FileData *ret;
@@ -1341,10 +1472,34 @@ gboolean image_loader_get_shrunk(ImageLoader *il)
 
 
 /**
- *  @FIXME this can be rather slow and blocks until the size is known
+ * @brief Gets the size of the source of a pixbuf that was decoded at reduced size
+ * @returns FALSE if the pixbuf has the full resolution of its source
+ *
+ * See image_loader_set_requested_size().
+ */
+gboolean image_loader_pixbuf_get_full_size(GdkPixbuf *pixbuf, gint &width, gint &height)
+{
+	if (!pixbuf) return FALSE;
+
+	const auto *full_size = static_cast<GqSize *>(g_object_get_data(G_OBJECT(pixbuf), "full_size"));
+	if (!full_size) return FALSE;
+
+	width = full_size->width;
+	height = full_size->height;
+
+	return TRUE;
+}
+
+/**
+ * @brief Gets the size of an image, from its headers when possible
+ *
+ * Files the header probe does not know are started in an image loader.
+ * @FIXME that can be rather slow and blocks until the size is known
  */
 gboolean image_load_dimensions(FileData *fd, GqSize &dimensions)
 {
+	if (image_probe_dimensions(fd->path, dimensions)) return TRUE;
+
 	ImageLoader *il = image_loader_new(fd);
 
 	gboolean success = image_loader_start_idle(il);
@@ -74,6 +74,7 @@ struct ImageLoader
 	gsize bytes_total;
 
 	ImageLoaderPreview preview;
+	gboolean preview_only;  /**< load only an embedded preview, fail if there is none */
 
 	gint requested_width;
 	gint requested_height;
@@ -82,6 +83,8 @@ struct ImageLoader
 	gint actual_height;
 
 	gboolean shrunk;
+	gint full_width;        /**< source size, when shrunk */
+	gint full_height;
 
 	gboolean done;
 	guint idle_id; /**< event source id */
@@ -105,6 +108,9 @@ struct ImageLoader
 	guchar *mapped_file;
 	gsize read_buffer_size;
 	guint idle_read_loop_count;
+
+	gint64 decode_time; /**< microseconds spent decoding, excluding waits */
+	gint64 decode_step_start;
 };
 
 struct ImageLoaderClass {
@@ -131,6 +137,9 @@ void image_loader_set_requested_size(ImageLoader *il, gint width, gint height);
 void image_loader_set_buffer_size(ImageLoader *il, guint count);
 
 void image_loader_set_priority(ImageLoader *il, gint priority);
+void image_loader_raise_priority(ImageLoader *il, gint priority);
+
+void image_loader_set_preview_only(ImageLoader *il, gboolean preview_only);
 
 gboolean image_loader_start(ImageLoader *il);
 
@@ -138,8 +147,10 @@ gboolean image_loader_start(ImageLoader *il);
 GdkPixbuf *image_loader_get_pixbuf(ImageLoader *il);
 gdouble image_loader_get_percent(ImageLoader *il);
 gboolean image_loader_get_is_done(ImageLoader *il);
+gdouble image_loader_get_decode_time(ImageLoader *il);
 FileData *image_loader_get_fd(ImageLoader *il);
 gboolean image_loader_get_shrunk(ImageLoader *il);
+gboolean image_loader_pixbuf_get_full_size(GdkPixbuf *pixbuf, gint &width, gint &height);
 GError *image_loader_dup_error(ImageLoader *il);
 
 gboolean image_load_dimensions(FileData *fd, GqSize &dimensions);
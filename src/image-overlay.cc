@@ -343,8 +343,9 @@ static GdkPixbuf *image_osd_info_render(OverlayStateData *osd)
 		histmap = histmap_get(imd->image_fd);
 		if (!histmap)
 			{
-			histmap_start_idle(imd->image_fd);
-			with_hist = FALSE;
+			/* a quick histogram may be ready at once */
+			if (histmap_start(imd->image_fd)) histmap = histmap_get(imd->image_fd);
+			with_hist = (histmap != nullptr);
 			}
 		}
 
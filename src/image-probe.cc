@@ -0,0 +1,716 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "image-probe.h"
+
+#include <sys/types.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "jpeg-parser.h"
+#include "ui-fileops.h"
+
+/**
+ * @file
+ * Reads the size of an image from the headers of the file, without a
+ * decoder. Only the few small blocks holding the size are read.
+ *
+ * Supported are JPEG, PNG, WebP, HEIF/AVIF, TIFF, and raw files built on
+ * TIFF. For a raw file the size is that of its largest embedded JPEG
+ * preview, which is what the image loader shows.
+ *
+ * Files that are not recognised, or look damaged, are left to the image
+ * loader.
+ *
+ * The dates of the Exif data are read the same way, for the sorts and
+ * file lists that need nothing else of the metadata.
+ */
+
+namespace
+{
+
+constexpr gint MAX_JPEG_SEGMENTS = 256;
+constexpr guint MAX_TIFF_ENTRIES = 1024;
+constexpr guint MAX_TIFF_IFDS = 16;
+constexpr gint MAX_HEIF_BOXES = 64;
+constexpr guint64 MAX_HEIF_BOX_SIZE = 1024 * 1024;
+
+constexpr guint16 TIFF_ASCII = 2;
+constexpr guint16 TIFF_SHORT = 3;
+constexpr guint TIFF_COMPRESSION_OJPEG = 6;
+constexpr guint TIFF_COMPRESSION_JPEG = 7;
+
+enum {
+	TIFF_TAG_IMAGE_WIDTH = 256,
+	TIFF_TAG_IMAGE_LENGTH = 257,
+	TIFF_TAG_COMPRESSION = 259,
+	TIFF_TAG_STRIP_OFFSETS = 273,
+	TIFF_TAG_SUB_IFDS = 330,
+	TIFF_TAG_JPEG_OFFSET = 513,
+	TIFF_TAG_EXIF_IFD = 0x8769,
+	EXIF_TAG_DATE_TIME_ORIGINAL = 0x9003,
+	EXIF_TAG_DATE_TIME_DIGITIZED = 0x9004
+};
+
+constexpr gsize EXIF_DATE_LENGTH = 19; /**< "YYYY:MM:DD HH:MM:SS" */
+
+guint16 get_be16(const guchar *p)
+{
+	return (p[0] << 8) | p[1];
+}
+
+guint32 get_be32(const guchar *p)
+{
+	return (static_cast<guint32>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+guint64 get_be64(const guchar *p)
+{
+	return (static_cast<guint64>(get_be32(p)) << 32) | get_be32(p + 4);
+}
+
+guint16 get_le16(const guchar *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+guint32 get_le24(const guchar *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16);
+}
+
+guint32 get_le32(const guchar *p)
+{
+	return get_le24(p) | (static_cast<guint32>(p[3]) << 24);
+}
+
+gboolean read_at(FILE *f, gint64 offset, guchar *buf, gsize size)
+{
+	return fseeko(f, offset, SEEK_SET) == 0 && fread(buf, 1, size, f) == size;
+}
+
+gboolean set_dimensions(GqSize &dimensions, guint32 width, guint32 height)
+{
+	if (width == 0 || height == 0 || width > G_MAXINT || height > G_MAXINT) return FALSE;
+
+	dimensions = {static_cast<gint>(width), static_cast<gint>(height)};
+	return TRUE;
+}
+
+/**
+ * @brief Walks the segments up to the first frame header
+ *
+ * Lossless frames are rejected, they are not decoded by the loader and
+ * in raw files they hold the sensor data rather than a preview.
+ */
+gboolean probe_jpeg(FILE *f, gint64 offset, GqSize &dimensions)
+{
+	guchar buf[5];
+
+	if (!read_at(f, offset, buf, 2) || buf[0] != JPEG_MARKER || buf[1] != JPEG_MARKER_SOI) return FALSE;
+	offset += 2;
+
+	for (gint i = 0; i < MAX_JPEG_SEGMENTS; i++)
+		{
+		if (!read_at(f, offset, buf, 4) || buf[0] != JPEG_MARKER) return FALSE;
+
+		const guchar marker = buf[1];
+
+		if (marker == JPEG_MARKER)
+			{
+			/* fill byte */
+			offset++;
+			continue;
+			}
+		if (marker == JPEG_MARKER_EOI || marker == 0xDA) return FALSE;
+
+		/* SOF0 to SOF15, other than DHT, JPG and DAC */
+		if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+			{
+			if ((marker & 0x03) == 0x03) return FALSE;
+
+			if (!read_at(f, offset + 4, buf, 5)) return FALSE;
+
+			return set_dimensions(dimensions, get_be16(buf + 3), get_be16(buf + 1));
+			}
+
+		offset += 2 + get_be16(buf + 2);
+		}
+
+	return FALSE;
+}
+
+gboolean probe_png(const guchar *head, gsize size, GqSize &dimensions)
+{
+	static constexpr guchar signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+
+	if (size < 24 || memcmp(head, signature, sizeof(signature)) != 0 || memcmp(head + 12, "IHDR", 4) != 0) return FALSE;
+
+	return set_dimensions(dimensions, get_be32(head + 16), get_be32(head + 20));
+}
+
+gboolean probe_webp(const guchar *head, gsize size, GqSize &dimensions)
+{
+	if (size < 30 || memcmp(head, "RIFF", 4) != 0 || memcmp(head + 8, "WEBP", 4) != 0) return FALSE;
+
+	const guchar *chunk = head + 12;
+	const guchar *data = head + 20;
+
+	if (memcmp(chunk, "VP8X", 4) == 0)
+		{
+		return set_dimensions(dimensions, get_le24(data + 4) + 1, get_le24(data + 7) + 1);
+		}
+
+	if (memcmp(chunk, "VP8L", 4) == 0 && data[0] == 0x2f)
+		{
+		const guint32 bits = get_le32(data + 1);
+
+		return set_dimensions(dimensions, (bits & 0x3fff) + 1, ((bits >> 14) & 0x3fff) + 1);
+		}
+
+	if (memcmp(chunk, "VP8 ", 4) == 0 && data[3] == 0x9d && data[4] == 0x01 && data[5] == 0x2a)
+		{
+		return set_dimensions(dimensions, get_le16(data + 6) & 0x3fff, get_le16(data + 8) & 0x3fff);
+		}
+
+	return FALSE;
+}
+
+/*
+ *-------------------------------------------------------------------
+ * HEIF
+ *-------------------------------------------------------------------
+ */
+
+struct HeifBox
+{
+	const guchar *type;
+	const guchar *data;
+	gsize size;
+
+	bool is(const gchar *name) const { return memcmp(type, name, 4) == 0; }
+};
+
+std::vector<HeifBox> heif_boxes(const guchar *data, gsize size)
+{
+	std::vector<HeifBox> boxes;
+
+	while (size >= 8)
+		{
+		guint64 box_size = get_be32(data);
+		gsize header = 8;
+
+		if (box_size == 1)
+			{
+			if (size < 16) break;
+			box_size = get_be64(data + 8);
+			header = 16;
+			}
+		else if (box_size == 0)
+			{
+			box_size = size;
+			}
+
+		if (box_size < header || box_size > size) break;
+
+		boxes.push_back({data + 4, data + header, static_cast<gsize>(box_size - header)});
+		data += box_size;
+		size -= box_size;
+		}
+
+	return boxes;
+}
+
+/**
+ * @brief Finds the size of the primary item, with its crop and rotation applied as libheif does
+ */
+gboolean probe_heif_meta(const guchar *data, gsize size, GqSize &dimensions)
+{
+	if (size < 4) return FALSE;
+
+	guint32 primary = 0;
+	std::vector<HeifBox> properties;
+	const HeifBox *ipma = nullptr;
+	std::vector<HeifBox> iprp;
+
+	const std::vector<HeifBox> meta = heif_boxes(data + 4, size - 4);
+	for (const HeifBox &box : meta)
+		{
+		if (box.is("pitm") && box.size >= 6)
+			{
+			primary = (box.data[0] == 0) ? get_be16(box.data + 4) : (box.size >= 8 ? get_be32(box.data + 4) : 0);
+			}
+		else if (box.is("iprp"))
+			{
+			iprp = heif_boxes(box.data, box.size);
+			}
+		}
+
+	for (const HeifBox &box : iprp)
+		{
+		if (box.is("ipco")) properties = heif_boxes(box.data, box.size);
+		else if (box.is("ipma")) ipma = &box;
+		}
+
+	if (primary == 0 || !ipma || ipma->size < 8) return FALSE;
+
+	const guchar *d = ipma->data;
+	const gsize end = ipma->size;
+	const gboolean long_ids = d[0] >= 1;
+	const gboolean long_indices = (d[3] & 1) != 0;
+	const guint32 entries = get_be32(d + 4);
+	gsize pos = 8;
+
+	guint32 width = 0;
+	guint32 height = 0;
+
+	for (guint32 i = 0; i < entries; i++)
+		{
+		if (pos + (long_ids ? 5 : 3) > end) return FALSE;
+
+		const guint32 item = long_ids ? get_be32(d + pos) : get_be16(d + pos);
+		pos += long_ids ? 4 : 2;
+		const guint count = d[pos++];
+
+		for (guint j = 0; j < count; j++)
+			{
+			if (pos + (long_indices ? 2 : 1) > end) return FALSE;
+
+			const guint index = long_indices ? (get_be16(d + pos) & 0x7fff) : (d[pos] & 0x7f);
+			pos += long_indices ? 2 : 1;
+
+			if (item != primary || index == 0 || index > properties.size()) continue;
+
+			/* in the order they apply */
+			const HeifBox &property = properties[index - 1];
+
+			if (property.is("ispe") && property.size >= 12)
+				{
+				width = get_be32(property.data + 4);
+				height = get_be32(property.data + 8);
+				}
+			else if (property.is("clap") && property.size >= 16)
+				{
+				const guint32 width_d = get_be32(property.data + 4);
+				const guint32 height_d = get_be32(property.data + 12);
+
+				if (width_d > 0 && height_d > 0)
+					{
+					width = get_be32(property.data) / width_d;
+					height = get_be32(property.data + 8) / height_d;
+					}
+				}
+			else if (property.is("irot") && property.size >= 1 && (property.data[0] & 1))
+				{
+				std::swap(width, height);
+				}
+			}
+
+		if (item == primary) break;
+		}
+
+	return set_dimensions(dimensions, width, height);
+}
+
+gboolean probe_heif(FILE *f, const guchar *head, gsize size, GqSize &dimensions)
+{
+	static constexpr const gchar *brands[] = {"mif1", "msf1", "heic", "heix", "avif", "avis"};
+
+	if (size < 16 || memcmp(head + 4, "ftyp", 4) != 0) return FALSE;
+
+	/* the major brand, then the compatible brands */
+	const gsize ftyp_size = std::min<gsize>(get_be32(head), size);
+	gboolean supported = FALSE;
+	for (gsize offset = 8; offset + 4 <= ftyp_size && !supported; offset += (offset == 8) ? 8 : 4)
+		{
+		for (const gchar *brand : brands)
+			{
+			if (memcmp(head + offset, brand, 4) == 0) supported = TRUE;
+			}
+		}
+	if (!supported) return FALSE;
+
+	gint64 offset = 0;
+	for (gint i = 0; i < MAX_HEIF_BOXES; i++)
+		{
+		guchar buf[16];
+		if (!read_at(f, offset, buf, 8)) return FALSE;
+
+		guint64 box_size = get_be32(buf);
+		if (box_size == 1)
+			{
+			if (!read_at(f, offset + 8, buf + 8, 8)) return FALSE;
+			box_size = get_be64(buf + 8);
+			}
+		if (box_size < 8) return FALSE;
+
+		if (memcmp(buf + 4, "meta", 4) == 0)
+			{
+			if (box_size > MAX_HEIF_BOX_SIZE) return FALSE;
+
+			std::vector<guchar> meta(box_size);
+			if (!read_at(f, offset, meta.data(), meta.size())) return FALSE;
+
+			const std::vector<HeifBox> boxes = heif_boxes(meta.data(), meta.size());
+			return !boxes.empty() && probe_heif_meta(boxes[0].data, boxes[0].size, dimensions);
+			}
+
+		offset += box_size;
+		}
+
+	return FALSE;
+}
+
+/*
+ *-------------------------------------------------------------------
+ * TIFF
+ *-------------------------------------------------------------------
+ */
+
+struct TiffFile
+{
+	FILE *f;
+	gboolean big_endian;
+
+	guint16 u16(const guchar *p) const { return big_endian ? get_be16(p) : get_le16(p); }
+	guint32 u32(const guchar *p) const { return big_endian ? get_be32(p) : get_le32(p); }
+};
+
+struct TiffIfd
+{
+	guint32 width = 0;
+	guint32 height = 0;
+	guint32 compression = 0;
+	guint32 strip_offset = 0; /**< when there is a single strip */
+	guint32 jpeg_offset = 0;
+	std::vector<guint32> sub_ifds;
+	guint32 next = 0;
+};
+
+gboolean tiff_read_ifd(const TiffFile &tiff, guint32 offset, TiffIfd &ifd)
+{
+	guchar buf[2];
+	if (offset == 0 || !read_at(tiff.f, offset, buf, 2)) return FALSE;
+
+	const guint count = tiff.u16(buf);
+	if (count == 0 || count > MAX_TIFF_ENTRIES) return FALSE;
+
+	std::vector<guchar> entries((count * 12) + 4);
+	if (!read_at(tiff.f, offset + 2, entries.data(), entries.size())) return FALSE;
+
+	for (guint i = 0; i < count; i++)
+		{
+		const guchar *entry = entries.data() + (i * 12);
+		const guint tag = tiff.u16(entry);
+		const guint32 n = tiff.u32(entry + 4);
+		const guint32 value = (tiff.u16(entry + 2) == TIFF_SHORT) ? tiff.u16(entry + 8) : tiff.u32(entry + 8);
+
+		switch (tag)
+			{
+			case TIFF_TAG_IMAGE_WIDTH:
+				ifd.width = value;
+				break;
+			case TIFF_TAG_IMAGE_LENGTH:
+				ifd.height = value;
+				break;
+			case TIFF_TAG_COMPRESSION:
+				ifd.compression = value;
+				break;
+			case TIFF_TAG_STRIP_OFFSETS:
+				if (n == 1) ifd.strip_offset = value;
+				break;
+			case TIFF_TAG_SUB_IFDS:
+				if (n == 1)
+					{
+					ifd.sub_ifds.push_back(value);
+					}
+				else if (n > 1 && n <= MAX_TIFF_IFDS)
+					{
+					std::vector<guchar> offsets(n * 4);
+					if (!read_at(tiff.f, value, offsets.data(), offsets.size())) break;
+
+					for (guint32 j = 0; j < n; j++) ifd.sub_ifds.push_back(tiff.u32(offsets.data() + (j * 4)));
+					}
+				break;
+			case TIFF_TAG_JPEG_OFFSET:
+				ifd.jpeg_offset = value;
+				break;
+			default:
+				break;
+			}
+		}
+
+	ifd.next = tiff.u32(entries.data() + (count * 12));
+
+	return TRUE;
+}
+
+gboolean probe_tiff(FILE *f, const guchar *head, gsize size, gboolean raw, GqSize &dimensions)
+{
+	if (size < 8) return FALSE;
+
+	TiffFile tiff{f, FALSE};
+	if (head[0] == 'M' && head[1] == 'M') tiff.big_endian = TRUE;
+	else if (head[0] != 'I' || head[1] != 'I') return FALSE;
+
+	/* TIFF, or the variants of Olympus and Panasonic */
+	const guint16 magic = tiff.u16(head + 2);
+	if (magic != 42 && magic != 0x4f52 && magic != 0x5352 && magic != 0x55) return FALSE;
+
+	TiffIfd ifd0;
+	if (!tiff_read_ifd(tiff, tiff.u32(head + 4), ifd0)) return FALSE;
+
+	if (!raw && magic == 42) return set_dimensions(dimensions, ifd0.width, ifd0.height);
+
+	/* the IFD chain and the sub IFDs of each, a bounded number of them */
+	std::vector<TiffIfd> ifds{ifd0};
+	for (gsize i = 0; i < ifds.size() && ifds.size() < MAX_TIFF_IFDS; i++)
+		{
+		std::vector<guint32> offsets = ifds[i].sub_ifds;
+		offsets.push_back(ifds[i].next);
+
+		for (guint32 offset : offsets)
+			{
+			TiffIfd ifd;
+			if (ifds.size() < MAX_TIFF_IFDS && tiff_read_ifd(tiff, offset, ifd)) ifds.push_back(ifd);
+			}
+		}
+
+	GqSize best{0, 0};
+	for (const TiffIfd &ifd : ifds)
+		{
+		GqSize preview;
+		gboolean found = ifd.jpeg_offset && probe_jpeg(f, ifd.jpeg_offset, preview);
+
+		if (!found && ifd.strip_offset &&
+		    (ifd.compression == TIFF_COMPRESSION_OJPEG || ifd.compression == TIFF_COMPRESSION_JPEG))
+			{
+			found = probe_jpeg(f, ifd.strip_offset, preview);
+			}
+
+		if (found && static_cast<gint64>(preview.width) * preview.height > static_cast<gint64>(best.width) * best.height)
+			{
+			best = preview;
+			}
+		}
+
+	if (best.empty()) return FALSE;
+
+	dimensions = best;
+	return TRUE;
+}
+
+gboolean is_raw_file(const gchar *path)
+{
+	const gchar *ext = strrchr(path, '.');
+
+	return !ext || (g_ascii_strcasecmp(ext, ".tif") != 0 && g_ascii_strcasecmp(ext, ".tiff") != 0);
+}
+
+/*
+ *-------------------------------------------------------------------
+ * Exif
+ *-------------------------------------------------------------------
+ */
+
+/**
+ * @brief A TIFF structure in memory, the whole file or the Exif segment of a JPEG
+ */
+struct TiffBuffer
+{
+	const guchar *data;
+	gsize size;
+	gboolean big_endian;
+
+	guint16 u16(const guchar *p) const { return big_endian ? get_be16(p) : get_le16(p); }
+	guint32 u32(const guchar *p) const { return big_endian ? get_be32(p) : get_le32(p); }
+};
+
+/**
+ * @brief Finds an entry of an IFD
+ * @param[out] entry set to nullptr when the IFD has no such tag
+ * @returns FALSE when the IFD is not within the buffer
+ */
+gboolean tiff_buffer_entry(const TiffBuffer &tiff, guint32 offset, guint tag, const guchar *&entry)
+{
+	entry = nullptr;
+	if (offset < 8 || offset > tiff.size - 2) return FALSE;
+
+	const guint count = tiff.u16(tiff.data + offset);
+	if (count > MAX_TIFF_ENTRIES || offset + 2 + (count * 12) > tiff.size) return FALSE;
+
+	for (guint i = 0; i < count; i++)
+		{
+		const guchar *e = tiff.data + offset + 2 + (i * 12);
+		if (tiff.u16(e) == tag)
+			{
+			entry = e;
+			break;
+			}
+		}
+
+	return TRUE;
+}
+
+/**
+ * @brief Converts a date entry the way FileData::read_exif_time_data() does
+ * @returns 0 when the entry is missing or not a date
+ */
+time_t tiff_buffer_date(const TiffBuffer &tiff, guint32 ifd, guint tag)
+{
+	const guchar *entry;
+	if (!tiff_buffer_entry(tiff, ifd, tag, entry) || !entry) return 0;
+
+	const guint32 count = tiff.u32(entry + 4);
+	if (tiff.u16(entry + 2) != TIFF_ASCII || count < EXIF_DATE_LENGTH) return 0;
+
+	const guint32 offset = tiff.u32(entry + 8);
+	if (offset > tiff.size || EXIF_DATE_LENGTH > tiff.size - offset) return 0;
+
+	const std::string text(reinterpret_cast<const gchar *>(tiff.data + offset), EXIF_DATE_LENGTH);
+
+	std::tm time_str{};
+	if (!strptime(text.c_str(), "%Y:%m:%d %H:%M:%S", &time_str)) return 0;
+
+	return mktime(&time_str);
+}
+
+gboolean probe_exif_tiff(const guchar *data, gsize size, ImageProbeExif &exif)
+{
+	if (size < 8) return FALSE;
+
+	TiffBuffer tiff{data, size, FALSE};
+	if (data[0] == 'M' && data[1] == 'M') tiff.big_endian = TRUE;
+	else if (data[0] != 'I' || data[1] != 'I') return FALSE;
+
+	const guint16 magic = tiff.u16(data + 2);
+	if (magic != 42 && magic != 0x4f52 && magic != 0x5352 && magic != 0x55) return FALSE;
+
+	const guchar *entry;
+	if (!tiff_buffer_entry(tiff, tiff.u32(data + 4), TIFF_TAG_EXIF_IFD, entry)) return FALSE;
+
+	/* valid Exif data without the dates is an answer too */
+	if (!entry) return TRUE;
+
+	const guint32 exif_ifd = tiff.u32(entry + 8);
+	exif.date_original = tiff_buffer_date(tiff, exif_ifd, EXIF_TAG_DATE_TIME_ORIGINAL);
+	exif.date_digitized = tiff_buffer_date(tiff, exif_ifd, EXIF_TAG_DATE_TIME_DIGITIZED);
+
+	return TRUE;
+}
+
+/**
+ * @brief Finds the APP1 Exif segment, which precedes the image data
+ */
+gboolean probe_exif_jpeg(const guchar *data, gsize size, ImageProbeExif &exif)
+{
+	static constexpr guchar exif_id[] = {'E', 'x', 'i', 'f', 0, 0};
+	gsize offset = 2;
+
+	for (gint i = 0; i < MAX_JPEG_SEGMENTS && offset + 4 <= size; i++)
+		{
+		if (data[offset] != JPEG_MARKER) return FALSE;
+
+		const guchar marker = data[offset + 1];
+
+		if (marker == JPEG_MARKER)
+			{
+			offset++;
+			continue;
+			}
+		if (marker == JPEG_MARKER_EOI || marker == 0xDA) return FALSE;
+
+		const gsize length = get_be16(data + offset + 2);
+		if (length < 2 || offset + 2 + length > size) return FALSE;
+
+		const guchar *segment = data + offset + 4;
+		if (marker == JPEG_MARKER_APP1 && length - 2 >= sizeof(exif_id) && memcmp(segment, exif_id, sizeof(exif_id)) == 0)
+			{
+			return probe_exif_tiff(segment + sizeof(exif_id), length - 2 - sizeof(exif_id), exif);
+			}
+
+		offset += 2 + length;
+		}
+
+	return FALSE;
+}
+
+} // namespace
+
+/**
+ * @brief Reads the size of an image from its headers
+ * @param path file name in UTF-8
+ * @param[out] dimensions set only on success
+ * @returns FALSE when the file has to be decoded to know its size
+ *
+ * Safe to call from any thread.
+ */
+gboolean image_probe_dimensions(const gchar *path, GqSize &dimensions)
+{
+	g_autofree gchar *pathl = path_from_utf8(path);
+	g_autoptr(FILE) f = fopen(pathl, "rb");
+	if (!f) return FALSE;
+
+	guchar head[64];
+	const gsize size = fread(head, 1, sizeof(head), f);
+
+	if (size >= 2 && head[0] == JPEG_MARKER && head[1] == JPEG_MARKER_SOI) return probe_jpeg(f, 0, dimensions);
+	if (probe_png(head, size, dimensions)) return TRUE;
+	if (probe_webp(head, size, dimensions)) return TRUE;
+	if (size >= 8 && memcmp(head + 4, "ftyp", 4) == 0) return probe_heif(f, head, size, dimensions);
+	if (size >= 8 && (head[0] == 'I' || head[0] == 'M')) return probe_tiff(f, head, size, is_raw_file(path), dimensions);
+
+	return FALSE;
+}
+
+/**
+ * @brief Reads the dates of the Exif data of a JPEG, TIFF or raw file built on TIFF
+ * @param path file name in UTF-8
+ * @param[out] exif set only on success, a date not in the file is 0
+ * @returns FALSE when the Exif data has to be read by exiv2
+ *
+ * The file is mapped, not read, only the pages of the headers are
+ * touched. Safe to call from any thread.
+ */
+gboolean image_probe_exif(const gchar *path, ImageProbeExif &exif)
+{
+	g_autofree gchar *pathl = path_from_utf8(path);
+	g_autoptr(GMappedFile) mapped = g_mapped_file_new(pathl, FALSE, nullptr);
+	if (!mapped) return FALSE;
+
+	const auto *data = reinterpret_cast<const guchar *>(g_mapped_file_get_contents(mapped));
+	const gsize size = g_mapped_file_get_length(mapped);
+	if (size < 8) return FALSE;
+
+	ImageProbeExif result;
+	gboolean found = FALSE;
+
+	if (data[0] == JPEG_MARKER && data[1] == JPEG_MARKER_SOI) found = probe_exif_jpeg(data, size, result);
+	else if (data[0] == 'I' || data[0] == 'M') found = probe_exif_tiff(data, size, result);
+
+	if (found) exif = result;
+	return found;
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef IMAGE_PROBE_H
+#define IMAGE_PROBE_H
+
+#include <ctime>
+
+#include <glib.h>
+
+#include "geometry.h"
+
+/**
+ * @brief The Exif dates that sorts and file lists use
+ */
+struct ImageProbeExif
+{
+	time_t date_original = 0;       /**< Exif.Photo.DateTimeOriginal, 0 if not set */
+	time_t date_digitized = 0;      /**< Exif.Photo.DateTimeDigitized, 0 if not set */
+};
+
+gboolean image_probe_dimensions(const gchar *path, GqSize &dimensions);
+gboolean image_probe_exif(const gchar *path, ImageProbeExif &exif);
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
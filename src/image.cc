@@ -21,8 +21,10 @@
 
 #include "image.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
+#include <memory>
 
 #include <cairo.h>
 #include <glib-object.h>
@@ -119,7 +121,9 @@ SelectionRectangle selection_rectangle;
 static GList *image_list = nullptr;
 
 static void image_read_ahead_start(ImageWindow *imd);
-static void image_cache_set(ImageWindow *imd, FileData *fd);
+static void image_cache_set(ImageWindow *imd, FileData *fd, ImageLoader *il);
+static void image_full_decode_check(ImageWindow *imd);
+static gdouble image_reduced_ratio(ImageWindow *imd);
 
 /*
  *-------------------------------------------------------------------
@@ -203,8 +207,11 @@ static void image_press_cb(PixbufRenderer *pr, GqMouseButtonEvent *event, gpoint
 		GqPoint pixel;
 		pixbuf_renderer_get_mouse_position(pr, pixel);
 		selection_rectangle = SelectionRectangle(std::max(0, gint(event->x)), std::max(0, gint(event->y)), options->rectangle_draw_aspect_ratio);
-		image_start.x = std::max(0, pixel.x);
-		image_start.y = std::max(0, pixel.y);
+
+		/* the rectangle is in pixels of the image file */
+		const gdouble ratio = image_reduced_ratio(imd);
+		image_start.x = std::max(0, static_cast<gint>(pixel.x * ratio));
+		image_start.y = std::max(0, static_cast<gint>(pixel.y * ratio));
 		}
 	if (rect_id)
 		{
@@ -248,13 +255,15 @@ static void image_drag_cb(PixbufRenderer *pr, GqPointerMotionEvent *event, gpoin
 		{
 		gint width;
 		gint height;
-		pixbuf_renderer_get_image_size(pr, width, height);
+		image_get_image_size(imd, width, height);
 
 		GqPoint pixel;
 		pixbuf_renderer_get_mouse_position(pr, pixel);
 
-		if (pixel.x == -1) pixel.x = width;
-		if (pixel.y == -1) pixel.y = height;
+		/* the rectangle is in pixels of the image file */
+		const gdouble ratio = image_reduced_ratio(imd);
+		pixel.x = (pixel.x == -1) ? width : static_cast<gint>(pixel.x * ratio);
+		pixel.y = (pixel.y == -1) ? height : static_cast<gint>(pixel.y * ratio);
 
 		if (options->rectangle_draw_aspect_ratio != RECTANGLE_DRAW_ASPECT_RATIO_NONE)
 			{
@@ -366,6 +375,8 @@ static void image_zoom_cb(PixbufRenderer *, gdouble, gpointer data)
 	if (imd->title_show_zoom) image_update_title(imd);
 	image_state_set(imd, IMAGE_STATE_IMAGE);
 	image_update_util(imd);
+
+	image_full_decode_check(imd);
 }
 
 /*
@@ -704,13 +715,18 @@ static void image_set_pixbuf_renderer_post_process_func(ImageWindow *imd)
 {
 	if (imd->cm || imd->desaturate || imd->overunderexposed)
 		{
-		const auto image_post_process_tile_color_cb = [imd](PixbufRenderer *, GdkPixbuf **pixbuf, gint x, gint y, gint w, gint h)
+		/* tiles may be post processed on worker threads, so nothing refers back to imd */
+		std::shared_ptr<const ColorMan> cm = imd->cm ? std::make_shared<const ColorMan>(*imd->cm) : nullptr;
+		const gboolean desaturate = imd->desaturate;
+		const gboolean overunderexposed = imd->overunderexposed;
+
+		const auto image_post_process_tile_color_cb = [cm, desaturate, overunderexposed](PixbufRenderer *, GdkPixbuf **pixbuf, gint x, gint y, gint w, gint h)
 		{
-			if (imd->cm) imd->cm->correct_region(*pixbuf, {x, y, w, h});
-			if (imd->desaturate) pixbuf_desaturate_rect(*pixbuf, x, y, w, h);
-			if (imd->overunderexposed) pixbuf_highlight_overunderexposed(*pixbuf, x, y, w, h);
+			if (cm) cm->correct_region(*pixbuf, {x, y, w, h});
+			if (desaturate) pixbuf_desaturate_rect(*pixbuf, x, y, w, h);
+			if (overunderexposed) pixbuf_highlight_overunderexposed(*pixbuf, x, y, w, h);
 		};
-		pixbuf_renderer_set_post_process_func(PIXBUF_RENDERER(imd->pr), image_post_process_tile_color_cb, (imd->cm != nullptr) );
+		pixbuf_renderer_set_post_process_func(PIXBUF_RENDERER(imd->pr), image_post_process_tile_color_cb, imd->cm && imd->cm->is_slow());
 		}
 	else
 		{
@@ -742,6 +758,196 @@ void image_set_ignore_alpha(ImageWindow *imd, gboolean ignore_alpha)
    pixbuf_renderer_set_ignore_alpha(PIXBUF_RENDERER(imd->pr), ignore_alpha);
 }
 
+/*
+ *-------------------------------------------------------------------
+ * reduced size decode
+ *-------------------------------------------------------------------
+ */
+
+/* With zoom to fit, large images are decoded at about the size of the view,
+ * which backends like jpeg do in a fraction of the time and memory of a full
+ * decode. The pixbuf remembers the size of its source, see
+ * image_loader_pixbuf_get_full_size(), and zoom and image size are reported
+ * relative to the source. When the user zooms in or the view grows, the
+ * image is decoded again at full size and swapped in.
+ */
+
+static gint image_view_size(ImageWindow *imd)
+{
+	PixbufRenderer *pr = PIXBUF_RENDERER(imd->pr);
+
+	return std::max(pr->window_width, pr->window_height) * gtk_widget_get_scale_factor(imd->pr);
+}
+
+/**
+ * @brief Asks il for an image just covering the view, if it will be shown at zoom to fit
+ * @param zoom The zoom the image will be shown at
+ */
+static void image_loader_request_view_size(ImageWindow *imd, ImageLoader *il, gdouble zoom)
+{
+	if (!options->image.reduced_decode || zoom != 0.0) return;
+
+	const gint size = image_view_size(imd);
+	if (size < 1) return;
+
+	/* a square, so that the image still covers the view when exif rotation swaps its sides */
+	image_loader_set_requested_size(il, size, size);
+}
+
+static gboolean image_pixbuf_covers_view(ImageWindow *imd, GdkPixbuf *pixbuf)
+{
+	gint full_width;
+	gint full_height;
+
+	if (!image_loader_pixbuf_get_full_size(pixbuf, full_width, full_height)) return TRUE;
+	if (PIXBUF_RENDERER(imd->pr)->zoom != 0.0) return FALSE;
+
+	return std::max(gdk_pixbuf_get_width(pixbuf), gdk_pixbuf_get_height(pixbuf)) >= image_view_size(imd);
+}
+
+/**
+ * @brief Size of the source relative to @a pixbuf
+ * @returns 1.0 unless it was decoded at reduced size
+ *
+ * Pixel positions in @a pixbuf are multiplied by this to get those in the
+ * image file, as the user sees them.
+ */
+gdouble image_pixbuf_reduced_ratio(GdkPixbuf *pixbuf)
+{
+	gint full_width;
+	gint full_height;
+
+	if (!image_loader_pixbuf_get_full_size(pixbuf, full_width, full_height)) return 1.0;
+
+	return static_cast<gdouble>(full_width) / gdk_pixbuf_get_width(pixbuf);
+}
+
+/* size of the source relative to the shown pixbuf */
+static gdouble image_reduced_ratio(ImageWindow *imd)
+{
+	return image_pixbuf_reduced_ratio(image_get_pixbuf(imd));
+}
+
+/* zoom is 0 for fit, a scale when >= 1 and -1/scale below that */
+static gdouble image_zoom_scale(gdouble zoom, gdouble ratio)
+{
+	if (zoom == 0.0 || ratio == 1.0) return zoom;
+
+	const gdouble scale = (zoom > 0.0 ? zoom : -1.0 / zoom) * ratio;
+
+	return scale >= 1.0 ? scale : -1.0 / scale;
+}
+
+static void image_full_decode_cancel(ImageWindow *imd)
+{
+	image_loader_free(imd->full_il);
+	imd->full_il = nullptr;
+}
+
+static void image_full_decode_done_cb(ImageLoader *il, gpointer data)
+{
+	auto imd = static_cast<ImageWindow *>(data);
+
+	GdkPixbuf *pixbuf = image_loader_get_pixbuf(il);
+	if (pixbuf && image_loader_get_fd(il) == imd->image_fd)
+		{
+		DEBUG_1("%s full size decode done for :%s", get_exec_time(), imd->image_fd->path);
+
+		gdouble x;
+		gdouble y;
+		image_get_scroll_center(imd, x, y);
+
+		/* keeps the zoom relative to the source, so the view does not jump */
+		image_change_pixbuf(imd, pixbuf, image_zoom_get(imd), FALSE);
+		image_set_scroll_center(imd, x, y);
+		}
+
+	image_full_decode_cancel(imd);
+}
+
+static void image_full_decode_check(ImageWindow *imd)
+{
+	if (imd->il || imd->full_il || !imd->image_fd) return;
+
+	GdkPixbuf *pixbuf = image_get_pixbuf(imd);
+	if (!pixbuf || image_pixbuf_covers_view(imd, pixbuf)) return;
+
+	DEBUG_1("%s full size decode started for :%s", get_exec_time(), imd->image_fd->path);
+
+	imd->full_il = image_loader_new(imd->image_fd);
+	image_loader_request_view_size(imd, imd->full_il, PIXBUF_RENDERER(imd->pr)->zoom);
+
+	g_signal_connect(G_OBJECT(imd->full_il), "error", (GCallback)image_full_decode_done_cb, imd);
+	g_signal_connect(G_OBJECT(imd->full_il), "done", (GCallback)image_full_decode_done_cb, imd);
+
+	if (!image_loader_start(imd->full_il)) image_full_decode_cancel(imd);
+}
+
+/*
+ *-------------------------------------------------------------------
+ * embedded preview
+ *-------------------------------------------------------------------
+ */
+
+/* Raw files and many jpegs carry a smaller preview, which decodes in a
+ * fraction of the time of the image. With zoom to fit it is decoded next
+ * to the image and shown as soon as it is ready, with the orientation and
+ * color management of the image. The image then behaves as with delay
+ * flip and replaces the preview when done, see image_load_done_cb().
+ */
+
+static void image_preview_cancel(ImageWindow *imd)
+{
+	image_loader_free(imd->preview_il);
+	imd->preview_il = nullptr;
+}
+
+static void image_preview_done_cb(ImageLoader *il, gpointer data)
+{
+	auto imd = static_cast<ImageWindow *>(data);
+
+	GdkPixbuf *pixbuf = image_loader_get_pixbuf(il);
+	if (pixbuf && imd->il && image_get_pixbuf(imd) != image_loader_get_pixbuf(imd->il))
+		{
+		DEBUG_1("%s embedded preview done for :%s", get_exec_time(), imd->image_fd->path);
+
+		/* once the image size is known, zoom and size are reported relative to it */
+		g_mutex_lock(imd->il->data_mutex);
+		const gint full_width = imd->il->shrunk ? imd->il->full_width : imd->il->actual_width;
+		const gint full_height = imd->il->shrunk ? imd->il->full_height : imd->il->actual_height;
+		g_mutex_unlock(imd->il->data_mutex);
+
+		if (full_width > gdk_pixbuf_get_width(pixbuf))
+			{
+			auto *full_size = g_new(GqSize, 1);
+			*full_size = {full_width, full_height};
+			g_object_set_data_full(G_OBJECT(pixbuf), "full_size", full_size, g_free);
+			}
+
+		imd->preview_shown = TRUE;
+		image_change_pixbuf(imd, pixbuf, image_zoom_get(imd), FALSE);
+		}
+
+	image_preview_cancel(imd);
+}
+
+static void image_preview_start(ImageWindow *imd, FileData *fd)
+{
+	if (!options->image.embedded_preview || PIXBUF_RENDERER(imd->pr)->zoom != 0.0) return;
+
+	/* a quarter of the view is enough to recognize the image */
+	const gint size = std::max(image_view_size(imd) / 4, 1);
+
+	imd->preview_il = image_loader_new(fd);
+	image_loader_set_preview_only(imd->preview_il, TRUE);
+	image_loader_set_requested_size(imd->preview_il, size, size);
+
+	g_signal_connect(G_OBJECT(imd->preview_il), "error", (GCallback)image_preview_done_cb, imd);
+	g_signal_connect(G_OBJECT(imd->preview_il), "done", (GCallback)image_preview_done_cb, imd);
+
+	if (!image_loader_start(imd->preview_il)) image_preview_cancel(imd);
+}
+
 /*
  *-------------------------------------------------------------------
  * read ahead (prebuffer)
@@ -773,7 +979,7 @@ static void image_read_ahead_done_cb(ImageLoader *, gpointer data)
 		if (imd->read_ahead_fd->pixbuf)
 			{
 			g_object_ref(imd->read_ahead_fd->pixbuf);
-			image_cache_set(imd, imd->read_ahead_fd);
+			image_cache_set(imd, imd->read_ahead_fd, imd->read_ahead_il);
 			}
 		}
 	image_loader_free(imd->read_ahead_il);
@@ -799,6 +1005,7 @@ static void image_read_ahead_start(ImageWindow *imd)
 	DEBUG_1("%s read ahead started for :%s", get_exec_time(), imd->read_ahead_fd->path);
 
 	imd->read_ahead_il = image_loader_new(imd->read_ahead_fd);
+	image_loader_request_view_size(imd, imd->read_ahead_il, image_zoom_get_default(imd));
 
 	image_loader_delay_area_ready(imd->read_ahead_il, TRUE); /* we will need the area_ready signals later */
 
@@ -831,6 +1038,11 @@ static void image_read_ahead_set(ImageWindow *imd, FileData *fd)
  *-------------------------------------------------------------------
  */
 
+static gsize image_pixbuf_size(GdkPixbuf *pixbuf)
+{
+	return static_cast<gsize>(gdk_pixbuf_get_rowstride(pixbuf)) * static_cast<gsize>(gdk_pixbuf_get_height(pixbuf));
+}
+
 static void image_cache_release_cb(FileData *fd)
 {
 	g_object_unref(fd->pixbuf);
@@ -839,16 +1051,33 @@ static void image_cache_release_cb(FileData *fd)
 
 static FileCache *image_get_cache()
 {
-	static FileCache *cache = file_cache_new(image_cache_release_cb, 1);
-	file_cache_set_max_size(cache, static_cast<gulong>(options->image.image_cache_max) * 1048576); /* update from options */
+	static FileCache *cache = file_cache_new(image_cache_release_cb, 1, "image");
+
+	/* update from options */
+	if (options->image.image_cache_auto)
+		{
+		file_cache_set_max_size(cache, file_cache_memory_budget());
+		}
+	else
+		{
+		file_cache_set_max_size(cache, static_cast<gulong>(options->image.image_cache_max) * 1048576);
+		}
 	return cache;
 }
 
-static void image_cache_set(ImageWindow *, FileData *fd)
+/**
+ * @brief Adds the decoded image of fd to the cache
+ *
+ * The decode time of il is the cost of the entry, so slow formats
+ * stay cached longer than images that are quick to load again.
+ */
+static void image_cache_set(ImageWindow *, FileData *fd, ImageLoader *il)
 {
+	static const FileCache::CostClass cost_class = FileCache::register_cost_class("image decode ms", 50.0);
+
 	g_assert(fd->pixbuf);
 
-	file_cache_put(image_get_cache(), fd, static_cast<gulong>(gdk_pixbuf_get_rowstride(fd->pixbuf)) * static_cast<gulong>(gdk_pixbuf_get_height(fd->pixbuf)));
+	file_cache_put_with_cost(image_get_cache(), fd, image_pixbuf_size(fd->pixbuf), cost_class, image_loader_get_decode_time(il));
 	file_data_send_notification(fd, NOTIFY_PIXBUF); /* to update histogram */
 }
 
@@ -856,7 +1085,8 @@ static gint image_cache_get(ImageWindow *imd)
 {
 	gint success;
 
-	success = file_cache_get(image_get_cache(), imd->image_fd);
+	success = file_cache_get(image_get_cache(), imd->image_fd) &&
+	          image_pixbuf_covers_view(imd, imd->image_fd->pixbuf);
 	if (success)
 		{
 		g_assert(imd->image_fd->pixbuf);
@@ -866,6 +1096,228 @@ static gint image_cache_get(ImageWindow *imd)
 	return success;
 }
 
+/*
+ *-------------------------------------------------------------------
+ * prefetch window
+ *-------------------------------------------------------------------
+ */
+
+/* Images further away than the read ahead image are decoded at low
+ * priority into the image cache. The window is trimmed to what fits in
+ * the cache, so prefetching never evicts the images it is about to need.
+ */
+
+namespace
+{
+
+struct ImagePrefetch
+{
+	FileData *fd;
+	ImageLoader *il;
+};
+
+gsize image_prefetch_estimate = 0; /**< decoded size of the last prefetched image, in bytes */
+
+void image_prefetch_free(gpointer data)
+{
+	auto ip = static_cast<ImagePrefetch *>(data);
+
+	image_loader_free(ip->il);
+	file_data_unref(ip->fd);
+	g_free(ip);
+}
+
+GList *image_prefetch_find(ImageWindow *imd, FileData *fd)
+{
+	for (GList *work = imd->prefetch_list; work; work = work->next)
+		{
+		if (static_cast<ImagePrefetch *>(work->data)->fd == fd) return work;
+		}
+
+	return nullptr;
+}
+
+} // namespace
+
+static void image_prefetch_start(ImageWindow *imd);
+
+static void image_prefetch_cancel(ImageWindow *imd)
+{
+	g_list_free_full(imd->prefetch_list, image_prefetch_free);
+	imd->prefetch_list = nullptr;
+}
+
+static void image_prefetch_done_cb(ImageLoader *il, gpointer data)
+{
+	auto imd = static_cast<ImageWindow *>(data);
+
+	GList *work = imd->prefetch_list;
+	while (work && static_cast<ImagePrefetch *>(work->data)->il != il) work = work->next;
+	if (!work) return;
+
+	auto ip = static_cast<ImagePrefetch *>(work->data);
+	imd->prefetch_list = g_list_delete_link(imd->prefetch_list, work);
+
+	DEBUG_1("%s prefetch done for :%s", get_exec_time(), ip->fd->path);
+
+	GdkPixbuf *pixbuf = image_loader_get_pixbuf(il);
+	if (pixbuf && !ip->fd->pixbuf)
+		{
+		ip->fd->pixbuf = g_object_ref(pixbuf);
+		image_prefetch_estimate = image_pixbuf_size(pixbuf);
+		image_cache_set(imd, ip->fd, il);
+		}
+
+	image_prefetch_free(ip);
+
+	image_prefetch_start(imd);
+}
+
+static void image_prefetch_start(ImageWindow *imd)
+{
+	const guint max_running = g_get_num_processors();
+	guint running = 0;
+
+	GList *work = imd->prefetch_list;
+	while (work && running < max_running)
+		{
+		auto ip = static_cast<ImagePrefetch *>(work->data);
+		GList *next = work->next;
+
+		if (!ip->il)
+			{
+			DEBUG_1("%s prefetch started for :%s", get_exec_time(), ip->fd->path);
+
+			ip->il = image_loader_new(ip->fd);
+			image_loader_request_view_size(imd, ip->il, image_zoom_get_default(imd));
+
+			/* never hold up the image being shown */
+			image_loader_set_priority(ip->il, G_PRIORITY_LOW);
+			image_loader_delay_area_ready(ip->il, TRUE); /* may become the displayed image */
+
+			g_signal_connect(G_OBJECT(ip->il), "error", (GCallback)image_prefetch_done_cb, imd);
+			g_signal_connect(G_OBJECT(ip->il), "done", (GCallback)image_prefetch_done_cb, imd);
+
+			if (!image_loader_start(ip->il))
+				{
+				imd->prefetch_list = g_list_delete_link(imd->prefetch_list, work);
+				image_prefetch_free(ip);
+				work = next;
+				continue;
+				}
+			}
+
+		running++;
+		work = next;
+		}
+}
+
+/**
+ * @brief Hands a prefetch of the new image over to the read ahead slot
+ *
+ * image_read_ahead_check() then continues it as the main loader instead
+ * of starting the decode again.
+ */
+static void image_prefetch_promote(ImageWindow *imd)
+{
+	GList *work = image_prefetch_find(imd, imd->image_fd);
+	if (!work) return;
+
+	auto ip = static_cast<ImagePrefetch *>(work->data);
+	imd->prefetch_list = g_list_delete_link(imd->prefetch_list, work);
+
+	if (!ip->il)
+		{
+		image_prefetch_free(ip);
+		return;
+		}
+
+	DEBUG_1("%s prefetch promoted for :%s", get_exec_time(), ip->fd->path);
+
+	image_read_ahead_cancel(imd);
+
+	/* it is the image shown now, stop yielding to other loaders */
+	image_loader_raise_priority(ip->il, G_PRIORITY_DEFAULT_IDLE);
+
+	g_signal_handlers_disconnect_by_func(G_OBJECT(ip->il), (gpointer)image_prefetch_done_cb, imd);
+	g_signal_connect(G_OBJECT(ip->il), "error", (GCallback)image_read_ahead_error_cb, imd);
+	g_signal_connect(G_OBJECT(ip->il), "done", (GCallback)image_read_ahead_done_cb, imd);
+
+	imd->read_ahead_fd = ip->fd;
+	imd->read_ahead_il = ip->il;
+	g_free(ip);
+}
+
+/**
+ * @brief Sets the images to decode in the background
+ * @param list Images in the order they are likely to be needed
+ *
+ * Decodes of images no longer in the list are cancelled, the others are
+ * kept and reordered. The list is cut where the images, together with the
+ * current and read ahead images, would no longer fit in the image cache.
+ */
+void image_prefetch_set(ImageWindow *imd, const std::vector<FileData *> &list)
+{
+	if (pixbuf_renderer_get_tiles(PIXBUF_RENDERER(imd->pr)))
+		{
+		image_prefetch_cancel(imd);
+		return;
+		}
+
+	FileCache *cache = image_get_cache();
+	const gsize budget = file_cache_get_max_size(cache);
+
+	gsize used = 0;
+	if (imd->image_fd) used += imd->image_fd->pixbuf ? image_pixbuf_size(imd->image_fd->pixbuf) : image_prefetch_estimate;
+	if (imd->read_ahead_fd) used += image_prefetch_estimate;
+
+	GList *old_list = imd->prefetch_list;
+	imd->prefetch_list = nullptr;
+
+	GList *new_list = nullptr;
+	for (FileData *fd : list)
+		{
+		if (!fd || fd == imd->image_fd || fd == imd->read_ahead_fd) continue;
+
+		/* a hit also moves it to the front of the cache */
+		if (file_cache_get(cache, fd))
+			{
+			used += image_pixbuf_size(fd->pixbuf);
+			continue;
+			}
+
+		used += image_prefetch_estimate;
+		if (used > budget) break;
+
+		GList *work = old_list;
+		while (work && static_cast<ImagePrefetch *>(work->data)->fd != fd) work = work->next;
+
+		ImagePrefetch *ip;
+		if (work)
+			{
+			ip = static_cast<ImagePrefetch *>(work->data);
+			old_list = g_list_delete_link(old_list, work);
+			}
+		else
+			{
+			ip = g_new0(ImagePrefetch, 1);
+			ip->fd = file_data_ref(fd);
+			}
+
+		new_list = g_list_prepend(new_list, ip);
+		}
+
+	for (GList *work = old_list; work; work = work->next)
+		{
+		DEBUG_1("%s prefetch cancelled for :%s", get_exec_time(), static_cast<ImagePrefetch *>(work->data)->fd->path);
+		}
+	g_list_free_full(old_list, image_prefetch_free);
+
+	imd->prefetch_list = g_list_reverse(new_list);
+
+	image_prefetch_start(imd);
+}
+
 /*
  *-------------------------------------------------------------------
  * loading
@@ -884,7 +1336,7 @@ static void image_load_area_ready_cb(ImageLoader *il, const GdkRectangle *area,
 	auto imd = static_cast<ImageWindow *>(data);
 	PixbufRenderer *pr = PIXBUF_RENDERER(imd->pr);
 
-	if (imd->delay_flip &&
+	if ((imd->delay_flip || imd->preview_shown) &&
 	    pr->pixbuf != image_loader_get_pixbuf(il))
 		{
 		return;
@@ -904,21 +1356,37 @@ static void image_load_done_cb(ImageLoader *, gpointer data)
 	if (options->image.enable_read_ahead && imd->image_fd && !imd->image_fd->pixbuf && image_loader_get_pixbuf(imd->il))
 		{
 		imd->image_fd->pixbuf = g_object_ref(image_loader_get_pixbuf(imd->il));
-		image_cache_set(imd, imd->image_fd);
+		image_cache_set(imd, imd->image_fd, imd->il);
 		}
 	/* call the callback triggered by image_state after fd->pixbuf is set */
 	g_object_set(imd->pr, "loading", FALSE, NULL);
 	image_state_unset(imd, IMAGE_STATE_LOADING);
 
+	image_preview_cancel(imd);
+
 	if (!image_loader_get_pixbuf(imd->il))
 		{
-		GdkPixbuf *pixbuf = pixbuf_fallback(imd->image_fd, 0, 0);
+		/* a preview beats the broken image icon */
+		if (!imd->preview_shown)
+			{
+			GdkPixbuf *pixbuf = pixbuf_fallback(imd->image_fd, 0, 0);
 
-		image_change_pixbuf(imd, pixbuf, image_zoom_get(imd), FALSE);
-		g_object_unref(pixbuf);
+			image_change_pixbuf(imd, pixbuf, image_zoom_get(imd), FALSE);
+			g_object_unref(pixbuf);
+			}
 
 		imd->unknown = TRUE;
 		}
+	else if (imd->preview_shown)
+		{
+		gdouble x;
+		gdouble y;
+		image_get_scroll_center(imd, x, y);
+
+		g_object_set(imd->pr, "complete", FALSE, NULL);
+		image_change_pixbuf(imd, image_loader_get_pixbuf(imd->il), image_zoom_get(imd), FALSE);
+		image_set_scroll_center(imd, x, y);
+		}
 	else if (imd->delay_flip &&
 	    image_get_pixbuf(imd) != image_loader_get_pixbuf(imd->il))
 		{
@@ -926,9 +1394,12 @@ static void image_load_done_cb(ImageLoader *, gpointer data)
 		image_change_pixbuf(imd, image_loader_get_pixbuf(imd->il), image_zoom_get(imd), FALSE);
 		}
 
+	imd->preview_shown = FALSE;
+
 	image_loader_free(imd->il);
 	imd->il = nullptr;
 
+	image_full_decode_check(imd);
 	image_read_ahead_start(imd);
 }
 
@@ -1013,7 +1484,7 @@ static gboolean image_read_ahead_check(ImageWindow *imd)
 		imd->read_ahead_fd = nullptr;
 		return TRUE;
 		}
-	if (imd->read_ahead_fd->pixbuf)
+	if (imd->read_ahead_fd->pixbuf && image_pixbuf_covers_view(imd, imd->read_ahead_fd->pixbuf))
 		{
 		image_change_pixbuf(imd, imd->read_ahead_fd->pixbuf, image_zoom_get(imd), FALSE);
 
@@ -1042,6 +1513,8 @@ static gboolean image_load_begin(ImageWindow *imd, FileData *fd)
 		return TRUE;
 		}
 
+	image_prefetch_promote(imd);
+
 	if (image_read_ahead_check(imd))
 		{
 		DEBUG_1("from read ahead buffer: %s", imd->image_fd->path);
@@ -1060,6 +1533,7 @@ static gboolean image_load_begin(ImageWindow *imd, FileData *fd)
 	g_object_set(imd->pr, "loading", TRUE, NULL);
 
 	imd->il = image_loader_new(fd);
+	image_loader_request_view_size(imd, imd->il, PIXBUF_RENDERER(imd->pr)->zoom);
 
 	image_load_set_signals(imd, FALSE);
 
@@ -1079,6 +1553,8 @@ static gboolean image_load_begin(ImageWindow *imd, FileData *fd)
 
 	image_state_set(imd, IMAGE_STATE_LOADING);
 
+	image_preview_start(imd, fd);
+
 /*
 	if (!imd->delay_flip && !image_get_pixbuf(imd) && image_loader_get_pixbuf(imd->il))
 		{
@@ -1099,7 +1575,13 @@ static void image_reset(ImageWindow *imd)
 	image_loader_free(imd->il);
 	imd->il = nullptr;
 
+	image_full_decode_cancel(imd);
+
+	image_preview_cancel(imd);
+	imd->preview_shown = FALSE;
+
 	g_clear_pointer(&imd->cm, delete_cb<ColorMan>);
+	image_set_pixbuf_renderer_post_process_func(imd);
 
 	image_state_set(imd, IMAGE_STATE_NONE);
 }
@@ -1422,9 +1904,22 @@ void image_change_fd(ImageWindow *imd, FileData *fd, gdouble zoom)
 	image_change_real(imd, fd, nullptr, nullptr, zoom);
 }
 
+/* the size of the source image, even when it was decoded at reduced size */
 gboolean image_get_image_size(ImageWindow *imd, gint &width, gint &height)
 {
-	return pixbuf_renderer_get_image_size(PIXBUF_RENDERER(imd->pr), width, height);
+	if (!pixbuf_renderer_get_image_size(PIXBUF_RENDERER(imd->pr), width, height)) return FALSE;
+
+	GdkPixbuf *pixbuf = image_get_pixbuf(imd);
+	gint full_width;
+	gint full_height;
+	if (image_loader_pixbuf_get_full_size(pixbuf, full_width, full_height))
+		{
+		const gboolean swapped = width != gdk_pixbuf_get_width(pixbuf);
+		width = swapped ? full_height : full_width;
+		height = swapped ? full_width : full_height;
+		}
+
+	return TRUE;
 }
 
 GdkPixbuf *image_get_pixbuf(ImageWindow *imd)
@@ -1432,6 +1927,53 @@ GdkPixbuf *image_get_pixbuf(ImageWindow *imd)
 	return pixbuf_renderer_get_pixbuf(PIXBUF_RENDERER(imd->pr));
 }
 
+static void image_copy_to_clipboard_done_cb(ImageLoader *il, gpointer data)
+{
+	auto clipboard = static_cast<GdkClipboard *>(data);
+
+	if (GdkPixbuf *pixbuf = image_loader_get_pixbuf(il))
+		{
+		g_autoptr(GdkTexture) texture = pixbuf_to_texture(pixbuf);
+		gdk_clipboard_set_texture(clipboard, texture);
+		}
+
+	g_object_unref(clipboard);
+	image_loader_free(il);
+}
+
+/**
+ * @brief Copies the image to the clipboard
+ *
+ * When the shown image was decoded at reduced size, the file is decoded
+ * again, so the clipboard gets the full resolution.
+ */
+void image_copy_to_clipboard(ImageWindow *imd, GdkClipboard *clipboard)
+{
+	GdkPixbuf *pixbuf = image_get_pixbuf(imd);
+	if (!pixbuf || !clipboard) return;
+
+	gint full_width;
+	gint full_height;
+	if (imd->image_fd && image_loader_pixbuf_get_full_size(pixbuf, full_width, full_height))
+		{
+		ImageLoader *il = image_loader_new(imd->image_fd);
+		g_object_ref(clipboard);
+
+		g_signal_connect(G_OBJECT(il), "error", (GCallback)image_copy_to_clipboard_done_cb, clipboard);
+		g_signal_connect(G_OBJECT(il), "done", (GCallback)image_copy_to_clipboard_done_cb, clipboard);
+
+		if (!image_loader_start(il))
+			{
+			g_object_unref(clipboard);
+			image_loader_free(il);
+			}
+		return;
+		}
+
+	g_autoptr(GdkTexture) texture = pixbuf_to_texture(pixbuf);
+	gdk_clipboard_set_texture(clipboard, texture);
+}
+
 void image_change_pixbuf(ImageWindow *imd, GdkPixbuf *pixbuf, gdouble zoom, gboolean lazy)
 {
 	LayoutWindow *lw;
@@ -1574,6 +2116,12 @@ void image_move_from_image(ImageWindow *imd, ImageWindow *source)
 	image_loader_free(imd->il);
 	imd->il = nullptr;
 
+	image_full_decode_cancel(imd);
+	image_full_decode_cancel(source);
+
+	image_preview_cancel(imd);
+	image_preview_cancel(source);
+
 	image_set_fd(imd, image_get_fd(source));
 
 
@@ -1585,6 +2133,9 @@ void image_move_from_image(ImageWindow *imd, ImageWindow *source)
 		image_loader_sync_data(imd->il, source, imd);
 		}
 
+	imd->preview_shown = source->preview_shown;
+	source->preview_shown = FALSE;
+
 	imd->color_profile_enable = source->color_profile_enable;
 	imd->color_profile_input = source->color_profile_input;
 	imd->color_profile_use_image = source->color_profile_use_image;
@@ -1623,6 +2174,13 @@ void image_copy_from_image(ImageWindow *imd, ImageWindow *source)
 	image_loader_free(imd->il);
 	imd->il = nullptr;
 
+	image_full_decode_cancel(imd);
+	image_full_decode_cancel(source);
+
+	image_preview_cancel(imd);
+	image_preview_cancel(source);
+	imd->preview_shown = FALSE;
+
 	image_set_fd(imd, image_get_fd(source));
 
 
@@ -1645,6 +2203,10 @@ void image_copy_from_image(ImageWindow *imd, ImageWindow *source)
 	imd->read_ahead_fd = source->read_ahead_fd;
 	source->read_ahead_fd = nullptr;
 
+	/* decoded prefetches are in the cache already, the rest starts over */
+	image_prefetch_cancel(imd);
+	image_prefetch_cancel(source);
+
 	imd->completed = source->completed;
 	imd->state = source->state;
 	source->state = IMAGE_STATE_NONE;
@@ -1792,7 +2354,7 @@ void image_zoom_set_limits(ImageWindow *imd, gdouble min, gdouble max)
 
 void image_zoom_set(ImageWindow *imd, gdouble zoom)
 {
-	pixbuf_renderer_zoom_set(PIXBUF_RENDERER(imd->pr), zoom);
+	pixbuf_renderer_zoom_set(PIXBUF_RENDERER(imd->pr), image_zoom_scale(zoom, image_reduced_ratio(imd)));
 }
 
 void image_zoom_set_fill_geometry(ImageWindow *imd, gboolean vertical)
@@ -1824,12 +2386,12 @@ void image_zoom_set_fill_geometry(ImageWindow *imd, gboolean vertical)
 
 gdouble image_zoom_get(ImageWindow *imd)
 {
-	return pixbuf_renderer_zoom_get(PIXBUF_RENDERER(imd->pr));
+	return image_zoom_scale(pixbuf_renderer_zoom_get(PIXBUF_RENDERER(imd->pr)), 1.0 / image_reduced_ratio(imd));
 }
 
 gdouble image_zoom_get_real(ImageWindow *imd)
 {
-	return pixbuf_renderer_zoom_get_scale(PIXBUF_RENDERER(imd->pr));
+	return pixbuf_renderer_zoom_get_scale(PIXBUF_RENDERER(imd->pr)) / image_reduced_ratio(imd);
 }
 
 gchar *image_zoom_get_as_text(ImageWindow *imd)
@@ -1927,6 +2489,7 @@ void image_prebuffer_set(ImageWindow *imd, FileData *fd)
 	else
 		{
 		image_read_ahead_cancel(imd);
+		image_prefetch_cancel(imd);
 		}
 }
 
@@ -2068,6 +2631,7 @@ void image_set_delay_flip(ImageWindow *imd, gboolean delay)
 		pr = PIXBUF_RENDERER(imd->pr);
 		if (pr->pixbuf) g_object_unref(pr->pixbuf);
 		pr->pixbuf = nullptr;
+		imd->preview_shown = FALSE;
 
 		image_load_pixbuf_ready(imd);
 		}
@@ -2172,6 +2736,7 @@ static void image_free(ImageWindow *imd)
 	image_reset(imd);
 
 	image_read_ahead_cancel(imd);
+	image_prefetch_cancel(imd);
 
 	file_data_unref(imd->image_fd);
 	g_free(imd->title);
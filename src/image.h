@@ -24,6 +24,7 @@
 
 #include <functional>
 #include <optional>
+#include <vector>
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <gdk/gdk.h>
@@ -136,6 +137,10 @@ struct ImageWindow
 
 	FileData *read_ahead_fd;
 	ImageLoader *read_ahead_il;
+	ImageLoader *full_il;	/**< decodes at full size when a reduced size decode no longer covers the view */
+	ImageLoader *preview_il;	/**< decodes the embedded preview while il decodes the image */
+	gboolean preview_shown;	/**< the embedded preview is shown until il is done */
+	GList *prefetch_list;	/**< ImagePrefetch, further images to decode, most wanted first */
 
 	gint prev_color_row;
 
@@ -207,7 +212,9 @@ void image_copy_from_image(ImageWindow *imd, ImageWindow *source);
 void image_move_from_image(ImageWindow *imd, ImageWindow *source);
 
 gboolean image_get_image_size(ImageWindow *imd, gint &width, gint &height);
+gdouble image_pixbuf_reduced_ratio(GdkPixbuf *pixbuf);
 GdkPixbuf *image_get_pixbuf(ImageWindow *imd);
+void image_copy_to_clipboard(ImageWindow *imd, GdkClipboard *clipboard);
 
 /* manipulation */
 void image_area_changed(ImageWindow *imd, gint x, gint y, gint width, gint height);
@@ -246,6 +253,7 @@ StereoPixbufData image_stereo_pixbuf_get(const ImageWindow *imd);
 void image_stereo_pixbuf_set(ImageWindow *imd, StereoPixbufData stereo_mode);
 
 void image_prebuffer_set(ImageWindow *imd, FileData *fd);
+void image_prefetch_set(ImageWindow *imd, const std::vector<FileData *> &list);
 
 void image_auto_refresh_enable(ImageWindow *imd, gboolean enable);
 
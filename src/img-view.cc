@@ -805,14 +805,8 @@ static void view_copy_image_cb(GSimpleAction *, GVariant *, gpointer data)
 {
 	auto vw = static_cast<ViewWindow *>(data);
 	ImageWindow *imd = view_window_active_image(vw);
-	GdkPixbuf *pixbuf = image_get_pixbuf(imd);
-	if (!pixbuf) return;
 
-	GdkClipboard *clipboard = gdk_display_get_clipboard(gtk_widget_get_display(imd->widget));
-	if (!clipboard) return;
-
-	g_autoptr(GdkTexture) texture = pixbuf_to_texture(pixbuf);
-	gdk_clipboard_set_texture(clipboard, texture);
+	image_copy_to_clipboard(imd, gdk_display_get_clipboard(gtk_widget_get_display(imd->widget)));
 }
 
 static void view_move_cb(GSimpleAction *, GVariant *, gpointer data)
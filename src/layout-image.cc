@@ -24,6 +24,7 @@
 #include <algorithm>
 #include <array>
 #include <cstring>
+#include <vector>
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <gdk/gdk.h>
@@ -58,7 +59,6 @@
 #include "misc.h"
 #include "options.h"
 #include "pixbuf-renderer.h"
-#include "pixbuf-util.h"
 #include "rcfile.h"
 #include "slideshow.h"
 #include "ui-fileops.h"
@@ -674,8 +674,7 @@ static void layout_image_pop_menu_cut_path_cb(GSimpleAction *, GVariant *, gpoin
 static void layout_image_pop_menu_copy_image_cb(GSimpleAction *, GVariant *, gpointer data)
 {
 	auto lw = static_cast<LayoutWindow *>(data);
-	GdkPixbuf *pixbuf = image_get_pixbuf(lw->image);
-	if (!pixbuf)
+	if (!image_get_pixbuf(lw->image))
 		{
 		return;
 		}
@@ -686,16 +685,7 @@ static void layout_image_pop_menu_copy_image_cb(GSimpleAction *, GVariant *, gpo
 		return;
 		}
 
-	GdkClipboard *clipboard = gdk_display_get_clipboard(display);
-	if (!clipboard)
-		{
-		return;
-		}
-
-	GdkTexture *texture = pixbuf_to_texture(pixbuf);
-
-	gdk_clipboard_set_texture(clipboard, texture);
-	g_object_unref(texture);
+	image_copy_to_clipboard(lw->image, gdk_display_get_clipboard(display));
 }
 
 template<gboolean safe_delete>
@@ -1417,6 +1407,43 @@ void layout_image_set_fd(LayoutWindow *lw, FileData *fd)
 		}
 }
 
+/**
+ * @brief Lists the neighbours of fd to prefetch, most wanted first
+ *
+ * The direction of travel is taken from read_ahead_fd, which itself is
+ * handled by the read ahead slot and not listed.
+ */
+static std::vector<FileData *> layout_image_prefetch_list(LayoutWindow *lw, FileData *fd, FileData *read_ahead_fd)
+{
+	std::vector<FileData *> list;
+
+	/* with a multiple selection, travel follows the selection */
+	if (!fd || !read_ahead_fd || layout_selection_count(lw) > 1) return list;
+
+	const gint index = layout_list_get_index(lw, fd);
+	const gint ahead = layout_list_get_index(lw, read_ahead_fd);
+	if (index < 0 || ahead < 0) return list;
+
+	const gint step = (ahead < index) ? -1 : 1;
+	const gint count = layout_list_count(lw, nullptr);
+
+	for (gint i = 2; i <= options->image.read_ahead_count; i++)
+		{
+		const gint n = index + step * i;
+		if (n < 0 || n >= count) break;
+		list.push_back(layout_list_get_fd(lw, n));
+		}
+
+	for (gint i = 1; i <= options->image.read_behind_count; i++)
+		{
+		const gint n = index - step * i;
+		if (n < 0 || n >= count) break;
+		list.push_back(layout_list_get_fd(lw, n));
+		}
+
+	return list;
+}
+
 void layout_image_set_with_ahead(LayoutWindow *lw, FileData *fd, FileData *read_ahead_fd)
 {
 	if (!layout_valid(&lw)) return;
@@ -1431,7 +1458,11 @@ void layout_image_set_with_ahead(LayoutWindow *lw, FileData *fd, FileData *read_
 		}
 */
 	layout_image_set_fd(lw, fd);
-	if (options->image.enable_read_ahead) image_prebuffer_set(lw->image, read_ahead_fd);
+	if (options->image.enable_read_ahead)
+		{
+		image_prebuffer_set(lw->image, read_ahead_fd);
+		image_prefetch_set(lw->image, layout_image_prefetch_list(lw, fd, read_ahead_fd));
+		}
 }
 
 void layout_image_set_index(LayoutWindow *lw, gint index)
@@ -1505,6 +1536,21 @@ static void layout_image_set_collection_real(LayoutWindow *lw, CollectionData *c
 			if (!r_info) r_info = collection_next_by_info(cd, info);
 			}
 		if (r_info) image_prebuffer_set(lw->image, r_info->fd);
+
+		std::vector<FileData *> list;
+		CollectInfo *p_info = r_info;
+		for (gint i = 2; p_info && i <= options->image.read_ahead_count; i++)
+			{
+			p_info = forward ? collection_next_by_info(cd, p_info) : collection_prev_by_info(cd, p_info);
+			if (p_info) list.push_back(p_info->fd);
+			}
+		p_info = info;
+		for (gint i = 1; p_info && i <= options->image.read_behind_count; i++)
+			{
+			p_info = forward ? collection_prev_by_info(cd, p_info) : collection_next_by_info(cd, p_info);
+			if (p_info) list.push_back(p_info->fd);
+			}
+		image_prefetch_set(lw->image, list);
 		}
 
 	layout_image_slideshow_continue_check(lw);
@@ -2030,6 +2076,13 @@ static void layout_status_update_pixel_cb(PixbufRenderer *pr, gpointer data)
 	GqPoint pixel;
 	pixbuf_renderer_get_mouse_position(pr, pixel);
 
+	/* positions and size of the image file, the pixbuf may have been decoded at reduced size */
+	const gdouble ratio = image_pixbuf_reduced_ratio(pr->pixbuf);
+	const gint x = static_cast<gint>(pixel.x * ratio);
+	const gint y = static_cast<gint>(pixel.y * ratio);
+	width = static_cast<gint>(width * ratio);
+	height = static_cast<gint>(height * ratio);
+
 	g_autofree gchar *text = nullptr;
 	if(pixel.x >= 0 && pixel.y >= 0)
 		{
@@ -2039,23 +2092,23 @@ static void layout_status_update_pixel_cb(PixbufRenderer *pr, gpointer data)
 			if (gdk_pixbuf_get_has_alpha(pr->pixbuf))
 				{
 				text = g_strdup_printf(_("[%*d,%*d]: RGBA(%3d,%3d,%3d,%3d)"),
-				                       num_length(width - 1), pixel.x,
-				                       num_length(height - 1), pixel.y,
+				                       num_length(width - 1), x,
+				                       num_length(height - 1), y,
 				                       color->r, color->g, color->b, color->a);
 				}
 			else
 				{
 				text = g_strdup_printf(_("[%*d,%*d]: RGB(%3d,%3d,%3d)"),
-				                       num_length(width - 1), pixel.x,
-				                       num_length(height - 1), pixel.y,
+				                       num_length(width - 1), x,
+				                       num_length(height - 1), y,
 				                       color->r, color->g, color->b);
 				}
 			}
 		else
 			{
 			text = g_strdup_printf(_("[%*d,%*d]: RGB(---,---,---)"),
-			                       num_length(width - 1), pixel.x,
-			                       num_length(height - 1), pixel.y);
+			                       num_length(width - 1), x,
+			                       num_length(height - 1), y);
 			}
 		}
 	else
@@ -69,7 +69,6 @@
 #include "options.h"
 #include "pan-view.h"
 #include "pixbuf-renderer.h"
-#include "pixbuf-util.h"
 #include "preferences.h"
 #include "print.h"
 #include "rcfile.h"
@@ -443,9 +442,7 @@ static void layout_menu_copy_image_cb(GSimpleAction *, GVariant *, gpointer)
 	auto lw = get_current_layout();
 	ImageWindow *imd = lw->image;
 
-	GdkPixbuf *pixbuf;
-	pixbuf = image_get_pixbuf(imd);
-	if (!pixbuf) return;
+	if (!image_get_pixbuf(imd)) return;
 
 	GdkDisplay *display = gdk_display_get_default();
 	if (!display)
@@ -453,15 +450,7 @@ static void layout_menu_copy_image_cb(GSimpleAction *, GVariant *, gpointer)
 		return;
 		}
 
-	GdkClipboard *clipboard = gdk_display_get_clipboard(display);
-	if (!clipboard)
-		{
-		return;
-		}
-
-	GdkTexture *texture = pixbuf_to_texture(pixbuf);
-	gdk_clipboard_set_texture(clipboard, texture);
-	g_object_unref(texture);
+	image_copy_to_clipboard(imd, gdk_display_get_clipboard(display));
 }
 
 static void layout_menu_cut_path_cb(GSimpleAction *, GVariant *, gpointer)
@@ -725,8 +714,11 @@ static void layout_menu_zoom_to_rectangle_cb(GSimpleAction *, GVariant *, gpoint
 	gdouble zoom_width = static_cast<gdouble>(pr->vis_width) / image_width;
 	gdouble zoom_height = static_cast<gdouble>(pr->vis_height) / image_height;
 
+	/* the rectangle is in pixels of the image file, the zoom too, scrolling is in the pixbuf */
+	const gdouble ratio = image_pixbuf_reduced_ratio(pr->pixbuf);
 	const GdkRectangle rect = pr_coords_map_orientation_reverse(pr->orientation,
-	                                                            {x1, y1, image_width, image_height},
+	                                                            {static_cast<gint>(x1 / ratio), static_cast<gint>(y1 / ratio),
+	                                                             static_cast<gint>(image_width / ratio), static_cast<gint>(image_height / ratio)},
 	                                                            pr->image_width, pr->image_height);
 
 	gint center_x = (rect.width / 2) + rect.x;
@@ -27,6 +27,8 @@
 #include <string>
 #include <utility>
 
+#include <config.h>
+
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <gdk/gdk.h>
 #ifdef GDK_WINDOWING_X11
@@ -633,12 +635,14 @@ static void layout_sort_method_change_state_cb(GSimpleAction *action, GVariant *
 	auto sort = lw->options.file_view_list_sort;
 	sort.method = static_cast<SortType>(g_variant_get_int32(state));
 
+	g_simple_action_set_state(action, state);
+	layout_sort_set_files(lw, sort);
+
+	/* after the sort is set, the Lua sort reads it */
 	if (sort_type_requires_metadata(sort.method))
 		{
 		vf_read_metadata_in_idle(lw->vf);
 		}
-	g_simple_action_set_state(action, state);
-	layout_sort_set_files(lw, sort);
 }
 
 static void layout_sort_ascending_change_state_cb(GSimpleAction *action, GVariant *state, gpointer data)
@@ -695,6 +699,9 @@ static GtkWidget *layout_sort_popover_new(LayoutWindow *lw)
 		{
 		layout_sort_popover_append_method_item(sort_section, sort_type);
 		}
+#if HAVE_LUA
+	layout_sort_popover_append_method_item(sort_section, SORT_LUA);
+#endif
 	g_menu_append_section(menu, nullptr, G_MENU_MODEL(sort_section));
 
 	g_menu_append(options_section, _("Ascending"), "sort.ascending");
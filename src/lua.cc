@@ -24,18 +24,27 @@
 
 #include "glua.h"
 
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include <cstring>
 #include <ctime>
+#include <memory>
+#include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include <glib.h>
 #include <lua.hpp>
 
+#include "debug.h"
 #include "exif.h"
+#include "filecache.h"
 #include "filedata.h"
 #include "main.h"
+#include "misc.h"
+#include "options.h"
 #include "ui-fileops.h"
 
 struct ExifData;
@@ -50,11 +59,100 @@ struct ExifData;
  *
  * @link exif_methods <exif-structure>:get_datum() @endlink get single exif parameter
  *
+ * @link cache_methods Cache:@endlink statistics of the internal caches
+ *
+ * Scripts run over a file list by lua_callvalue_list() run on worker
+ * threads, each with a lua_State of its own. There Image: returns the
+ * file information as it was when the list was handed over,
+ * Image:get_exif() reads the Exif data of the file alone, without
+ * sidecars, and Cache is not available.
  */
 
 static lua_State *L; /** The LUA object needed for all operations (NOTE: That is
 		       * a upper-case variable to match the documentation!) */
 
+/**
+ * @brief A script compiled once, and run again while the file is unchanged
+ */
+struct LuaChunk
+{
+	struct timespec mtime{}; /**< to the nanosecond, an edit within the same second may keep the size */
+	off_t size = 0;
+	gint ref = LUA_NOREF;   /**< of the compiled function in the registry */
+	guint calls = 0;
+	gint64 time = 0;        /**< microseconds spent running the script */
+};
+
+using LuaChunks = std::unordered_map<std::string, LuaChunk>; /**< path, or "=" and the code of an inline script */
+
+static LuaChunks lua_chunks;
+
+/**
+ * @brief Logs the number of runs and the time spent in each script
+ *
+ * Once for a thread, not for each run, as scripts run over a file list
+ * run once per file.
+ */
+static void lua_chunks_log(const LuaChunks &chunks)
+{
+	for (const auto &[key, chunk] : chunks)
+		{
+		if (chunk.calls == 0) continue;
+
+		DEBUG_1("lua: %s, %u calls, %.3f ms in total", key[0] == '=' ? "inline script" : key.c_str(), chunk.calls, chunk.time / 1000.0);
+		}
+}
+
+/**
+ * @brief The lua_State of a worker thread
+ */
+struct LuaWorker
+{
+	lua_State *L = nullptr;
+	LuaChunks chunks;
+	const LuaImageInfo *image = nullptr; /**< of the file the script runs for */
+
+	~LuaWorker()
+	{
+		lua_chunks_log(chunks);
+		if (L) lua_close(L);
+	}
+};
+
+static thread_local std::unique_ptr<LuaWorker> lua_worker;
+
+/**
+ * @brief The Exif userdata
+ *
+ * A script may keep it in a global from one call to the next, so what a
+ * worker reads is owned by the userdata and freed by its __gc.
+ */
+struct LuaExif
+{
+	ExifData *exif;
+	gboolean owned; /**< read by exif_read(), else from the cache of exif_read_fd() */
+};
+
+struct LuaListEntry
+{
+	LuaListJob *job;
+	FileData *fd;                   /**< not read by the worker */
+	LuaImageInfo image;
+	gchar *value;
+	gint64 time;                    /**< microseconds the script ran for */
+};
+
+struct LuaListJob
+{
+	gchar *file;
+	std::vector<LuaListEntry> entries;
+	LuaListDoneFunc done_func;
+	gint pending;                   /**< entries not yet run by a worker */
+	gint cancel;
+};
+
+static GThreadPool *lua_list_pool = nullptr;
+
 /* Taking that definition from lua 5.1 source */
 #if defined(LUA_VERSION_NUM) && LUA_VERSION_NUM >= 502
 static int luaL_typerror(lua_State *L, int narg, const char *tname)
@@ -74,6 +172,16 @@ static int luaL_typerror(lua_State *L, int narg, const char *tname)
 # define LUA_register_global(L, string, func) luaL_register(L, string, func)
 #endif
 
+LuaImageInfo::LuaImageInfo(const FileData *fd)
+	: path(fd->path)
+	, name(fd->name)
+	, extension(fd->extension ? fd->extension : "")
+	, date(fd->date)
+	, size(fd->size)
+	, marks(fd->marks)
+{
+}
+
 static FileData *lua_check_image(lua_State *L, int index)
 {
 	FileData **fd;
@@ -83,6 +191,15 @@ static FileData *lua_check_image(lua_State *L, int index)
 	return *fd;
 }
 
+/**
+ * @brief The copy of the file information on a worker thread
+ * @returns nullptr on the main thread, where the image is read from its FileData
+ */
+static const LuaImageInfo *lua_worker_image(lua_State *L)
+{
+	return (lua_worker && lua_worker->L == L) ? lua_worker->image : nullptr;
+}
+
 /**
  * @brief Get exif structure of selected image
  * @param L
@@ -93,17 +210,24 @@ static FileData *lua_check_image(lua_State *L, int index)
 static int lua_image_get_exif(lua_State *L)
 {
 	FileData *fd;
-	ExifData *exif;
-	ExifData **exif_data;
+	LuaExif *exif_data;
 
 	fd = lua_check_image(L, 1);
-	exif = exif_read_fd(fd);
 
-	exif_data = static_cast<ExifData **>(lua_newuserdata(L, sizeof(ExifData *)));
+	exif_data = static_cast<LuaExif *>(lua_newuserdata(L, sizeof(LuaExif)));
 	luaL_getmetatable(L, "Exif");
 	lua_setmetatable(L, -2);
 
-	*exif_data = exif;
+	if (const LuaImageInfo *image = lua_worker_image(L))
+		{
+		/* the cache of exif_read_fd() belongs to the main thread */
+		g_autofree gchar *path = g_strdup(image->path.c_str());
+		*exif_data = {exif_read(path, nullptr, nullptr), TRUE};
+		}
+	else
+		{
+		*exif_data = {exif_read_fd(fd), FALSE};
+		}
 
 	return 1;
 }
@@ -120,7 +244,8 @@ static int lua_image_get_path(lua_State *L)
 	FileData *fd;
 
 	fd = lua_check_image(L, 1);
-	lua_pushstring(L, fd->path);
+	const LuaImageInfo *image = lua_worker_image(L);
+	lua_pushstring(L, image ? image->path.c_str() : fd->path);
 	return 1;
 }
 
@@ -136,7 +261,8 @@ static int lua_image_get_name(lua_State *L)
 	FileData *fd;
 
 	fd = lua_check_image(L, 1);
-	lua_pushstring(L, fd->name);
+	const LuaImageInfo *image = lua_worker_image(L);
+	lua_pushstring(L, image ? image->name.c_str() : fd->name);
 	return 1;
 }
 
@@ -152,7 +278,8 @@ static int lua_image_get_extension(lua_State *L)
 	FileData *fd;
 
 	fd = lua_check_image(L, 1);
-	lua_pushstring(L, fd->extension);
+	const LuaImageInfo *image = lua_worker_image(L);
+	lua_pushstring(L, image ? image->extension.c_str() : fd->extension);
 	return 1;
 }
 
@@ -169,7 +296,8 @@ static int lua_image_get_date(lua_State *L)
 	FileData *fd;
 
 	fd = lua_check_image(L, 1);
-	lua_pushnumber(L, fd->date);
+	const LuaImageInfo *image = lua_worker_image(L);
+	lua_pushnumber(L, image ? image->date : fd->date);
 	return 1;
 }
 
@@ -185,7 +313,8 @@ static int lua_image_get_size(lua_State *L)
 	FileData *fd;
 
 	fd = lua_check_image(L, 1);
-	lua_pushnumber(L, fd->size);
+	const LuaImageInfo *image = lua_worker_image(L);
+	lua_pushnumber(L, image ? image->size : fd->size);
 	return 1;
 }
 
@@ -203,17 +332,31 @@ static int lua_image_get_marks(lua_State *L)
 	FileData *fd;
 
 	fd = lua_check_image(L, 1);
-	lua_pushnumber(L, fd->marks);
+	const LuaImageInfo *image = lua_worker_image(L);
+	lua_pushnumber(L, image ? image->marks : fd->marks);
 	return 1;
 }
 
 static ExifData *lua_check_exif(lua_State *L, int index)
 {
-	ExifData **exif;
+	LuaExif *exif;
 	luaL_checktype(L, index, LUA_TUSERDATA);
-	exif = static_cast<ExifData **>(luaL_checkudata(L, index, "Exif"));
+	exif = static_cast<LuaExif *>(luaL_checkudata(L, index, "Exif"));
 	if (exif == nullptr) luaL_typerror(L, index, "Exif");
-	return *exif;
+	return exif->exif;
+}
+
+/**
+ * @brief Frees the Exif data the userdata owns, when Lua collects it
+ */
+static int lua_exif_gc(lua_State *L)
+{
+	auto exif = static_cast<LuaExif *>(luaL_checkudata(L, 1, "Exif"));
+
+	if (exif->owned && exif->exif) exif_free(exif->exif);
+	exif->exif = nullptr;
+
+	return 0;
 }
 
 /**
@@ -269,6 +412,43 @@ static int lua_exif_get_datum(lua_State *L)
 	return 1;
 }
 
+/**
+ * @brief Get the statistics of the internal caches
+ * @param L
+ * @returns A table indexed by cache name, each entry a table with the fields
+ * hits, misses, evictions, size, max_size and count
+ *
+ * stats = Cache.get_stats() \n
+ * hits = stats.image.hits
+ */
+static int lua_cache_get_stats(lua_State *L)
+{
+	lua_newtable(L);
+
+	FileCache::foreach([L](const FileCache &fc)
+		{
+		const FileCache::Stats stats = fc.get_stats();
+		if (!stats.name) return;
+
+		lua_newtable(L);
+		lua_pushnumber(L, stats.hits);
+		lua_setfield(L, -2, "hits");
+		lua_pushnumber(L, stats.misses);
+		lua_setfield(L, -2, "misses");
+		lua_pushnumber(L, stats.evictions);
+		lua_setfield(L, -2, "evictions");
+		lua_pushnumber(L, stats.size);
+		lua_setfield(L, -2, "size");
+		lua_pushnumber(L, stats.max_size);
+		lua_setfield(L, -2, "max_size");
+		lua_pushnumber(L, stats.count);
+		lua_setfield(L, -2, "count");
+		lua_setfield(L, -2, stats.name);
+		});
+
+	return 1;
+}
+
 /**
  * @brief  <b>Image:</b> metatable and methods \n
  * Call by e.g. \n
@@ -301,17 +481,32 @@ static const luaL_Reg exif_methods[] = {
 };
 
 /**
- * @brief Initialize the lua interpreter.
+ * @brief  <b>Cache:</b> table and methods \n
+ * Call by e.g. \n
+ * @link lua_cache_get_stats Cache.get_stats() @endlink
  */
-void lua_init()
+static const luaL_Reg cache_methods[] = {
+		{"get_stats", lua_cache_get_stats},
+		{nullptr, nullptr}
+};
+
+/**
+ * @brief Creates a lua_State with the Geeqie API
+ * @param worker TRUE for a worker thread, without the API that is not thread safe
+ */
+static lua_State *lua_state_new(gboolean worker)
 {
-	L = luaL_newstate();
+	lua_State *L = luaL_newstate();
 	luaL_openlibs(L); /* Open all libraries for lua programs */
 
 	/* Now create custom methodes to do something */
 	static const luaL_Reg meta_methods[] = {
 			{nullptr, nullptr}
 	};
+	static const luaL_Reg exif_meta_methods[] = {
+			{"__gc", lua_exif_gc},
+			{nullptr, nullptr}
+	};
 
 	LUA_register_global(L, "Image", image_methods);
 	luaL_newmetatable(L, "Image");
@@ -325,9 +520,15 @@ void lua_init()
 	lua_pop(L, 1);
 	lua_pop(L, 1);
 
+	if (!worker)
+		{
+		LUA_register_global(L, "Cache", cache_methods);
+		lua_pop(L, 1);
+		}
+
 	LUA_register_global(L, "Exif", exif_methods);
 	luaL_newmetatable(L, "Exif");
-	LUA_register_meta(L, meta_methods);
+	LUA_register_meta(L, exif_meta_methods);
 	lua_pushliteral(L, "__index");
 	lua_pushvalue(L, -3);
 	lua_settable(L, -3);
@@ -336,24 +537,105 @@ void lua_init()
 	lua_settable(L, -3);
 	lua_pop(L, 1);
 	lua_pop(L, 1);
+
+	return L;
 }
 
 /**
- * @brief Call a lua function to get a single value.
+ * @brief Initialize the lua interpreter.
  */
-gchar *lua_callvalue(FileData *fd, const gchar *file, const gchar *function)
+void lua_init()
+{
+	L = lua_state_new(FALSE);
+}
+
+/**
+ * @brief Logs the use of the scripts run on the main thread, at exit
+ */
+void lua_exit()
 {
-	g_autofree gchar *path = g_build_filename(get_rc_dir(), "lua", file, NULL);
-	if (access(path, R_OK) == -1)
+	lua_chunks_log(lua_chunks);
+}
+
+/**
+ * @brief Pushes the compiled script, compiles it first if it is new or the file changed
+ * @param path the script file, or nullptr for the inline script @a code
+ * @returns nullptr with the error message pushed instead
+ *
+ * Each script gets a table of its own for its globals, falling back to
+ * the shared ones. What a script keeps there lasts from one call to the
+ * next, until the file changes.
+ */
+static LuaChunk *lua_chunk_push(lua_State *L, LuaChunks &chunks, const gchar *path, const gchar *code)
+{
+	struct stat st{};
+	if (path && stat(path, &st) != 0)
 		{
-		g_free(path);
-		path = g_build_filename(gq_bindir, file, NULL);
-		if (access(path, R_OK) == -1)
-			{
-			return g_strdup("");
-			}
+		lua_pushfstring(L, "cannot open %s", path);
+		return nullptr;
+		}
+
+	const std::string key = path ? std::string(path) : std::string("=") + code;
+	LuaChunk &chunk = chunks[key];
+
+	if (chunk.ref != LUA_NOREF && chunk.size == st.st_size &&
+	    chunk.mtime.tv_sec == st.st_mtim.tv_sec && chunk.mtime.tv_nsec == st.st_mtim.tv_nsec)
+		{
+		lua_rawgeti(L, LUA_REGISTRYINDEX, chunk.ref);
+		return &chunk;
 		}
 
+	luaL_unref(L, LUA_REGISTRYINDEX, chunk.ref);
+	chunk.ref = LUA_NOREF;
+
+	const gint64 start = g_get_monotonic_time();
+	const gint result = path ? luaL_loadfile(L, path) : luaL_loadstring(L, code);
+	if (result != LUA_OK) return nullptr;
+
+	DEBUG_1("lua: compiled %s in %.3f ms", path ? path : "inline script", (g_get_monotonic_time() - start) / 1000.0);
+
+	lua_newtable(L);
+	lua_newtable(L);
+	lua_pushglobaltable(L);
+	lua_setfield(L, -2, "__index");
+	lua_setmetatable(L, -2);
+	lua_setupvalue(L, -2, 1); /* _ENV */
+
+	lua_pushvalue(L, -1);
+	chunk.ref = luaL_ref(L, LUA_REGISTRYINDEX);
+	chunk.mtime = st.st_mtim;
+	chunk.size = st.st_size;
+
+	return &chunk;
+}
+
+/**
+ * @brief Finds a script in the lua folder of the configuration, then next to the executable
+ * @returns nullptr if there is no such script
+ */
+static gchar *lua_script_path(const gchar *file)
+{
+	gchar *path = g_build_filename(get_rc_dir(), "lua", file, NULL);
+	if (access(path, R_OK) == 0) return path;
+
+	g_free(path);
+	path = g_build_filename(gq_bindir, file, NULL);
+	if (access(path, R_OK) == 0) return path;
+
+	g_free(path);
+	return nullptr;
+}
+
+/**
+ * @brief Runs a script for @a fd, returns its value as UTF-8
+ *
+ * On a worker thread @a fd is nullptr, Image: reads the LuaImageInfo of
+ * the LuaWorker instead.
+ */
+static gchar *lua_run(lua_State *L, LuaChunks &chunks, FileData *fd, const gchar *path, const gchar *code)
+{
+	const gint top = lua_gettop(L);
+
 	/* Collection Table (Dummy at the moment) */
 	lua_newtable(L);
 	lua_setglobal(L, "Collection");
@@ -366,22 +648,28 @@ gchar *lua_callvalue(FileData *fd, const gchar *file, const gchar *function)
 
 	*image_data = fd;
 
-	gint result;
-	if (file[0] == '\0')
-		{
-		result = luaL_dostring(L, function);
-		}
-	else
+	LuaChunk *chunk = lua_chunk_push(L, chunks, path, code);
+	gint result = LUA_ERRFILE;
+	if (chunk)
 		{
-		result = luaL_dofile(L, path);
+		const gint64 start = g_get_monotonic_time();
+		result = lua_pcall(L, 0, 1, 0);
+
+		chunk->calls++;
+		chunk->time += g_get_monotonic_time() - start;
 		}
 
 	if (result)
 		{
-		return g_strdup_printf("Error running lua script: %s", lua_tostring(L, -1));
+		gchar *message = g_strdup_printf("Error running lua script: %s", lua_tostring(L, -1));
+		lua_settop(L, top);
+		return message;
 		}
 
-	gchar *data = g_strdup(lua_tostring(L, -1));
+	const gchar *value = lua_tostring(L, -1);
+	gchar *data = g_strdup(value ? value : "");
+	lua_settop(L, top);
+
 	g_autoptr(GError) error = nullptr;
 	g_autofree gchar *tmp = g_locale_to_utf8(data, strlen(data), nullptr, nullptr, &error);
 	if (error)
@@ -395,4 +683,152 @@ gchar *lua_callvalue(FileData *fd, const gchar *file, const gchar *function)
 	return data;
 }
 
+/**
+ * @brief Call a lua function to get a single value.
+ */
+gchar *lua_callvalue(FileData *fd, const gchar *file, const gchar *function)
+{
+	g_autofree gchar *path = nullptr;
+	if (file[0] != '\0')
+		{
+		path = lua_script_path(file);
+		if (!path) return g_strdup("");
+		}
+
+	return lua_run(L, lua_chunks, fd, path, function);
+}
+
+/**
+ * @brief Runs the script @a file for @a image on the calling thread
+ *
+ * Each thread has a lua_State of its own, kept for the next call, so
+ * this is safe to call from any thread other than the main one. The
+ * globals of a script are not shared between threads.
+ */
+gchar *lua_callvalue_thread(const LuaImageInfo &image, const gchar *file)
+{
+	g_autofree gchar *path = lua_script_path(file);
+	if (!path) return g_strdup("");
+
+	if (!lua_worker)
+		{
+		lua_worker = std::make_unique<LuaWorker>();
+		lua_worker->L = lua_state_new(TRUE);
+		}
+
+	lua_worker->image = &image;
+	gchar *value = lua_run(lua_worker->L, lua_worker->chunks, nullptr, path, nullptr);
+	lua_worker->image = nullptr;
+
+	return value;
+}
+
+static void lua_list_job_free(LuaListJob *job)
+{
+	for (LuaListEntry &entry : job->entries)
+		{
+		file_data_unref(entry.fd);
+		g_free(entry.value);
+		}
+	g_free(job->file);
+	delete job;
+}
+
+static gboolean lua_list_done_cb(gpointer data)
+{
+	auto job = static_cast<LuaListJob *>(data);
+
+	if (!g_atomic_int_get(&job->cancel))
+		{
+		GList *list = nullptr;
+		std::vector<const gchar *> values;
+
+		for (auto it = job->entries.rbegin(); it != job->entries.rend(); ++it)
+			{
+			list = g_list_prepend(list, it->fd);
+			}
+		for (const LuaListEntry &entry : job->entries) values.push_back(entry.value);
+
+		job->done_func(list, values);
+		g_list_free(list);
+		}
+
+	gint64 time = 0;
+	for (const LuaListEntry &entry : job->entries) time += entry.time;
+	DEBUG_1("lua: %s, %zu files, %.3f ms in total", job->file, job->entries.size(), time / 1000.0);
+
+	lua_list_job_free(job);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void lua_list_worker(gpointer data, gpointer)
+{
+	auto entry = static_cast<LuaListEntry *>(data);
+	LuaListJob *job = entry->job;
+
+	if (!g_atomic_int_get(&job->cancel))
+		{
+		const gint64 start = g_get_monotonic_time();
+		entry->value = lua_callvalue_thread(entry->image, job->file);
+		entry->time = g_get_monotonic_time() - start;
+		}
+
+	if (g_atomic_int_dec_and_test(&job->pending))
+		{
+		g_idle_add(lua_list_done_cb, job);
+		}
+}
+
+/**
+ * @brief Runs the script @a file for each file of @a list, on a pool of worker threads
+ * @param done_func called on the main thread with the files and their values, in the order of @a list
+ * @returns the job, to cancel it, or nullptr if @a list is empty
+ *
+ * The job is freed after @a done_func returns, or once cancelled.
+ */
+LuaListJob *lua_callvalue_list(GList *list, const gchar *file, const LuaListDoneFunc &done_func)
+{
+	if (!list) return nullptr;
+
+	const gint threads = options->threads.lua > 0 ? options->threads.lua : get_cpu_cores();
+
+	if (!lua_list_pool)
+		{
+		lua_list_pool = g_thread_pool_new(lua_list_worker, nullptr, threads, FALSE, nullptr);
+		}
+	else
+		{
+		g_thread_pool_set_max_threads(lua_list_pool, threads, nullptr);
+		}
+
+	auto job = new LuaListJob{};
+	job->file = g_strdup(file);
+	job->done_func = done_func;
+
+	for (GList *work = list; work; work = work->next)
+		{
+		auto fd = static_cast<FileData *>(work->data);
+
+		job->entries.push_back({job, file_data_ref(fd), LuaImageInfo(fd), nullptr, 0});
+		}
+	job->pending = job->entries.size();
+
+	/* the entries are not moved again, the workers point into them */
+	for (LuaListEntry &entry : job->entries)
+		{
+		g_thread_pool_push(lua_list_pool, &entry, nullptr);
+		}
+
+	return job;
+}
+
+/**
+ * @brief Drops the results of @a job, which is freed once the workers are done with it
+ */
+void lua_callvalue_list_cancel(LuaListJob *job)
+{
+	if (job) g_atomic_int_set(&job->cancel, TRUE);
+}
+
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
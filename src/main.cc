@@ -50,6 +50,8 @@
 
 #include "accelerators.h"
 #include "cache-maint.h"
+#include "cache-meta-db.h"
+#include "cache-sim-db.h"
 #include "cache.h"
 #include "collect-io.h"
 #include "collect.h"
@@ -123,6 +125,8 @@ This is a command line program that will recursively remove orphaned thumbnails
 .sim files, and create thumbnails and similarity data for all images found under FOLDER.\n\n \
 It may also be called from cron or anacron thus enabling automatic updating of the cached\n \
 data for all your images.\n\n \
+With --find-duplicates it instead prints the duplicates found under FOLDER to stdout,\n \
+as CSV or as one JSON object per group and line.\n\n \
 Note that bash command line completion does not work in this mode.\n\n \
 User manual: https://www.geeqie.org/help/GuideIndex.html\n \
            : https://www.geeqie.org/help-pdf/help.pdf");
@@ -197,7 +201,11 @@ GOptionEntry command_line_options[] =
 GOptionEntry command_line_options_cache_maintenance[] =
 {
 	{ "cache-maintenance", 'c', G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, nullptr, _("execute cache maintenance recursively on FOLDER"), "<FOLDER>" },
+	{ "find-duplicates"  ,   0, G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, nullptr, _("print the duplicates found recursively in FOLDER"), "<FOLDER>" },
+	{ "format"           ,   0, G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, nullptr, _("duplicates output format, default csv")          , "csv|json" },
+	{ "mode"             ,   0, G_OPTION_FLAG_NONE, G_OPTION_ARG_STRING, nullptr, _("duplicates match type, default sum")             , "name|name-ci|name-content|name-ci-content|size|date|dimensions|sum|path|sim-high|sim-med|sim-low|sim-custom" },
 	{ "quit"             , 'q', G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE  , nullptr, _("stop cache maintenance")                         , nullptr },
+	{ "threads"          ,   0, G_OPTION_FLAG_NONE, G_OPTION_ARG_INT   , nullptr, _("duplicates threads, default all cores")          , "<N>" },
 	{ nullptr            ,   0, G_OPTION_FLAG_NONE, G_OPTION_ARG_NONE  , nullptr, nullptr                                             , nullptr },
 };
 
@@ -419,6 +427,12 @@ void exit_program_final()
 
 	save_options(options);
 	keys_save();
+	cache_maintain_db_finish();
+	cache_sim_db_close();
+	cache_meta_db_close();
+#if HAVE_LUA
+	lua_exit();
+#endif
 
 	LayoutWindow *lw = get_current_layout();
 	if (lw)
@@ -426,6 +440,8 @@ void exit_program_final()
 		layout_free(lw);
 		}
 
+	g_clear_pointer(&options->file_sort.lua_script, g_free);
+
 	/* Delete any files/folders in /tmp that have been created by the open archive function */
 	g_autofree gchar *instance_archive_dir = g_build_filename(g_get_tmp_dir(), GQ_ARCHIVE_DIR, instance_identifier, NULL);
 	if (isdir(instance_archive_dir))
@@ -561,6 +577,9 @@ void setup_sig_handler()
 	sigaction(SIGILL, &sigsegv_action, nullptr);
 	sigaction(SIGIOT, &sigsegv_action, nullptr);
 	sigaction(SIGSEGV, &sigsegv_action, nullptr);
+
+	/* a persistent external tool exiting must not take geeqie with it when the next request is written */
+	signal(SIGPIPE, SIG_IGN);
 }
 
 void set_theme_bg_color()
@@ -32,7 +32,10 @@
 
 #include "md5-util.h"
 
+#include <sys/types.h>
+
 #include <cstdio>
+#include <vector>
 
 #include "ui-fileops.h"
 
@@ -43,26 +46,37 @@ namespace
  * md5_update_from_file: get the md5 hash of a file
  * @md5: MD5 checksumming context
  * @path: file name
+ * @cancel: if not NULL, reading stops when it is set
  * @return: TRUE on success
  *
  * Get the md5 hash of a file.
  **/
-gboolean md5_update_from_file(GChecksum *md5, const gchar *path)
+gboolean md5_update_from_file(GChecksum *md5, const gchar *path, const gint *cancel = nullptr)
 {
-	guchar tmp_buf[1024];
-	gint nb_bytes_read;
+	std::vector<guchar> tmp_buf(65536);
+	gsize nb_bytes_read;
 
 	g_autoptr(FILE) fp = fopen(path, "r");
 	if (!fp) return FALSE;
 
-	while ((nb_bytes_read = fread(tmp_buf, sizeof (guchar), sizeof(tmp_buf), fp)) > 0)
+	while ((nb_bytes_read = fread(tmp_buf.data(), sizeof (guchar), tmp_buf.size(), fp)) > 0)
 		{
-		g_checksum_update(md5, tmp_buf, nb_bytes_read);
+		if (cancel && g_atomic_int_get(cancel)) return FALSE;
+
+		g_checksum_update(md5, tmp_buf.data(), nb_bytes_read);
 		}
 
 	return ferror(fp) == 0;
 }
 
+gboolean md5_checksum_get_digest(GChecksum *md5, Md5Digest &digest)
+{
+	gsize digest_size = MD5_SIZE;
+	g_checksum_get_digest(md5, digest.data(), &digest_size);
+
+	return digest_size == MD5_SIZE;
+}
+
 } // namespace
 
 /**
@@ -74,18 +88,46 @@ gboolean md5_update_from_file(GChecksum *md5, const gchar *path)
  * Get the md5 hash of a file. The result is put in
  * the 16 bytes buffer @digest .
  **/
-gboolean md5_get_digest_from_file(const gchar *path, Md5Digest &digest)
+gboolean md5_get_digest_from_file(const gchar *path, Md5Digest &digest, const gint *cancel)
 {
 	g_autoptr(GChecksum) md5 = g_checksum_new(G_CHECKSUM_MD5);
 	if (!md5) return FALSE;
 
-	if (!md5_update_from_file(md5, path)) return FALSE;
+	if (!md5_update_from_file(md5, path, cancel)) return FALSE;
 
-	gsize digest_size = MD5_SIZE;
-	g_checksum_get_digest(md5, digest.data(), &digest_size);
-	if (digest_size != MD5_SIZE) return FALSE;
+	return md5_checksum_get_digest(md5, digest);
+}
 
-	return TRUE;
+/**
+ * @brief Get the md5 hash of the first and the last block_size bytes of a file
+ * @param path file name
+ * @param block_size bytes read at either end
+ * @param digest 16 bytes buffer receiving the hash code
+ * @returns TRUE on success
+ *
+ * Files of up to twice block_size are hashed in full, and then the
+ * result is the same as md5_get_digest_from_file().
+ */
+gboolean md5_get_partial_digest_from_file(const gchar *path, gsize block_size, Md5Digest &digest)
+{
+	g_autoptr(GChecksum) md5 = g_checksum_new(G_CHECKSUM_MD5);
+	if (!md5) return FALSE;
+
+	g_autoptr(FILE) fp = fopen(path, "r");
+	if (!fp) return FALSE;
+
+	std::vector<guchar> buf(2 * block_size);
+
+	gsize n = fread(buf.data(), sizeof(guchar), buf.size(), fp);
+	if (n == buf.size() && fseeko(fp, -static_cast<off_t>(block_size), SEEK_END) == 0)
+		{
+		n = block_size + fread(buf.data() + block_size, sizeof(guchar), block_size, fp);
+		}
+	if (ferror(fp)) return FALSE;
+
+	g_checksum_update(md5, buf.data(), n);
+
+	return md5_checksum_get_digest(md5, digest);
 }
 
 /**
@@ -47,7 +47,9 @@ inline constexpr gsize MD5_SIZE = 16;
 
 using Md5Digest = std::array<guchar, MD5_SIZE>;
 
-gboolean md5_get_digest_from_file(const gchar *path, Md5Digest &digest);
+gboolean md5_get_digest_from_file(const gchar *path, Md5Digest &digest, const gint *cancel = nullptr);
+
+gboolean md5_get_partial_digest_from_file(const gchar *path, gsize block_size, Md5Digest &digest);
 
 std::string md5_get_string_from_file(const gchar *path);
 
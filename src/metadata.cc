@@ -30,6 +30,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <ctime>
 #include <string>
 
 #include <glib-object.h>
@@ -38,12 +39,14 @@
 
 #include <config.h>
 
+#include "cache-meta-db.h"
 #include "cache.h"
 #include "exif.h"
 #include "filedata.h"
 #if HAVE_LUA
 #  include "glua.h"
 #endif
+#include "image-probe.h"
 #include "intl.h"
 #include "layout-util.h"
 #include "main-defines.h"
@@ -442,6 +445,9 @@ gboolean metadata_write_perform(FileData *fd)
 
 	g_assert(fd->change);
 
+	/* files in the metadata folder are not part of the index key */
+	if (CacheMetaDb *db = cache_meta_db_get()) db->remove(fd->path);
+
 	static const size_t lf = strlen(GQ_CACHE_EXT_METADATA);
 	if (fd->change->dest &&
 	    g_ascii_strncasecmp(fd->change->dest + strlen(fd->change->dest) - lf, GQ_CACHE_EXT_METADATA, lf) == 0)
@@ -934,6 +940,158 @@ gboolean metadata_append_string(FileData *fd, const gchar *key, const char *valu
 	return metadata_write_string(fd, key, new_string);
 }
 
+/**
+ * @brief The mtime the index entry of fd is keyed by
+ *
+ * The metadata may be in a sidecar, so the newest of the file and its
+ * sidecars is used.
+ */
+static time_t metadata_index_mtime(FileData *fd)
+{
+	time_t mtime = fd->date;
+
+	for (GList *work = fd->sidecar_files; work; work = work->next)
+		{
+		mtime = std::max(mtime, static_cast<FileData *>(work->data)->date);
+		}
+
+	return mtime;
+}
+
+/**
+ * @brief Reads all fields of the index entry from the file, and stores it
+ */
+static void metadata_index_fill(CacheMetaDb *db, FileData *fd, CacheMetaEntry &entry, time_t mtime)
+{
+	entry = CacheMetaEntry{};
+	entry.mtime = mtime;
+	entry.size = fd->size;
+
+	GList *keywords = metadata_read_list(fd, KEYWORD_KEY, METADATA_PLAIN);
+	for (GList *work = keywords; work; work = work->next)
+		{
+		entry.keywords.emplace_back(static_cast<const gchar *>(work->data));
+		}
+	g_list_free_full(keywords, g_free);
+
+	g_autofree gchar *comment = metadata_read_string(fd, COMMENT_KEY, METADATA_PLAIN);
+	if (comment) entry.comment = comment;
+
+	entry.rating = metadata_read_int(fd, RATING_KEY, 0);
+
+	g_autofree gchar *camera = metadata_read_string(fd, "formatted.Camera", METADATA_FORMATTED);
+	if (camera) entry.camera = camera;
+
+	g_autofree gchar *lens = metadata_read_string(fd, "Exif.Photo.LensModel", METADATA_FORMATTED);
+	if (lens) entry.lens = lens;
+
+	ExifData *exif = exif_read_fd(fd);
+	if (exif)
+		{
+		g_autofree gchar *date = exif_get_data_as_text(exif, "Exif.Photo.DateTimeOriginal");
+		if (date)
+			{
+			std::tm time_str{};
+			if (strptime(date, "%Y:%m:%d %H:%M:%S", &time_str)) entry.date = mktime(&time_str);
+			}
+		exif_free_fd(fd, exif);
+		}
+
+	const gdouble latitude = metadata_read_GPS_coord(fd, "Xmp.exif.GPSLatitude", 1000);
+	const gdouble longitude = metadata_read_GPS_coord(fd, "Xmp.exif.GPSLongitude", 1000);
+	if (latitude != 1000 && longitude != 1000)
+		{
+		entry.has_gps = TRUE;
+		entry.latitude = latitude;
+		entry.longitude = longitude;
+		}
+
+	if (GqSize dimensions; image_probe_dimensions(fd->path, dimensions)) entry.dimensions = dimensions;
+
+	db->store(fd->path, entry);
+}
+
+/**
+ * @brief Reads the metadata searches and sorts use, from the index if it is current
+ * @returns FALSE if the index is disabled, or fd has unwritten changes
+ *
+ * On a miss all fields are read from the file once and added to the index.
+ */
+gboolean metadata_index_read(FileData *fd, CacheMetaEntry &entry)
+{
+	CacheMetaDb *db = cache_meta_db_get();
+	if (!db || !fd || fd->modified_xmp) return FALSE;
+
+	const time_t mtime = metadata_index_mtime(fd);
+	if (!db->lookup(fd->path, mtime, fd->size, entry)) metadata_index_fill(db, fd, entry, mtime);
+
+	return TRUE;
+}
+
+/*
+ *-------------------------------------------------------------------
+ * index fill queue
+ *-------------------------------------------------------------------
+ */
+
+static GQueue metadata_index_queue = G_QUEUE_INIT;
+static GHashTable *metadata_index_queued = nullptr; /**< The FileData in metadata_index_queue */
+static guint metadata_index_idle_id = 0; /* event source id */
+
+/**
+ * @brief Adds the index entry of one queued file per call, on the main loop
+ */
+static gboolean metadata_index_queue_idle_cb(gpointer)
+{
+	auto fd = static_cast<FileData *>(g_queue_pop_head(&metadata_index_queue));
+	g_hash_table_remove(metadata_index_queued, fd);
+
+	CacheMetaDb *db = cache_meta_db_get();
+	if (db && !fd->modified_xmp && isname(fd->path))
+		{
+		CacheMetaEntry entry;
+		const time_t mtime = metadata_index_mtime(fd);
+
+		if (!db->lookup(fd->path, mtime, fd->size, entry)) metadata_index_fill(db, fd, entry, mtime);
+		}
+
+	file_data_unref(fd);
+
+	if (!g_queue_is_empty(&metadata_index_queue)) return G_SOURCE_CONTINUE;
+
+	metadata_index_idle_id = 0;
+	return G_SOURCE_REMOVE;
+}
+
+static void metadata_index_queue_add(FileData *fd)
+{
+	if (!metadata_index_queued) metadata_index_queued = g_hash_table_new(g_direct_hash, g_direct_equal);
+	if (!g_hash_table_add(metadata_index_queued, fd)) return;
+
+	g_queue_push_tail(&metadata_index_queue, file_data_ref(fd));
+
+	if (!metadata_index_idle_id) metadata_index_idle_id = g_idle_add(metadata_index_queue_idle_cb, nullptr);
+}
+
+/**
+ * @brief Reads the index entry of fd if it is current
+ * @returns FALSE if the index is disabled, fd has unwritten changes or the entry is missing
+ *
+ * Unlike metadata_index_read(), a miss does not read the file. The caller
+ * reads just the field it needs, and the entry is added from the main loop
+ * when it is idle.
+ */
+gboolean metadata_index_lookup(FileData *fd, CacheMetaEntry &entry)
+{
+	CacheMetaDb *db = cache_meta_db_get();
+	if (!db || !fd || fd->modified_xmp) return FALSE;
+
+	if (db->lookup(fd->path, metadata_index_mtime(fd), fd->size, entry)) return TRUE;
+
+	metadata_index_queue_add(fd);
+	return FALSE;
+}
+
 gboolean metadata_write_GPS_coord(FileData *fd, const gchar *key, gdouble value)
 {
 	gint deg;
@@ -30,6 +30,7 @@
 enum NotifyType : gint;
 
 class FileData;
+struct CacheMetaEntry;
 
 #define COMMENT_KEY "Xmp.dc.description"
 #define KEYWORD_KEY "Xmp.dc.subject"
@@ -60,6 +61,8 @@ gchar *metadata_read_string(FileData *fd, const gchar *key, MetadataFormat forma
 guint64 metadata_read_int(FileData *fd, const gchar *key, guint64 fallback);
 gdouble metadata_read_GPS_coord(FileData *fd, const gchar *key, gdouble fallback);
 gdouble metadata_read_GPS_direction(FileData *fd, const gchar *key, gdouble fallback);
+gboolean metadata_index_read(FileData *fd, CacheMetaEntry &entry);
+gboolean metadata_index_lookup(FileData *fd, CacheMetaEntry &entry);
 gboolean metadata_write_GPS_coord(FileData *fd, const gchar *key, gdouble value);
 
 gboolean metadata_append_string(FileData *fd, const gchar *key, const char *value);
@@ -68,14 +68,22 @@ ConfOptions *conf_options_new()
 	options->color_profile.use_image = TRUE;
 	options->color_profile.use_x11_screen_profile = TRUE;
 	options->color_profile.render_intent = 0;
+	options->color_profile.use_lut = FALSE;
 
 	options->dnd_icon_size = 48;
 	options->dnd_default_action = DND_ACTION_ASK;
 	options->duplicates_similarity_threshold = 99;
 	options->rot_invariant_sim = TRUE;
 	options->sort_totals = FALSE;
+	options->duplicates_sim_exhaustive = FALSE;
+	options->duplicates_sim_prefilter = TRUE;
 	options->rectangle_draw_aspect_ratio = RECTANGLE_DRAW_ASPECT_RATIO_NONE;
 
+	options->external_preview.enable = FALSE;
+	options->external_preview.select = nullptr;
+	options->external_preview.extract = nullptr;
+	options->external_preview.persistent = FALSE;
+
 	options->file_filter.disable = FALSE;
 	options->file_filter.show_dot_directory = FALSE;
 	options->file_filter.show_hidden_files = FALSE;
@@ -102,6 +110,7 @@ ConfOptions *conf_options_new()
 	options->file_ops.no_trash = FALSE;
 
 	options->file_sort.case_sensitive = FALSE;
+	options->file_sort.lua_script = nullptr;
 
 	options->fullscreen.clean_flip = FALSE;
 	options->fullscreen.disable_saver = TRUE;
@@ -128,6 +137,8 @@ ConfOptions *conf_options_new()
 	options->image.alpha_color_2.green = static_cast<gdouble>(0x006666) / 65535;
 	options->image.alpha_color_2.blue = static_cast<gdouble>(0x006666) / 65535;
 	options->image.enable_read_ahead = TRUE;
+	options->image.read_ahead_count = 3;
+	options->image.read_behind_count = 1;
 	options->image.exif_rotate_enable = TRUE;
 	options->image.fit_window_to_image = FALSE;
 	options->image.limit_autofit_size = FALSE;
@@ -138,6 +149,7 @@ ConfOptions *conf_options_new()
 	options->image.scroll_reset_method = ScrollReset::NOCHANGE;
 	options->image.tile_cache_max = 64;
 	options->image.image_cache_max = 128; /* 4 x 10MPix */
+	options->image.image_cache_auto = FALSE;
 	options->image.use_custom_border_color = FALSE;
 	options->image.use_custom_border_color_in_fullscreen = TRUE;
 	options->image.zoom_2pass = TRUE;
@@ -145,6 +157,9 @@ ConfOptions *conf_options_new()
 	options->image.zoom_mode = ZOOM_RESET_NONE;
 	options->image.zoom_quality = GDK_INTERP_BILINEAR;
 	options->image.zoom_to_fit_allow_expand = FALSE;
+	options->image.reduced_decode = TRUE;
+	options->image.embedded_preview = TRUE;
+	options->image.histogram_preview = TRUE;
 	options->image.zoom_style = ZOOM_GEOMETRIC;
 	options->image.tile_size = 128;
 
@@ -184,6 +199,7 @@ ConfOptions *conf_options_new()
 	options->metadata.write_orientation = TRUE;
 	options->metadata.sidecar_extended_name = FALSE;
 	options->metadata.check_spelling = TRUE;
+	options->metadata.use_index = TRUE;
 
 	options->show_icon_names = TRUE;
 	options->show_star_rating = FALSE;
@@ -199,6 +215,7 @@ ConfOptions *conf_options_new()
 
 	options->thumbnails.cache_into_dirs = FALSE;
 	options->thumbnails.enable_caching = TRUE;
+	options->thumbnails.similarity_database = FALSE;
 	options->thumbnails.size = { DEFAULT_THUMB_WIDTH, DEFAULT_THUMB_HEIGHT };
 	options->thumbnails.quality = GDK_INTERP_TILES;
 	options->thumbnails.spec_standard = TRUE;
@@ -235,6 +252,10 @@ ConfOptions *conf_options_new()
 	options->printer.page_text_position = HEADER_1;
 
 	options->threads.duplicates = get_cpu_cores() - 1;
+	options->threads.thumbnails = 0;
+	options->threads.tile_render = 0;
+	options->threads.search = 0;
+	options->threads.lua = 0;
 
 	options->disabled_plugins.clear();
 
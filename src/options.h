@@ -118,6 +118,8 @@ struct ConfOptions
 	DupeSelectType duplicates_select_type;
 	gboolean rot_invariant_sim;
 	gboolean sort_totals;
+	gboolean duplicates_sim_exhaustive; /**< Compare every pair instead of querying the similarity index */
+	gboolean duplicates_sim_prefilter; /**< Reject pairs on a 16 x 16 signature before the full compare */
 
 	gint open_recent_list_maxsize;
 	gint recent_folder_image_list_maxsize;
@@ -215,11 +217,17 @@ struct ConfOptions
 
 		gint tile_cache_max;	/**< in megabytes */
 		gint image_cache_max;   /**< in megabytes */
+		gboolean image_cache_auto; /**< size the cache from the installed memory, ignoring image_cache_max */
 		gboolean enable_read_ahead;
+		gint read_ahead_count;  /**< images to decode ahead, in the direction of travel */
+		gint read_behind_count; /**< images to decode behind */
 
 		ZoomMode zoom_mode;
 		gboolean zoom_2pass;
 		gboolean zoom_to_fit_allow_expand;
+		gboolean reduced_decode; /**< decode large images at about the view size when zooming to fit */
+		gboolean embedded_preview; /**< show the preview embedded in the file while it is decoded */
+		gboolean histogram_preview; /**< show a histogram of sampled pixels while the full one is computed */
 		GdkInterpType zoom_quality;
 		gint zoom_increment;	/**< 100 is 1.0, 5 is 0.05, 200 is 2.0, etc. */
 		ZoomStyle zoom_style;
@@ -238,6 +246,7 @@ struct ConfOptions
 		GqSize size;
 		gboolean enable_caching;
 		gboolean cache_into_dirs;
+		gboolean similarity_database;
 		gboolean spec_standard;
 		GdkInterpType quality;
 		gboolean use_exif;
@@ -274,6 +283,7 @@ struct ConfOptions
 	/* file sorting */
 	struct {
 		gboolean case_sensitive; /**< file sorting method (case) */
+		gchar *lua_script; /**< in the lua folder, its value is the key of SORT_LUA */
 	} file_sort;
 
 	/* slideshow */
@@ -314,6 +324,7 @@ struct ConfOptions
 		gboolean use_image;
 		gboolean use_x11_screen_profile;
 		gint render_intent;
+		gboolean use_lut; /**< apply profiles with a lookup table */
 	} color_profile;
 
 	/* Metadata */
@@ -338,6 +349,8 @@ struct ConfOptions
 		gboolean sidecar_extended_name;
 
 		gboolean check_spelling;
+
+		gboolean use_index; /**< keep the metadata used by searches and sorts in an index file */
 	} metadata;
 
 	/* Stereo */
@@ -369,6 +382,7 @@ struct ConfOptions
 		gboolean enable;
 		gchar *select; /**< path to executable */
 		gchar *extract; /**< path to executable */
+		gboolean persistent; /**< tools are started once and read requests from stdin */
 	} external_preview;
 
 	/**
@@ -411,6 +425,10 @@ struct ConfOptions
 	/* Threads */
 	struct {
 		gint duplicates;
+		gint thumbnails; /**< thumbnails loaded in parallel by the file views, 0 for one per core */
+		gint tile_render; /**< threads rendering image tiles at full quality, 0 for one per core */
+		gint search; /**< files checked in parallel by the search window, 0 for one per core */
+		gint lua; /**< Lua scripts run in parallel by the Lua value sort, 0 for one per core */
 	} threads;
 
 	/* Selectable bars */
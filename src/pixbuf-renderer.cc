@@ -25,6 +25,7 @@
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
+#include <vector>
 
 #include "geometry.h"
 #include "main-defines.h"
@@ -33,6 +34,13 @@
 #include "renderer-tiles.h"
 #include "ui-misc.h"
 
+#if defined(__x86_64__) || defined(__i386__)
+#  include <immintrin.h>
+#endif
+#if defined(__ARM_NEON)
+#  include <arm_neon.h>
+#endif
+
 /* comment this out if not using this from within Geeqie
  * defining GQ_BUILD does these things:
  *   - Sets the shift-click scroller pixbuf to a nice icon instead of a black box
@@ -142,6 +150,7 @@ static void pr_birdseye_show(PixbufRenderer *pr);
 
 
 static void pr_source_tile_free_all(PixbufRenderer *pr);
+static void pr_mipmap_free_all(PixbufRenderer *pr);
 
 static void pr_zoom_sync(PixbufRenderer *pr, gdouble zoom,
 			 PrZoomFlags flags, gint px, gint py);
@@ -499,6 +508,7 @@ static void pixbuf_renderer_finalize(GObject *object)
 
 
 	if (pr->pixbuf) g_object_unref(pr->pixbuf);
+	pr_mipmap_free_all(pr);
 
 	pr_scroller_timer_set(pr, FALSE);
 	pr_birdseye_hide(pr);
@@ -1288,6 +1298,7 @@ void pixbuf_renderer_set_tiles(PixbufRenderer *pr, gint width, gint height,
 
 	if (pr->pixbuf) g_object_unref(pr->pixbuf);
 	pr->pixbuf = nullptr;
+	pr_mipmap_free_all(pr);
 
 	pr_source_tile_unset(pr);
 
@@ -1327,6 +1338,330 @@ gint pixbuf_renderer_get_tiles(PixbufRenderer *pr)
 	return pr->source_tiles_enabled;
 }
 
+/*
+ *-------------------------------------------------------------------
+ * mipmaps
+ *-------------------------------------------------------------------
+ */
+
+/* Level n is reduced by 2 x 2 from level n - 1, the first from the image.
+ * Levels are built on a worker, until then tiles are rendered from the
+ * finest level there is, or the image.
+ */
+
+struct PrMipmapJob
+{
+	PixbufRenderer *pr;                     /**< nullptr once the renderer dropped the job */
+	GdkPixbuf *source;                      /**< referenced, the image or the level below the first to build */
+	gint source_level;                      /**< 0 for the image */
+	gint level;                             /**< last level to build */
+	GdkPixbuf *mipmaps[PR_MIPMAP_LEVELS];   /**< built levels that are kept, source_level + 1 up to level */
+	gsize room;                             /**< of the budget, for the levels on the way, when queued */
+	gint64 time;                            /**< microseconds spent building */
+};
+
+static GThreadPool *pr_mipmap_pool = nullptr;
+
+static gsize pr_mipmap_size(const GdkPixbuf *pixbuf)
+{
+	return static_cast<gsize>(gdk_pixbuf_get_rowstride(pixbuf)) * gdk_pixbuf_get_height(pixbuf);
+}
+
+static void pr_mipmap_free_all(PixbufRenderer *pr)
+{
+	if (pr->mipmap_job)
+		{
+		g_atomic_pointer_set(&pr->mipmap_job->pr, nullptr);
+		pr->mipmap_job = nullptr;
+		}
+
+	for (GdkPixbuf *&mipmap : pr->mipmaps)
+		{
+		g_clear_object(&mipmap);
+		}
+	pr->mipmaps_size = 0;
+}
+
+/**
+ * @brief Sums two rows of bytes into 16 bit sums
+ */
+static void pr_mipmap_sum_rows(const guchar *a, const guchar *b, guint16 *sum, gint n)
+{
+	gint i = 0;
+
+#if defined(__SSE2__)
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 16 <= n; i += 16)
+		{
+		const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+		const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+
+		const __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(va, zero), _mm_unpacklo_epi8(vb, zero));
+		const __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(va, zero), _mm_unpackhi_epi8(vb, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(sum + i), lo);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(sum + i + 8), hi);
+		}
+#elif defined(__ARM_NEON)
+	for (; i + 16 <= n; i += 16)
+		{
+		const uint8x16_t va = vld1q_u8(a + i);
+		const uint8x16_t vb = vld1q_u8(b + i);
+
+		vst1q_u16(sum + i, vaddl_u8(vget_low_u8(va), vget_low_u8(vb)));
+		vst1q_u16(sum + i + 8, vaddl_u8(vget_high_u8(va), vget_high_u8(vb)));
+		}
+#endif
+
+	for (; i < n; i++)
+		{
+		sum[i] = a[i] + b[i];
+		}
+}
+
+/**
+ * @brief Reduces a pixbuf by averaging each block of 2 x 2 pixels
+ *
+ * Without alpha, the two rows of a block are summed with SSE2 or NEON and
+ * the pairs of columns then added up. Colors of images with alpha are
+ * weighted by alpha, so that transparent pixels do not darken the edges;
+ * this is done per pixel. A last odd row or column is averaged with itself.
+ */
+static GdkPixbuf *pr_mipmap_new(const GdkPixbuf *src)
+{
+	const gint src_width = gdk_pixbuf_get_width(src);
+	const gint src_height = gdk_pixbuf_get_height(src);
+	const gint src_rowstride = gdk_pixbuf_get_rowstride(src);
+	const guchar *src_pixels = gdk_pixbuf_get_pixels(src);
+	const gboolean has_alpha = gdk_pixbuf_get_has_alpha(src);
+	const gint channels = gdk_pixbuf_get_n_channels(src);
+
+	if (gdk_pixbuf_get_bits_per_sample(src) != 8 || channels != (has_alpha ? 4 : 3)) return nullptr;
+
+	const gint width = (src_width + 1) / 2;
+	const gint height = (src_height + 1) / 2;
+
+	GdkPixbuf *dest = gdk_pixbuf_new(GDK_COLORSPACE_RGB, has_alpha, 8, width, height);
+	if (!dest) return nullptr;
+
+	const gint dest_rowstride = gdk_pixbuf_get_rowstride(dest);
+	guchar *dest_pixels = gdk_pixbuf_get_pixels(dest);
+
+	std::vector<guint16> row_sums(static_cast<gsize>(src_width) * channels);
+
+	for (gint dy = 0; dy < height; dy++)
+		{
+		const guchar *s1 = src_pixels + static_cast<gsize>(2 * dy) * src_rowstride;
+		const guchar *s2 = (2 * dy + 1 < src_height) ? s1 + src_rowstride : s1;
+		guchar *d = dest_pixels + static_cast<gsize>(dy) * dest_rowstride;
+
+		if (!has_alpha)
+			{
+			pr_mipmap_sum_rows(s1, s2, row_sums.data(), src_width * 3);
+
+			for (gint dx = 0; dx < width; dx++)
+				{
+				const guint16 *c1 = row_sums.data() + (6 * dx);
+				const guint16 *c2 = (2 * dx + 1 < src_width) ? c1 + 3 : c1;
+
+				d[0] = (c1[0] + c2[0] + 2) >> 2;
+				d[1] = (c1[1] + c2[1] + 2) >> 2;
+				d[2] = (c1[2] + c2[2] + 2) >> 2;
+				d += 3;
+				}
+			continue;
+			}
+
+		for (gint dx = 0; dx < width; dx++)
+			{
+			const gint x1 = 8 * dx;
+			const gint x2 = (2 * dx + 1 < src_width) ? x1 + 4 : x1;
+			const guchar *p[4] = {s1 + x1, s1 + x2, s2 + x1, s2 + x2};
+			guint32 sum[4] = {0, 0, 0, 0};
+
+			for (const guchar *q : p)
+				{
+				const guint32 alpha = q[3];
+				sum[0] += q[0] * alpha;
+				sum[1] += q[1] * alpha;
+				sum[2] += q[2] * alpha;
+				sum[3] += alpha;
+				}
+
+			for (gint c = 0; c < 3; c++)
+				{
+				d[c] = sum[3] ? (sum[c] + (sum[3] / 2)) / sum[3] : 0;
+				}
+			d[3] = (sum[3] + 2) >> 2;
+			d += 4;
+			}
+		}
+
+	return dest;
+}
+
+static void pr_mipmap_job_free(PrMipmapJob *job)
+{
+	g_object_unref(job->source);
+	for (GdkPixbuf *&mipmap : job->mipmaps)
+		{
+		g_clear_object(&mipmap);
+		}
+	g_free(job);
+}
+
+/**
+ * @brief Drops other mipmaps, finest first, until size more bytes fit the budget
+ */
+static gboolean pr_mipmap_make_room(PixbufRenderer *pr, gsize size)
+{
+	const gsize budget = static_cast<gsize>(pr->tile_cache_max) * 1048576;
+
+	for (GdkPixbuf *&other : pr->mipmaps)
+		{
+		if (pr->mipmaps_size + size <= budget) break;
+		if (!other) continue;
+
+		pr->mipmaps_size -= pr_mipmap_size(other);
+		g_clear_object(&other);
+		}
+
+	return pr->mipmaps_size + size <= budget;
+}
+
+static gboolean pr_mipmap_job_done_cb(gpointer data)
+{
+	auto *job = static_cast<PrMipmapJob *>(data);
+	PixbufRenderer *pr = job->pr;
+
+	if (pr)
+		{
+		pr->mipmap_job = nullptr;
+
+		/* the requested level may drop others, the levels on the way are kept only if they fit */
+		const gsize budget = static_cast<gsize>(pr->tile_cache_max) * 1048576;
+		for (gint level = job->level; level > job->source_level; level--)
+			{
+			GdkPixbuf *&mipmap = job->mipmaps[level - 1];
+			if (!mipmap || pr->mipmaps[level - 1]) continue;
+
+			const gsize size = pr_mipmap_size(mipmap);
+			if (level == job->level ? !pr_mipmap_make_room(pr, size) : pr->mipmaps_size + size > budget) continue;
+
+			pr->mipmaps[level - 1] = mipmap;
+			pr->mipmaps_size += size;
+			mipmap = nullptr;
+			}
+
+		DEBUG_1("%s pixbuf renderer mipmaps 1/%d to 1/%d in %.1f ms", get_exec_time(),
+		        1 << (job->source_level + 1), 1 << job->level, job->time / 1000.0);
+		}
+
+	pr_mipmap_job_free(job);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void pr_mipmap_job_run(gpointer data, gpointer)
+{
+	auto *job = static_cast<PrMipmapJob *>(data);
+	const gint64 start = g_get_monotonic_time();
+
+	/* a level on the way is kept only if it fits the room left when queued,
+	 * otherwise it is dropped as soon as the next one is built from it
+	 */
+	const GdkPixbuf *source = job->source;
+	GdkPixbuf *dropped = nullptr;
+	gsize room = job->room;
+	gint width = gdk_pixbuf_get_width(source);
+	gint height = gdk_pixbuf_get_height(source);
+	for (gint level = job->source_level + 1; level <= job->level; level++)
+		{
+		if (!g_atomic_pointer_get(&job->pr)) break;
+
+		width = (width + 1) / 2;
+		height = (height + 1) / 2;
+		const gsize size = static_cast<gsize>(width) * height * gdk_pixbuf_get_n_channels(source);
+		const gboolean keep = (level == job->level || size <= room);
+
+		GdkPixbuf *mipmap = pr_mipmap_new(source);
+		g_clear_object(&dropped);
+		if (!mipmap) break;
+
+		if (keep)
+			{
+			job->mipmaps[level - 1] = mipmap;
+			if (level < job->level) room -= size;
+			}
+		else
+			{
+			dropped = mipmap;
+			}
+		source = mipmap;
+		}
+	g_clear_object(&dropped);
+
+	job->time = g_get_monotonic_time() - start;
+
+	g_idle_add(pr_mipmap_job_done_cb, job);
+}
+
+/**
+ * @brief Returns the pixbuf to render from at scale, a reduced copy of pr->pixbuf when zoomed out
+ * @param scale The larger of the horizontal and vertical scale from pr->pixbuf
+ *
+ * The reduced copy is the smallest power of two reduction that is still
+ * at least as large as the rendered image, so the scalers read at most
+ * four source pixels per screen pixel. It counts against tile_cache_max;
+ * if it would not fit, pr->pixbuf is returned. The first time a zoom is
+ * rendered the copy is queued for building, and the finest copy already
+ * built, or pr->pixbuf, is returned.
+ */
+GdkPixbuf *pr_mipmap_get(PixbufRenderer *pr, gdouble scale)
+{
+	/* a loading image changes, and stereo offsets are in full size pixels */
+	if (!pr->pixbuf || pr->loading || scale <= 0.0 || scale > 0.5 ||
+	    pr->stereo_pixbuf_offset_left > 0 || pr->stereo_pixbuf_offset_right > 0) return pr->pixbuf;
+
+	const gint level = std::min(static_cast<gint>(floor(-log2(scale))), PR_MIPMAP_LEVELS);
+	if (level < 1) return pr->pixbuf;
+
+	if (pr->mipmaps[level - 1]) return pr->mipmaps[level - 1];
+
+	const gint factor = 1 << level;
+	const gint width = (gdk_pixbuf_get_width(pr->pixbuf) + factor - 1) / factor;
+	const gint height = (gdk_pixbuf_get_height(pr->pixbuf) + factor - 1) / factor;
+	if (width < PR_MIN_SCALE_SIZE || height < PR_MIN_SCALE_SIZE) return pr->pixbuf;
+
+	const gsize size = static_cast<gsize>(width) * height * gdk_pixbuf_get_n_channels(pr->pixbuf);
+	const gsize budget = static_cast<gsize>(pr->tile_cache_max) * 1048576;
+	if (size > budget) return pr->pixbuf;
+
+	gint source_level = level - 1;
+	while (source_level > 0 && !pr->mipmaps[source_level - 1]) source_level--;
+	GdkPixbuf *source = (source_level > 0) ? pr->mipmaps[source_level - 1] : pr->pixbuf;
+
+	if (!pr->mipmap_job)
+		{
+		if (!pr_mipmap_pool)
+			{
+			/* one image is shown at a time, its levels are built in order */
+			pr_mipmap_pool = g_thread_pool_new(pr_mipmap_job_run, nullptr, 1, FALSE, nullptr);
+			}
+
+		auto *job = g_new0(PrMipmapJob, 1);
+		job->pr = pr;
+		job->source = g_object_ref(source);
+		job->source_level = source_level;
+		job->level = level;
+		job->room = (pr->mipmaps_size + size <= budget) ? budget - pr->mipmaps_size - size : 0;
+
+		pr->mipmap_job = job;
+		g_thread_pool_push(pr_mipmap_pool, job, nullptr);
+		}
+
+	return source;
+}
+
 static gdouble pr_zoom_adjust(const PixbufRenderer *pr, gdouble increment)
 {
 	gdouble zoom = pr->zoom;
@@ -2614,6 +2949,7 @@ static void pr_set_pixbuf(PixbufRenderer *pr, GdkPixbuf *pixbuf, gdouble zoom, P
 	if (pixbuf) g_object_ref(pixbuf);
 	if (pr->pixbuf) g_object_unref(pr->pixbuf);
 	pr->pixbuf = pixbuf;
+	pr_mipmap_free_all(pr);
 
 	if (!pr->pixbuf)
 		{
@@ -2838,6 +3174,10 @@ void pixbuf_renderer_area_changed(PixbufRenderer *pr, GdkRectangle area)
 		{
 		pr_source_tile_changed(pr, area);
 		}
+	else
+		{
+		pr_mipmap_free_all(pr);
+		}
 
 	pr->renderer->area_changed(pr->renderer, area);
 	if (pr->renderer2) pr->renderer2->area_changed(pr->renderer2, area);
@@ -35,6 +35,7 @@
 
 struct GqColor;
 struct PixbufRenderer;
+struct PrMipmapJob;
 
 #define TYPE_PIXBUF_RENDERER		(pixbuf_renderer_get_type())
 #define PIXBUF_RENDERER(obj)		(G_TYPE_CHECK_INSTANCE_CAST((obj), TYPE_PIXBUF_RENDERER, PixbufRenderer))
@@ -62,6 +63,13 @@ struct PixbufRenderer;
  */
 #define PR_CACHE_SIZE_DEFAULT 8
 
+/**
+ * @def PR_MIPMAP_LEVELS
+ * number of reduced copies of the image kept for zoomed out rendering,
+ * the smallest is 1/256 of the image size
+ */
+#define PR_MIPMAP_LEVELS 8
+
 /**
  * @def ROUND_UP
  * round A up to integer count of B
@@ -230,6 +238,10 @@ struct PixbufRenderer
 	gint source_tile_width;
 	gint source_tile_height;
 
+	GdkPixbuf *mipmaps[PR_MIPMAP_LEVELS];	/**< pixbuf reduced by 2, 4, 8..., built when first needed */
+	gsize mipmaps_size;			/**< bytes used by mipmaps, counted against tile_cache_max */
+	PrMipmapJob *mipmap_job;		/**< mipmaps being built on a worker */
+
 	using TileRequestFunc = std::function<gboolean(PixbufRenderer *, gint, gint, gint, gint, GdkPixbuf *)>;
 	TileRequestFunc func_tile_request;
 	using TileDisposeFunc = std::function<void(PixbufRenderer *, gint, gint, gint, gint, GdkPixbuf *)>;
@@ -418,6 +430,8 @@ void pr_scale_region(GdkRectangle &region, gdouble scale);
 
 GList *pr_source_tile_compute_region(PixbufRenderer *pr, gint x, gint y, gint w, gint h, gboolean request);
 
+GdkPixbuf *pr_mipmap_get(PixbufRenderer *pr, gdouble scale);
+
 void pr_create_anaglyph(guint mode, GdkPixbuf *pixbuf, GdkPixbuf *right, gint x, gint y, gint w, gint h);
 
 void pixbuf_renderer_set_ignore_alpha(PixbufRenderer *pr, gint ignore_alpha);
@@ -47,6 +47,7 @@
 #include "cache.h"
 #include "color-man.h"
 #include "editors.h"
+#include "filecache.h"
 #include "filedata.h"
 #include "filefilter.h"
 #include "fullscreen.h"
@@ -272,6 +273,9 @@ static GtkWidget *external_preview_extract_entry;
 
 static GtkWidget *sidecar_ext_entry;
 static GtkWidget *help_search_engine_entry;
+#if HAVE_LUA
+static GtkWidget *file_sort_lua_script_entry;
+#endif
 
 #ifdef DEBUG
 static GtkWidget *log_window_f1_entry;
@@ -392,6 +396,9 @@ static void config_window_apply(const ConfOptions *c_options)
 	options->image.fit_window_to_image = c_options->image.fit_window_to_image;
 	options->image.limit_window_size = c_options->image.limit_window_size;
 	options->image.zoom_to_fit_allow_expand = c_options->image.zoom_to_fit_allow_expand;
+	options->image.reduced_decode = c_options->image.reduced_decode;
+	options->image.embedded_preview = c_options->image.embedded_preview;
+	options->image.histogram_preview = c_options->image.histogram_preview;
 	options->image.max_window_size = c_options->image.max_window_size;
 	options->image.limit_autofit_size = c_options->image.limit_autofit_size;
 	options->image.max_autofit_size = c_options->image.max_autofit_size;
@@ -428,6 +435,7 @@ static void config_window_apply(const ConfOptions *c_options)
 
 	options->image.tile_cache_max = c_options->image.tile_cache_max;
 	options->image.image_cache_max = c_options->image.image_cache_max;
+	options->image.image_cache_auto = c_options->image.image_cache_auto;
 
 	options->image.zoom_quality = c_options->image.zoom_quality;
 
@@ -436,6 +444,8 @@ static void config_window_apply(const ConfOptions *c_options)
 	options->image.zoom_style = c_options->image.zoom_style;
 
 	options->image.enable_read_ahead = c_options->image.enable_read_ahead;
+	options->image.read_ahead_count = c_options->image.read_ahead_count;
+	options->image.read_behind_count = c_options->image.read_behind_count;
 
 	options->appimage_notifications = c_options->appimage_notifications;
 
@@ -526,8 +536,12 @@ static void config_window_apply(const ConfOptions *c_options)
 	options->hide_window_in_fullscreen = c_options->hide_window_in_fullscreen;
 	options->hide_osd_in_fullscreen = c_options->hide_osd_in_fullscreen;
 	config_entry_to_option(help_search_engine_entry, &options->help_search_engine, nullptr);
+#if HAVE_LUA
+	config_entry_to_option(file_sort_lua_script_entry, &options->file_sort.lua_script, nullptr);
+#endif
 
 	options->external_preview.enable = c_options->external_preview.enable;
+	options->external_preview.persistent = c_options->external_preview.persistent;
 	config_entry_to_option(external_preview_select_entry, &options->external_preview.select, nullptr);
 	config_entry_to_option(external_preview_extract_entry, &options->external_preview.extract, nullptr);
 
@@ -536,8 +550,13 @@ static void config_window_apply(const ConfOptions *c_options)
 	options->star_rating = c_options->star_rating;
 
 	options->threads.duplicates = c_options->threads.duplicates > 0 ? c_options->threads.duplicates : -1;
+	options->threads.thumbnails = c_options->threads.thumbnails;
+	options->threads.tile_render = c_options->threads.tile_render;
+	options->threads.search = c_options->threads.search;
+	options->threads.lua = c_options->threads.lua;
 
 	options->alternate_similarity_algorithm = c_options->alternate_similarity_algorithm;
+	options->duplicates_sim_prefilter = c_options->duplicates_sim_prefilter;
 
 #ifdef DEBUG
 	set_debug_level(debug_c);
@@ -559,6 +578,11 @@ static void config_window_apply(const ConfOptions *c_options)
 		options->color_profile.render_intent = c_options->color_profile.render_intent;
 		color_man_update();
 		}
+	if (options->color_profile.use_lut != c_options->color_profile.use_lut)
+		{
+		options->color_profile.use_lut = c_options->color_profile.use_lut;
+		color_man_update();
+		}
 #endif
 
 	options->mouse_button_8 = c_options->mouse_button_8;
@@ -1822,6 +1846,10 @@ static void config_tab_general(GtkWidget *notebook, ConfOptions *c_options)
 	                     options->thumbnails.spec_standard && !options->thumbnails.cache_into_dirs,
 	                     G_CALLBACK(cache_standard_cb), c_options);
 
+	button = pref_checkbox_new_int(subgroup, _("Keep similarity data in a single database file"),
+	                               options->thumbnails.similarity_database, &c_options->thumbnails.similarity_database);
+	gtk_widget_set_tooltip_text(button, _("Store the data used by Find duplicates in one file instead of a .sim file per image. Existing .sim files are imported when first read."));
+
 	pref_checkbox_new_int(group, _("Use EXIF thumbnails when available (EXIF thumbnails may be outdated)"),
 			      options->thumbnails.use_exif, &c_options->thumbnails.use_exif);
 
@@ -1885,14 +1913,27 @@ static void config_tab_general(GtkWidget *notebook, ConfOptions *c_options)
 
 	group = pref_group_new(vbox, FALSE, _("Image loading and caching"), GTK_ORIENTATION_VERTICAL);
 
+	button = pref_checkbox_new_int(group, _("Size decoded image cache from installed memory"),
+				       options->image.image_cache_auto, &c_options->image.image_cache_auto);
+	g_autofree gchar *auto_size_tip = g_strdup_printf(_("Use an eighth of the installed memory, currently %zu MiB, instead of the size below"),
+	                                                  file_cache_memory_budget() / 1048576);
+	gtk_widget_set_tooltip_text(button, auto_size_tip);
 	pref_spin_new_int(group, _("Decoded image cache size (MiB):"), nullptr,
 			  0, 99999, 1, options->image.image_cache_max, &c_options->image.image_cache_max);
 	display_cache = pref_spin_new_int(group, _("Display tile cache per image (MiB):"), nullptr,
 	                                  0, 1024, 1, options->image.tile_cache_max, &c_options->image.tile_cache_max);
 	gtk_widget_set_tooltip_text(display_cache,
 	                            _("Maximum memory used to cache rendered image tiles for each image view. Larger values may improve panning and repaint performance, particularly on high-resolution displays. A value of 64 MiB is recommended."));
-	pref_checkbox_new_int(group, _("Preload next image"),
-			      options->image.enable_read_ahead, &c_options->image.enable_read_ahead);
+	ct_button = pref_checkbox_new_int(group, _("Preload next image"),
+					  options->image.enable_read_ahead, &c_options->image.enable_read_ahead);
+
+	subgroup = pref_box_new(group, FALSE, GTK_ORIENTATION_HORIZONTAL, PREF_PAD_SPACE);
+	pref_checkbox_link_sensitivity(ct_button, subgroup);
+	spin = pref_spin_new_int(subgroup, _("Images ahead:"), nullptr,
+				 1, 32, 1, options->image.read_ahead_count, &c_options->image.read_ahead_count);
+	gtk_widget_set_tooltip_text(spin, _("Number of images to preload in the direction of travel. Preloading stops when the decoded image cache is full."));
+	pref_spin_new_int(subgroup, _("behind:"), nullptr,
+			  0, 32, 1, options->image.read_behind_count, &c_options->image.read_behind_count);
 
 	pref_checkbox_new_int(group, _("Refresh on file change"),
 			      options->update_on_time_change, &c_options->update_on_time_change);
@@ -2001,6 +2042,7 @@ static void config_tab_image(GtkWidget *notebook, ConfOptions *c_options)
 	GtkWidget *hbox;
 	GtkWidget *vbox;
 	GtkWidget *group;
+	GtkWidget *button;
 	GtkWidget *ct_button;
 	GtkWidget *enlargement_button;
 	GtkWidget *table;
@@ -2048,6 +2090,21 @@ static void config_tab_image(GtkWidget *notebook, ConfOptions *c_options)
 	gtk_widget_set_tooltip_text(hbox,
 	                            _("This value will set the virtual size of the window when 'Fit image to window' is set. Instead of using the actual size of the window, the specified percentage of the window will be used. It allows one to keep a border around the image (values lower than 100%) or to auto zoom the image (values greater than 100%). It affects fullscreen mode too."));
 
+	button = pref_checkbox_new_int(group, _("Decode large images at screen size"),
+				       options->image.reduced_decode, &c_options->image.reduced_decode);
+	gtk_widget_set_tooltip_text(button,
+	                            _("When an image is much larger than the window, decode it at about the window size. This is faster and uses less memory. The full image is decoded when zooming in beyond that size, and for copying to the clipboard."));
+
+	button = pref_checkbox_new_int(group, _("Show embedded preview while loading"),
+				       options->image.embedded_preview, &c_options->image.embedded_preview);
+	gtk_widget_set_tooltip_text(button,
+	                            _("Raw files and many jpeg files contain a smaller preview image. Show it at once while the image itself is decoded."));
+
+	button = pref_checkbox_new_int(group, _("Show quick histogram of large images"),
+				       options->image.histogram_preview, &c_options->image.histogram_preview);
+	gtk_widget_set_tooltip_text(button,
+	                            _("Show a histogram of a sample of the pixels at once, and replace it when the histogram of all pixels is ready."));
+
 	group = pref_group_new(vbox, FALSE, _("Tile size"), GTK_ORIENTATION_VERTICAL);
 
 	hbox = pref_box_new(group, FALSE, GTK_ORIENTATION_HORIZONTAL, PREF_PAD_SPACE);
@@ -2445,6 +2502,14 @@ static void config_tab_files(GtkWidget *notebook, ConfOptions *c_options)
 	pref_checkbox_new_int(group, _("Show parent folder (..)"),
 			      options->file_filter.show_parent_directory, &c_options->file_filter.show_parent_directory);
 	pref_checkbox_new_int(group, _("Case sensitive sort (Search and Collection windows, and tab completion)"), options->file_sort.case_sensitive, &c_options->file_sort.case_sensitive);
+#if HAVE_LUA
+	hbox = pref_box_new(group, FALSE, GTK_ORIENTATION_HORIZONTAL, PREF_PAD_SPACE);
+	pref_label_new(hbox, _("Lua script of \"Sort by Lua value\":"));
+	file_sort_lua_script_entry = gtk_entry_new();
+	entry_set_text(GTK_ENTRY(file_sort_lua_script_entry), options->file_sort.lua_script ? options->file_sort.lua_script : "");
+	gtk_box_append(GTK_BOX(hbox), file_sort_lua_script_entry);
+	gtk_widget_set_tooltip_text(file_sort_lua_script_entry, _("A script in the lua folder, run for each file of the list. What it returns is the sort key, numbers sort before text."));
+#endif
 	pref_checkbox_new_int(group, _("Disable file extension checks"),
 			      options->file_filter.disable_file_extension_checks, &c_options->file_filter.disable_file_extension_checks);
 
@@ -2739,6 +2804,9 @@ static void config_tab_metadata(GtkWidget *notebook, ConfOptions *c_options)
 
 	ct_button = pref_checkbox_new_int(group, _("Read metadata in background"), options->read_metadata_in_idle, &c_options->read_metadata_in_idle);
 	gtk_widget_set_tooltip_text(ct_button,_("On folder change, read DateTimeOriginal, DateTimeDigitized and Star Rating in the idle loop.\nIf this is not selected, initial loading of the folder will be faster but sorting on these items will be slower"));
+
+	ct_button = pref_checkbox_new_int(group, _("Keep an index of metadata for searches and sorts"), options->metadata.use_index, &c_options->metadata.use_index);
+	gtk_widget_set_tooltip_text(ct_button, _("Keywords, comment, rating, date, camera, lens and GPS position of each file read are kept in one file in the cache folder.\nSearching and sorting files already in the index does not read their metadata again"));
 }
 
 /* keywords tab */
@@ -3164,6 +3232,10 @@ static void config_tab_color(GtkWidget *notebook, ConfOptions *c_options)
 	add_intent_menu(table, 0, 1, _("Render Intent:"), options->color_profile.render_intent, &c_options->color_profile.render_intent);
 #endif
 	gtk_grid_attach(GTK_GRID(table), tab_completion_get_box(color_profile_screen_file_entry), 1, 0, 1, 1);
+
+	GtkWidget *lut_button = pref_checkbox_new_int(group, _("Apply profiles with a lookup table"),
+	                                              options->color_profile.use_lut, &c_options->color_profile.use_lut);
+	gtk_widget_set_tooltip_text(lut_button, _("Much faster, with a small loss of accuracy"));
 }
 
 /* advanced entry tab */
@@ -3551,10 +3623,17 @@ static void config_tab_toolbar(GtkWidget *notebook, GtkWidget *window, ToolbarTy
 static void config_tab_advanced(GtkWidget *notebook, ConfOptions *c_options)
 {
 	GtkWidget *alternate_checkbox;
+	GtkWidget *checkbox;
 	GtkWidget *dupes_threads_spin;
 	GtkWidget *group;
 	GtkWidget *subgroup;
 	GtkWidget *threads_string_label;
+	GtkWidget *thumbs_threads_spin;
+	GtkWidget *render_threads_spin;
+	GtkWidget *search_threads_spin;
+#if HAVE_LUA
+	GtkWidget *lua_threads_spin;
+#endif
 	GtkWidget *types_string_label;
 	GtkWidget *vbox;
 
@@ -3585,13 +3664,14 @@ static void config_tab_advanced(GtkWidget *notebook, ConfOptions *c_options)
 	external_preview_extract_entry = tab_completion_new(group, options->external_preview.extract);
 	tab_completion_add_select_button(external_preview_extract_entry, _("Select preview extraction tool"), FALSE, nullptr, nullptr, nullptr);
 
+	pref_checkbox_new_int(group, _("Tools run persistently and read one request per line"), options->external_preview.persistent, &c_options->external_preview.persistent);
 
 	pref_spacer(group, PREF_PAD_GROUP);
 
 	pref_line(vbox, PREF_PAD_SPACE);
 	group = pref_group_new(vbox, FALSE, _("Thread pool limits"), GTK_ORIENTATION_VERTICAL);
 
-	threads_string_label = pref_label_new(group, _("This option limits the number of threads (or cpu cores) that Geeqie will use when running duplicate checks.\nThe value 0 means all available cores will be used."));
+	threads_string_label = pref_label_new(group, _("These options limit the number of threads (or cpu cores) that Geeqie will use when running duplicate checks, loading thumbnails, rendering images, searching and sorting by Lua value.\nThe value 0 means all available cores will be used."));
 	gtk_label_set_wrap(GTK_LABEL(threads_string_label), TRUE);
 
 	pref_spacer(vbox, PREF_PAD_GROUP);
@@ -3599,6 +3679,20 @@ static void config_tab_advanced(GtkWidget *notebook, ConfOptions *c_options)
 	dupes_threads_spin = pref_spin_new_int(vbox, _("Duplicate check:"), _("max. threads"), 0, get_cpu_cores(), 1, options->threads.duplicates, &c_options->threads.duplicates);
 	gtk_widget_set_tooltip_markup(dupes_threads_spin, _("Set to 0 for unlimited"));
 
+	thumbs_threads_spin = pref_spin_new_int(vbox, _("Thumbnails:"), _("max. threads"), 0, get_cpu_cores(), 1, options->threads.thumbnails, &c_options->threads.thumbnails);
+	gtk_widget_set_tooltip_markup(thumbs_threads_spin, _("Set to 0 for one per core"));
+
+	render_threads_spin = pref_spin_new_int(vbox, _("Image rendering:"), _("max. threads"), 0, get_cpu_cores(), 1, options->threads.tile_render, &c_options->threads.tile_render);
+	gtk_widget_set_tooltip_markup(render_threads_spin, _("Set to 0 for one per core"));
+
+	search_threads_spin = pref_spin_new_int(vbox, _("Search:"), _("max. threads"), 0, get_cpu_cores(), 1, options->threads.search, &c_options->threads.search);
+	gtk_widget_set_tooltip_markup(search_threads_spin, _("Set to 0 for one per core"));
+
+#if HAVE_LUA
+	lua_threads_spin = pref_spin_new_int(vbox, _("Lua value sort:"), _("max. threads"), 0, get_cpu_cores(), 1, options->threads.lua, &c_options->threads.lua);
+	gtk_widget_set_tooltip_markup(lua_threads_spin, _("Set to 0 for one per core"));
+#endif
+
 	pref_spacer(group, PREF_PAD_GROUP);
 
 	pref_line(vbox, PREF_PAD_SPACE);
@@ -3612,6 +3706,13 @@ static void config_tab_advanced(GtkWidget *notebook, ConfOptions *c_options)
 
 	alternate_checkbox = pref_checkbox_new_int(subgroup, _("Use grayscale"), options->alternate_similarity_algorithm.grayscale, &c_options->alternate_similarity_algorithm.grayscale);
 	gtk_widget_set_tooltip_text(alternate_checkbox, _("Reduce fingerprint to grayscale"));
+
+	pref_line(vbox, PREF_PAD_SPACE);
+
+	group = pref_group_new(vbox, FALSE, _("Similarity prefilter"), GTK_ORIENTATION_VERTICAL);
+
+	checkbox = pref_checkbox_new_int(group, _("Reject clearly different images on a reduced fingerprint"), options->duplicates_sim_prefilter, &c_options->duplicates_sim_prefilter);
+	gtk_widget_set_tooltip_text(checkbox, _("Compare a 16 x 16 fingerprint first, and skip the full 32 x 32 compare if it cannot match"));
 }
 
 /* stereo tab */
@@ -420,6 +420,8 @@ static void write_global_attributes(GString *outstr, gint indent)
 	WRITE_NL(); WRITE_BOOL(*options, duplicates_thumbnails);
 	WRITE_NL(); WRITE_BOOL(*options, rot_invariant_sim);
 	WRITE_NL(); WRITE_BOOL(*options, sort_totals);
+	WRITE_NL(); WRITE_BOOL(*options, duplicates_sim_exhaustive);
+	WRITE_NL(); WRITE_BOOL(*options, duplicates_sim_prefilter);
 	WRITE_SEPARATOR();
 
 	WRITE_NL(); WRITE_BOOL(*options, mousewheel_scrolls);
@@ -457,6 +459,7 @@ static void write_global_attributes(GString *outstr, gint indent)
 	WRITE_NL(); WRITE_BOOL(*options, external_preview.enable);
 	WRITE_NL(); WRITE_CHAR(*options, external_preview.select);
 	WRITE_NL(); WRITE_CHAR(*options, external_preview.extract);
+	WRITE_NL(); WRITE_BOOL(*options, external_preview.persistent);
 
 	WRITE_NL(); WRITE_BOOL(*options, with_rename);
 	WRITE_NL(); WRITE_BOOL(*options, collections_duplicates);
@@ -484,6 +487,9 @@ static void write_global_attributes(GString *outstr, gint indent)
 	WRITE_SEPARATOR();
 	WRITE_NL(); WRITE_BOOL(*options, image.zoom_2pass);
 	WRITE_NL(); WRITE_BOOL(*options, image.zoom_to_fit_allow_expand);
+	WRITE_NL(); WRITE_BOOL(*options, image.reduced_decode);
+	WRITE_NL(); WRITE_BOOL(*options, image.embedded_preview);
+	WRITE_NL(); WRITE_BOOL(*options, image.histogram_preview);
 	WRITE_NL(); WRITE_UINT(*options, image.zoom_quality);
 	WRITE_NL(); WRITE_INT(*options, image.zoom_increment);
 	WRITE_NL(); WRITE_UINT(*options, image.zoom_style);
@@ -496,7 +502,10 @@ static void write_global_attributes(GString *outstr, gint indent)
 	WRITE_NL(); WRITE_UINT(*options, image.scroll_reset_method);
 	WRITE_NL(); WRITE_INT(*options, image.tile_cache_max);
 	WRITE_NL(); WRITE_INT(*options, image.image_cache_max);
+	WRITE_NL(); WRITE_BOOL(*options, image.image_cache_auto);
 	WRITE_NL(); WRITE_BOOL(*options, image.enable_read_ahead);
+	WRITE_NL(); WRITE_INT(*options, image.read_ahead_count);
+	WRITE_NL(); WRITE_INT(*options, image.read_behind_count);
 	WRITE_NL(); WRITE_BOOL(*options, image.exif_rotate_enable);
 	WRITE_NL(); WRITE_BOOL(*options, image.use_custom_border_color);
 	WRITE_NL(); WRITE_BOOL(*options, image.use_custom_border_color_in_fullscreen);
@@ -510,6 +519,7 @@ static void write_global_attributes(GString *outstr, gint indent)
 	WRITE_NL(); WRITE_INT_FULL("thumbnails.max_height", options->thumbnails.size.height);
 	WRITE_NL(); WRITE_BOOL(*options, thumbnails.enable_caching);
 	WRITE_NL(); WRITE_BOOL(*options, thumbnails.cache_into_dirs);
+	WRITE_NL(); WRITE_BOOL(*options, thumbnails.similarity_database);
 	WRITE_NL(); WRITE_BOOL(*options, thumbnails.spec_standard);
 	WRITE_NL(); WRITE_UINT(*options, thumbnails.quality);
 	WRITE_NL(); WRITE_BOOL(*options, thumbnails.use_exif);
@@ -519,6 +529,7 @@ static void write_global_attributes(GString *outstr, gint indent)
 
 	/* File sorting Options */
 	WRITE_NL(); WRITE_BOOL(*options, file_sort.case_sensitive);
+	WRITE_NL(); WRITE_CHAR(*options, file_sort.lua_script);
 
 	/* Fullscreen Options */
 	WRITE_NL(); WRITE_INT(*options, fullscreen.screen);
@@ -583,6 +594,7 @@ static void write_global_attributes(GString *outstr, gint indent)
 	WRITE_NL(); WRITE_BOOL(*options, metadata.keywords_case_sensitive);
 	WRITE_NL(); WRITE_BOOL(*options, metadata.write_orientation);
 	WRITE_NL(); WRITE_BOOL(*options, metadata.check_spelling);
+	WRITE_NL(); WRITE_BOOL(*options, metadata.use_index);
 
 	WRITE_NL(); WRITE_INT(*options, stereo.mode);
 	WRITE_NL(); WRITE_INT(*options, stereo.fsmode);
@@ -620,6 +632,10 @@ static void write_global_attributes(GString *outstr, gint indent)
 
 	/* Threads */
 	WRITE_NL(); WRITE_INT(*options, threads.duplicates);
+	WRITE_NL(); WRITE_INT(*options, threads.thumbnails);
+	WRITE_NL(); WRITE_INT(*options, threads.tile_render);
+	WRITE_NL(); WRITE_INT(*options, threads.search);
+	WRITE_NL(); WRITE_INT(*options, threads.lua);
 	WRITE_SEPARATOR();
 
 	/* user-definable mouse buttons */
@@ -648,6 +664,7 @@ static void write_color_profile(GString *outstr, gint indent)
 	WRITE_INT(options->color_profile, input_type);
 	WRITE_BOOL(options->color_profile, use_x11_screen_profile);
 	WRITE_INT(options->color_profile, render_intent);
+	WRITE_BOOL(options->color_profile, use_lut);
 	WRITE_STRING(">");
 
 	indent++;
@@ -893,6 +910,8 @@ static gboolean load_global_params(const gchar **attribute_names, const gchar **
 		if (READ_BOOL(*options, duplicates_thumbnails)) continue;
 		if (READ_BOOL(*options, rot_invariant_sim)) continue;
 		if (READ_BOOL(*options, sort_totals)) continue;
+		if (READ_BOOL(*options, duplicates_sim_exhaustive)) continue;
+		if (READ_BOOL(*options, duplicates_sim_prefilter)) continue;
 
 		if (READ_BOOL(*options, progressive_key_scrolling)) continue;
 		if (READ_UINT_CLAMP(*options, keyboard_scroll_step, 1, 32)) continue;
@@ -933,6 +952,7 @@ static gboolean load_global_params(const gchar **attribute_names, const gchar **
 		if (READ_BOOL(*options, external_preview.enable)) continue;
 		if (READ_CHAR(*options, external_preview.select)) continue;
 		if (READ_CHAR(*options, external_preview.extract)) continue;
+		if (READ_BOOL(*options, external_preview.persistent)) continue;
 
 		if (READ_BOOL(*options, collections_duplicates)) continue;
 		if (READ_BOOL(*options, hide_window_in_fullscreen)) continue;
@@ -949,6 +969,9 @@ static gboolean load_global_params(const gchar **attribute_names, const gchar **
 		if (READ_UINT_ENUM_CLAMP(*options, image.zoom_style, 0, ZOOM_ARITHMETIC)) continue;
 		if (READ_BOOL(*options, image.zoom_2pass)) continue;
 		if (READ_BOOL(*options, image.zoom_to_fit_allow_expand)) continue;
+		if (READ_BOOL(*options, image.reduced_decode)) continue;
+		if (READ_BOOL(*options, image.embedded_preview)) continue;
+		if (READ_BOOL(*options, image.histogram_preview)) continue;
 		if (READ_BOOL(*options, image.fit_window_to_image)) continue;
 		if (READ_BOOL(*options, image.limit_window_size)) continue;
 		if (READ_INT(*options, image.max_window_size)) continue;
@@ -958,9 +981,12 @@ static gboolean load_global_params(const gchar **attribute_names, const gchar **
 		if (READ_UINT_ENUM_CLAMP(*options, image.scroll_reset_method, 0, ScrollReset::COUNT - 1)) continue;
 		if (READ_INT(*options, image.tile_cache_max)) continue;
 		if (READ_INT(*options, image.image_cache_max)) continue;
+		if (READ_BOOL(*options, image.image_cache_auto)) continue;
 		if (READ_UINT_ENUM_CLAMP(*options, image.zoom_quality, GDK_INTERP_NEAREST, GDK_INTERP_BILINEAR)) continue;
 		if (READ_INT(*options, image.zoom_increment)) continue;
 		if (READ_BOOL(*options, image.enable_read_ahead)) continue;
+		if (READ_INT_CLAMP(*options, image.read_ahead_count, 1, 32)) continue;
+		if (READ_INT_CLAMP(*options, image.read_behind_count, 0, 32)) continue;
 		if (READ_BOOL(*options, image.exif_rotate_enable)) continue;
 		if (READ_BOOL(*options, image.use_custom_border_color)) continue;
 		if (READ_BOOL(*options, image.use_custom_border_color_in_fullscreen)) continue;
@@ -975,6 +1001,7 @@ static gboolean load_global_params(const gchar **attribute_names, const gchar **
 
 		if (READ_BOOL(*options, thumbnails.enable_caching)) continue;
 		if (READ_BOOL(*options, thumbnails.cache_into_dirs)) continue;
+		if (READ_BOOL(*options, thumbnails.similarity_database)) continue;
 		if (READ_BOOL(*options, thumbnails.spec_standard)) continue;
 		if (READ_UINT_ENUM_CLAMP(*options, thumbnails.quality, GDK_INTERP_NEAREST, GDK_INTERP_BILINEAR)) continue;
 		if (READ_BOOL(*options, thumbnails.use_exif)) continue;
@@ -984,6 +1011,7 @@ static gboolean load_global_params(const gchar **attribute_names, const gchar **
 
 		/* File sorting options */
 		if (READ_BOOL(*options, file_sort.case_sensitive)) continue;
+		if (READ_CHAR(*options, file_sort.lua_script)) continue;
 
 		/* File operations *options */
 		if (READ_BOOL(*options, file_ops.enable_in_place_rename)) continue;
@@ -1055,6 +1083,7 @@ static gboolean load_global_params(const gchar **attribute_names, const gchar **
 		if (READ_BOOL(*options, metadata.keywords_case_sensitive)) continue;
 		if (READ_BOOL(*options, metadata.write_orientation)) continue;
 		if (READ_BOOL(*options, metadata.check_spelling)) continue;
+		if (READ_BOOL(*options, metadata.use_index)) continue;
 
 		if (READ_INT(*options, stereo.mode)) continue;
 		if (READ_INT(*options, stereo.fsmode)) continue;
@@ -1089,6 +1118,10 @@ static gboolean load_global_params(const gchar **attribute_names, const gchar **
 
 		/* Threads */
 		if (READ_INT(*options, threads.duplicates)) continue;
+		if (READ_INT_CLAMP(*options, threads.thumbnails, 0, 256)) continue;
+		if (READ_INT_CLAMP(*options, threads.tile_render, 0, 256)) continue;
+		if (READ_INT_CLAMP(*options, threads.search, 0, 256)) continue;
+		if (READ_INT_CLAMP(*options, threads.lua, 0, 256)) continue;
 
 		/* user-definable mouse buttons */
 		if (READ_CHAR(*options, mouse_button_8)) continue;
@@ -1121,6 +1154,7 @@ static void options_load_color_profiles(const gchar **attribute_names, const gch
 		if (READ_CHAR(options->color_profile, screen_file)) continue;
 		if (READ_BOOL(options->color_profile, use_x11_screen_profile)) continue;
 		if (READ_INT(options->color_profile, render_intent)) continue;
+		if (READ_BOOL(options->color_profile, use_lut)) continue;
 
 		config_file_error((std::string("Unknown attribute: ") + option + " = " + value).c_str());
 		}
@@ -70,6 +70,7 @@ cairo_surface_t *rt_surface_new(gint width, gint height)
 }
 
 struct QueueData;
+struct RendererTiles;
 
 enum class TileRender {
 	NONE = 0, /**< do nothing */
@@ -111,6 +112,49 @@ struct QueueData
 	gboolean new_data;
 };
 
+/* lets worker jobs find their renderer, or see that it is gone */
+struct TileRenderLink
+{
+	RendererTiles *rt;
+	gint ref;
+};
+
+/* what rendering a tile region from pr->pixbuf needs, so that it can run on a worker */
+struct TileRenderParams
+{
+	GdkPixbuf *source;
+	gboolean has_alpha;
+	gboolean ignore_alpha;
+	gboolean wide_image;
+	GdkRectangle pb_rect;	/* region of the tile, before orientation */
+	gdouble src_x;
+	gdouble src_y;
+	gdouble scale_x;
+	gdouble scale_y;
+	GdkInterpType interp_type;
+	gint check_x;
+	gint check_y;
+	gint orientation;
+	gint tile_width;
+	gint tile_height;
+};
+
+struct TileRenderJob
+{
+	TileRenderLink *link;
+	guint generation;
+	gint tile_x;		/* identifies the tile, which may be gone when the job is done */
+	gint tile_y;
+	GdkRectangle area;	/* region of the tile */
+	TileRenderParams params;
+	gint pixbuf_offset;	/* stereo offset in the source */
+	GdkPixbuf *pixbuf;
+	GdkPixbuf *spare;
+	PixbufRenderer::PostProcessFunc post_process;
+	PixbufRenderer *pr;	/* only passed on to post_process */
+	gint64 render_time;
+};
+
 struct OverlayData
 {
 	gint id;
@@ -150,6 +194,13 @@ struct RendererTiles
 
 	gint x_scroll;  /* allow local adjustment and mirroring */
 	gint y_scroll;
+
+	TileRenderLink *render_link;	/* shared with the worker jobs, outlives the renderer */
+	guint render_generation;	/* results of older jobs are stale */
+	gint render_jobs;		/* jobs not yet handed back */
+	gint64 render_batch_start;
+	gint render_batch_tiles;
+	gint64 render_batch_worker_time;
 };
 
 constexpr size_t COLOR_BYTES = 3; /* rgb */
@@ -304,6 +355,7 @@ void rt_tile_free_all(RendererTiles *rt)
 	g_list_free_full(rt->tiles, reinterpret_cast<GDestroyNotify>(rt_tile_free));
 	rt->tiles = nullptr;
 	rt->tile_cache_size = 0;
+	rt->render_generation++;
 }
 
 ImageTile *rt_tile_add(RendererTiles *rt, gint x, gint y)
@@ -376,6 +428,9 @@ void rt_tile_free_space(RendererTiles *rt, guint space, ImageTile *it)
 		tile_max = pr->tile_cache_max * 1048576;
 		}
 
+	/* the mipmaps share the budget, visible tiles are kept in any case */
+	tile_max -= static_cast<guint>(std::min<gsize>(pr->mipmaps_size, tile_max));
+
 	while (work && rt->tile_cache_size + space > tile_max)
 		{
 		ImageTile *needle;
@@ -392,6 +447,8 @@ void rt_tile_invalidate_all(RendererTiles *rt)
 	PixbufRenderer *pr = rt->pr;
 	GList *work;
 
+	rt->render_generation++;
+
 	work = rt->tiles;
 	while (work)
 		{
@@ -668,13 +725,18 @@ void rt_scale_factor_changed_cb(GObject *, GParamSpec *, gpointer data)
  *-------------------------------------------------------------------
  */
 
+GdkPixbuf *rt_spare_tile_get(GdkPixbuf **spare, gint tile_width, gint tile_height)
+{
+	if (!*spare) *spare = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, tile_width, tile_height);
+	return *spare;
+}
+
 GdkPixbuf *rt_get_spare_tile(RendererTiles *rt)
 {
-	if (!rt->spare_tile) rt->spare_tile = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, rt->tile_width, rt->tile_height);
-	return rt->spare_tile;
+	return rt_spare_tile_get(&rt->spare_tile, rt->tile_width, rt->tile_height);
 }
 
-void rt_tile_rotate_90_clockwise(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
+void rt_tile_rotate_90_clockwise(gint tile_width, gint tile_height, GdkPixbuf **spare, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
 {
 	GdkPixbuf *src = *tile;
 	GdkPixbuf *dest;
@@ -689,13 +751,13 @@ void rt_tile_rotate_90_clockwise(RendererTiles *rt, GdkPixbuf **tile, gint x, gi
 	guchar *dpi;
 	gint i;
 	gint j;
-	gint tw = rt->tile_width;
+	gint tw = tile_width;
 
 	srs = gdk_pixbuf_get_rowstride(src);
 	s_pix = gdk_pixbuf_get_pixels(src);
 	spi = s_pix + (x * COLOR_BYTES);
 
-	dest = rt_get_spare_tile(rt);
+	dest = rt_spare_tile_get(spare, tile_width, tile_height);
 	drs = gdk_pixbuf_get_rowstride(dest);
 	d_pix = gdk_pixbuf_get_pixels(dest);
 	dpi = d_pix + ((tw - 1) * COLOR_BYTES);
@@ -712,11 +774,11 @@ void rt_tile_rotate_90_clockwise(RendererTiles *rt, GdkPixbuf **tile, gint x, gi
 			}
 		}
 
-	rt->spare_tile = src;
+	*spare = src;
 	*tile = dest;
 }
 
-void rt_tile_rotate_90_counter_clockwise(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
+void rt_tile_rotate_90_counter_clockwise(gint tile_width, gint tile_height, GdkPixbuf **spare, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
 {
 	GdkPixbuf *src = *tile;
 	GdkPixbuf *dest;
@@ -731,13 +793,13 @@ void rt_tile_rotate_90_counter_clockwise(RendererTiles *rt, GdkPixbuf **tile, gi
 	guchar *dpi;
 	gint i;
 	gint j;
-	gint th = rt->tile_height;
+	gint th = tile_height;
 
 	srs = gdk_pixbuf_get_rowstride(src);
 	s_pix = gdk_pixbuf_get_pixels(src);
 	spi = s_pix + (x * COLOR_BYTES);
 
-	dest = rt_get_spare_tile(rt);
+	dest = rt_spare_tile_get(spare, tile_width, tile_height);
 	drs = gdk_pixbuf_get_rowstride(dest);
 	d_pix = gdk_pixbuf_get_pixels(dest);
 	dpi = d_pix + ((th - 1) * drs);
@@ -754,11 +816,11 @@ void rt_tile_rotate_90_counter_clockwise(RendererTiles *rt, GdkPixbuf **tile, gi
 			}
 		}
 
-	rt->spare_tile = src;
+	*spare = src;
 	*tile = dest;
 }
 
-void rt_tile_mirror_only(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
+void rt_tile_mirror_only(gint tile_width, gint tile_height, GdkPixbuf **spare, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
 {
 	GdkPixbuf *src = *tile;
 	GdkPixbuf *dest;
@@ -773,13 +835,13 @@ void rt_tile_mirror_only(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gi
 	gint i;
 	gint j;
 
-	gint tw = rt->tile_width;
+	gint tw = tile_width;
 
 	srs = gdk_pixbuf_get_rowstride(src);
 	s_pix = gdk_pixbuf_get_pixels(src);
 	spi = s_pix + (x * COLOR_BYTES);
 
-	dest = rt_get_spare_tile(rt);
+	dest = rt_spare_tile_get(spare, tile_width, tile_height);
 	drs = gdk_pixbuf_get_rowstride(dest);
 	d_pix = gdk_pixbuf_get_pixels(dest);
 	dpi =  d_pix + ((tw - x - 1) * COLOR_BYTES);
@@ -796,11 +858,11 @@ void rt_tile_mirror_only(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gi
 			}
 		}
 
-	rt->spare_tile = src;
+	*spare = src;
 	*tile = dest;
 }
 
-void rt_tile_mirror_and_flip(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
+void rt_tile_mirror_and_flip(gint tile_width, gint tile_height, GdkPixbuf **spare, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
 {
 	GdkPixbuf *src = *tile;
 	GdkPixbuf *dest;
@@ -813,13 +875,13 @@ void rt_tile_mirror_and_flip(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y
 	guchar *dpi;
 	gint i;
 	gint j;
-	gint tw = rt->tile_width;
-	gint th = rt->tile_height;
+	gint tw = tile_width;
+	gint th = tile_height;
 
 	srs = gdk_pixbuf_get_rowstride(src);
 	s_pix = gdk_pixbuf_get_pixels(src);
 
-	dest = rt_get_spare_tile(rt);
+	dest = rt_spare_tile_get(spare, tile_width, tile_height);
 	drs = gdk_pixbuf_get_rowstride(dest);
 	d_pix = gdk_pixbuf_get_pixels(dest);
 	dpi = d_pix + ((th - 1) * drs) + ((tw - 1) * COLOR_BYTES);
@@ -836,11 +898,11 @@ void rt_tile_mirror_and_flip(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y
 			}
 		}
 
-	rt->spare_tile = src;
+	*spare = src;
 	*tile = dest;
 }
 
-void rt_tile_flip_only(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
+void rt_tile_flip_only(gint tile_width, gint tile_height, GdkPixbuf **spare, GdkPixbuf **tile, gint x, gint y, gint w, gint h)
 {
 	GdkPixbuf *src = *tile;
 	GdkPixbuf *dest;
@@ -853,13 +915,13 @@ void rt_tile_flip_only(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint
 	guchar *spi;
 	guchar *dpi;
 	gint i;
-	gint th = rt->tile_height;
+	gint th = tile_height;
 
 	srs = gdk_pixbuf_get_rowstride(src);
 	s_pix = gdk_pixbuf_get_pixels(src);
 	spi = s_pix + (x * COLOR_BYTES);
 
-	dest = rt_get_spare_tile(rt);
+	dest = rt_spare_tile_get(spare, tile_width, tile_height);
 	drs = gdk_pixbuf_get_rowstride(dest);
 	d_pix = gdk_pixbuf_get_pixels(dest);
 	dpi = d_pix + ((th - 1) * drs) + (x * COLOR_BYTES);
@@ -871,11 +933,11 @@ void rt_tile_flip_only(RendererTiles *rt, GdkPixbuf **tile, gint x, gint y, gint
 		memcpy(dp, sp, w * COLOR_BYTES);
 		}
 
-	rt->spare_tile = src;
+	*spare = src;
 	*tile = dest;
 }
 
-void rt_tile_apply_orientation(RendererTiles *rt, gint orientation, GdkPixbuf **pixbuf, gint x, gint y, gint w, gint h)
+void rt_tile_apply_orientation(gint tile_width, gint tile_height, GdkPixbuf **spare, gint orientation, GdkPixbuf **pixbuf, gint x, gint y, gint w, gint h)
 {
 	switch (orientation)
 		{
@@ -885,43 +947,43 @@ void rt_tile_apply_orientation(RendererTiles *rt, gint orientation, GdkPixbuf **
 		case EXIF_ORIENTATION_TOP_RIGHT:
 			/* mirrored */
 			{
-				rt_tile_mirror_only(rt, pixbuf, x, y, w, h);
+				rt_tile_mirror_only(tile_width, tile_height, spare, pixbuf, x, y, w, h);
 			}
 			break;
 		case EXIF_ORIENTATION_BOTTOM_RIGHT:
 			/* upside down */
 			{
-				rt_tile_mirror_and_flip(rt, pixbuf, x, y, w, h);
+				rt_tile_mirror_and_flip(tile_width, tile_height, spare, pixbuf, x, y, w, h);
 			}
 			break;
 		case EXIF_ORIENTATION_BOTTOM_LEFT:
 			/* flipped */
 			{
-				rt_tile_flip_only(rt, pixbuf, x, y, w, h);
+				rt_tile_flip_only(tile_width, tile_height, spare, pixbuf, x, y, w, h);
 			}
 			break;
 		case EXIF_ORIENTATION_LEFT_TOP:
 			{
-				rt_tile_flip_only(rt, pixbuf, x, y, w, h);
-				rt_tile_rotate_90_clockwise(rt, pixbuf, x, rt->tile_height - y - h, w, h);
+				rt_tile_flip_only(tile_width, tile_height, spare, pixbuf, x, y, w, h);
+				rt_tile_rotate_90_clockwise(tile_width, tile_height, spare, pixbuf, x, tile_height - y - h, w, h);
 			}
 			break;
 		case EXIF_ORIENTATION_RIGHT_TOP:
 			/* rotated -90 (270) */
 			{
-				rt_tile_rotate_90_clockwise(rt, pixbuf, x, y, w, h);
+				rt_tile_rotate_90_clockwise(tile_width, tile_height, spare, pixbuf, x, y, w, h);
 			}
 			break;
 		case EXIF_ORIENTATION_RIGHT_BOTTOM:
 			{
-				rt_tile_flip_only(rt, pixbuf, x, y, w, h);
-				rt_tile_rotate_90_counter_clockwise(rt, pixbuf, x, rt->tile_height - y - h, w, h);
+				rt_tile_flip_only(tile_width, tile_height, spare, pixbuf, x, y, w, h);
+				rt_tile_rotate_90_counter_clockwise(tile_width, tile_height, spare, pixbuf, x, tile_height - y - h, w, h);
 			}
 			break;
 		case EXIF_ORIENTATION_LEFT_BOTTOM:
 			/* rotated 90 */
 			{
-				rt_tile_rotate_90_counter_clockwise(rt, pixbuf, x, y, w, h);
+				rt_tile_rotate_90_counter_clockwise(tile_width, tile_height, spare, pixbuf, x, y, w, h);
 			}
 			break;
 		default:
@@ -1196,15 +1258,87 @@ gint rt_get_orientation(RendererTiles *rt)
 }
 
 
+/**
+ * @brief Collects what rendering a region of a tile from pr->pixbuf needs
+ * @retval FALSE There is no image to render from
+ */
+gboolean rt_tile_render_params(RendererTiles *rt, ImageTile *it,
+                               gint x, gint y, gint w, gint h,
+                               gboolean fast, TileRenderParams &params)
+{
+	PixbufRenderer *pr = rt->pr;
+
+	if (!pr->pixbuf || pr->image_width == 0 || pr->image_height == 0) return FALSE;
+
+	params.orientation = rt_get_orientation(rt);
+	params.scale_x = static_cast<gdouble>(pr->width) / pr->image_width;
+	params.scale_y = static_cast<gdouble>(pr->height) / pr->image_height;
+
+	pr_tile_coords_map_orientation(params.orientation, it->x, it->y,
+	                               pr->width, pr->height,
+	                               rt->tile_width, rt->tile_height,
+	                               params.src_x, params.src_y);
+	params.pb_rect = pr_tile_region_map_orientation(params.orientation,
+	                                                {x, y, w, h},
+	                                                rt->tile_width,
+	                                                rt->tile_height);
+
+	switch (params.orientation)
+		{
+		case EXIF_ORIENTATION_LEFT_TOP:
+		case EXIF_ORIENTATION_RIGHT_TOP:
+		case EXIF_ORIENTATION_RIGHT_BOTTOM:
+		case EXIF_ORIENTATION_LEFT_BOTTOM:
+			std::swap(params.scale_x, params.scale_y);
+			break;
+		default:
+			/* nothing to do */
+			break;
+		}
+
+	/* HACK: The pixbuf scalers get kinda buggy(crash) with extremely
+	 * small sizes for anything but GDK_INTERP_NEAREST
+	 */
+	if (pr->width < PR_MIN_SCALE_SIZE || pr->height < PR_MIN_SCALE_SIZE) fast = TRUE;
+
+	/* zoomed out, render from a reduced copy of the image */
+	params.source = pr_mipmap_get(pr, std::max(params.scale_x, params.scale_y));
+	if (params.source != pr->pixbuf)
+		{
+		params.scale_x *= static_cast<gdouble>(gdk_pixbuf_get_width(pr->pixbuf)) / gdk_pixbuf_get_width(params.source);
+		params.scale_y *= static_cast<gdouble>(gdk_pixbuf_get_height(pr->pixbuf)) / gdk_pixbuf_get_height(params.source);
+		}
+
+	params.has_alpha = gdk_pixbuf_get_has_alpha(params.source);
+	params.ignore_alpha = pr->ignore_alpha;
+	params.wide_image = gdk_pixbuf_get_width(params.source) > 32767 ||
+	                    gdk_pixbuf_get_height(params.source) > 32767;
+	params.interp_type = fast ? GDK_INTERP_NEAREST : pr->zoom_quality;
+	params.check_x = it->x + params.pb_rect.x;
+	params.check_y = it->y + params.pb_rect.y;
+	params.tile_width = rt->tile_width;
+	params.tile_height = rt->tile_height;
+
+	return TRUE;
+}
+
+void rt_tile_render_region(const TileRenderParams &params, GdkPixbuf *dest, gint pixbuf_offset)
+{
+	rt_tile_get_region(params.has_alpha, params.ignore_alpha,
+	                   params.source, dest, params.pb_rect,
+	                   static_cast<gdouble>(0.0) - params.src_x - (pixbuf_offset * params.scale_x),
+	                   static_cast<gdouble>(0.0) - params.src_y,
+	                   params.scale_x, params.scale_y,
+	                   params.interp_type,
+	                   params.check_x, params.check_y, params.wide_image);
+}
+
 void rt_tile_render(RendererTiles *rt, ImageTile *it,
                     gint x, gint y, gint w, gint h,
                     gboolean new_data, gboolean fast)
 {
 	PixbufRenderer *pr = rt->pr;
-	gboolean has_alpha;
 	gboolean draw = FALSE;
-	gint orientation = rt_get_orientation(rt);
-	gboolean wide_image = FALSE;
 
 	if (it->render_todo == TileRender::NONE && it->surface && !new_data) return;
 
@@ -1227,7 +1361,6 @@ void rt_tile_render(RendererTiles *rt, ImageTile *it,
 	if (new_data) it->blank = FALSE;
 
 	rt_tile_prepare(rt, it);
-	has_alpha = (pr->pixbuf && gdk_pixbuf_get_has_alpha(pr->pixbuf));
 
 	/** @FIXME checker colors for alpha should be configurable,
 	 * also should be drawn for blank = TRUE
@@ -1249,67 +1382,21 @@ void rt_tile_render(RendererTiles *rt, ImageTile *it,
 		}
 	else
 		{
-		gdouble scale_x;
-		gdouble scale_y;
-		gdouble src_x;
-		gdouble src_y;
+		TileRenderParams params;
 
-		if (pr->image_width == 0 || pr->image_height == 0) return;
+		if (!rt_tile_render_params(rt, it, x, y, w, h, fast, params)) return;
 
-		scale_x = static_cast<gdouble>(pr->width) / pr->image_width;
-		scale_y = static_cast<gdouble>(pr->height) / pr->image_height;
-
-		pr_tile_coords_map_orientation(orientation, it->x, it->y,
-		                               pr->width, pr->height,
-		                               rt->tile_width, rt->tile_height,
-		                               src_x, src_y);
-		GdkRectangle pb_rect = pr_tile_region_map_orientation(orientation,
-		                                                      {x, y, w, h},
-		                                                      rt->tile_width,
-		                                                      rt->tile_height);
-
-		switch (orientation)
-			{
-			case EXIF_ORIENTATION_LEFT_TOP:
-			case EXIF_ORIENTATION_RIGHT_TOP:
-			case EXIF_ORIENTATION_RIGHT_BOTTOM:
-			case EXIF_ORIENTATION_LEFT_BOTTOM:
-				std::swap(scale_x, scale_y);
-				break;
-			default:
-				/* nothing to do */
-				break;
-			}
-
-		/* HACK: The pixbuf scalers get kinda buggy(crash) with extremely
-		 * small sizes for anything but GDK_INTERP_NEAREST
-		 */
-		if (pr->width < PR_MIN_SCALE_SIZE || pr->height < PR_MIN_SCALE_SIZE) fast = TRUE;
-		if (gdk_pixbuf_get_width(pr->pixbuf) > 32767 ||
-		    gdk_pixbuf_get_height(pr->pixbuf) > 32767) wide_image = TRUE;
-
-		rt_tile_get_region(has_alpha, pr->ignore_alpha,
-		                   pr->pixbuf, it->pixbuf, pb_rect,
-		                   static_cast<gdouble>(0.0) - src_x - (get_right_pixbuf_offset(rt) * scale_x),
-		                   static_cast<gdouble>(0.0) - src_y,
-		                   scale_x, scale_y,
-		                   (fast) ? GDK_INTERP_NEAREST : pr->zoom_quality,
-		                   it->x + pb_rect.x, it->y + pb_rect.y, wide_image);
+		rt_tile_render_region(params, it->pixbuf, get_right_pixbuf_offset(rt));
 		if (rt->stereo_mode & PR_STEREO_ANAGLYPH &&
 		    (pr->stereo_pixbuf_offset_right > 0 || pr->stereo_pixbuf_offset_left > 0))
 			{
 			GdkPixbuf *right_pb = rt_get_spare_tile(rt);
-			rt_tile_get_region(has_alpha, pr->ignore_alpha,
-			                   pr->pixbuf, right_pb, pb_rect,
-			                   static_cast<gdouble>(0.0) - src_x - (get_left_pixbuf_offset(rt) * scale_x),
-			                   static_cast<gdouble>(0.0) - src_y,
-			                   scale_x, scale_y,
-			                   (fast) ? GDK_INTERP_NEAREST : pr->zoom_quality,
-			                   it->x + pb_rect.x, it->y + pb_rect.y, wide_image);
-			pr_create_anaglyph(rt->stereo_mode, it->pixbuf, right_pb, pb_rect.x, pb_rect.y, pb_rect.width, pb_rect.height);
+			rt_tile_render_region(params, right_pb, get_left_pixbuf_offset(rt));
+			pr_create_anaglyph(rt->stereo_mode, it->pixbuf, right_pb, params.pb_rect.x, params.pb_rect.y, params.pb_rect.width, params.pb_rect.height);
 			/* do not care about freeing spare_tile, it will be reused */
 			}
-		rt_tile_apply_orientation(rt, orientation, &it->pixbuf, pb_rect.x, pb_rect.y, pb_rect.width, pb_rect.height);
+		rt_tile_apply_orientation(rt->tile_width, rt->tile_height, &rt->spare_tile, params.orientation, &it->pixbuf,
+		                          params.pb_rect.x, params.pb_rect.y, params.pb_rect.width, params.pb_rect.height);
 		draw = TRUE;
 		}
 
@@ -1328,14 +1415,10 @@ void rt_tile_render(RendererTiles *rt, ImageTile *it,
 }
 
 
-void rt_tile_expose(RendererTiles *rt, ImageTile *it,
-                    gint x, gint y, gint w, gint h,
-                    gboolean new_data, gboolean fast)
+gboolean rt_tile_clamp_to_visible(const RendererTiles *rt, const ImageTile *it, gint &x, gint &y, gint &w, gint &h)
 {
 	PixbufRenderer *pr = rt->pr;
-	cairo_t *cr;
 
-	/* clamp to visible */
 	if (it->x + x < rt->x_scroll)
 		{
 		w -= rt->x_scroll - it->x - x;
@@ -1345,7 +1428,7 @@ void rt_tile_expose(RendererTiles *rt, ImageTile *it,
 		{
 		w = rt->x_scroll + pr->vis_width - it->x - x;
 		}
-	if (w < 1) return;
+	if (w < 1) return FALSE;
 	if (it->y + y < rt->y_scroll)
 		{
 		h -= rt->y_scroll - it->y - y;
@@ -1355,9 +1438,13 @@ void rt_tile_expose(RendererTiles *rt, ImageTile *it,
 		{
 		h = rt->y_scroll + pr->vis_height - it->y - y;
 		}
-	if (h < 1) return;
+	return h >= 1;
+}
 
-	rt_tile_render(rt, it, x, y, w, h, new_data, fast);
+void rt_tile_composite(RendererTiles *rt, ImageTile *it, gint x, gint y, gint w, gint h)
+{
+	PixbufRenderer *pr = rt->pr;
+	cairo_t *cr;
 
 	cr = cairo_create(rt->surface);
 	cairo_set_source_surface(cr, it->surface, pr->x_offset + (it->x - rt->x_scroll) + rt->stereo_off_x, pr->y_offset + (it->y - rt->y_scroll) + rt->stereo_off_y);
@@ -1368,6 +1455,219 @@ void rt_tile_expose(RendererTiles *rt, ImageTile *it,
 	rt->draw_pending = TRUE;
 }
 
+void rt_tile_expose(RendererTiles *rt, ImageTile *it,
+                    gint x, gint y, gint w, gint h,
+                    gboolean new_data, gboolean fast)
+{
+	if (!rt_tile_clamp_to_visible(rt, it, x, y, w, h)) return;
+
+	rt_tile_render(rt, it, x, y, w, h, new_data, fast);
+
+	rt_tile_composite(rt, it, x, y, w, h);
+}
+
+/*
+ *-------------------------------------------------------------------
+ * threaded rendering
+ *-------------------------------------------------------------------
+ */
+
+/* Slow tile renders (high quality scaling, color management) of a loaded
+ * image run on a pool of worker threads. A job renders into its own
+ * pixbuf from a reference to pr->pixbuf, and hands the result back to the
+ * main thread, where it is only painted onto the tile and the window.
+ * Anything that makes rendered tiles invalid bumps render_generation, and
+ * results of older jobs are dropped.
+ */
+
+gboolean rt_queue_draw_done(RendererTiles *rt);
+
+TileRenderLink *rt_render_link_ref(RendererTiles *rt)
+{
+	if (!rt->render_link)
+		{
+		rt->render_link = g_new0(TileRenderLink, 1);
+		rt->render_link->rt = rt;
+		rt->render_link->ref = 1;
+		}
+
+	rt->render_link->ref++;
+	return rt->render_link;
+}
+
+void rt_render_link_unref(TileRenderLink *link)
+{
+	if (!link) return;
+
+	link->ref--;
+	if (link->ref == 0) g_free(link);
+}
+
+void rt_tile_job_free(TileRenderJob *job)
+{
+	rt_render_link_unref(job->link);
+	g_object_unref(job->params.source);
+	if (job->pixbuf) g_object_unref(job->pixbuf);
+	if (job->spare) g_object_unref(job->spare);
+	delete job;
+}
+
+gboolean rt_tile_job_done_cb(gpointer data)
+{
+	auto *job = static_cast<TileRenderJob *>(data);
+	RendererTiles *rt = job->link->rt;
+
+	if (rt)
+		{
+		rt->render_jobs--;
+		rt->render_batch_worker_time += job->render_time;
+
+		/* a tile that was dropped and created again waits for its own render */
+		ImageTile *it = (job->generation == rt->render_generation) ? rt_tile_get(rt, job->tile_x, job->tile_y, TRUE) : nullptr;
+		if (it && it->surface && it->render_done == TileRender::ALL)
+			{
+			cairo_t *cr = cairo_create(it->surface);
+			cairo_rectangle(cr, job->area.x, job->area.y, job->area.width, job->area.height);
+			gdk_cairo_set_source_pixbuf(cr, job->pixbuf, 0, 0);
+			cairo_fill(cr);
+			cairo_destroy(cr);
+
+			rt->render_batch_tiles++;
+
+			gint x = job->area.x;
+			gint y = job->area.y;
+			gint w = job->area.width;
+			gint h = job->area.height;
+			if (rt->surface && rt_tile_clamp_to_visible(rt, it, x, y, w, h))
+				{
+				rt_tile_composite(rt, it, x, y, w, h);
+				}
+			}
+
+		if (rt->render_jobs > 0 || rt->draw_idle_id)
+			{
+			rt_present_pending(rt);
+			}
+		else
+			{
+			rt_queue_draw_done(rt);
+			}
+		}
+
+	rt_tile_job_free(job);
+
+	return G_SOURCE_REMOVE;
+}
+
+void rt_tile_job_run(gpointer data, gpointer)
+{
+	auto *job = static_cast<TileRenderJob *>(data);
+	const TileRenderParams &params = job->params;
+	const gint64 start = g_get_monotonic_time();
+
+	rt_tile_render_region(params, job->pixbuf, job->pixbuf_offset);
+	rt_tile_apply_orientation(params.tile_width, params.tile_height, &job->spare, params.orientation, &job->pixbuf,
+	                          params.pb_rect.x, params.pb_rect.y, params.pb_rect.width, params.pb_rect.height);
+
+	if (job->post_process)
+		{
+		job->post_process(job->pr, &job->pixbuf, job->area.x, job->area.y, job->area.width, job->area.height);
+		}
+
+	job->render_time = g_get_monotonic_time() - start;
+
+	g_idle_add_full(GDK_PRIORITY_REDRAW, rt_tile_job_done_cb, job, nullptr);
+}
+
+GThreadPool *rt_tile_render_pool()
+{
+	static GThreadPool *pool = nullptr;
+
+	const gint threads = options->threads.tile_render > 0 ? options->threads.tile_render : static_cast<gint>(g_get_num_processors());
+
+	if (!pool)
+		{
+		pool = g_thread_pool_new(rt_tile_job_run, nullptr, threads, FALSE, nullptr);
+		}
+	else if (g_thread_pool_get_max_threads(pool) != threads)
+		{
+		g_thread_pool_set_max_threads(pool, threads, nullptr);
+		}
+
+	return pool;
+}
+
+/**
+ * @brief Renders a visible region of a tile on a worker thread, if that is worth it
+ * @retval TRUE The region is composited when the worker is done
+ * @retval FALSE The caller renders the region with rt_tile_expose()
+ */
+gboolean rt_tile_render_async(RendererTiles *rt, ImageTile *it,
+                              gint x, gint y, gint w, gint h,
+                              gboolean new_data)
+{
+	PixbufRenderer *pr = rt->pr;
+
+	/* partially loaded pixbufs change under the worker, and the rest is cheap */
+	if (pr->loading || pr->source_tiles_enabled || !pr->pixbuf ||
+	    (rt->stereo_mode & PR_STEREO_ANAGLYPH) ||
+	    (it->blank && !new_data)) return FALSE;
+	if ((pr->zoom_quality == GDK_INTERP_NEAREST || pr->scale == 1.0) && !pr->func_post_process) return FALSE;
+	if (pr->width < PR_MIN_SCALE_SIZE || pr->height < PR_MIN_SCALE_SIZE) return FALSE;
+
+	if (it->render_todo == TileRender::NONE && it->surface && !new_data) return FALSE;
+
+	if (it->render_done != TileRender::ALL)
+		{
+		/* until the worker is done, show a quick render instead of whatever was there */
+		rt_tile_expose(rt, it, x, y, w, h, new_data, TRUE);
+
+		x = 0;
+		y = 0;
+		w = it->w;
+		h = it->h;
+		it->render_done = TileRender::ALL;
+		}
+	else if (it->render_todo != TileRender::AREA)
+		{
+		return FALSE;
+		}
+	else if (!rt_tile_clamp_to_visible(rt, it, x, y, w, h))
+		{
+		return TRUE;
+		}
+
+	it->render_todo = TileRender::NONE;
+	if (new_data) it->blank = FALSE;
+
+	rt_tile_prepare(rt, it);
+
+	auto *job = new TileRenderJob();
+	if (!rt_tile_render_params(rt, it, x, y, w, h, FALSE, job->params))
+		{
+		delete job;
+		return FALSE;
+		}
+
+	g_object_ref(job->params.source);
+	job->link = rt_render_link_ref(rt);
+	job->generation = rt->render_generation;
+	job->tile_x = it->x;
+	job->tile_y = it->y;
+	job->area = {x, y, w, h};
+	job->pixbuf_offset = get_right_pixbuf_offset(rt);
+	job->pixbuf = gdk_pixbuf_new(GDK_COLORSPACE_RGB, FALSE, 8, rt->tile_width, rt->tile_height);
+	job->post_process = pr->func_post_process;
+	job->pr = pr;
+
+	if (rt->render_jobs == 0 && rt->render_batch_tiles == 0) rt->render_batch_start = g_get_monotonic_time();
+	rt->render_jobs++;
+
+	g_thread_pool_push(rt_tile_render_pool(), job, nullptr);
+
+	return TRUE;
+}
+
 
 gboolean rt_tile_is_visible(RendererTiles *rt, ImageTile *it)
 {
@@ -1458,6 +1758,32 @@ void queue_data_merge(QueueData *parent, const QueueData *qd)
 	parent->new_data |= qd->new_data;
 }
 
+/**
+ * @brief Ends a render batch, the completion is signalled once the workers are done too
+ */
+gboolean rt_queue_draw_done(RendererTiles *rt)
+{
+	rt_present_pending(rt);
+	rt->draw_idle_id = 0;
+
+	if (rt->render_jobs > 0) return G_SOURCE_REMOVE;
+
+	if (rt->render_batch_tiles > 0)
+		{
+		const gint64 elapsed = g_get_monotonic_time() - rt->render_batch_start;
+		DEBUG_1("tile render: %d tiles in %.1f ms (%.0f tiles/s), %.1f ms in workers",
+		        rt->render_batch_tiles, elapsed / 1000.0,
+		        elapsed > 0 ? rt->render_batch_tiles * 1000000.0 / elapsed : 0.0,
+		        rt->render_batch_worker_time / 1000.0);
+		}
+	rt->render_batch_tiles = 0;
+	rt->render_batch_worker_time = 0;
+
+	pr_render_complete_signal(rt->pr);
+
+	return G_SOURCE_REMOVE;
+}
+
 gboolean rt_queue_draw_idle_cb(gpointer data)
 {
 	auto rt = static_cast<RendererTiles *>(data);
@@ -1470,11 +1796,7 @@ gboolean rt_queue_draw_idle_cb(gpointer data)
 	    (g_queue_is_empty(&rt->draw_queue) && g_queue_is_empty(&rt->draw_queue_2pass)) ||
 	    !rt->draw_idle_id)
 		{
-		rt_present_pending(rt);
-		pr_render_complete_signal(pr);
-
-		rt->draw_idle_id = 0;
-		return G_SOURCE_REMOVE;
+		return rt_queue_draw_done(rt);
 		}
 
 	if (first_pass)
@@ -1500,7 +1822,10 @@ gboolean rt_queue_draw_idle_cb(gpointer data)
 		{
 		if (rt_tile_is_visible(rt, qd->it))
 			{
-			rt_tile_expose(rt, qd->it, qd->x, qd->y, qd->w, qd->h, qd->new_data, fast);
+			if (fast || !rt_tile_render_async(rt, qd->it, qd->x, qd->y, qd->w, qd->h, qd->new_data))
+				{
+				rt_tile_expose(rt, qd->it, qd->x, qd->y, qd->w, qd->h, qd->new_data, fast);
+				}
 			}
 		else if (qd->new_data)
 			{
@@ -1545,11 +1870,7 @@ gboolean rt_queue_draw_idle_cb(gpointer data)
 	if (g_queue_is_empty(&rt->draw_queue) && g_queue_is_empty(&rt->draw_queue_2pass))
 		{
 		/* Present all tiles updated by this render batch in one frame. */
-		rt_present_pending(rt);
-		pr_render_complete_signal(pr);
-
-		rt->draw_idle_id = 0;
-		return G_SOURCE_REMOVE;
+		return rt_queue_draw_done(rt);
 		}
 
 	return rt_queue_schedule_next_draw(rt, FALSE);
@@ -1826,6 +2147,8 @@ void renderer_invalidate_region(void *renderer, GdkRectangle region)
 	const gint y1 = ROUND_DOWN(region.y, rt->tile_height);
 	const gint y2 = ROUND_UP(region.y + region.height, rt->tile_height);
 
+	rt->render_generation++;
+
 	for (GList *work = rt->tiles; work; work = work->next)
 		{
 		auto *it = static_cast<ImageTile *>(work->data);
@@ -1888,6 +2211,12 @@ void renderer_free(void *renderer)
 	auto rt = static_cast<RendererTiles *>(renderer);
 	rt_queue_clear(rt);
 	rt_tile_free_all(rt);
+	if (rt->render_link)
+		{
+		/* jobs still running find the renderer gone */
+		rt->render_link->rt = nullptr;
+		rt_render_link_unref(rt->render_link);
+		}
 	if (rt->spare_tile) g_object_unref(rt->spare_tile);
 	g_list_free_full(rt->overlay_list, reinterpret_cast<GDestroyNotify>(overlay_data_free));
 	g_clear_pointer(&rt->overlay_buffer, cairo_surface_destroy);
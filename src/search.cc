@@ -27,6 +27,11 @@
 #include <cstdio>
 #include <cstring>
 #include <ctime>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include <config.h>
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <gdk/gdk.h>
@@ -37,6 +42,8 @@
 #include "accelerators.h"
 #include "actions.h"
 #include "bar-keywords.h"
+#include "cache-meta-db.h"
+#include "cache-sim-db.h"
 #include "cache.h"
 #include "cellrenderericon.h"
 #include "collect.h"
@@ -44,8 +51,12 @@
 #include "dnd.h"
 #include "editors.h"
 #include "filedata.h"
+#if HAVE_LUA
+#  include "glua.h"
+#endif
 #include "history-list.h"
 #include "image-load.h"
+#include "image-probe.h"
 #include "img-view.h"
 #include "intl.h"
 #include "layout-util.h"
@@ -148,6 +159,11 @@ struct SearchUi
 	GtkWidget *entry_exif_tag;
 	GtkWidget *entry_exif_value;
 
+	// "Lua" row
+	GtkWidget *menu_lua;
+	GtkWidget *entry_lua_script;
+	GtkWidget *entry_lua_value;
+
 	// "Image rating" row
 	GtkWidget *menu_rating;
 	GtkWidget *spin_rating;
@@ -263,6 +279,10 @@ struct SearchData
 	gchar *search_exif_tag;
 	gchar *search_exif_value;
 	gboolean search_exif_match_case;
+	gchar *search_lua_script;
+	gchar *search_lua_value;
+	GRegex *search_lua_regex;
+	gboolean search_lua_match_case;
 	gint   search_rating;
 	gint   search_rating_end;
 	gboolean   search_comment_match_case;
@@ -282,6 +302,7 @@ struct SearchData
 	MatchType match_keywords;
 	MatchType match_comment;
 	MatchType match_exif;
+	MatchType match_lua;
 	MatchType match_rating;
 	MatchType match_gps;
 	MatchType match_class;
@@ -295,6 +316,7 @@ struct SearchData
 	gboolean match_keywords_enable;
 	gboolean match_comment_enable;
 	gboolean match_exif_enable;
+	gboolean match_lua_enable;
 	gboolean match_rating_enable;
 	gboolean match_gps_enable;
 	gboolean match_class_enable;
@@ -313,8 +335,8 @@ struct SearchData
 	guint search_idle_id; /* event source id */
 	guint update_idle_id; /* event source id */
 
-	ImageLoader *img_loader;
-	std::unique_ptr<CacheData> img_cd;
+	ImageLoader *img_loader; /**< of the similarity reference image */
+	GList *search_extra_jobs; /**< SearchExtraJob of files being checked by the workers */
 
 	FileData *click_fd;
 
@@ -377,6 +399,7 @@ constexpr std::array<MatchList, 2> text_search_menu_comment{{
 }};
 
 constexpr auto &text_search_menu_exif = text_search_menu_comment;
+constexpr auto &text_search_menu_lua = text_search_menu_comment;
 
 constexpr auto &text_search_menu_rating = text_search_menu_size;
 
@@ -508,7 +531,7 @@ static void search_progress_update(SearchData *sd, gboolean search, gdouble thum
 		{
 		const gchar *message;
 
-		if (search && (sd->search_folder_list || sd->search_file_list))
+		if (search && (sd->search_folder_list || sd->search_file_list || sd->search_extra_jobs))
 			message = _("Searching…");
 		else if (thumbs >= 0.0)
 			message = _("Loading thumbs…");
@@ -1020,7 +1043,7 @@ static void search_result_thumb_enable(SearchData *sd, gboolean enable)
 	sd->thumb_enable = enable;
 
 	search_result_thumb_height(sd);
-	if (!sd->search_folder_list && !sd->search_file_list) search_result_thumb_step(sd);
+	if (!sd->search_folder_list && !sd->search_file_list && !sd->search_extra_jobs) search_result_thumb_step(sd);
 }
 
 /*
@@ -1580,13 +1603,82 @@ static void search_buffer_flush(SearchData *sd)
 	sd->search_buffer_count = 0;
 }
 
+/**
+ * @brief A file whose dimensions or similarity are checked off the main loop
+ *
+ * A worker of the pool reads the cache data, and probes the file headers
+ * for the dimensions. When the image has to be decoded, an image loader
+ * is started from the main loop. The match itself is evaluated on the
+ * main loop once the data is complete, like all other match types.
+ */
+struct SearchExtraJob
+{
+	SearchData *sd;                /**< nullptr once the search stopped, the job is then only freed */
+	FileData *fd;                  /**< ref held by the job, the worker reads only this */
+	std::unique_ptr<CacheData> cd;
+	ImageLoader *il;
+	gboolean probe;                /**< try the file headers for the dimensions */
+	gboolean probed;               /**< dimensions found in the file headers */
+	gboolean load_cache;           /**< the image is checked, not only the Lua value */
+	gchar *lua_script;             /**< run by the worker, nullptr if not searched for */
+#if HAVE_LUA
+	std::unique_ptr<LuaImageInfo> lua_image; /**< what the script reads of fd, copied when queued */
+#endif
+	gchar *lua_value;
+	gint cancel;                   /**< set to skip the job, atomic */
+};
+
+static GThreadPool *search_extra_pool = nullptr;
+
+static gboolean search_lua_enabled(const SearchData *sd)
+{
+	return sd->match_lua_enable && sd->search_lua_script && sd->search_lua_script[0] != '\0';
+}
+
+static gint search_extra_threads()
+{
+	return options->threads.search > 0 ? options->threads.search : get_cpu_cores();
+}
+
+static void search_extra_job_free(SearchExtraJob *job)
+{
+	image_loader_free(job->il);
+	file_data_unref(job->fd);
+	g_free(job->lua_script);
+	g_free(job->lua_value);
+	delete job;
+}
+
+/**
+ * @brief Detaches the jobs from the search
+ *
+ * Jobs still owned by the pool are freed once they come back to the main
+ * loop, jobs decoding an image are freed here with their loader.
+ */
+static void search_extra_cancel(SearchData *sd)
+{
+	for (GList *work = sd->search_extra_jobs; work; work = work->next)
+		{
+		auto job = static_cast<SearchExtraJob *>(work->data);
+
+		job->sd = nullptr;
+		g_atomic_int_set(&job->cancel, TRUE);
+
+		if (job->il) search_extra_job_free(job);
+		}
+
+	g_list_free(sd->search_extra_jobs);
+	sd->search_extra_jobs = nullptr;
+}
+
 static void search_stop(SearchData *sd)
 {
 	g_clear_handle_id(&sd->search_idle_id, g_source_remove);
 
 	image_loader_free(sd->img_loader);
 	sd->img_loader = nullptr;
-	sd->img_cd.reset();
+
+	search_extra_cancel(sd);
 
 	sd->search_similarity_cd.reset();
 
@@ -1611,11 +1703,11 @@ static void search_stop(SearchData *sd)
 	search_status_update(sd);
 }
 
-static void search_file_load_process(SearchData *sd, CacheData *cd)
+static void search_file_load_process(SearchData *sd, ImageLoader *il, CacheData *cd)
 {
 	GdkPixbuf *pixbuf;
 
-	pixbuf = image_loader_get_pixbuf(sd->img_loader);
+	pixbuf = image_loader_get_pixbuf(il);
 
 	/* Used to determine if image is broken
 	 */
@@ -1642,55 +1734,33 @@ static void search_file_load_process(SearchData *sd, CacheData *cd)
 			}
 
 		if (options->thumbnails.enable_caching &&
-		    sd->img_loader && image_loader_get_fd(sd->img_loader))
+		    il && image_loader_get_fd(il))
 			{
-			const FileData *fd = image_loader_get_fd(sd->img_loader);
+			const FileData *fd = image_loader_get_fd(il);
 
 			cd->save(fd->path);
 			}
 		}
-
-	image_loader_free(sd->img_loader);
-	sd->img_loader = nullptr;
-
-	sd->search_idle_id = g_idle_add(search_step_cb, sd);
 }
 
-static void search_file_load_done_cb(ImageLoader *, gpointer data)
-{
-	auto sd = static_cast<SearchData *>(data);
-	search_file_load_process(sd, sd->img_cd.get());
-}
-
-static gboolean search_file_do_extra(SearchData *sd, MatchFileData &mfd, gboolean &match)
+static gboolean search_file_extra_match(SearchData *sd, const CacheData &cd, const gchar *lua_value, MatchFileData &mfd)
 {
 	gboolean tmatch = TRUE;
 	gboolean tested = FALSE;
 
-	if (!sd->img_cd)
+	if (sd->match_lua_enable && lua_value)
 		{
-		sd->img_cd = std::make_unique<CacheData>(mfd.fd->path);
+		tested = TRUE;
 
-		if ((sd->match_dimensions_enable && !sd->img_cd->dimensions) ||
-		    (sd->match_similarity_enable && !sd->img_cd->similarity) ||
-		    sd->match_broken_enable)
-			{
-			sd->img_loader = image_loader_new(mfd.fd);
-			g_signal_connect(G_OBJECT(sd->img_loader), "error", (GCallback)search_file_load_done_cb, sd);
-			g_signal_connect(G_OBJECT(sd->img_loader), "done", (GCallback)search_file_load_done_cb, sd);
-			if (image_loader_start(sd->img_loader))
-				{
-				return TRUE;
-				}
+		g_autofree gchar *haystack = sd->search_lua_match_case ? g_strdup(lua_value) : g_utf8_strdown(lua_value, -1);
+		const gboolean found = g_regex_match(sd->search_lua_regex, haystack, static_cast<GRegexMatchFlags>(0), nullptr);
 
-			image_loader_free(sd->img_loader);
-			sd->img_loader = nullptr;
-			}
+		tmatch = (sd->match_lua == SEARCH_MATCH_CONTAINS) ? found : !found;
 		}
 
-	const auto &dimensions = sd->img_cd->dimensions; // prevent clang-tidy bugprone-unchecked-optional-access
+	const auto &dimensions = cd.dimensions; // prevent clang-tidy bugprone-unchecked-optional-access
 
-	if (sd->match_broken_enable && dimensions)
+	if (tmatch && sd->match_broken_enable && dimensions)
 		{
 		tested = TRUE;
 		tmatch = FALSE;
@@ -1728,7 +1798,7 @@ static gboolean search_file_do_extra(SearchData *sd, MatchFileData &mfd, gboolea
 			}
 		}
 
-	if (tmatch && sd->match_similarity_enable && sd->img_cd->similarity)
+	if (tmatch && sd->match_similarity_enable && cd.similarity)
 		{
 		tmatch = FALSE;
 		tested = TRUE;
@@ -1738,7 +1808,7 @@ static gboolean search_file_do_extra(SearchData *sd, MatchFileData &mfd, gboolea
 			{
 			gdouble result;
 
-			result = image_sim_compare_fast(sd->search_similarity_cd->similarity.get(), sd->img_cd->similarity.get(),
+			result = image_sim_compare_fast(sd->search_similarity_cd->similarity.get(), cd.similarity.get(),
 			                                static_cast<gdouble>(sd->search_similarity) / 100.0);
 			result *= 100.0;
 			if (result >= static_cast<gdouble>(sd->search_similarity))
@@ -1754,32 +1824,165 @@ static gboolean search_file_do_extra(SearchData *sd, MatchFileData &mfd, gboolea
 		mfd.dimensions = dimensions.value();
 		}
 
-	sd->img_cd.reset();
+	return (tmatch && tested);
+}
+
+static void search_file_add(SearchData *sd, const MatchFileData &mfd, gboolean match)
+{
+	if (match)
+		{
+		auto new_mfd = g_new(MatchFileData, 1);
+		*new_mfd = mfd;
+
+		sd->search_buffer_list = g_list_prepend(sd->search_buffer_list, new_mfd);
+		sd->search_buffer_count += SEARCH_BUFFER_MATCH_HIT;
+		sd->search_count++;
+		search_progress_update(sd, TRUE, -1.0);
+		}
+	else
+		{
+		file_data_unref(mfd.fd);
+		sd->search_buffer_count += SEARCH_BUFFER_MATCH_MISS;
+		}
+}
+
+/**
+ * @brief Evaluates the match of a job and frees it, then resumes the search
+ *
+ * The step callback pauses while all workers are busy, and at the end of
+ * the file lists until the last job is done.
+ */
+static void search_extra_job_done(SearchExtraJob *job)
+{
+	SearchData *sd = job->sd;
+
+	if (job->probed && options->thumbnails.enable_caching) job->cd->save(job->fd->path);
 
-	match = (tmatch && tested);
+	MatchFileData mfd{ file_data_ref(job->fd), {0, 0}, 0 };
+	search_file_add(sd, mfd, search_file_extra_match(sd, *job->cd, job->lua_value, mfd));
 
-	return FALSE;
+	sd->search_extra_jobs = g_list_remove(sd->search_extra_jobs, job);
+	search_extra_job_free(job);
+
+	if (!sd->search_idle_id) sd->search_idle_id = g_idle_add(search_step_cb, sd);
 }
 
-static gboolean search_file_next(SearchData *sd)
+static void search_extra_load_done_cb(ImageLoader *, gpointer data)
 {
-	FileData *fd;
-	gboolean match = TRUE;
-	gboolean tested = FALSE;
-	gboolean extra_only = FALSE;
+	auto job = static_cast<SearchExtraJob *>(data);
 
-	if (!sd->search_file_list) return FALSE;
+	search_file_load_process(job->sd, job->il, job->cd.get());
+	search_extra_job_done(job);
+}
 
-	if (sd->img_cd)
+static gboolean search_extra_read_done_cb(gpointer data)
+{
+	auto job = static_cast<SearchExtraJob *>(data);
+	SearchData *sd = job->sd;
+
+	if (!sd)
 		{
-		/* on end of a CacheData load, skip recomparing non-extra match types */
-		extra_only = TRUE;
-		match = FALSE;
+		search_extra_job_free(job);
+		return G_SOURCE_REMOVE;
+		}
+
+	if ((sd->match_dimensions_enable && !job->cd->dimensions) ||
+	    (sd->match_similarity_enable && !job->cd->similarity) ||
+	    sd->match_broken_enable)
+		{
+		job->il = image_loader_new(job->fd);
+		g_signal_connect(G_OBJECT(job->il), "error", (GCallback)search_extra_load_done_cb, job);
+		g_signal_connect(G_OBJECT(job->il), "done", (GCallback)search_extra_load_done_cb, job);
+		if (image_loader_start(job->il))
+			{
+			return G_SOURCE_REMOVE;
+			}
+
+		image_loader_free(job->il);
+		job->il = nullptr;
+		}
+
+	search_extra_job_done(job);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void search_extra_read(gpointer data, gpointer)
+{
+	auto job = static_cast<SearchExtraJob *>(data);
+
+	if (!g_atomic_int_get(&job->cancel))
+		{
+		job->cd = std::make_unique<CacheData>(job->load_cache ? job->fd->path : nullptr);
+
+		if (job->probe && !job->cd->dimensions)
+			{
+			if (GqSize dimensions; image_probe_dimensions(job->fd->path, dimensions))
+				{
+				job->cd->set_dimensions(dimensions);
+				job->probed = TRUE;
+				}
+			}
+
+#if HAVE_LUA
+		if (job->lua_script) job->lua_value = lua_callvalue_thread(*job->lua_image, job->lua_script);
+#endif
+		}
+
+	g_idle_add(search_extra_read_done_cb, job);
+}
+
+/**
+ * @brief Hands a file over to the workers, the reference to fd is taken over
+ * @returns TRUE when all workers are busy, and the search should wait for one
+ */
+static gboolean search_extra_queue(SearchData *sd, FileData *fd)
+{
+	const gint threads = search_extra_threads();
+
+	if (!search_extra_pool)
+		{
+		search_extra_pool = g_thread_pool_new(search_extra_read, nullptr, threads, FALSE, nullptr);
 		}
 	else
 		{
-		sd->search_total++;
+		g_thread_pool_set_max_threads(search_extra_pool, threads, nullptr);
+		}
+
+	/* the workers may read the similarity database, open it here */
+	if (!sd->search_extra_jobs) cache_sim_db_get();
+
+	auto job = new SearchExtraJob{};
+	job->sd = sd;
+	job->fd = fd;
+	/* the file headers are enough, unless the image is decoded anyway */
+	job->probe = sd->match_dimensions_enable && !sd->match_similarity_enable && !sd->match_broken_enable;
+	job->load_cache = sd->match_dimensions_enable || sd->match_similarity_enable || sd->match_broken_enable;
+#if HAVE_LUA
+	if (search_lua_enabled(sd))
+		{
+		job->lua_script = g_strdup(sd->search_lua_script);
+		job->lua_image = std::make_unique<LuaImageInfo>(fd);
 		}
+#endif
+
+	sd->search_extra_jobs = g_list_prepend(sd->search_extra_jobs, job);
+	sd->search_buffer_count += SEARCH_BUFFER_MATCH_LOAD;
+
+	g_thread_pool_push(search_extra_pool, job, nullptr);
+
+	return static_cast<gint>(g_list_length(sd->search_extra_jobs)) >= threads;
+}
+
+static gboolean search_file_next(SearchData *sd)
+{
+	FileData *fd;
+	gboolean match = TRUE;
+	gboolean tested = FALSE;
+
+	if (!sd->search_file_list) return FALSE;
+
+	sd->search_total++;
 
 	fd = static_cast<FileData *>(sd->search_file_list->data);
 
@@ -1882,14 +2085,30 @@ static gboolean search_file_next(SearchData *sd)
 			}
 		}
 
+	std::optional<CacheMetaEntry> meta;
+	if (match && (sd->match_keywords_enable || sd->match_comment_enable || sd->match_rating_enable || sd->match_gps_enable))
+		{
+		if (CacheMetaEntry entry; metadata_index_read(fd, entry)) meta = std::move(entry);
+		}
+
 	if (match && sd->match_keywords_enable && sd->search_keyword_list)
 		{
-		GList *list;
+		GList *list = nullptr;
 
 		tested = TRUE;
 		match = FALSE;
 
-		list = metadata_read_list(fd, KEYWORD_KEY, METADATA_PLAIN);
+		if (meta)
+			{
+			for (const std::string &keyword : meta->keywords)
+				{
+				list = g_list_prepend(list, g_strdup(keyword.c_str()));
+				}
+			}
+		else
+			{
+			list = metadata_read_list(fd, KEYWORD_KEY, METADATA_PLAIN);
+			}
 
 		if (list)
 			{
@@ -1947,7 +2166,15 @@ static gboolean search_file_next(SearchData *sd)
 		tested = TRUE;
 		match = FALSE;
 
-		g_autofree gchar *comment = metadata_read_string(fd, COMMENT_KEY, METADATA_PLAIN);
+		g_autofree gchar *comment = nullptr;
+		if (!meta)
+			{
+			comment = metadata_read_string(fd, COMMENT_KEY, METADATA_PLAIN);
+			}
+		else if (!meta->comment.empty())
+			{
+			comment = g_strdup(meta->comment.c_str());
+			}
 
 		if (comment)
 			{
@@ -2008,7 +2235,7 @@ static gboolean search_file_next(SearchData *sd)
 		match = FALSE;
 		gint rating;
 
-		rating = metadata_read_int(fd, RATING_KEY, 0);
+		rating = meta ? meta->rating : metadata_read_int(fd, RATING_KEY, 0);
 		if (sd->match_rating == SEARCH_MATCH_EQUAL)
 			{
 			match = (rating == sd->search_rating);
@@ -2074,8 +2301,18 @@ static gboolean search_file_next(SearchData *sd)
 		tested = TRUE;
 		match = FALSE;
 
-		const gdouble latitude = metadata_read_GPS_coord(fd, "Xmp.exif.GPSLatitude", 1000);
-		const gdouble longitude = metadata_read_GPS_coord(fd, "Xmp.exif.GPSLongitude", 1000);
+		gdouble latitude;
+		gdouble longitude;
+		if (meta)
+			{
+			latitude = meta->has_gps ? meta->latitude : 1000;
+			longitude = meta->has_gps ? meta->longitude : 1000;
+			}
+		else
+			{
+			latitude = metadata_read_GPS_coord(fd, "Xmp.exif.GPSLatitude", 1000);
+			longitude = metadata_read_GPS_coord(fd, "Xmp.exif.GPSLongitude", 1000);
+			}
 		const bool image_has_gps = (latitude != 1000 && longitude != 1000);
 
 		if (sd->match_gps == SEARCH_MATCH_NONE)
@@ -2090,36 +2327,16 @@ static gboolean search_file_next(SearchData *sd)
 			}
 		}
 
-	MatchFileData mfd_extra{ fd, {0, 0}, 0 };
-	if ((match || extra_only) && (sd->match_dimensions_enable || sd->match_similarity_enable || sd->match_broken_enable))
-		{
-		tested = TRUE;
-
-		if (search_file_do_extra(sd, mfd_extra, match))
-			{
-			sd->search_buffer_count += SEARCH_BUFFER_MATCH_LOAD;
-			return TRUE;
-			}
-		}
-
 	sd->search_file_list = g_list_remove(sd->search_file_list, fd);
 
-	if (tested && match)
+	/* Lua scripts run on the workers too, they may be slow */
+	if (match && (sd->match_dimensions_enable || sd->match_similarity_enable || sd->match_broken_enable || search_lua_enabled(sd)))
 		{
-		auto mfd = g_new(MatchFileData, 1);
-		*mfd = mfd_extra;
-
-		sd->search_buffer_list = g_list_prepend(sd->search_buffer_list, mfd);
-		sd->search_buffer_count += SEARCH_BUFFER_MATCH_HIT;
-		sd->search_count++;
-		search_progress_update(sd, TRUE, -1.0);
-		}
-	else
-		{
-		file_data_unref(fd);
-		sd->search_buffer_count += SEARCH_BUFFER_MATCH_MISS;
+		return search_extra_queue(sd, fd);
 		}
 
+	search_file_add(sd, { fd, {0, 0}, 0 }, tested && match);
+
 	return FALSE;
 }
 
@@ -2148,6 +2365,9 @@ static gboolean search_step_cb(gpointer data)
 		{
 		sd->search_idle_id = 0;
 
+		/* resumed by the last job */
+		if (sd->search_extra_jobs) return G_SOURCE_REMOVE;
+
 		search_stop(sd);
 		search_result_thumb_step(sd);
 
@@ -2235,7 +2455,12 @@ static gboolean search_step_cb(gpointer data)
 static void search_similarity_load_done_cb(ImageLoader *, gpointer data)
 {
 	auto sd = static_cast<SearchData *>(data);
-	search_file_load_process(sd, sd->search_similarity_cd.get());
+	search_file_load_process(sd, sd->img_loader, sd->search_similarity_cd.get());
+
+	image_loader_free(sd->img_loader);
+	sd->img_loader = nullptr;
+
+	sd->search_idle_id = g_idle_add(search_step_cb, sd);
 }
 
 static GRegex *create_search_regex(const gchar *pattern)
@@ -2303,6 +2528,23 @@ static void search_start(SearchData *sd)
 		}
 	sd->search_exif_regex = create_search_regex(sd->search_exif_value);
 
+	if (sd->match_lua_enable)
+		{
+		if (!sd->search_lua_match_case)
+			{
+			/* convert to lowercase here, so that this is only done once per search */
+			gchar *tmp = g_utf8_strdown(sd->search_lua_value, -1);
+			g_free(sd->search_lua_value);
+			sd->search_lua_value = tmp;
+			}
+
+		if (sd->search_lua_regex)
+			{
+			g_regex_unref(sd->search_lua_regex);
+			}
+		sd->search_lua_regex = create_search_regex(sd->search_lua_value);
+		}
+
 	sd->search_count = 0;
 	sd->search_total = 0;
 
@@ -2337,7 +2579,7 @@ static void search_start(SearchData *sd)
 
 static void search_start_do(SearchData *sd)
 {
-	if (sd->search_folder_list)
+	if (sd->search_folder_list || sd->search_file_list || sd->search_extra_jobs)
 		{
 		search_stop(sd);
 		search_result_thumb_step(sd);
@@ -2374,6 +2616,19 @@ static void search_start_do(SearchData *sd)
 		sd->search_exif_value = g_strdup(gtk_editable_get_text(GTK_EDITABLE(sd->ui.entry_exif_value)));
 		}
 
+#if HAVE_LUA
+	if (sd->match_lua_enable)
+		{
+		menu_choice_get_match_type(sd->ui.menu_lua, sd->match_lua);
+
+		g_free(sd->search_lua_script);
+		sd->search_lua_script = g_strdup(gtk_editable_get_text(GTK_EDITABLE(sd->ui.entry_lua_script)));
+
+		g_free(sd->search_lua_value);
+		sd->search_lua_value = g_strdup(gtk_editable_get_text(GTK_EDITABLE(sd->ui.entry_lua_value)));
+		}
+#endif
+
 	g_free(sd->search_similarity_path);
 	sd->search_similarity_path = g_strdup(gtk_editable_get_text(GTK_EDITABLE(sd->ui.entry_similarity)));
 	if (sd->match_similarity_enable)
@@ -2922,6 +3177,12 @@ static void search_window_destroy_cb(GtkWidget *, gpointer data)
 		{
 		g_regex_unref(sd->search_comment_regex);
 		}
+	g_free(sd->search_lua_script);
+	g_free(sd->search_lua_value);
+	if(sd->search_lua_regex)
+		{
+		g_regex_unref(sd->search_lua_regex);
+		}
 	g_free(sd->search_similarity_path);
 	g_list_free_full(sd->search_keyword_list, g_free);
 
@@ -3002,6 +3263,7 @@ void search_new(FileData *dir_fd, FileData *example_file)
 	sd->match_keywords = SEARCH_MATCH_ALL;
 	sd->match_comment = SEARCH_MATCH_CONTAINS;
 	sd->match_exif = SEARCH_MATCH_CONTAINS;
+	sd->match_lua = SEARCH_MATCH_CONTAINS;
 	sd->match_rating = SEARCH_MATCH_EQUAL;
 	sd->match_class = SEARCH_MATCH_EQUAL;
 	sd->match_marks = SEARCH_MATCH_EQUAL;
@@ -3240,6 +3502,48 @@ void search_new(FileData *dir_fd, FileData *example_file)
 
 	pref_checkbox_new_int(hbox, _("Match case"), sd->search_exif_match_case, &sd->search_exif_match_case);
 
+#if HAVE_LUA
+	/* Search for the value of a Lua script */
+	GtkWidget *check_lua = nullptr;
+	hbox = menu_choice(sd->ui.box_search, _("Lua"), &sd->match_lua_enable,
+	                   &check_lua);
+	sd->ui.menu_lua = menu_choice_menu(hbox, text_search_menu_lua,
+	                                   nullptr, nullptr);
+
+	pref_label_new(hbox, _("Script"));
+
+	sd->ui.entry_lua_script = gtk_entry_new();
+	gtk_widget_set_hexpand(sd->ui.entry_lua_script, gtk_orientable_get_orientation(GTK_ORIENTABLE(GTK_BOX(hbox))) == GTK_ORIENTATION_HORIZONTAL ? TRUE : FALSE);
+	gtk_widget_set_vexpand(sd->ui.entry_lua_script, gtk_orientable_get_orientation(GTK_ORIENTABLE(GTK_BOX(hbox))) == GTK_ORIENTATION_VERTICAL ? TRUE : FALSE);
+	gtk_box_append(GTK_BOX(hbox), sd->ui.entry_lua_script);
+
+	search_entry_attach_focus_controller(sd->ui.entry_lua_script, sd);
+
+	gtk_widget_set_sensitive(sd->ui.entry_lua_script, sd->match_lua_enable);
+	g_signal_connect(G_OBJECT(check_lua), "toggled",
+	                 G_CALLBACK(menu_choice_check_cb), sd->ui.entry_lua_script);
+	gtk_widget_set_tooltip_text(sd->ui.entry_lua_script,
+	                            _("A script in the lua folder, run for each file on worker threads\n\nSee the Help file."));
+
+	pref_label_new(hbox, _("Value"));
+
+	sd->ui.entry_lua_value = gtk_entry_new();
+	gtk_widget_set_hexpand(sd->ui.entry_lua_value, gtk_orientable_get_orientation(GTK_ORIENTABLE(GTK_BOX(hbox))) == GTK_ORIENTATION_HORIZONTAL ? TRUE : FALSE);
+	gtk_widget_set_vexpand(sd->ui.entry_lua_value, gtk_orientable_get_orientation(GTK_ORIENTABLE(GTK_BOX(hbox))) == GTK_ORIENTATION_VERTICAL ? TRUE : FALSE);
+	gtk_box_append(GTK_BOX(hbox), sd->ui.entry_lua_value);
+
+	search_entry_attach_focus_controller(sd->ui.entry_lua_value, sd);
+
+	gtk_widget_set_sensitive(sd->ui.entry_lua_value, sd->match_lua_enable);
+	g_signal_connect(G_OBJECT(check_lua), "toggled",
+	                 G_CALLBACK(menu_choice_check_cb), sd->ui.entry_lua_value);
+
+	gtk_widget_set_tooltip_text(sd->ui.entry_lua_value,
+	                            _("This field uses Perl Compatible Regular Expressions.\ne.g. use \nabc.*ghk\n and not \nabc*ghk\n\nSee the Help file."));
+
+	pref_checkbox_new_int(hbox, _("Match case"), sd->search_lua_match_case, &sd->search_lua_match_case);
+#endif
+
 	/* Search for image rating */
 	hbox = menu_choice(sd->ui.box_search, _("Image rating is"), &sd->match_rating_enable);
 	sd->ui.menu_rating = menu_choice_menu(hbox, text_search_menu_rating,
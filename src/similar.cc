@@ -25,10 +25,26 @@
 #include <cmath>
 #include <cstdlib>
 #include <functional>
+#include <iterator>
+#include <map>
+#include <set>
 #include <vector>
 
 #include "options.h"
 
+#if defined(__x86_64__) || defined(__i386__)
+#  include <immintrin.h>
+#endif
+#if defined(__ARM_NEON)
+#  include <arm_neon.h>
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#  define GQ_SIM_HAVE_AVX2 1
+#else
+#  define GQ_SIM_HAVE_AVX2 0
+#endif
+
 /**
  * @file
  *
@@ -60,6 +76,118 @@ namespace
 
 using ImageSimilarityCheckAbort = std::function<bool(gdouble)>;
 
+constexpr gsize SIM_GRID_SIZE = std::tuple_size_v<ImageSimilarityData::Avg>;
+
+/**
+ * @brief A borrowed view of one signature
+ *
+ * Lets the compare functions work on both #ImageSimilarityData and
+ * rows of an #ImageSimilarityStore.
+ */
+struct ImageSimilarityView
+{
+	const guint8 *r;
+	const guint8 *g;
+	const guint8 *b;
+	bool filled;
+};
+
+ImageSimilarityView image_sim_view(const ImageSimilarityData *sd)
+{
+	if (!image_sim_filled(sd)) return {nullptr, nullptr, nullptr, false};
+
+	return {sd->avg_r.data(), sd->avg_g.data(), sd->avg_b.data(), true};
+}
+
+using ImageSimSadFunc = guint32 (*)(const guint8 *, const guint8 *, gsize);
+
+struct ImageSimSadImpl
+{
+	ImageSimSadFunc func;
+	const gchar *name;
+};
+
+#if defined(__SSE2__)
+guint32 image_sim_sad_sse2(const guint8 *a, const guint8 *b, gsize n)
+{
+	__m128i acc = _mm_setzero_si128();
+	gsize i = 0;
+
+	for (; i + 16 <= n; i += 16)
+		{
+		const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+		const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+		acc = _mm_add_epi64(acc, _mm_sad_epu8(va, vb));
+		}
+
+	const guint32 sum = _mm_cvtsi128_si32(acc) + _mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+
+	return sum + image_sim_sad_scalar(a + i, b + i, n - i);
+}
+#endif
+
+#if GQ_SIM_HAVE_AVX2
+__attribute__((target("avx2")))
+guint32 image_sim_sad_avx2(const guint8 *a, const guint8 *b, gsize n)
+{
+	__m256i acc = _mm256_setzero_si256();
+	gsize i = 0;
+
+	for (; i + 32 <= n; i += 32)
+		{
+		const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+		const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+		acc = _mm256_add_epi64(acc, _mm256_sad_epu8(va, vb));
+		}
+
+	const __m128i acc128 = _mm_add_epi64(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+	const guint32 sum = _mm_cvtsi128_si32(acc128) + _mm_cvtsi128_si32(_mm_srli_si128(acc128, 8));
+
+	return sum + image_sim_sad_scalar(a + i, b + i, n - i);
+}
+#endif
+
+#if defined(__ARM_NEON)
+guint32 image_sim_sad_neon(const guint8 *a, const guint8 *b, gsize n)
+{
+	uint32x4_t acc = vdupq_n_u32(0);
+	gsize i = 0;
+
+	for (; i + 16 <= n; i += 16)
+		{
+		const uint8x16_t diff = vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+		acc = vpadalq_u16(acc, vpaddlq_u8(diff));
+		}
+
+	const guint32 sum = vgetq_lane_u32(acc, 0) + vgetq_lane_u32(acc, 1) + vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3);
+
+	return sum + image_sim_sad_scalar(a + i, b + i, n - i);
+}
+#endif
+
+/**
+ * @brief Selects the sum of absolute differences kernel once, at first use
+ */
+const ImageSimSadImpl &image_sim_sad_impl()
+{
+	static const ImageSimSadImpl impl = []() -> ImageSimSadImpl
+	{
+#if GQ_SIM_HAVE_AVX2
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2")) return {image_sim_sad_avx2, "avx2"};
+#endif
+#if defined(__SSE2__)
+		return {image_sim_sad_sse2, "sse2"};
+#elif defined(__ARM_NEON)
+		return {image_sim_sad_neon, "neon"};
+#else
+		return {image_sim_sad_scalar, "scalar"};
+#endif
+	}();
+
+	return impl;
+}
+
 void image_sim_channel_equal(ImageSimilarityData::Avg &pix)
 {
 	struct IndexedPix
@@ -91,36 +219,183 @@ void image_sim_channel_equal(ImageSimilarityData::Avg &pix)
  * generate all possible isometric transformations
  * = 8 tests
  * = change dir of x, change dir of y, exchange x and y = 2^3 = 8
+ *
+ * Each table maps a grid index of a to the grid index of b it is compared with.
+ */
+using ImageSimTransfoTables = std::array<std::array<guint16, SIM_GRID_SIZE>, 8>;
+
+const ImageSimTransfoTables &image_sim_transfo_tables()
+{
+	static const ImageSimTransfoTables tables = []()
+	{
+		ImageSimTransfoTables t{};
+
+		for (gint transfo = 0; transfo < 8; transfo++)
+			{
+			gint i2;
+			gint *i;
+			gint j2;
+			gint *j;
+
+			if (transfo & 1) { i = &j2; j = &i2; } else { i = &i2; j = &j2; }
+			for (gint j1 = 0; j1 < 32; j1++)
+				{
+				if (transfo & 2) *j = 31-j1; else *j = j1;
+				for (gint i1 = 0; i1 < 32; i1++)
+					{
+					if (transfo & 4) *i = 31-i1; else *i = i1;
+					t[transfo][(i1*32)+j1] = (i2*32)+j2;
+					}
+				}
+			}
+
+		return t;
+	}();
+
+	return tables;
+}
+
+/*
+ * The index works on a 4 x 4 grid of block sums per channel, and the
+ * prefilter on a 16 x 16 grid of block averages. Each block of the full
+ * grid maps onto a whole block under all 8 transformations, so the tables
+ * above reduce to a permutation of the blocks.
  */
-gdouble image_sim_data_compare_transfo(const ImageSimilarityData *a, const ImageSimilarityData *b, gchar transfo, const ImageSimilarityCheckAbort &check_abort)
+template<gint BLOCKS>
+using ImageSimBlockTables = std::array<std::array<guint8, BLOCKS * BLOCKS>, 8>;
+
+template<gint BLOCKS>
+const ImageSimBlockTables<BLOCKS> &image_sim_block_tables()
+{
+	static const ImageSimBlockTables<BLOCKS> tables = []()
+	{
+		constexpr gint cells = 32 / BLOCKS;
+		ImageSimBlockTables<BLOCKS> t{};
+
+		for (gint transfo = 0; transfo < 8; transfo++)
+			{
+			for (gint by = 0; by < BLOCKS; by++)
+				{
+				for (gint bx = 0; bx < BLOCKS; bx++)
+					{
+					const gint k = image_sim_transfo_tables()[transfo][(by * cells * 32) + (bx * cells)];
+
+					t[transfo][(by * BLOCKS) + bx] = ((k / 32 / cells) * BLOCKS) + ((k % 32) / cells);
+					}
+				}
+			}
+
+		return t;
+	}();
+
+	return tables;
+}
+
+constexpr gint SIM_COARSE_BLOCKS = 4;
+constexpr gint SIM_COARSE_CELLS = 32 / SIM_COARSE_BLOCKS;
+constexpr gint SIM_COARSE_CHANNEL = SIM_COARSE_BLOCKS * SIM_COARSE_BLOCKS;
+
+constexpr gint SIM_SMALL_BLOCKS = 16;
+constexpr gint SIM_SMALL_CELLS = 32 / SIM_SMALL_BLOCKS;
+constexpr gint SIM_SMALL_CHANNEL = SIM_SMALL_BLOCKS * SIM_SMALL_BLOCKS;
+constexpr gint SIM_SMALL_SIZE = 3 * SIM_SMALL_CHANNEL;
+
+void image_sim_coarse_fill(const ImageSimilarityData &sd, ImageSimilarityStore::Coarse &coarse)
 {
-	if (!image_sim_filled(a) || !image_sim_filled(b)) return 0.0;
+	const std::array<const ImageSimilarityData::Avg *, 3> channels{&sd.avg_r, &sd.avg_g, &sd.avg_b};
 
-	gint sim = 0.0;
-	gint i2;
-	gint *i;
-	gint j2;
-	gint *j;
+	coarse.fill(0);
 
-	if (transfo & 1) { i = &j2; j = &i2; } else { i = &i2; j = &j2; }
-	for (gint j1 = 0; j1 < 32; j1++)
+	for (gsize c = 0; c < channels.size(); c++)
 		{
-		if (transfo & 2) *j = 31-j1; else *j = j1;
-		for (gint i1 = 0; i1 < 32; i1++)
+		for (gint y = 0; y < 32; y++)
 			{
-			if (transfo & 4) *i = 31-i1; else *i = i1;
-			sim += abs(a->avg_r[(i1*32)+j1] - b->avg_r[(i2*32)+j2]);
-			sim += abs(a->avg_g[(i1*32)+j1] - b->avg_g[(i2*32)+j2]);
-			sim += abs(a->avg_b[(i1*32)+j1] - b->avg_b[(i2*32)+j2]);
-			/* check for abort, if so return 0.0 */
-			if (check_abort(sim)) return 0.0;
+			for (gint x = 0; x < 32; x++)
+				{
+				const gint block = ((y / SIM_COARSE_CELLS) * SIM_COARSE_BLOCKS) + (x / SIM_COARSE_CELLS);
+
+				coarse[(c * SIM_COARSE_CHANNEL) + block] += (*channels[c])[(y * 32) + x];
+				}
+			}
+		}
+}
+
+/**
+ * @brief Appends the 2 x 2 block averages of each channel, rounded down
+ */
+void image_sim_small_append(const ImageSimilarityData &sd, std::vector<guint8> &plane)
+{
+	static_assert(SIM_SMALL_CELLS == 2);
+
+	for (const ImageSimilarityData::Avg *channel : {&sd.avg_r, &sd.avg_g, &sd.avg_b})
+		{
+		for (gint by = 0; by < SIM_SMALL_BLOCKS; by++)
+			{
+			for (gint bx = 0; bx < SIM_SMALL_BLOCKS; bx++)
+				{
+				const gint n = (by * SIM_SMALL_CELLS * 32) + (bx * SIM_SMALL_CELLS);
+
+				plane.push_back(((*channel)[n] + (*channel)[n + 1] + (*channel)[n + 32] + (*channel)[n + 33]) / 4);
+				}
+			}
+		}
+}
+
+guint32 image_sim_coarse_distance(const ImageSimilarityStore::Coarse &a, const ImageSimilarityStore::Coarse &b)
+{
+	guint32 distance = 0;
+
+	for (gsize i = 0; i < a.size(); i++)
+		{
+		distance += abs(a[i] - b[i]);
+		}
+
+	return distance;
+}
+
+/*
+ * The sum of absolute differences only grows, so checking the abort
+ * condition once on the total gives the same result as checking it
+ * after every grid cell.
+ */
+gdouble image_sim_data_compare_transfo(const ImageSimilarityView &a, const ImageSimilarityView &b, gchar transfo, const ImageSimilarityCheckAbort &check_abort)
+{
+	if (!a.filled || !b.filled) return 0.0;
+
+	gint sim;
+
+	if (transfo == 0)
+		{
+		sim = image_sim_sad(a.r, b.r, SIM_GRID_SIZE)
+		    + image_sim_sad(a.g, b.g, SIM_GRID_SIZE)
+		    + image_sim_sad(a.b, b.b, SIM_GRID_SIZE);
+		}
+	else
+		{
+		const auto &table = image_sim_transfo_tables()[transfo];
+		ImageSimilarityData::Avg t_r;
+		ImageSimilarityData::Avg t_g;
+		ImageSimilarityData::Avg t_b;
+
+		for (gsize n = 0; n < SIM_GRID_SIZE; n++)
+			{
+			t_r[n] = b.r[table[n]];
+			t_g[n] = b.g[table[n]];
+			t_b[n] = b.b[table[n]];
 			}
+
+		sim = image_sim_sad(a.r, t_r.data(), SIM_GRID_SIZE)
+		    + image_sim_sad(a.g, t_g.data(), SIM_GRID_SIZE)
+		    + image_sim_sad(a.b, t_b.data(), SIM_GRID_SIZE);
 		}
 
+	/* check for abort, if so return 0.0 */
+	if (check_abort(sim)) return 0.0;
+
 	return 1.0 - (static_cast<gdouble>(sim) / (255.0 * 1024.0 * 3.0));
 }
 
-gdouble image_sim_data_compare(const ImageSimilarityData *a, const ImageSimilarityData *b, const ImageSimilarityCheckAbort &check_abort)
+gdouble image_sim_data_compare(const ImageSimilarityView &a, const ImageSimilarityView &b, const ImageSimilarityCheckAbort &check_abort)
 {
 	gchar max_t = (options->rot_invariant_sim ? 8 : 1);
 	gdouble max_score = 0;
@@ -133,6 +408,52 @@ gdouble image_sim_data_compare(const ImageSimilarityData *a, const ImageSimilari
 	return max_score;
 }
 
+/*
+ * Signatures are allocated from slabs of SIM_SLAB_COUNT, so that loading
+ * many of them neither fragments the heap nor scatters them in memory.
+ * Freed signatures are reused, lowest slab first. A slab is released as
+ * soon as its last signature is freed, except for the first one, so that
+ * a single signature allocated and freed over and over does not go back
+ * to the heap each time.
+ */
+constexpr gsize SIM_SLAB_COUNT = 256;
+constexpr gsize SIM_SLAB_SLOT = (sizeof(ImageSimilarityData) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+
+struct ImageSimSlab
+{
+	gpointer free_slots = nullptr; /**< Linked through the first bytes of each free slot */
+	gsize live = 0;
+};
+
+struct ImageSimSlabs
+{
+	GMutex mutex;
+	std::map<guint8 *, ImageSimSlab> slabs; /**< by start address */
+	std::set<guint8 *> available;           /**< slabs with free slots */
+	guint8 *resident = nullptr;             /**< never released */
+};
+
+ImageSimSlabs &image_sim_slabs()
+{
+	static ImageSimSlabs slabs;
+
+	return slabs;
+}
+
+/* Puts all slots of @data on the free list of @slab, the first slot at its head. */
+void image_sim_slab_link(ImageSimSlab &slab, guint8 *data)
+{
+	slab.free_slots = nullptr;
+
+	for (gsize i = SIM_SLAB_COUNT; i > 0; i--)
+		{
+		gpointer slot = data + ((i - 1) * SIM_SLAB_SLOT);
+
+		*static_cast<gpointer *>(slot) = slab.free_slots;
+		slab.free_slots = slot;
+		}
+}
+
 } // namespace
 
 static void image_sim_channel_norm(ImageSimilarityData::Avg &pix)
@@ -153,6 +474,68 @@ ImageSimilarityData::ImageSimilarityData(GdkPixbuf *pixbuf)
 	fill_data(pixbuf);
 }
 
+void *ImageSimilarityData::operator new(std::size_t size)
+{
+	g_assert(size == sizeof(ImageSimilarityData));
+
+	ImageSimSlabs &s = image_sim_slabs();
+	g_mutex_lock(&s.mutex);
+
+	if (s.available.empty())
+		{
+		auto *data = static_cast<guint8 *>(g_malloc(SIM_SLAB_COUNT * SIM_SLAB_SLOT));
+		image_sim_slab_link(s.slabs[data], data);
+		s.available.insert(data);
+		if (!s.resident) s.resident = data;
+		}
+
+	guint8 *data = *s.available.begin();
+	ImageSimSlab &slab = s.slabs[data];
+
+	gpointer slot = slab.free_slots;
+	slab.free_slots = *static_cast<gpointer *>(slot);
+	slab.live++;
+
+	if (!slab.free_slots) s.available.erase(data);
+
+	g_mutex_unlock(&s.mutex);
+
+	return slot;
+}
+
+void ImageSimilarityData::operator delete(void *p)
+{
+	if (!p) return;
+
+	ImageSimSlabs &s = image_sim_slabs();
+	g_mutex_lock(&s.mutex);
+
+	auto it = std::prev(s.slabs.upper_bound(static_cast<guint8 *>(p)));
+	ImageSimSlab &slab = it->second;
+
+	if (!slab.free_slots) s.available.insert(it->first);
+
+	*static_cast<gpointer *>(p) = slab.free_slots;
+	slab.free_slots = p;
+	slab.live--;
+
+	if (slab.live == 0)
+		{
+		if (it->first == s.resident)
+			{
+			image_sim_slab_link(slab, it->first);
+			}
+		else
+			{
+			s.available.erase(it->first);
+			g_free(it->first);
+			s.slabs.erase(it);
+			}
+		}
+
+	g_mutex_unlock(&s.mutex);
+}
+
 /*
  * The Alternate algorithm is only for testing of new techniques to
  * improve the result, and hopes to reduce false positives.
@@ -329,14 +712,14 @@ void ImageSimilarityData::to_string(GString *str) const
 		}
 }
 
-static gdouble alternate_image_sim_compare_fast(const ImageSimilarityData *a, const ImageSimilarityData *b, gdouble min)
+static gdouble alternate_image_sim_compare_fast(const ImageSimilarityView &a, const ImageSimilarityView &b, gdouble min)
 {
 	gint sim;
 	gint i;
 	gint j;
 	gint ld;
 
-	if (!image_sim_filled(a) || !image_sim_filled(b)) return 0.0;
+	if (!a.filled || !b.filled) return 0.0;
 
 	sim = 0.0;
 	ld = 0;
@@ -350,9 +733,9 @@ static gdouble alternate_image_sim_compare_fast(const ImageSimilarityData *a, co
 			gint cb;
 			gint cd;
 
-			cr = abs(a->avg_r[i] - b->avg_r[i]);
-			cg = abs(a->avg_g[i] - b->avg_g[i]);
-			cb = abs(a->avg_b[i] - b->avg_b[i]);
+			cr = abs(a.r[i] - b.r[i]);
+			cg = abs(a.g[i] - b.g[i]);
+			cb = abs(a.b[i] - b.b[i]);
 
 			cd = cr + cg + cb;
 			sim += cd + abs(cd - ld);
@@ -365,9 +748,21 @@ static gdouble alternate_image_sim_compare_fast(const ImageSimilarityData *a, co
 	return (1.0 - ((gdouble)sim / (255.0 * 1024.0 * 4.0)) );
 }
 
+static gdouble image_sim_view_compare_fast(const ImageSimilarityView &a, const ImageSimilarityView &b, gdouble min)
+{
+	min = 1.0 - min;
+
+	if (options->alternate_similarity_algorithm.enabled)
+		{
+		return alternate_image_sim_compare_fast(a, b, min);
+		}
+
+	return image_sim_data_compare(a, b, [min](gdouble sim){ return (sim / (255.0 * 1024.0 * 3.0)) > min; });
+}
+
 gdouble image_sim_compare(ImageSimilarityData *a, ImageSimilarityData *b)
 {
-	return image_sim_data_compare(a, b, [](gdouble){ return false; });
+	return image_sim_data_compare(image_sim_view(a), image_sim_view(b), [](gdouble){ return false; });
 }
 
 /* this uses a cutoff point so that it can abort early when it gets to
@@ -375,18 +770,311 @@ gdouble image_sim_compare(ImageSimilarityData *a, ImageSimilarityData *b)
  */
 gdouble image_sim_compare_fast(ImageSimilarityData *a, ImageSimilarityData *b, gdouble min)
 {
-	min = 1.0 - min;
+	return image_sim_view_compare_fast(image_sim_view(a), image_sim_view(b), min);
+}
 
-	if (options->alternate_similarity_algorithm.enabled)
+bool image_sim_filled(const ImageSimilarityData *sd)
+{
+	return sd && sd->filled;
+}
+
+/**
+ * @brief Sum of absolute differences of two byte arrays
+ *
+ * Uses the widest vector unit found at run time (AVX2, SSE2 or NEON).
+ * The result is identical to image_sim_sad_scalar().
+ */
+guint32 image_sim_sad(const guint8 *a, const guint8 *b, gsize n)
+{
+	return image_sim_sad_impl().func(a, b, n);
+}
+
+guint32 image_sim_sad_scalar(const guint8 *a, const guint8 *b, gsize n)
+{
+	guint32 sum = 0;
+
+	for (gsize i = 0; i < n; i++)
 		{
-		return alternate_image_sim_compare_fast(a, b, min);
+		sum += abs(a[i] - b[i]);
 		}
 
-	return image_sim_data_compare(a, b, [min](gdouble sim){ return (sim / (255.0 * 1024.0 * 3.0)) > min; });
+	return sum;
 }
 
-bool image_sim_filled(const ImageSimilarityData *sd)
+const gchar *image_sim_sad_implementation()
 {
-	return sd && sd->filled;
+	return image_sim_sad_impl().name;
+}
+
+void ImageSimilarityStore::reserve(gsize count)
+{
+	plane_r.reserve(count * SIM_GRID_SIZE);
+	plane_g.reserve(count * SIM_GRID_SIZE);
+	plane_b.reserve(count * SIM_GRID_SIZE);
+	if (prefilter) plane_small.reserve(count * SIM_SMALL_SIZE);
+	filled.reserve(count);
+	coarse.reserve(count);
+}
+
+gsize ImageSimilarityStore::memory_size() const
+{
+	return plane_r.capacity() + plane_g.capacity() + plane_b.capacity() + plane_small.capacity()
+	     + filled.capacity() + (coarse.capacity() * sizeof(Coarse))
+	     + (index_ids.capacity() * sizeof(guint)) + (index_nodes.capacity() * sizeof(IndexNode));
+}
+
+/**
+ * @brief Copies a signature into the store
+ * @param sd May be NULL or not filled; the entry then never matches
+ * @returns The index of the new entry
+ */
+gsize ImageSimilarityStore::append(const ImageSimilarityData *sd)
+{
+	const gsize index = filled.size();
+
+	coarse.emplace_back();
+
+	if (image_sim_filled(sd))
+		{
+		image_sim_coarse_fill(*sd, coarse.back());
+		plane_r.insert(plane_r.end(), sd->avg_r.cbegin(), sd->avg_r.cend());
+		plane_g.insert(plane_g.end(), sd->avg_g.cbegin(), sd->avg_g.cend());
+		plane_b.insert(plane_b.end(), sd->avg_b.cbegin(), sd->avg_b.cend());
+		if (prefilter) image_sim_small_append(*sd, plane_small);
+		filled.push_back(TRUE);
+		}
+	else
+		{
+		plane_r.resize(plane_r.size() + SIM_GRID_SIZE);
+		plane_g.resize(plane_g.size() + SIM_GRID_SIZE);
+		plane_b.resize(plane_b.size() + SIM_GRID_SIZE);
+		if (prefilter) plane_small.resize(plane_small.size() + SIM_SMALL_SIZE);
+		filled.push_back(FALSE);
+		}
+
+	return index;
+}
+
+gdouble ImageSimilarityStore::compare_fast(gsize a, gsize b, gdouble min) const
+{
+	const auto view = [this](gsize n) -> ImageSimilarityView
+	{
+		const gsize offset = n * SIM_GRID_SIZE;
+
+		return {plane_r.data() + offset, plane_g.data() + offset, plane_b.data() + offset, filled[n] != 0};
+	};
+
+	return image_sim_view_compare_fast(view(a), view(b), min);
+}
+
+/**
+ * @brief Lower bound of the full distance of \a a and \a b under one transformation
+ * @param a
+ * @param b
+ * @param transfo 0 to 7, as for the full compare
+ *
+ * Each 2 x 2 block sum is 4 times its average plus 0 to 3, so the full
+ * distance is at least 4 times the 16 x 16 distance less 3 per block.
+ * Only valid if the store was created with a prefilter.
+ */
+guint32 ImageSimilarityStore::prefilter_distance(gsize a, gsize b, gint transfo) const
+{
+	const guint8 *small_a = plane_small.data() + (a * SIM_SMALL_SIZE);
+	const guint8 *small_b = plane_small.data() + (b * SIM_SMALL_SIZE);
+	guint32 sad;
+
+	if (transfo == 0)
+		{
+		sad = image_sim_sad(small_a, small_b, SIM_SMALL_SIZE);
+		}
+	else
+		{
+		const auto &table = image_sim_block_tables<SIM_SMALL_BLOCKS>()[transfo];
+		std::array<guint8, SIM_SMALL_SIZE> t_b;
+
+		for (gint c = 0; c < 3; c++)
+			{
+			for (gint block = 0; block < SIM_SMALL_CHANNEL; block++)
+				{
+				t_b[(c * SIM_SMALL_CHANNEL) + block] = small_b[(c * SIM_SMALL_CHANNEL) + table[block]];
+				}
+			}
+
+		sad = image_sim_sad(small_a, t_b.data(), SIM_SMALL_SIZE);
+		}
+
+	constexpr guint32 rounding = 3 * SIM_SMALL_SIZE;
+
+	return (4 * sad > rounding) ? (4 * sad) - rounding : 0;
+}
+
+/**
+ * @brief Whether compare_fast() of \a a and \a b can be skipped because it cannot reach \a min
+ *
+ * Never rejects a pair that would match, and always FALSE without a prefilter.
+ */
+bool ImageSimilarityStore::prefilter_reject(gsize a, gsize b, gdouble min) const
+{
+	if (!prefilter || !filled[a] || !filled[b]) return false;
+
+	/* as in index_query(), the alternate algorithm has a larger range */
+	const bool alternate = options->alternate_similarity_algorithm.enabled;
+	const gdouble scale = alternate ? 4.0 : 3.0;
+	const gdouble radius = std::max(0.0, 1.0 - min) * 255.0 * 1024.0 * scale;
+	const gint transfo_count = (options->rot_invariant_sim && !alternate) ? 8 : 1;
+
+	for (gint t = 0; t < transfo_count; t++)
+		{
+		if (prefilter_distance(a, b, t) <= radius) return false;
+		}
+
+	return true;
+}
+
+guint32 ImageSimilarityStore::coarse_distance(gsize a, gsize b) const
+{
+	return image_sim_coarse_distance(coarse[a], coarse[b]);
+}
+
+/**
+ * @brief Builds the vantage-point tree over the filled entries of a range
+ * @param first
+ * @param last One past the final entry
+ */
+void ImageSimilarityStore::index_build(gsize first, gsize last)
+{
+	index_ids.clear();
+	index_nodes.clear();
+
+	for (gsize n = first; n < last; n++)
+		{
+		if (filled[n]) index_ids.push_back(n);
+		}
+
+	index_build_node(0, index_ids.size());
+}
+
+gint ImageSimilarityStore::index_build_node(guint lo, guint hi)
+{
+	static constexpr guint INDEX_LEAF_SIZE = 16;
+
+	if (lo >= hi) return -1;
+
+	const gint node_index = index_nodes.size();
+	index_nodes.push_back({});
+
+	if (hi - lo <= INDEX_LEAF_SIZE)
+		{
+		index_nodes[node_index].leaf_first = lo;
+		index_nodes[node_index].leaf_count = hi - lo;
+		return node_index;
+		}
+
+	const guint vantage = index_ids[lo];
+	std::vector<std::pair<guint32, guint>> distances;
+	distances.reserve(hi - lo - 1);
+
+	for (guint i = lo + 1; i < hi; i++)
+		{
+		distances.emplace_back(coarse_distance(vantage, index_ids[i]), index_ids[i]);
+		}
+
+	/* entries up to and including the median are no further than mu, the rest no closer */
+	const gsize median = distances.size() / 2;
+	std::nth_element(distances.begin(), distances.begin() + median, distances.end());
+
+	for (gsize i = 0; i < distances.size(); i++)
+		{
+		index_ids[lo + 1 + i] = distances[i].second;
+		}
+
+	const guint mid = lo + 1 + median + 1;
+
+	index_nodes[node_index].vantage = vantage;
+	index_nodes[node_index].mu = distances[median].first;
+
+	const gint inner = index_build_node(lo + 1, mid);
+	const gint outer = index_build_node(mid, hi);
+
+	index_nodes[node_index].inner = inner;
+	index_nodes[node_index].outer = outer;
+
+	return node_index;
+}
+
+void ImageSimilarityStore::index_search(const Coarse &query, guint32 radius, std::vector<guint> &candidates) const
+{
+	std::vector<gint> stack{0};
+
+	while (!stack.empty())
+		{
+		const gint node_index = stack.back();
+		stack.pop_back();
+		if (node_index < 0) continue;
+
+		const IndexNode &node = index_nodes[node_index];
+
+		if (node.leaf_count > 0)
+			{
+			for (guint i = node.leaf_first; i < node.leaf_first + node.leaf_count; i++)
+				{
+				if (image_sim_coarse_distance(query, coarse[index_ids[i]]) <= radius) candidates.push_back(index_ids[i]);
+				}
+			continue;
+			}
+
+		const guint32 d = image_sim_coarse_distance(query, coarse[node.vantage]);
+
+		if (d <= radius) candidates.push_back(node.vantage);
+		if (d <= node.mu + radius) stack.push_back(node.inner);
+		if (d + radius >= node.mu) stack.push_back(node.outer);
+		}
+}
+
+/**
+ * @brief Finds the entries that may match \a needle
+ * @param needle
+ * @param radius Largest sum of absolute differences that is still a match
+ * @param transfo_count 1, or 8 to include rotated and mirrored matches
+ * @param[out] candidates Store indices, sorted ascending; may include \a needle
+ *
+ * The result is a superset of the entries within \a radius.
+ */
+void ImageSimilarityStore::index_query_radius(gsize needle, guint32 radius, gint transfo_count, std::vector<guint> &candidates) const
+{
+	candidates.clear();
+
+	if (!filled[needle] || index_nodes.empty()) return;
+
+	for (gint t = 0; t < transfo_count; t++)
+		{
+		const auto &table = image_sim_block_tables<SIM_COARSE_BLOCKS>()[t];
+		Coarse query;
+
+		for (gint c = 0; c < 3; c++)
+			{
+			for (gint block = 0; block < SIM_COARSE_CHANNEL; block++)
+				{
+				query[(c * SIM_COARSE_CHANNEL) + block] = coarse[needle][(c * SIM_COARSE_CHANNEL) + table[block]];
+				}
+			}
+
+		index_search(query, radius, candidates);
+		}
+
+	std::sort(candidates.begin(), candidates.end());
+	candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+}
+
+/**
+ * @brief Finds the entries that may reach \a min with compare_fast()
+ */
+void ImageSimilarityStore::index_query(gsize needle, gdouble min, std::vector<guint> &candidates) const
+{
+	/* The alternate algorithm adds a non-negative term to each difference */
+	const gdouble scale = options->alternate_similarity_algorithm.enabled ? 4.0 : 3.0;
+	const guint32 radius = static_cast<guint32>(std::max(0.0, 1.0 - min) * 255.0 * 1024.0 * scale) + 1;
+
+	index_query_radius(needle, radius, options->rot_invariant_sim ? 8 : 1, candidates);
 }
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
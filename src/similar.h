@@ -23,6 +23,8 @@
 #define SIMILAR_H
 
 #include <array>
+#include <cstddef>
+#include <vector>
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <glib.h>
@@ -46,6 +48,84 @@ struct ImageSimilarityData
 	Avg avg_b;
 
 	bool filled;
+
+	static void *operator new(std::size_t size);
+	static void operator delete(void *p);
+};
+
+
+/**
+ * @brief Packed similarity signatures for bulk comparison
+ *
+ * The red, green and blue grids of all signatures are held in three
+ * contiguous planes (structure of arrays). Walking a range of indices
+ * therefore streams through memory instead of following one heap
+ * allocation per image.
+ *
+ * An optional index (a vantage-point tree over a 4 x 4 block sum of each
+ * channel) returns the candidates that can possibly match a needle. The
+ * block sum distance is a lower bound of the full grid distance, so the
+ * index never drops a real match.
+ *
+ * An optional prefilter keeps a 16 x 16 version of each channel, the
+ * average of every 2 x 2 block. Its distance gives a lower bound of the
+ * full distance at a quarter of the cost, so pairs that are clearly too
+ * different are rejected before the full 32 x 32 compare.
+ *
+ * The store is filled once on the main thread and is read-only
+ * afterwards, so it may be shared by the comparison threads.
+ */
+class ImageSimilarityStore
+{
+public:
+	explicit ImageSimilarityStore(bool prefilter = false) : prefilter(prefilter) {}
+
+	void reserve(gsize count);
+	gsize append(const ImageSimilarityData *sd);
+	gsize size() const { return filled.size(); }
+	gsize memory_size() const;
+
+	gdouble compare_fast(gsize a, gsize b, gdouble min) const;
+
+	bool prefilter_enabled() const { return prefilter; }
+	bool prefilter_reject(gsize a, gsize b, gdouble min) const;
+	guint32 prefilter_distance(gsize a, gsize b, gint transfo) const;
+
+	void index_build(gsize first, gsize last);
+	bool index_built() const { return !index_nodes.empty(); }
+	void index_query(gsize needle, gdouble min, std::vector<guint> &candidates) const;
+	void index_query_radius(gsize needle, guint32 radius, gint transfo_count, std::vector<guint> &candidates) const;
+
+	guint32 coarse_distance(gsize a, gsize b) const;
+
+	static constexpr gsize COARSE_SIZE = 3 * 4 * 4;
+	using Coarse = std::array<guint16, COARSE_SIZE>;
+
+private:
+	struct IndexNode
+	{
+		guint vantage;
+		guint32 mu; /**< Distance from \a vantage splitting the inner and outer subtrees */
+		gint inner;
+		gint outer;
+		guint leaf_first; /**< Range of \a index_ids held by a leaf */
+		guint leaf_count; /**< Zero for inner nodes */
+	};
+
+	gint index_build_node(guint lo, guint hi);
+	void index_search(const Coarse &query, guint32 radius, std::vector<guint> &candidates) const;
+
+	std::vector<guint8> plane_r;
+	std::vector<guint8> plane_g;
+	std::vector<guint8> plane_b;
+	std::vector<guint8> plane_small; /**< 16 x 16 red, green and blue of each entry, if \a prefilter */
+	std::vector<guint8> filled;
+	std::vector<Coarse> coarse;
+
+	std::vector<guint> index_ids;
+	std::vector<IndexNode> index_nodes;
+
+	bool prefilter;
 };
 
 
@@ -54,6 +134,10 @@ gdouble image_sim_compare_fast(ImageSimilarityData *a, ImageSimilarityData *b, g
 
 bool image_sim_filled(const ImageSimilarityData *sd);
 
+guint32 image_sim_sad(const guint8 *a, const guint8 *b, gsize n);
+guint32 image_sim_sad_scalar(const guint8 *a, const guint8 *b, gsize n);
+const gchar *image_sim_sad_implementation();
+
 
 #endif
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -30,6 +30,8 @@ const gchar *sort_type_get_text(SortType method)
 			return _("Sort by rating");
 		case SORT_CLASS:
 			return _("Sort by class");
+		case SORT_LUA:
+			return _("Sort by Lua value");
 		case SORT_NAME:
 		default:
 			return _("Sort by name");
@@ -42,7 +44,8 @@ bool sort_type_requires_metadata(SortType method)
 {
 	return method == SORT_EXIFTIME
 	    || method == SORT_EXIFTIMEDIGITIZED
-	    || method == SORT_RATING;
+	    || method == SORT_RATING
+	    || method == SORT_LUA;
 }
 
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "union-find.h"
+
+#include <numeric>
+#include <utility>
+
+/**
+ * @brief Makes each of \a count indices a set of its own
+ */
+void UnionFind::reset(guint count)
+{
+	parent.resize(count);
+	std::iota(parent.begin(), parent.end(), 0);
+	sizes.assign(count, 1);
+}
+
+/**
+ * @brief Returns the root of the set containing \a item
+ *
+ * The path is halved on the way up, which keeps the trees flat.
+ */
+guint UnionFind::find(guint item)
+{
+	while (parent[item] != item)
+		{
+		parent[item] = parent[parent[item]];
+		item = parent[item];
+		}
+
+	return item;
+}
+
+/**
+ * @brief Merges the sets containing \a a and \a b
+ * @returns TRUE if they were different sets
+ *
+ * The smaller set is attached below the larger one.
+ */
+gboolean UnionFind::unite(guint a, guint b)
+{
+	a = find(a);
+	b = find(b);
+	if (a == b) return FALSE;
+
+	if (sizes[a] < sizes[b]) std::swap(a, b);
+
+	parent[b] = a;
+	sizes[a] += sizes[b];
+
+	return TRUE;
+}
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
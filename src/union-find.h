@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef UNION_FIND_H
+#define UNION_FIND_H
+
+#include <vector>
+
+#include <glib.h>
+
+/**
+ * @brief Disjoint sets of the indices 0 … n - 1
+ *
+ * Used to group matches as they are found, so that the groups can be
+ * shown before all comparisons are complete.
+ */
+class UnionFind
+{
+public:
+	void reset(guint count);
+
+	guint find(guint item);
+	gboolean unite(guint a, guint b);
+
+	guint size(guint item) { return sizes[find(item)]; }
+	guint count() const { return parent.size(); }
+
+private:
+	std::vector<guint> parent;
+	std::vector<guint> sizes; /**< Number of members, valid for the root of each set */
+};
+
+#endif
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
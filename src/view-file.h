@@ -31,7 +31,6 @@
 #include "main-defines.h"
 
 struct LayoutWindow;
-struct ThumbLoader;
 
 enum FileViewType : guint {
 	FILEVIEW_LIST,
@@ -82,8 +81,11 @@ struct ViewFile
 
 	/* thumbs updates*/
 	gboolean thumbs_running;
-	ThumbLoader *thumbs_loader;
-	FileData *thumbs_filedata;
+	GList *thumbs_jobs;     /**< ViewFileThumbJob, loaders in flight */
+	GList *thumbs_done;     /**< ViewFileThumbJob, finished but not yet shown */
+	guint thumbs_done_id;   /**< event source id */
+	guint thumbs_scroll_id; /**< event source id */
+	gint64 thumbs_visible_start; /**< monotonic time visible thumbs were wanted from, 0 once one is shown */
 
 	/* marks */
 	gboolean marks_enabled;
@@ -104,6 +106,8 @@ struct ViewFile
 	GList *editmenu_fd_list; /**< file list for edit menu */
 
 	guint read_metadata_in_idle_id;
+	struct ViewFileMetadataJob *read_metadata_job; /**< Exif dates read by the workers */
+	struct LuaListJob *lua_sort_job; /**< values of the Lua sort script */
 
 	using SelectionCallback = std::function<void(FileData *)>;
 };
@@ -172,6 +176,7 @@ void vf_notify_cb(FileData *fd, NotifyType type, gpointer data);
 void vf_thumb_update(ViewFile *vf);
 void vf_thumb_cleanup(ViewFile *vf);
 void vf_thumb_stop(ViewFile *vf);
+gboolean vf_thumb_is_pending(const ViewFile *vf, const FileData *fd);
 void vf_read_metadata_in_idle(ViewFile *vf);
 void vf_file_filter_set(ViewFile *vf, gboolean enable);
 GRegex *vf_file_filter_get_filter(ViewFile *vf);
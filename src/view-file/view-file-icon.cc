@@ -1531,34 +1531,72 @@ void vficon_set_thumb_fd(ViewFile *vf, FileData *fd)
 	gtk_list_store_set(GTK_LIST_STORE(store), &iter, FILE_COLUMN_POINTER, list, -1);
 }
 
-/* Returns the next fd without a loaded pixbuf, so the thumb-loader can load the pixbuf for it. */
+gboolean vficon_thumb_is_visible(ViewFile *vf, FileData *fd)
+{
+	GtkTreeIter iter;
+
+	if (!vficon_find_iter(vf, fd, &iter, nullptr)) return FALSE;
+
+	return tree_view_row_is_visible(GTK_TREE_VIEW(vf->listview), &iter, FALSE);
+}
+
+static FileData *vficon_thumb_row_next_fd(ViewFile *vf, GtkTreeModel *store, GtkTreeIter *iter)
+{
+	GList *list;
+	gtk_tree_model_get(store, iter, FILE_COLUMN_POINTER, &list, -1);
+
+	for (; list; list = list->next)
+		{
+		auto fd = static_cast<FileData *>(list->data);
+		if (fd && !fd->thumb_pixbuf && !vf_thumb_is_pending(vf, fd)) return fd;
+		}
+
+	return nullptr;
+}
+
+/* Returns the next fd without a loaded pixbuf that is not already being loaded,
+ * so a thumb-loader can load the pixbuf for it. */
 FileData *vficon_thumb_next_fd(ViewFile *vf)
 {
-	/* First see if there are visible files that don't have a loaded thumb... */
+	/* First see if there are visible files that don't have a loaded thumb,
+	 * then look a page of rows beyond either side of the view... */
 	if (g_autoptr(GtkTreePath) tpath = nullptr;
 	    gtk_tree_view_get_path_at_pos(GTK_TREE_VIEW(vf->listview), 0, 0, &tpath, nullptr, nullptr, nullptr))
 		{
 		GtkTreeModel *store;
 		GtkTreeIter iter;
+		GtkTreeIter first;
 		gboolean valid = TRUE;
+		gint visible = 0;
+		FileData *fd;
 
 		store = gtk_tree_view_get_model(GTK_TREE_VIEW(vf->listview));
 		gtk_tree_model_get_iter(store, &iter, tpath);
+		first = iter;
 
 		while (valid && tree_view_row_is_visible(GTK_TREE_VIEW(vf->listview), &iter, FALSE))
 			{
-			GList *list;
-			gtk_tree_model_get(store, &iter, FILE_COLUMN_POINTER, &list, -1);
+			fd = vficon_thumb_row_next_fd(vf, store, &iter);
+			if (fd) return fd;
 
-			/** @todo (xsdg): for loop here. */
-			for (; list; list = list->next)
-				{
-				auto fd = static_cast<FileData *>(list->data);
-				if (fd && !fd->thumb_pixbuf) return fd;
-				}
+			visible++;
+			valid = gtk_tree_model_iter_next(store, &iter);
+			}
+
+		for (gint i = 0; valid && i < visible; i++)
+			{
+			fd = vficon_thumb_row_next_fd(vf, store, &iter);
+			if (fd) return fd;
 
 			valid = gtk_tree_model_iter_next(store, &iter);
 			}
+
+		iter = first;
+		for (gint i = 0; i < visible && gtk_tree_model_iter_previous(store, &iter); i++)
+			{
+			fd = vficon_thumb_row_next_fd(vf, store, &iter);
+			if (fd) return fd;
+			}
 		}
 
 	/* Then iterate through the entire list to load all of them. */
@@ -1569,7 +1607,7 @@ FileData *vficon_thumb_next_fd(ViewFile *vf)
 
 		// Note: This implementation differs from view-file-list.cc because sidecar files are not
 		// distinct list elements here, as they are in the list view.
-		if (!fd->thumb_pixbuf) return fd;
+		if (!fd->thumb_pixbuf && !vf_thumb_is_pending(vf, fd)) return fd;
 		}
 
 	return nullptr;
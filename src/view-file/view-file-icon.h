@@ -97,6 +97,7 @@ void vficon_selection_to_mark(ViewFile *vf, gint mark, SelectionToMarkMode mode)
 void vficon_thumb_progress_count(const GList *list, gint &count, gint &done);
 void vficon_read_metadata_progress_count(const GList *list, gint &count, gint &done);
 void vficon_set_thumb_fd(ViewFile *vf, FileData *fd);
+gboolean vficon_thumb_is_visible(ViewFile *vf, FileData *fd);
 FileData *vficon_thumb_next_fd(ViewFile *vf);
 
 FileData *vficon_star_next_fd(ViewFile *vf);
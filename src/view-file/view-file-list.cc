@@ -1000,21 +1000,38 @@ void vflist_set_thumb_fd(ViewFile *vf, FileData *fd)
 	gtk_tree_store_set(store, &iter, FILE_COLUMN_THUMB, thumb, -1);
 }
 
+gboolean vflist_thumb_is_visible(ViewFile *vf, FileData *fd)
+{
+	GtkTreeIter iter;
+
+	if (!vflist_find_row(vf, fd, &iter)) return FALSE;
+
+	return tree_view_row_is_visible(GTK_TREE_VIEW(vf->listview), &iter, FALSE);
+}
+
+static gboolean vflist_thumb_wanted(const ViewFile *vf, const FileData *fd)
+{
+	return fd && !fd->thumb_pixbuf && !vf_thumb_is_pending(vf, fd);
+}
+
 FileData *vflist_thumb_next_fd(ViewFile *vf)
 {
 	FileData *fd = nullptr;
 
-	/* first check the visible files */
+	/* first check the visible files, then a page of files on either side of them */
 
 	if (g_autoptr(GtkTreePath) tpath = nullptr;
 	    gtk_tree_view_get_path_at_pos(GTK_TREE_VIEW(vf->listview), 0, 0, &tpath, nullptr, nullptr, nullptr))
 		{
 		GtkTreeModel *store;
 		GtkTreeIter iter;
+		GtkTreeIter first;
 		gboolean valid = TRUE;
+		gint visible = 0;
 
 		store = gtk_tree_view_get_model(GTK_TREE_VIEW(vf->listview));
 		gtk_tree_model_get_iter(store, &iter, tpath);
+		first = iter;
 
 		while (!fd && valid && tree_view_row_is_visible(GTK_TREE_VIEW(vf->listview), &iter, FALSE))
 			{
@@ -1022,10 +1039,33 @@ FileData *vflist_thumb_next_fd(ViewFile *vf)
 
 			gtk_tree_model_get(store, &iter, FILE_COLUMN_POINTER, &nfd, -1);
 
-			if (!nfd->thumb_pixbuf) fd = nfd;
+			if (vflist_thumb_wanted(vf, nfd)) fd = nfd;
+
+			visible++;
+			valid = gtk_tree_model_iter_next(store, &iter);
+			}
+
+		/* below the view first, as that is where scrolling usually goes */
+		for (gint i = 0; !fd && valid && i < visible; i++)
+			{
+			FileData *nfd;
+
+			gtk_tree_model_get(store, &iter, FILE_COLUMN_POINTER, &nfd, -1);
+
+			if (vflist_thumb_wanted(vf, nfd)) fd = nfd;
 
 			valid = gtk_tree_model_iter_next(store, &iter);
 			}
+
+		iter = first;
+		for (gint i = 0; !fd && i < visible && gtk_tree_model_iter_previous(store, &iter); i++)
+			{
+			FileData *nfd;
+
+			gtk_tree_model_get(store, &iter, FILE_COLUMN_POINTER, &nfd, -1);
+
+			if (vflist_thumb_wanted(vf, nfd)) fd = nfd;
+			}
 		}
 
 	/* then find first undone */
@@ -1036,7 +1076,7 @@ FileData *vflist_thumb_next_fd(ViewFile *vf)
 		while (work && !fd)
 			{
 			auto fd_p = static_cast<FileData *>(work->data);
-			if (!fd_p->thumb_pixbuf)
+			if (vflist_thumb_wanted(vf, fd_p))
 				fd = fd_p;
 			else
 				{
@@ -1045,7 +1085,7 @@ FileData *vflist_thumb_next_fd(ViewFile *vf)
 				while (work2 && !fd)
 					{
 					fd_p = static_cast<FileData *>(work2->data);
-					if (!fd_p->thumb_pixbuf) fd = fd_p;
+					if (vflist_thumb_wanted(vf, fd_p)) fd = fd_p;
 					work2 = work2->next;
 					}
 				}
@@ -20,6 +20,12 @@
 
 #include "view-file.h"
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <config.h>
+
 #include <gdk/gdk.h>
 #include <glib-object.h>
 
@@ -30,10 +36,15 @@
 #include "compat.h"
 #include "dnd.h"
 #include "dupe.h"
+#include "exif.h"
 #include "filedata.h"
 #include "filefilter.h"
+#if HAVE_LUA
+#  include "glua.h"
+#endif
 #include "history-list.h"
 #include "image-load.h"
+#include "image-probe.h"
 #include "img-view.h"
 #include "intl.h"
 #include "layout.h"
@@ -63,6 +74,9 @@ constexpr auto VIEW_FILE_DATA_KEY = "view-file";
 
 } // namespace
 
+static void vf_thumb_scroll_cb(GtkAdjustment *adjustment, gpointer data);
+static void vf_read_metadata_cancel(ViewFile *vf);
+
 /*
  *-----------------------------------------------------------------------------
  * signals
@@ -761,11 +775,6 @@ static void vf_pop_menu_set_sort(ViewFile *vf, FileData::FileList::SortSettings
 {
 	if (!vf) return;
 
-	if (sort_type_requires_metadata(sort.method))
-		{
-		vf_read_metadata_in_idle(vf);
-		}
-
 	if (vf->layout)
 		{
 		layout_sort_set_files(vf->layout, sort);
@@ -774,6 +783,12 @@ static void vf_pop_menu_set_sort(ViewFile *vf, FileData::FileList::SortSettings
 		{
 		vf_sort_set(vf, sort);
 		}
+
+	/* after the sort is set, the Lua sort reads it */
+	if (sort_type_requires_metadata(sort.method))
+		{
+		vf_read_metadata_in_idle(vf);
+		}
 }
 
 static void vf_pop_menu_sort_action_cb(GSimpleAction *action, GVariant *parameter, gpointer data)
@@ -1055,6 +1070,9 @@ GtkWidget *vf_pop_menu(ViewFile *vf, GtkWidget *parent, gdouble x, gdouble y)
 		{
 		gmenu_append_int32_action_item(sort_menu, sort_type_get_text(sort_type), "win.view-file-sort", sort_type);
 		}
+#if HAVE_LUA
+	gmenu_append_int32_action_item(sort_menu, sort_type_get_text(SORT_LUA), "win.view-file-sort", SORT_LUA);
+#endif
 
 	GMenu *view_specific_menu = G_MENU(gtk_builder_get_object(builder, "view-specific-section"));
 	switch (vf->type)
@@ -1157,6 +1175,12 @@ static void vf_destroy_cb(GtkWidget *, gpointer data)
 		vf->marks_filter_tooltip_id = 0;
 		}
 
+	if (vf->scrolled)
+		{
+		g_signal_handlers_disconnect_by_func(gtk_scrolled_window_get_vadjustment(GTK_SCROLLED_WINDOW(vf->scrolled)),
+		                                     (gpointer)vf_thumb_scroll_cb, vf);
+		}
+
 	if (vf->listview)
 		{
 		g_object_set_data(G_OBJECT(vf->listview), VIEW_FILE_DATA_KEY, nullptr);
@@ -1182,6 +1206,10 @@ static void vf_destroy_cb(GtkWidget *, gpointer data)
 		{
 		g_idle_remove_by_data(vf);
 		}
+	vf_read_metadata_cancel(vf);
+#if HAVE_LUA
+	lua_callvalue_list_cancel(vf->lua_sort_job);
+#endif
 	file_data_unref(vf->dir_fd);
 	g_free(vf->info);
 	g_free(vf);
@@ -1858,6 +1886,8 @@ ViewFile *vf_new(FileViewType type, FileData *dir_fd)
 	gtk_widget_add_controller(vf->listview, GTK_EVENT_CONTROLLER(gesture));
 
 	gtk_scrolled_window_set_child(GTK_SCROLLED_WINDOW(vf->scrolled), vf->listview);
+	g_signal_connect(gtk_scrolled_window_get_vadjustment(GTK_SCROLLED_WINDOW(vf->scrolled)), "value-changed",
+	                 G_CALLBACK(vf_thumb_scroll_cb), vf);
 
 	vf_dnd_init(vf);
 
@@ -1888,7 +1918,35 @@ void vf_thumb_set(ViewFile *vf, gboolean enable)
 }
 
 
-static gboolean vf_thumb_next(ViewFile *vf);
+namespace
+{
+
+struct ViewFileThumbJob
+{
+	ThumbLoader *tl;
+	FileData *fd;
+};
+
+constexpr guint THUMB_BATCH_INTERVAL = 50; /**< ms between updates of finished thumbs */
+constexpr guint THUMB_SCROLL_DELAY = 100;  /**< ms after scrolling stops before jobs are rescheduled */
+
+void vf_thumb_job_free(gpointer data)
+{
+	auto job = static_cast<ViewFileThumbJob *>(data);
+
+	thumb_loader_free(job->tl);
+	file_data_unref(job->fd);
+	g_free(job);
+}
+
+guint vf_thumb_max_jobs()
+{
+	return std::max(options->threads.thumbnails > 0 ? options->threads.thumbnails : get_cpu_cores(), 1);
+}
+
+} // namespace
+
+static void vf_thumb_fill(ViewFile *vf);
 
 static gdouble vf_thumb_progress(ViewFile *vf)
 {
@@ -1936,12 +1994,34 @@ static void vf_thumb_status(ViewFile *vf, gdouble val, const gchar *text)
 		}
 }
 
-static void vf_thumb_do(ViewFile *vf, FileData *fd)
+static gboolean vf_thumb_is_visible(ViewFile *vf, FileData *fd)
 {
-	if (!fd) return;
+	switch (vf->type)
+	{
+	case FILEVIEW_LIST: return vflist_thumb_is_visible(vf, fd);
+	case FILEVIEW_ICON: return vficon_thumb_is_visible(vf, fd);
+	}
+
+	return FALSE;
+}
+
+static FileData *vf_thumb_next_fd(ViewFile *vf)
+{
+	switch (vf->type)
+	{
+	case FILEVIEW_LIST: return vflist_thumb_next_fd(vf);
+	case FILEVIEW_ICON: return vficon_thumb_next_fd(vf);
+	}
 
-	vf_set_thumb_fd(vf, fd);
-	vf_thumb_status(vf, vf_thumb_progress(vf), _("Loading thumbs…"));
+	return nullptr;
+}
+
+/* the next fd is a visible one if any visible row still lacks a thumb */
+static gboolean vf_thumb_visible_wanted(ViewFile *vf)
+{
+	FileData *fd = vf_thumb_next_fd(vf);
+
+	return fd && vf_thumb_is_visible(vf, fd);
 }
 
 void vf_thumb_cleanup(ViewFile *vf)
@@ -1950,10 +2030,15 @@ void vf_thumb_cleanup(ViewFile *vf)
 
 	vf->thumbs_running = FALSE;
 
-	thumb_loader_free(vf->thumbs_loader);
-	vf->thumbs_loader = nullptr;
+	g_clear_handle_id(&vf->thumbs_done_id, g_source_remove);
+	g_clear_handle_id(&vf->thumbs_scroll_id, g_source_remove);
+	vf->thumbs_visible_start = 0;
+
+	g_list_free_full(vf->thumbs_jobs, vf_thumb_job_free);
+	vf->thumbs_jobs = nullptr;
 
-	vf->thumbs_filedata = nullptr;
+	g_list_free_full(vf->thumbs_done, vf_thumb_job_free);
+	vf->thumbs_done = nullptr;
 }
 
 void vf_thumb_stop(ViewFile *vf)
@@ -1961,16 +2046,85 @@ void vf_thumb_stop(ViewFile *vf)
 	if (vf->thumbs_running) vf_thumb_cleanup(vf);
 }
 
+/**
+ * @brief Checks if a thumb for fd is being loaded
+ *
+ * The view's next_fd functions skip these, so that each loader works on a different file.
+ */
+gboolean vf_thumb_is_pending(const ViewFile *vf, const FileData *fd)
+{
+	for (GList *work = vf->thumbs_jobs; work; work = work->next)
+		{
+		auto job = static_cast<ViewFileThumbJob *>(work->data);
+		if (job->fd == fd) return TRUE;
+		}
+
+	return FALSE;
+}
+
+static gboolean vf_thumb_batch_cb(gpointer data)
+{
+	auto vf = static_cast<ViewFile *>(data);
+
+	vf->thumbs_done_id = 0;
+
+	GList *done = g_list_reverse(vf->thumbs_done);
+	vf->thumbs_done = nullptr;
+
+	for (GList *work = done; work; work = work->next)
+		{
+		auto job = static_cast<ViewFileThumbJob *>(work->data);
+		vf_set_thumb_fd(vf, job->fd);
+
+		if (vf->thumbs_visible_start && vf_thumb_is_visible(vf, job->fd))
+			{
+			DEBUG_1("thumb: first visible thumbnail after %.1f ms", (g_get_monotonic_time() - vf->thumbs_visible_start) / 1000.0);
+			vf->thumbs_visible_start = 0;
+			}
+		}
+	g_list_free_full(done, vf_thumb_job_free);
+
+	if (vf->thumbs_jobs)
+		{
+		vf_thumb_status(vf, vf_thumb_progress(vf), _("Loading thumbs…"));
+		}
+	else
+		{
+		/* done */
+		vf_thumb_cleanup(vf);
+		}
+
+	return G_SOURCE_REMOVE;
+}
+
+/* finished thumbs are shown in batches, so that a fast run of cache hits redraws and
+ * counts progress once per interval rather than once per file */
+static void vf_thumb_job_finish(ViewFile *vf, ViewFileThumbJob *job)
+{
+	vf->thumbs_jobs = g_list_remove(vf->thumbs_jobs, job);
+	vf->thumbs_done = g_list_prepend(vf->thumbs_done, job);
+
+	if (!vf->thumbs_done_id)
+		{
+		vf->thumbs_done_id = g_timeout_add(THUMB_BATCH_INTERVAL, vf_thumb_batch_cb, vf);
+		}
+}
+
 static void vf_thumb_common_cb(ThumbLoader *tl, gpointer data)
 {
 	auto vf = static_cast<ViewFile *>(data);
 
-	if (vf->thumbs_filedata && vf->thumbs_loader == tl)
+	for (GList *work = vf->thumbs_jobs; work; work = work->next)
 		{
-		vf_thumb_do(vf, vf->thumbs_filedata);
+		auto job = static_cast<ViewFileThumbJob *>(work->data);
+		if (job->tl == tl)
+			{
+			vf_thumb_job_finish(vf, job);
+			break;
+			}
 		}
 
-	while (vf_thumb_next(vf));
+	vf_thumb_fill(vf);
 }
 
 static void vf_thumb_error_cb(ThumbLoader *tl, gpointer data)
@@ -1985,48 +2139,97 @@ static void vf_thumb_done_cb(ThumbLoader *tl, gpointer data)
 
 static gboolean vf_thumb_next(ViewFile *vf)
 {
-	FileData *fd = nullptr;
-
 	if (!gtk_widget_get_realized(vf->listview))
 		{
 		vf_thumb_status(vf, 0.0, nullptr);
 		return FALSE;
 		}
 
-	switch (vf->type)
-	{
-	case FILEVIEW_LIST: fd = vflist_thumb_next_fd(vf); break;
-	case FILEVIEW_ICON: fd = vficon_thumb_next_fd(vf); break;
-	}
-
-	if (!fd)
-		{
-		/* done */
-		vf_thumb_cleanup(vf);
-		return FALSE;
-		}
-
-	vf->thumbs_filedata = fd;
-
-	thumb_loader_free(vf->thumbs_loader);
+	FileData *fd = vf_thumb_next_fd(vf);
+	if (!fd) return FALSE;
 
-	vf->thumbs_loader = thumb_loader_new(options->thumbnails.size.width, options->thumbnails.size.height);
-	thumb_loader_set_callbacks(vf->thumbs_loader,
+	auto job = g_new0(ViewFileThumbJob, 1);
+	job->fd = file_data_ref(fd);
+	job->tl = thumb_loader_new(options->thumbnails.size.width, options->thumbnails.size.height);
+	thumb_loader_set_callbacks(job->tl,
 				   vf_thumb_done_cb,
 				   vf_thumb_error_cb,
 				   nullptr,
 				   vf);
 
-	if (!thumb_loader_start(vf->thumbs_loader, fd))
+	vf->thumbs_jobs = g_list_prepend(vf->thumbs_jobs, job);
+
+	if (!thumb_loader_start(job->tl, fd))
 		{
 		/* set icon to unknown, continue */
 		DEBUG_1("thumb loader start failed %s", fd->path);
-		vf_thumb_do(vf, fd);
+		if (g_list_find(vf->thumbs_jobs, job)) vf_thumb_job_finish(vf, job);
+		}
+
+	return TRUE;
+}
 
-		return TRUE;
+/**
+ * @brief Starts loaders until the configured number of thumbs is being loaded
+ *
+ * The image loaders decode on the shared thread pool, so each loader in flight
+ * keeps one core busy.
+ */
+static void vf_thumb_fill(ViewFile *vf)
+{
+	if (!vf->thumbs_running) return;
+
+	const guint max_jobs = vf_thumb_max_jobs();
+
+	while (g_list_length(vf->thumbs_jobs) < max_jobs && vf_thumb_next(vf));
+
+	/* done, unless waiting for the view to be realized */
+	if (!vf->thumbs_jobs && !vf->thumbs_done && gtk_widget_get_realized(vf->listview))
+		{
+		vf_thumb_cleanup(vf);
 		}
+}
 
-	return FALSE;
+static gboolean vf_thumb_scroll_timeout_cb(gpointer data)
+{
+	auto vf = static_cast<ViewFile *>(data);
+
+	vf->thumbs_scroll_id = 0;
+
+	if (!vf->thumbs_running) return G_SOURCE_REMOVE;
+
+	/* loaders of rows scrolled out of view give way to visible rows */
+	if (vf_thumb_visible_wanted(vf))
+		{
+		if (!vf->thumbs_visible_start) vf->thumbs_visible_start = g_get_monotonic_time();
+
+		GList *work = vf->thumbs_jobs;
+		while (work)
+			{
+			auto job = static_cast<ViewFileThumbJob *>(work->data);
+			work = work->next;
+
+			if (vf_thumb_is_visible(vf, job->fd)) continue;
+
+			DEBUG_1("thumb cancelled, scrolled out of view %s", job->fd->path);
+			vf->thumbs_jobs = g_list_remove(vf->thumbs_jobs, job);
+			vf_thumb_job_free(job);
+			}
+		}
+
+	vf_thumb_fill(vf);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void vf_thumb_scroll_cb(GtkAdjustment *, gpointer data)
+{
+	auto vf = static_cast<ViewFile *>(data);
+
+	if (!vf->thumbs_running) return;
+
+	g_clear_handle_id(&vf->thumbs_scroll_id, g_source_remove);
+	vf->thumbs_scroll_id = g_timeout_add(THUMB_SCROLL_DELAY, vf_thumb_scroll_timeout_cb, vf);
 }
 
 static void vf_thumb_reset_all(ViewFile *vf)
@@ -2059,7 +2262,8 @@ void vf_thumb_update(ViewFile *vf)
 		thumb_format_changed = FALSE;
 		}
 
-	while (vf_thumb_next(vf));
+	vf->thumbs_visible_start = vf_thumb_visible_wanted(vf) ? g_get_monotonic_time() : 0;
+	vf_thumb_fill(vf);
 }
 
 void vf_star_cleanup(ViewFile *vf)
@@ -2357,13 +2561,16 @@ static gboolean vf_read_metadata_in_idle_cb(gpointer data)
 
 	vf_thumb_status(vf, vf_read_metadata_in_idle_progress(vf), _("Loading meta…"));
 
+	/* the file lists read the ratings they show themselves */
+	const gboolean read_rating = (vf->sort.method == SORT_RATING || options->read_metadata_in_idle);
+
 	work = vf->list;
 
 	while (work)
 		{
 		fd = static_cast<FileData *>(work->data);
 
-		if (fd && !fd->metadata_in_idle_loaded)
+		if (fd && (!fd->metadata_in_idle_loaded || (read_rating && fd->rating == STAR_RATING_NOT_READ)))
 			{
 			if (!fd->exifdate)
 				{
@@ -2373,7 +2580,7 @@ static gboolean vf_read_metadata_in_idle_cb(gpointer data)
 				{
 				read_exif_time_digitized_data(fd);
 				}
-			if (fd->rating == STAR_RATING_NOT_READ)
+			if (read_rating && fd->rating == STAR_RATING_NOT_READ)
 				{
 				read_rating_data(fd);
 				}
@@ -2397,19 +2604,217 @@ static void vf_read_metadata_in_idle_finished_cb(gpointer data)
 	vf->read_metadata_in_idle_id = 0;
 }
 
+/*
+ *-----------------------------------------------------------------------------
+ * Exif dates read ahead of the idle, from the file headers
+ *-----------------------------------------------------------------------------
+ */
+
+struct ViewFileMetadataJob;
+
+struct ViewFileMetadataEntry
+{
+	ViewFileMetadataJob *job;
+	FileData *fd;
+	ImageProbeExif exif;
+	gboolean found;
+};
+
+struct ViewFileMetadataJob
+{
+	ViewFile *vf;                   /**< nullptr once cancelled */
+	std::vector<ViewFileMetadataEntry> entries;
+	gint pending;                   /**< entries not yet read by a worker */
+	gint cancel;
+};
+
+static GThreadPool *vf_metadata_pool = nullptr;
+
+static void vf_read_metadata_job_free(ViewFileMetadataJob *job)
+{
+	for (ViewFileMetadataEntry &entry : job->entries) file_data_unref(entry.fd);
+	delete job;
+}
+
+/**
+ * @brief Detaches the job from the view, it is freed once the workers are done with it
+ */
+static void vf_read_metadata_cancel(ViewFile *vf)
+{
+	ViewFileMetadataJob *job = vf->read_metadata_job;
+	if (!job) return;
+
+	job->vf = nullptr;
+	g_atomic_int_set(&job->cancel, TRUE);
+	vf->read_metadata_job = nullptr;
+}
+
+static void vf_read_metadata_start_idle(ViewFile *vf)
+{
+	vf->read_metadata_in_idle_id = g_idle_add_full(G_PRIORITY_LOW, vf_read_metadata_in_idle_cb, vf, vf_read_metadata_in_idle_finished_cb);
+}
+
+static gboolean vf_read_metadata_done_cb(gpointer data)
+{
+	auto job = static_cast<ViewFileMetadataJob *>(data);
+	ViewFile *vf = job->vf;
+
+	if (vf)
+		{
+		for (const ViewFileMetadataEntry &entry : job->entries)
+			{
+			if (!entry.found || entry.fd->exifdate) continue;
+
+			entry.fd->exifdate = entry.exif.date_original;
+			entry.fd->exifdate_digitized = entry.exif.date_digitized;
+			}
+
+		vf->read_metadata_job = nullptr;
+
+		/* most dates are known now, the idle only has the rest to read */
+		if (vf->sort.method == SORT_EXIFTIME || vf->sort.method == SORT_EXIFTIMEDIGITIZED)
+			{
+			/* vf_sort_set() skips settings that are unchanged */
+			const FileData::FileList::SortSettings sort = vf->sort;
+			vf->sort.method = SORT_NONE;
+			vf_sort_set(vf, sort);
+			}
+
+		vf_read_metadata_start_idle(vf);
+		}
+
+	vf_read_metadata_job_free(job);
+
+	return G_SOURCE_REMOVE;
+}
+
+static void vf_read_metadata_worker(gpointer data, gpointer)
+{
+	auto entry = static_cast<ViewFileMetadataEntry *>(data);
+	ViewFileMetadataJob *job = entry->job;
+
+	/* a sidecar in the metadata cache may set other dates, exiv2 merges it */
+	if (!g_atomic_int_get(&job->cancel) && exif_dates_in_file_cached(entry->fd->path))
+		{
+		entry->found = image_probe_exif(entry->fd->path, entry->exif);
+		}
+
+	if (g_atomic_int_dec_and_test(&job->pending))
+		{
+		g_idle_add_full(G_PRIORITY_LOW, vf_read_metadata_done_cb, job, nullptr);
+		}
+}
+
+/**
+ * @brief Reads the Exif dates of the list on a pool of workers
+ * @returns FALSE if there is nothing for the workers to read
+ *
+ * The idle then only has the rating and the files the workers could not
+ * read left to do, with exiv2.
+ */
+static gboolean vf_read_metadata_queue(ViewFile *vf)
+{
+	auto job = new ViewFileMetadataJob{};
+	job->vf = vf;
+
+	for (GList *work = vf->list; work; work = work->next)
+		{
+		auto fd = static_cast<FileData *>(work->data);
+
+		if (fd->metadata_in_idle_loaded || fd->exifdate || !exif_dates_in_file_listed(fd)) continue;
+
+		job->entries.push_back({job, file_data_ref(fd), {}, FALSE});
+		}
+
+	if (job->entries.empty())
+		{
+		delete job;
+		return FALSE;
+		}
+
+	if (!vf_metadata_pool)
+		{
+		vf_metadata_pool = g_thread_pool_new(vf_read_metadata_worker, nullptr, get_cpu_cores(), FALSE, nullptr);
+		}
+
+	vf->read_metadata_job = job;
+	job->pending = job->entries.size();
+
+	/* the entries are not moved again, the workers point into them */
+	for (ViewFileMetadataEntry &entry : job->entries)
+		{
+		g_thread_pool_push(vf_metadata_pool, &entry, nullptr);
+		}
+
+	vf_thumb_status(vf, 0.0, _("Loading meta…"));
+
+	return TRUE;
+}
+
+#if HAVE_LUA
+/**
+ * @brief Sets the key of SORT_LUA, as a number when the value is one
+ */
+static void vf_lua_sort_value_set(FileData *fd, const gchar *value)
+{
+	g_free(fd->lua_sort_value);
+	fd->lua_sort_value = g_strstrip(g_strdup(value));
+
+	gchar *end;
+	const gdouble number = g_ascii_strtod(fd->lua_sort_value, &end);
+	fd->lua_sort_number = (end != fd->lua_sort_value && *end == '\0') ? number : NAN;
+}
+
+/**
+ * @brief Runs the Lua sort script over the list on the workers, then sorts the list again
+ *
+ * The script runs each time, it may read anything, so its values are
+ * never known to be current.
+ */
+static void vf_lua_sort_start(ViewFile *vf)
+{
+	lua_callvalue_list_cancel(vf->lua_sort_job);
+	vf->lua_sort_job = nullptr;
+
+	if (vf->sort.method != SORT_LUA || !options->file_sort.lua_script || !vf->list) return;
+
+	vf->lua_sort_job = lua_callvalue_list(vf->list, options->file_sort.lua_script,
+	                                      [vf](GList *list, const std::vector<const gchar *> &values)
+		{
+		gsize i = 0;
+		for (GList *work = list; work; work = work->next)
+			{
+			vf_lua_sort_value_set(static_cast<FileData *>(work->data), values[i++]);
+			}
+
+		vf->lua_sort_job = nullptr;
+
+		/* vf_sort_set() skips settings that are unchanged */
+		const FileData::FileList::SortSettings sort = vf->sort;
+		vf->sort.method = SORT_NONE;
+		vf_sort_set(vf, sort);
+		});
+}
+#endif
+
 void vf_read_metadata_in_idle(ViewFile *vf)
 {
 	if (!vf) return;
 
+#if HAVE_LUA
+	vf_lua_sort_start(vf);
+#endif
+
 	if (vf->read_metadata_in_idle_id)
 		{
 		g_idle_remove_by_data(vf);
 		}
 	vf->read_metadata_in_idle_id = 0;
+	vf_read_metadata_cancel(vf);
 
-	if (vf->list)
+	if (vf->list && !vf_read_metadata_queue(vf))
 		{
-		vf->read_metadata_in_idle_id = g_idle_add_full(G_PRIORITY_LOW, vf_read_metadata_in_idle_cb, vf, vf_read_metadata_in_idle_finished_cb);
+		vf_read_metadata_start_idle(vf);
 		}
 }
 
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for cache-meta-db.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <string>
+
+#include <glib.h>
+
+#include "cache-meta-db.h"
+#include "temp-dir-fixture.h"
+
+namespace {
+
+class CacheMetaDbTest : public TempDirTest
+{
+protected:
+	void SetUp() override
+	{
+		TempDirTest::SetUp();
+		path = path_of("metadata-index.db");
+	}
+
+	static CacheMetaEntry make_entry(gint seed)
+	{
+		CacheMetaEntry entry;
+		entry.mtime = 1000 + seed;
+		entry.size = 2000 + seed;
+		entry.keywords = {"holiday", "beach", std::to_string(seed)};
+		entry.comment = "comment " + std::to_string(seed);
+		entry.rating = seed % 6;
+		entry.date = 1600000000 + seed;
+		entry.camera = "Canon EOS R5";
+		entry.lens = "RF24-105mm F4 L IS USM";
+		entry.has_gps = (seed % 2) == 0;
+		entry.latitude = entry.has_gps ? 51.5 : 0.0;
+		entry.longitude = entry.has_gps ? -0.12 : 0.0;
+		entry.dimensions = {8192, 5464};
+
+		return entry;
+	}
+
+	std::string path;
+};
+
+TEST_F(CacheMetaDbTest, StoreAndLookup)
+{
+	CacheMetaDb db;
+	ASSERT_TRUE(db.open(path.c_str()));
+
+	const CacheMetaEntry in = make_entry(2);
+	ASSERT_TRUE(db.store("/images/a.jpg", in));
+
+	CacheMetaEntry out;
+	ASSERT_TRUE(db.lookup("/images/a.jpg", in.mtime, in.size, out));
+	ASSERT_EQ(out.keywords, in.keywords);
+	ASSERT_EQ(out.comment, in.comment);
+	ASSERT_EQ(out.rating, in.rating);
+	ASSERT_EQ(out.date, in.date);
+	ASSERT_EQ(out.camera, in.camera);
+	ASSERT_EQ(out.lens, in.lens);
+	ASSERT_TRUE(out.has_gps);
+	ASSERT_DOUBLE_EQ(out.latitude, in.latitude);
+	ASSERT_DOUBLE_EQ(out.longitude, in.longitude);
+	ASSERT_EQ(out.dimensions, in.dimensions);
+
+	CacheMetaEntry stale;
+	ASSERT_FALSE(db.lookup("/images/a.jpg", in.mtime + 1, in.size, stale));
+	ASSERT_FALSE(db.lookup("/images/a.jpg", in.mtime, in.size + 1, stale));
+	ASSERT_FALSE(db.lookup("/images/b.jpg", in.mtime, in.size, stale));
+
+	CacheMetaEntry empty;
+	empty.mtime = 5;
+	ASSERT_TRUE(db.store("/images/empty.jpg", empty));
+	ASSERT_TRUE(db.lookup("/images/empty.jpg", 5, 0, out));
+	ASSERT_TRUE(out.keywords.empty());
+	ASSERT_TRUE(out.comment.empty());
+	ASSERT_FALSE(out.has_gps);
+}
+
+TEST_F(CacheMetaDbTest, PersistsSupersedesAndRemoves)
+{
+	{
+	CacheMetaDb db;
+	ASSERT_TRUE(db.open(path.c_str()));
+	for (gint i = 0; i < 50; i++)
+		{
+		g_autofree gchar *source = g_strdup_printf("/images/%d.jpg", i);
+		ASSERT_TRUE(db.store(source, make_entry(i)));
+		}
+	ASSERT_TRUE(db.store("/images/7.jpg", make_entry(77)));
+	ASSERT_TRUE(db.remove("/images/8.jpg"));
+	ASSERT_TRUE(db.remove("/images/unknown.jpg"));
+	}
+
+	CacheMetaDb db;
+	ASSERT_TRUE(db.open(path.c_str()));
+	ASSERT_EQ(db.count(), 49u);
+	ASSERT_GT(db.dead_bytes(), 0u);
+
+	CacheMetaEntry out;
+	ASSERT_FALSE(db.lookup("/images/7.jpg", 1007, 2007, out));
+	ASSERT_TRUE(db.lookup("/images/7.jpg", 1077, 2077, out));
+	ASSERT_EQ(out.comment, "comment 77");
+	ASSERT_FALSE(db.lookup("/images/8.jpg", 1008, 2008, out));
+
+	const gsize before = file_size(path);
+	ASSERT_TRUE(db.compact(false));
+	ASSERT_EQ(db.count(), 49u);
+	ASSERT_EQ(db.dead_bytes(), 0u);
+	ASSERT_LT(file_size(path), before);
+
+	ASSERT_TRUE(db.lookup("/images/49.jpg", 1049, 2049, out));
+	ASSERT_EQ(out.keywords, make_entry(49).keywords);
+}
+
+TEST_F(CacheMetaDbTest, DamagedRecordIsDropped)
+{
+	{
+	CacheMetaDb db;
+	ASSERT_TRUE(db.open(path.c_str()));
+	ASSERT_TRUE(db.store("/images/a.jpg", make_entry(1)));
+	ASSERT_TRUE(db.store("/images/b.jpg", make_entry(2)));
+	}
+
+	/* corrupt the comment of the second record */
+	const gsize n = damage_file(path, "comment 2", 0);
+	ASSERT_GT(n, 0u);
+
+	CacheMetaDb db;
+	ASSERT_TRUE(db.open(path.c_str()));
+	ASSERT_EQ(db.count(), 1u);
+
+	CacheMetaEntry out;
+	ASSERT_TRUE(db.lookup("/images/a.jpg", 1001, 2001, out));
+	ASSERT_FALSE(db.lookup("/images/b.jpg", 1002, 2002, out));
+	ASSERT_LT(file_size(path), n);
+
+	ASSERT_TRUE(db.store("/images/b.jpg", make_entry(2)));
+	ASSERT_TRUE(db.lookup("/images/b.jpg", 1002, 2002, out));
+}
+
+} // namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
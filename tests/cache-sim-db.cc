@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for cache-sim-db.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <sys/stat.h>
+
+#include <memory>
+#include <string>
+
+#include <glib.h>
+
+#include "cache-sim-db.h"
+#include "cache.h"
+#include "similar.h"
+#include "temp-dir-fixture.h"
+
+namespace {
+
+class CacheSimDbTest : public TempDirTest
+{
+protected:
+	void SetUp() override
+	{
+		TempDirTest::SetUp();
+		path = path_of("similarity.db");
+	}
+
+	static CacheData make_data(guint8 seed)
+	{
+		CacheData cd;
+		cd.dimensions = GqSize{640 + seed, 480};
+		cd.date = 1000 + seed;
+
+		auto sd = std::make_unique<ImageSimilarityData>();
+		for (gsize i = 0; i < sd->avg_r.size(); i++)
+			{
+			sd->avg_r[i] = i + seed;
+			sd->avg_g[i] = i * 3 + seed;
+			sd->avg_b[i] = i * 7 + seed;
+			}
+		sd->filled = true;
+		cd.similarity = std::move(sd);
+
+		return cd;
+	}
+
+	std::string path;
+};
+
+TEST_F(CacheSimDbTest, StoreAndLookup)
+{
+	CacheSimDb db;
+	ASSERT_TRUE(db.open(path.c_str()));
+
+	const CacheData in = make_data(1);
+	ASSERT_TRUE(db.store("/images/a.jpg", 100, 2000, in));
+
+	CacheData out;
+	ASSERT_TRUE(db.lookup("/images/a.jpg", 100, 2000, out));
+	ASSERT_TRUE(out.dimensions);
+	ASSERT_EQ(out.dimensions->width, in.dimensions->width);
+	ASSERT_EQ(*out.date, *in.date);
+	ASSERT_FALSE(out.md5sum);
+	ASSERT_TRUE(out.similarity && out.similarity->filled);
+	ASSERT_EQ(out.similarity->avg_r, in.similarity->avg_r);
+	ASSERT_EQ(out.similarity->avg_g, in.similarity->avg_g);
+	ASSERT_EQ(out.similarity->avg_b, in.similarity->avg_b);
+
+	CacheData stale;
+	ASSERT_FALSE(db.lookup("/images/a.jpg", 101, 2000, stale));
+	ASSERT_FALSE(db.lookup("/images/a.jpg", 100, 2001, stale));
+	ASSERT_FALSE(db.lookup("/images/b.jpg", 100, 2000, stale));
+}
+
+TEST_F(CacheSimDbTest, PersistsAndSupersedes)
+{
+	{
+	CacheSimDb db;
+	ASSERT_TRUE(db.open(path.c_str()));
+	for (guint8 i = 0; i < 50; i++)
+		{
+		g_autofree gchar *source = g_strdup_printf("/images/%d.jpg", i);
+		ASSERT_TRUE(db.store(source, i, 10, make_data(i)));
+		}
+	ASSERT_TRUE(db.store("/images/7.jpg", 77, 10, make_data(77)));
+	}
+
+	CacheSimDb db;
+	ASSERT_TRUE(db.open(path.c_str()));
+	ASSERT_EQ(db.count(), 50u);
+	ASSERT_GT(db.dead_bytes(), 0u);
+
+	CacheData out;
+	ASSERT_FALSE(db.lookup("/images/7.jpg", 7, 10, out));
+	ASSERT_TRUE(db.lookup("/images/7.jpg", 77, 10, out));
+	ASSERT_EQ(*out.date, 1077);
+
+	ASSERT_TRUE(db.compact(false));
+	ASSERT_EQ(db.count(), 50u);
+	ASSERT_EQ(db.dead_bytes(), 0u);
+
+	CacheData again;
+	ASSERT_TRUE(db.lookup("/images/49.jpg", 49, 10, again));
+	ASSERT_EQ(again.similarity->avg_b, make_data(49).similarity->avg_b);
+
+	/* a store after compaction goes to the new file */
+	ASSERT_TRUE(db.store("/images/new.jpg", 1, 10, make_data(1)));
+	db.close();
+
+	ASSERT_TRUE(db.open(path.c_str()));
+	ASSERT_EQ(db.count(), 51u);
+	ASSERT_TRUE(db.lookup("/images/new.jpg", 1, 10, again));
+}
+
+TEST_F(CacheSimDbTest, CompactDropsChangedSources)
+{
+	const std::string source = write_file("a.jpg", "jpeg");
+	const std::string changed = write_file("b.jpg", "jpeg");
+	struct stat st;
+	ASSERT_EQ(stat(source.c_str(), &st), 0);
+
+	CacheSimDb db;
+	ASSERT_TRUE(db.open(path.c_str()));
+	ASSERT_TRUE(db.store(source.c_str(), st.st_mtime, st.st_size, make_data(1)));
+	ASSERT_TRUE(db.store(changed.c_str(), st.st_mtime, st.st_size + 1, make_data(2)));
+	ASSERT_TRUE(db.store(path_of("missing.jpg").c_str(), st.st_mtime, st.st_size, make_data(3)));
+
+	ASSERT_TRUE(db.compact(true));
+	ASSERT_EQ(db.count(), 1u);
+
+	CacheData out;
+	ASSERT_TRUE(db.lookup(source.c_str(), st.st_mtime, st.st_size, out));
+}
+
+TEST_F(CacheSimDbTest, DamagedRecordIsDropped)
+{
+	{
+	CacheSimDb db;
+	ASSERT_TRUE(db.open(path.c_str()));
+	ASSERT_TRUE(db.store("/images/a.jpg", 1, 1, make_data(1)));
+	ASSERT_TRUE(db.store("/images/b.jpg", 2, 2, make_data(2)));
+	}
+
+	/* corrupt the grid of the second record */
+	ASSERT_GT(damage_file(path, "/images/a.jpg", 16 + 200), 0u);
+
+	CacheSimDb db;
+	ASSERT_TRUE(db.open(path.c_str()));
+	ASSERT_EQ(db.count(), 1u);
+
+	CacheData out;
+	ASSERT_TRUE(db.lookup("/images/a.jpg", 1, 1, out));
+	ASSERT_FALSE(db.lookup("/images/b.jpg", 2, 2, out));
+
+	ASSERT_TRUE(db.store("/images/b.jpg", 2, 2, make_data(2)));
+	ASSERT_TRUE(db.lookup("/images/b.jpg", 2, 2, out));
+	ASSERT_GT(file_size(path), 0u);
+}
+
+} // namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
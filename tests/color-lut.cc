@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for color-lut.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <config.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <glib.h>
+
+#include "color-lut.h"
+
+#if HAVE_LCMS
+#include <lcms2.h>
+#endif
+
+namespace {
+
+std::vector<guchar> random_pixels(gint count, gint channels)
+{
+	std::vector<guchar> pixels(static_cast<gsize>(count) * channels);
+	GRand *rand = g_rand_new_with_seed(42);
+
+	for (guchar &value : pixels)
+		{
+		value = g_rand_int_range(rand, 0, 256);
+		}
+
+	g_rand_free(rand);
+	return pixels;
+}
+
+TEST(ColorLutTest, IdentityIsExact)
+{
+	ColorLut lut;
+	ASSERT_FALSE(lut.is_valid());
+
+	lut.build([](const guint16 *in, guint16 *out, gint count)
+	{
+		std::copy(in, in + (count * 3), out);
+	});
+	ASSERT_TRUE(lut.is_valid());
+
+	std::vector<guchar> pixels = random_pixels(4096, 4);
+	const std::vector<guchar> expected = pixels;
+
+	lut.apply(pixels.data(), 4096, 4);
+	ASSERT_EQ(pixels, expected);
+}
+
+TEST(ColorLutTest, SaveAndLoad)
+{
+	ColorLut lut;
+	lut.build([](const guint16 *in, guint16 *out, gint count)
+	{
+		for (gint i = 0; i < count * 3; i++) out[i] = 65535 - in[i];
+	});
+
+	g_autofree gchar *path = g_build_filename(g_get_tmp_dir(), "geeqie-color-lut-test.lut", NULL);
+	ASSERT_TRUE(lut.save(path));
+
+	ColorLut loaded;
+	ASSERT_TRUE(loaded.load(path));
+	remove(path);
+
+	guchar pixel[3] = {10, 128, 250};
+	loaded.apply(pixel, 1, 3);
+	ASSERT_EQ(pixel[0], 245);
+	ASSERT_EQ(pixel[1], 127);
+	ASSERT_EQ(pixel[2], 5);
+
+	ColorLut missing;
+	ASSERT_FALSE(missing.load(path));
+}
+
+/* A row goes through the vector code where there is one, a single pixel
+ * through the scalar code.
+ */
+TEST(ColorLutTest, RowMatchesSinglePixels)
+{
+	ColorLut lut;
+	lut.build([](const guint16 *in, guint16 *out, gint count)
+	{
+		for (gint i = 0; i < count; i++)
+			{
+			out[(i * 3) + 0] = (in[(i * 3) + 0] / 2) + (in[(i * 3) + 1] / 2);
+			out[(i * 3) + 1] = in[(i * 3) + 1] * static_cast<guint32>(in[(i * 3) + 1]) / 65535;
+			out[(i * 3) + 2] = 65535 - in[(i * 3) + 2];
+			}
+	});
+
+	for (const gint channels : {3, 4})
+		{
+		constexpr gint width = 1003;
+
+		std::vector<guchar> row = random_pixels(width, channels);
+		std::vector<guchar> single = row;
+
+		lut.apply(row.data(), width, channels);
+		for (gint x = 0; x < width; x++)
+			{
+			lut.apply(single.data() + (x * channels), 1, channels);
+			}
+
+		ASSERT_EQ(row, single) << "channels = " << channels;
+		}
+}
+
+#if HAVE_LCMS
+/* sRGB to a wide gamut profile, with the table made from the 16 bit transform */
+struct WideGamutTransform
+{
+	WideGamutTransform()
+	{
+		srgb = cmsCreate_sRGBProfile();
+
+		const cmsCIExyY white{0.3127, 0.3290, 1.0};
+		const cmsCIExyYTRIPLE primaries{{0.708, 0.292, 1.0}, {0.170, 0.797, 1.0}, {0.131, 0.046, 1.0}};
+		cmsToneCurve *gamma = cmsBuildGamma(nullptr, 2.2);
+		cmsToneCurve *curves[3] = {gamma, gamma, gamma};
+		wide = cmsCreateRGBProfile(&white, &primaries, curves);
+		cmsFreeToneCurve(gamma);
+
+		transform_8 = cmsCreateTransform(srgb, TYPE_RGB_8, wide, TYPE_RGB_8, INTENT_PERCEPTUAL, 0);
+		transform_16 = cmsCreateTransform(srgb, TYPE_RGB_16, wide, TYPE_RGB_16, INTENT_PERCEPTUAL, 0);
+
+		if (transform_16)
+			{
+			lut.build([this](const guint16 *in, guint16 *out, gint n)
+			{
+				cmsDoTransform(transform_16, in, out, n);
+			});
+			}
+	}
+
+	~WideGamutTransform()
+	{
+		if (transform_16) cmsDeleteTransform(transform_16);
+		if (transform_8) cmsDeleteTransform(transform_8);
+		cmsCloseProfile(wide);
+		cmsCloseProfile(srgb);
+	}
+
+	/* Mean and maximum CIE76 difference of two images in the wide gamut profile */
+	void delta_e(const std::vector<guchar> &a, const std::vector<guchar> &b, gdouble &mean, gdouble &max) const
+	{
+		const gint count = a.size() / 3;
+
+		cmsHPROFILE lab = cmsCreateLab4Profile(nullptr);
+		cmsHTRANSFORM to_lab = cmsCreateTransform(wide, TYPE_RGB_8, lab, TYPE_Lab_DBL, INTENT_RELATIVE_COLORIMETRIC, 0);
+		std::vector<cmsCIELab> lab_a(count);
+		std::vector<cmsCIELab> lab_b(count);
+		cmsDoTransform(to_lab, a.data(), lab_a.data(), count);
+		cmsDoTransform(to_lab, b.data(), lab_b.data(), count);
+
+		gdouble sum = 0.0;
+		max = 0.0;
+		for (gint i = 0; i < count; i++)
+			{
+			const gdouble delta = cmsDeltaE(&lab_a[i], &lab_b[i]);
+			sum += delta;
+			max = std::max(max, delta);
+			}
+		mean = sum / count;
+
+		cmsDeleteTransform(to_lab);
+		cmsCloseProfile(lab);
+	}
+
+	cmsHPROFILE srgb;
+	cmsHPROFILE wide;
+	cmsHTRANSFORM transform_8;
+	cmsHTRANSFORM transform_16;
+	ColorLut lut;
+};
+
+/* Compares the table with the transform it was made from. */
+TEST(ColorLutTest, MatchesLcms)
+{
+	constexpr gint count = 1 << 20;
+
+	const WideGamutTransform transform;
+	ASSERT_NE(transform.transform_8, nullptr);
+	ASSERT_NE(transform.transform_16, nullptr);
+
+	const std::vector<guchar> source = random_pixels(count, 3);
+	std::vector<guchar> by_lcms = source;
+	std::vector<guchar> by_lut = source;
+
+	cmsDoTransform(transform.transform_8, by_lcms.data(), by_lcms.data(), count);
+	transform.lut.apply(by_lut.data(), count, 3);
+
+	gdouble mean;
+	gdouble max;
+	transform.delta_e(by_lcms, by_lut, mean, max);
+
+	ASSERT_LT(mean, 0.5);
+	ASSERT_LT(max, 3.0);
+}
+
+/* Prints the speed of both and the difference between them. Not run by
+ * default, run with --gtest_also_run_disabled_tests --gtest_filter='*Benchmark*'
+ */
+TEST(ColorLutTest, DISABLED_Benchmark)
+{
+	constexpr gint count = 1 << 22;
+	constexpr gint rounds = 5;
+
+	const WideGamutTransform transform;
+	ASSERT_NE(transform.transform_8, nullptr);
+	ASSERT_NE(transform.transform_16, nullptr);
+
+	const std::vector<guchar> source = random_pixels(count, 3);
+	std::vector<guchar> by_lcms;
+	std::vector<guchar> by_lut;
+	gint64 lcms_time = G_MAXINT64;
+	gint64 lut_time = G_MAXINT64;
+
+	/* the best of several rounds, the first one also pays for page faults */
+	for (gint round = 0; round < rounds; round++)
+		{
+		by_lcms = source;
+		gint64 start = g_get_monotonic_time();
+		cmsDoTransform(transform.transform_8, by_lcms.data(), by_lcms.data(), count);
+		lcms_time = std::min(lcms_time, g_get_monotonic_time() - start);
+
+		by_lut = source;
+		start = g_get_monotonic_time();
+		transform.lut.apply(by_lut.data(), count, 3);
+		lut_time = std::min(lut_time, g_get_monotonic_time() - start);
+		}
+
+	gdouble mean;
+	gdouble max;
+	transform.delta_e(by_lcms, by_lut, mean, max);
+
+	printf("lcms: %.1f Mpix/s\n", static_cast<gdouble>(count) / std::max<gint64>(lcms_time, 1));
+	printf("lut:  %.1f Mpix/s\n", static_cast<gdouble>(count) / std::max<gint64>(lut_time, 1));
+	printf("delta E: mean %.3f, max %.3f\n", mean, max);
+}
+#endif
+
+} // namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
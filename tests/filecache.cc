@@ -24,6 +24,9 @@
 
 #include "gtest/gtest.h"
 
+#include <memory>
+#include <vector>
+
 #include <glib.h>
 
 #include "filecache.h"
@@ -174,6 +177,46 @@ TEST_F(FileCacheTest, ReentrantNotifyPutGet)
 	ASSERT_EQ(1, cache_and_fds.trigger_count);
 }
 
+std::vector<FileData *> released_fds;
+
+void record_release(FileData *fd)
+{
+	released_fds.push_back(fd);
+}
+
+/**
+ * Ensures that eviction prefers cheap entries over ones that are expensive to recreate.
+ **/
+TEST_F(FileCacheTest, CostAwareEviction)
+{
+	fd = FileData::new_simple("/does/not/exist.jpg", &context);
+	fd2 = FileData::new_simple("/does/not/exist2.jpg", &context);
+	FileDataRef fd3 = FileData::new_simple("/does/not/exist3.jpg", &context);
+	std::unique_ptr<FileCache> cache(file_cache_new(&record_release, /*max_size=*/2, "test"));
+	FileCache *fc = cache.get();
+	const FileCache::CostClass cost_class = FileCache::register_cost_class("test", 10.0);
+
+	released_fds.clear();
+	file_cache_put_with_cost(fc, fd, /*size=*/1, cost_class, /*cost=*/100.0);
+	file_cache_put_with_cost(fc, fd2, /*size=*/1, cost_class, /*cost=*/1.0);
+	ASSERT_TRUE(released_fds.empty());
+
+	// fd2 is the cheapest to recreate, so it goes first even though fd is older.
+	file_cache_put_with_cost(fc, fd3, /*size=*/1, cost_class);
+	ASSERT_EQ(1u, released_fds.size());
+	ASSERT_EQ(static_cast<FileData *>(fd2), released_fds[0]);
+
+	const FileCache::Stats stats = fc->get_stats();
+	ASSERT_EQ(1u, stats.evictions);
+	ASSERT_EQ(2u, stats.size);
+	ASSERT_EQ(2u, stats.count);
+
+	// Shrinking evicts the rest, most recently used last.
+	file_cache_set_max_size(fc, 0);
+	ASSERT_EQ(3u, released_fds.size());
+	ASSERT_EQ(static_cast<FileData *>(fd3), released_fds[2]);
+}
+
 }  // anonymous namespace
 
 /* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
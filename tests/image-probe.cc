@@ -0,0 +1,323 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for image-probe.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <glib.h>
+
+#include "image-probe.h"
+#include "temp-dir-fixture.h"
+
+namespace {
+
+using Bytes = std::vector<guchar>;
+
+void append_be16(Bytes &data, guint value)
+{
+	data.push_back(value >> 8);
+	data.push_back(value & 0xff);
+}
+
+void append_be32(Bytes &data, guint32 value)
+{
+	append_be16(data, value >> 16);
+	append_be16(data, value & 0xffff);
+}
+
+void append_le16(Bytes &data, guint value)
+{
+	data.push_back(value & 0xff);
+	data.push_back(value >> 8);
+}
+
+void append_le32(Bytes &data, guint32 value)
+{
+	append_le16(data, value & 0xffff);
+	append_le16(data, value >> 16);
+}
+
+void append_text(Bytes &data, const gchar *text)
+{
+	data.insert(data.end(), text, text + strlen(text));
+}
+
+Bytes jpeg(guint width, guint height, guchar sof = 0xC0)
+{
+	Bytes data{0xFF, 0xD8, 0xFF, 0xE0};
+	append_be16(data, 16);
+	append_text(data, "JFIF");
+	data.resize(data.size() + 10, 0);
+
+	data.push_back(0xFF);
+	data.push_back(sof);
+	append_be16(data, 11);
+	data.push_back(8);
+	append_be16(data, height);
+	append_be16(data, width);
+	data.insert(data.end(), {1, 1, 0x11, 0});
+
+	data.insert(data.end(), {0xFF, 0xD9});
+	return data;
+}
+
+Bytes box(const gchar *type, const Bytes &payload)
+{
+	Bytes data;
+	append_be32(data, 8 + payload.size());
+	append_text(data, type);
+	data.insert(data.end(), payload.begin(), payload.end());
+	return data;
+}
+
+Bytes full_box(const gchar *type, Bytes payload)
+{
+	payload.insert(payload.begin(), 4, 0);
+	return box(type, payload);
+}
+
+Bytes operator+(Bytes a, const Bytes &b)
+{
+	a.insert(a.end(), b.begin(), b.end());
+	return a;
+}
+
+void append_tiff_entry(Bytes &data, guint tag, guint type, guint32 value, guint32 count = 1)
+{
+	append_le16(data, tag);
+	append_le16(data, type);
+	append_le32(data, count);
+	append_le32(data, value);
+}
+
+/* IFD0 pointing to an Exif IFD with both dates */
+Bytes exif_tiff(const gchar *original, const gchar *digitized)
+{
+	constexpr guint32 ifd0 = 8;
+	constexpr guint32 exif_ifd = ifd0 + 2 + 12 + 4;
+	constexpr guint32 dates = exif_ifd + 2 + (2 * 12) + 4;
+
+	Bytes tiff{'I', 'I', 42, 0};
+	append_le32(tiff, ifd0);
+
+	append_le16(tiff, 1);
+	append_tiff_entry(tiff, 0x8769, 4, exif_ifd);
+	append_le32(tiff, 0);
+
+	append_le16(tiff, 2);
+	append_tiff_entry(tiff, 0x9003, 2, dates, 20);
+	append_tiff_entry(tiff, 0x9004, 2, dates + 20, 20);
+	append_le32(tiff, 0);
+
+	append_text(tiff, original);
+	tiff.push_back(0);
+	append_text(tiff, digitized);
+	tiff.push_back(0);
+
+	return tiff;
+}
+
+time_t local_time(gint year, gint month, gint day, gint hour, gint minute, gint second)
+{
+	std::tm tm{};
+	tm.tm_year = year - 1900;
+	tm.tm_mon = month - 1;
+	tm.tm_mday = day;
+	tm.tm_hour = hour;
+	tm.tm_min = minute;
+	tm.tm_sec = second;
+	tm.tm_isdst = -1;
+	return mktime(&tm);
+}
+
+class ImageProbeTest : public TempDirTest
+{
+protected:
+	GqSize probe(const gchar *name, const Bytes &contents)
+	{
+		const std::string path = write_file(name, contents.data(), contents.size());
+
+		GqSize dimensions{0, 0};
+		if (!image_probe_dimensions(path.c_str(), dimensions)) return {0, 0};
+		return dimensions;
+	}
+
+	gboolean probe_exif(const gchar *name, const Bytes &contents, ImageProbeExif &exif)
+	{
+		const std::string path = write_file(name, contents.data(), contents.size());
+
+		return image_probe_exif(path.c_str(), exif);
+	}
+};
+
+TEST_F(ImageProbeTest, Jpeg)
+{
+	ASSERT_EQ(probe("a.jpg", jpeg(640, 480)), (GqSize{640, 480}));
+	ASSERT_EQ(probe("progressive.jpg", jpeg(320, 200, 0xC2)), (GqSize{320, 200}));
+	ASSERT_TRUE(probe("lossless.jpg", jpeg(320, 200, 0xC3)).empty());
+
+	Bytes truncated = jpeg(640, 480);
+	truncated.resize(20);
+	ASSERT_TRUE(probe("truncated.jpg", truncated).empty());
+}
+
+TEST_F(ImageProbeTest, PngAndWebp)
+{
+	Bytes png{0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+	append_be32(png, 13);
+	append_text(png, "IHDR");
+	append_be32(png, 1920);
+	append_be32(png, 1080);
+	png.resize(png.size() + 9, 0);
+	ASSERT_EQ(probe("a.png", png), (GqSize{1920, 1080}));
+
+	Bytes webp;
+	append_text(webp, "RIFF");
+	append_le32(webp, 30);
+	append_text(webp, "WEBPVP8X");
+	append_le32(webp, 10);
+	append_le32(webp, 0);
+	webp.insert(webp.end(), {0x7f, 0x0c, 0x00, 0xff, 0x0f, 0x00}); /* 3200 - 1, 4096 - 1 */
+	ASSERT_EQ(probe("a.webp", webp), (GqSize{3200, 4096}));
+}
+
+TEST_F(ImageProbeTest, HeifPrimaryItemRotated)
+{
+	Bytes other_ispe{};
+	append_be32(other_ispe, 512);
+	append_be32(other_ispe, 512);
+	Bytes ispe{};
+	append_be32(ispe, 4032);
+	append_be32(ispe, 3024);
+
+	const Bytes ipco = box("ipco", full_box("ispe", other_ispe) + full_box("ispe", ispe) + box("irot", {1}));
+
+	/* item 1 has property 1, item 2 has properties 2 and 3 */
+	Bytes associations;
+	append_be32(associations, 2);
+	append_be16(associations, 1);
+	associations.insert(associations.end(), {1, 0x81});
+	append_be16(associations, 2);
+	associations.insert(associations.end(), {2, 0x82, 0x03});
+
+	Bytes pitm;
+	append_be16(pitm, 2);
+
+	const Bytes meta = full_box("meta", full_box("pitm", pitm) + box("iprp", ipco + full_box("ipma", associations)));
+
+	Bytes brands;
+	append_text(brands, "heic");
+	append_be32(brands, 0);
+	append_text(brands, "mif1heic");
+
+	ASSERT_EQ(probe("a.heic", box("ftyp", brands) + meta + box("mdat", Bytes(64, 0))), (GqSize{3024, 4032}));
+}
+
+TEST_F(ImageProbeTest, TiffAndRaw)
+{
+	const Bytes thumbnail = jpeg(160, 120);
+	const Bytes preview = jpeg(6000, 4000);
+
+	/* IFD0 with a thumbnail, and a sub IFD with a larger preview */
+	constexpr guint32 ifd0 = 8;
+	constexpr guint32 sub_ifd = ifd0 + 2 + (5 * 12) + 4;
+	constexpr guint32 thumbnail_offset = sub_ifd + 2 + (4 * 12) + 4;
+	const guint32 preview_offset = thumbnail_offset + thumbnail.size();
+
+	Bytes tiff{'I', 'I', 42, 0};
+	append_le32(tiff, ifd0);
+
+	append_le16(tiff, 5);
+	append_tiff_entry(tiff, 256, 3, 160);
+	append_tiff_entry(tiff, 257, 3, 120);
+	append_tiff_entry(tiff, 330, 4, sub_ifd);
+	append_tiff_entry(tiff, 513, 4, thumbnail_offset);
+	append_tiff_entry(tiff, 514, 4, thumbnail.size());
+	append_le32(tiff, 0);
+
+	append_le16(tiff, 4);
+	append_tiff_entry(tiff, 256, 4, 6000);
+	append_tiff_entry(tiff, 257, 4, 4000);
+	append_tiff_entry(tiff, 259, 3, 6);
+	append_tiff_entry(tiff, 273, 4, preview_offset);
+	append_le32(tiff, 0);
+
+	tiff = tiff + thumbnail + preview;
+
+	ASSERT_EQ(probe("a.tif", tiff), (GqSize{160, 120}));
+	ASSERT_EQ(probe("a.nef", tiff), (GqSize{6000, 4000}));
+}
+
+TEST_F(ImageProbeTest, ExifDates)
+{
+	const Bytes tiff = exif_tiff("2024:06:01 12:30:15", "2024:06:02 08:00:00");
+
+	ImageProbeExif exif;
+	ASSERT_TRUE(probe_exif("a.tif", tiff, exif));
+	ASSERT_EQ(exif.date_original, local_time(2024, 6, 1, 12, 30, 15));
+	ASSERT_EQ(exif.date_digitized, local_time(2024, 6, 2, 8, 0, 0));
+
+	/* the same Exif data in the APP1 segment of a JPEG */
+	Bytes app1;
+	app1.insert(app1.end(), {0xFF, 0xD8, 0xFF, 0xE1});
+	append_be16(app1, 2 + 6 + tiff.size());
+	app1.insert(app1.end(), {'E', 'x', 'i', 'f', 0, 0});
+	const Bytes image = jpeg(640, 480);
+	const Bytes with_exif = app1 + tiff + Bytes(image.begin() + 2, image.end());
+
+	ImageProbeExif from_jpeg;
+	ASSERT_TRUE(probe_exif("a.jpg", with_exif, from_jpeg));
+	ASSERT_EQ(from_jpeg.date_original, exif.date_original);
+	ASSERT_EQ(from_jpeg.date_digitized, exif.date_digitized);
+
+	/* a blank date, as some cameras write it */
+	ImageProbeExif blank;
+	ASSERT_TRUE(probe_exif("blank.tif", exif_tiff("    :  :     :  :  ", "2024:06:02 08:00:00"), blank));
+	ASSERT_EQ(blank.date_original, 0);
+	ASSERT_EQ(blank.date_digitized, exif.date_digitized);
+
+	/* no Exif segment, or a damaged one, is left to exiv2 */
+	ImageProbeExif none;
+	ASSERT_FALSE(probe_exif("plain.jpg", jpeg(640, 480), none));
+
+	Bytes truncated = with_exif;
+	truncated.resize(30);
+	ASSERT_FALSE(probe_exif("truncated.jpg", truncated, none));
+}
+
+TEST_F(ImageProbeTest, UnknownFormat)
+{
+	Bytes gif;
+	append_text(gif, "GIF89a");
+	gif.resize(64, 0);
+	ASSERT_TRUE(probe("a.gif", gif).empty());
+
+	GqSize dimensions{0, 0};
+	ASSERT_FALSE(image_probe_dimensions("/nonexistent/a.jpg", dimensions));
+}
+
+} // namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for md5-util.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <string>
+
+#include <glib.h>
+
+#include "md5-util.h"
+#include "temp-dir-fixture.h"
+
+namespace {
+
+constexpr gsize BLOCK_SIZE = 1024;
+
+using Md5UtilTest = TempDirTest;
+
+TEST_F(Md5UtilTest, SmallFileIsHashedInFull)
+{
+	const std::string path = write_file("small", std::string((2 * BLOCK_SIZE) - 1, 'a') + "b");
+
+	Md5Digest full;
+	Md5Digest partial;
+	ASSERT_TRUE(md5_get_digest_from_file(path.c_str(), full));
+	ASSERT_TRUE(md5_get_partial_digest_from_file(path.c_str(), BLOCK_SIZE, partial));
+	ASSERT_EQ(full, partial);
+}
+
+TEST_F(Md5UtilTest, PartialReadsBothEnds)
+{
+	const std::string middle_a = std::string(BLOCK_SIZE, 'h') + std::string(BLOCK_SIZE, 'a') + std::string(BLOCK_SIZE, 't');
+	const std::string middle_b = std::string(BLOCK_SIZE, 'h') + std::string(BLOCK_SIZE, 'b') + std::string(BLOCK_SIZE, 't');
+	const std::string tail = std::string(BLOCK_SIZE, 'h') + std::string(BLOCK_SIZE, 'a') + std::string(BLOCK_SIZE, 'x');
+
+	Md5Digest a;
+	Md5Digest b;
+	Md5Digest c;
+	ASSERT_TRUE(md5_get_partial_digest_from_file(write_file("a", middle_a).c_str(), BLOCK_SIZE, a));
+	ASSERT_TRUE(md5_get_partial_digest_from_file(write_file("b", middle_b).c_str(), BLOCK_SIZE, b));
+	ASSERT_TRUE(md5_get_partial_digest_from_file(write_file("c", tail).c_str(), BLOCK_SIZE, c));
+
+	ASSERT_EQ(a, b);
+	ASSERT_NE(a, c);
+
+	Md5Digest full_a;
+	Md5Digest full_b;
+	ASSERT_TRUE(md5_get_digest_from_file(path_of("a").c_str(), full_a));
+	ASSERT_TRUE(md5_get_digest_from_file(path_of("b").c_str(), full_b));
+	ASSERT_NE(full_a, full_b);
+}
+
+TEST_F(Md5UtilTest, CancelAndMissingFile)
+{
+	const std::string path = write_file("file", std::string(BLOCK_SIZE, 'a'));
+
+	Md5Digest digest;
+	const gint cancel = TRUE;
+	ASSERT_FALSE(md5_get_digest_from_file(path.c_str(), digest, &cancel));
+
+	const std::string missing = path_of("missing");
+	ASSERT_FALSE(md5_get_digest_from_file(missing.c_str(), digest));
+	ASSERT_FALSE(md5_get_partial_digest_from_file(missing.c_str(), BLOCK_SIZE, digest));
+}
+
+} // namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,364 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for similar.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <set>
+#include <vector>
+
+#include <glib.h>
+
+#include "similar.h"
+
+namespace {
+
+std::vector<guint8> random_bytes(std::mt19937 &rng, gsize n)
+{
+	std::vector<guint8> bytes(n);
+
+	for (guint8 &b : bytes)
+		{
+		b = rng() & 0xff;
+		}
+
+	return bytes;
+}
+
+TEST(ImageSimSad, MatchesScalarForAllLengthsAndAlignments)
+{
+	std::mt19937 rng(42);
+
+	SCOPED_TRACE(image_sim_sad_implementation());
+
+	for (gsize n = 0; n <= 200; n++)
+		{
+		const std::vector<guint8> a = random_bytes(rng, n + 31);
+		const std::vector<guint8> b = random_bytes(rng, n + 31);
+
+		for (gsize offset = 0; offset < 32; offset += 7)
+			{
+			ASSERT_EQ(image_sim_sad_scalar(a.data() + offset, b.data() + (31 - offset), n),
+			          image_sim_sad(a.data() + offset, b.data() + (31 - offset), n))
+			    << "n = " << n << " offset = " << offset;
+			}
+		}
+}
+
+TEST(ImageSimSad, HandlesExtremeValues)
+{
+	const std::vector<guint8> black(1024, 0);
+	const std::vector<guint8> white(1024, 255);
+
+	EXPECT_EQ(255u * 1024u, image_sim_sad(black.data(), white.data(), 1024));
+	EXPECT_EQ(255u * 1024u, image_sim_sad(white.data(), black.data(), 1024));
+	EXPECT_EQ(0u, image_sim_sad(white.data(), white.data(), 1024));
+}
+
+/**
+ * Checks the kernel against the per grid cell sum that image_sim_compare_fast()
+ * computed before it was vectorized.
+ **/
+TEST(ImageSimSad, BitExactWithPerCellSum)
+{
+	std::mt19937 rng(7);
+
+	for (gint iteration = 0; iteration < 100; iteration++)
+		{
+		ImageSimilarityData a{};
+		ImageSimilarityData b{};
+
+		for (gsize i = 0; i < a.avg_r.size(); i++)
+			{
+			a.avg_r[i] = rng() & 0xff;
+			a.avg_g[i] = rng() & 0xff;
+			a.avg_b[i] = rng() & 0xff;
+			b.avg_r[i] = rng() & 0xff;
+			b.avg_g[i] = rng() & 0xff;
+			b.avg_b[i] = rng() & 0xff;
+			}
+
+		gint expected = 0;
+		for (gint j1 = 0; j1 < 32; j1++)
+			{
+			for (gint i1 = 0; i1 < 32; i1++)
+				{
+				expected += abs(a.avg_r[(i1*32)+j1] - b.avg_r[(i1*32)+j1]);
+				expected += abs(a.avg_g[(i1*32)+j1] - b.avg_g[(i1*32)+j1]);
+				expected += abs(a.avg_b[(i1*32)+j1] - b.avg_b[(i1*32)+j1]);
+				}
+			}
+
+		const guint32 sum = image_sim_sad(a.avg_r.data(), b.avg_r.data(), a.avg_r.size())
+		                  + image_sim_sad(a.avg_g.data(), b.avg_g.data(), a.avg_g.size())
+		                  + image_sim_sad(a.avg_b.data(), b.avg_b.data(), a.avg_b.size());
+
+		ASSERT_EQ(static_cast<guint32>(expected), sum);
+		}
+}
+
+/**
+ * Near copies of a few random base images, so that the index has clusters to find.
+ **/
+ImageSimilarityStore make_clustered_store(std::mt19937 &rng, std::vector<ImageSimilarityData> &data, bool prefilter = false)
+{
+	ImageSimilarityStore store(prefilter);
+
+	for (gint n = 0; n < 400; n++)
+		{
+		ImageSimilarityData sd{};
+		sd.filled = true;
+
+		if (n % 4 != 0)
+			{
+			sd = data[rng() % data.size()];
+			for (guint8 &p : sd.avg_g)
+				{
+				p = std::min<gint>(255, p + (rng() % 12));
+				}
+			}
+		else
+			{
+			for (gsize i = 0; i < sd.avg_r.size(); i++)
+				{
+				sd.avg_r[i] = rng() & 0xff;
+				sd.avg_g[i] = rng() & 0xff;
+				sd.avg_b[i] = rng() & 0xff;
+				}
+			}
+
+		data.push_back(sd);
+		store.append(&sd);
+		}
+
+	return store;
+}
+
+guint32 full_distance(const ImageSimilarityData &a, const ImageSimilarityData &b)
+{
+	return image_sim_sad_scalar(a.avg_r.data(), b.avg_r.data(), a.avg_r.size())
+	     + image_sim_sad_scalar(a.avg_g.data(), b.avg_g.data(), a.avg_g.size())
+	     + image_sim_sad_scalar(a.avg_b.data(), b.avg_b.data(), a.avg_b.size());
+}
+
+TEST(ImageSimilarityStore, CoarseDistanceIsLowerBound)
+{
+	std::mt19937 rng(11);
+	std::vector<ImageSimilarityData> data;
+	const ImageSimilarityStore store = make_clustered_store(rng, data);
+
+	for (gsize a = 0; a < data.size(); a += 3)
+		{
+		for (gsize b = 0; b < data.size(); b += 5)
+			{
+			ASSERT_LE(store.coarse_distance(a, b), full_distance(data[a], data[b]));
+			}
+		}
+}
+
+/**
+ * The index must return every entry within the radius, i.e. a recall of 1.
+ **/
+TEST(ImageSimilarityStore, IndexQueryHasFullRecall)
+{
+	std::mt19937 rng(5);
+	std::vector<ImageSimilarityData> data;
+	ImageSimilarityStore store = make_clustered_store(rng, data);
+	store.index_build(0, store.size());
+	ASSERT_TRUE(store.index_built());
+
+	std::vector<guint> candidates;
+
+	for (const guint32 radius : {0u, 5000u, 20000u, 60000u})
+		{
+		gsize total_candidates = 0;
+
+		for (gsize needle = 0; needle < data.size(); needle++)
+			{
+			store.index_query_radius(needle, radius, 1, candidates);
+			total_candidates += candidates.size();
+
+			for (gsize n = 0; n < data.size(); n++)
+				{
+				const bool found = std::binary_search(candidates.cbegin(), candidates.cend(), n);
+
+				ASSERT_EQ(store.coarse_distance(n, needle) <= radius, found)
+				    << "needle = " << needle << " n = " << n << " radius = " << radius;
+				ASSERT_TRUE(found || full_distance(data[n], data[needle]) > radius);
+				}
+			}
+
+		/* within the spread of a cluster the index has to prune most entries */
+		if (radius <= 20000)
+			{
+			EXPECT_LT(total_candidates, data.size() * data.size() / 4) << "radius = " << radius;
+			}
+		}
+}
+
+TEST(ImageSimilarityStore, IndexSkipsRangeAndUnfilled)
+{
+	std::mt19937 rng(9);
+	std::vector<ImageSimilarityData> data;
+	ImageSimilarityStore store = make_clustered_store(rng, data);
+	const gsize unfilled = store.append(nullptr);
+
+	store.index_build(100, store.size());
+
+	std::vector<guint> candidates;
+	store.index_query_radius(0, G_MAXUINT32 / 2, 8, candidates);
+
+	EXPECT_EQ(data.size() - 100, candidates.size());
+	for (const guint n : candidates)
+		{
+		EXPECT_GE(n, 100u);
+		EXPECT_NE(unfilled, n);
+		}
+
+	store.index_query_radius(unfilled, G_MAXUINT32 / 2, 1, candidates);
+	EXPECT_TRUE(candidates.empty());
+}
+
+TEST(ImageSimilarityStore, PrefilterDistanceIsLowerBound)
+{
+	std::mt19937 rng(13);
+	std::vector<ImageSimilarityData> data;
+	const ImageSimilarityStore store = make_clustered_store(rng, data, true);
+
+	for (gsize a = 0; a < data.size(); a += 3)
+		{
+		for (gsize b = 0; b < data.size(); b += 5)
+			{
+			ASSERT_LE(store.prefilter_distance(a, b, 0), full_distance(data[a], data[b]));
+			}
+		}
+}
+
+TEST(ImageSimilarityStore, PrefilterFollowsTransformation)
+{
+	std::mt19937 rng(17);
+	ImageSimilarityData a{};
+	ImageSimilarityData transposed{};
+	a.filled = transposed.filled = true;
+
+	for (gsize i = 0; i < a.avg_r.size(); i++)
+		{
+		a.avg_r[i] = rng() & 0xff;
+		a.avg_g[i] = rng() & 0xff;
+		a.avg_b[i] = rng() & 0xff;
+		}
+
+	for (gint y = 0; y < 32; y++)
+		{
+		for (gint x = 0; x < 32; x++)
+			{
+			transposed.avg_r[(x * 32) + y] = a.avg_r[(y * 32) + x];
+			transposed.avg_g[(x * 32) + y] = a.avg_g[(y * 32) + x];
+			transposed.avg_b[(x * 32) + y] = a.avg_b[(y * 32) + x];
+			}
+		}
+
+	ImageSimilarityStore store(true);
+	store.append(&a);
+	store.append(&transposed);
+
+	EXPECT_GT(store.prefilter_distance(0, 1, 0), 0u);
+	EXPECT_EQ(0u, store.prefilter_distance(0, 1, 1));
+}
+
+/**
+ * Rejecting on the prefilter must not lose a match, i.e. a recall of 1.
+ **/
+TEST(ImageSimilarityStore, PrefilterHasFullRecall)
+{
+	std::mt19937 rng(19);
+	std::vector<ImageSimilarityData> data;
+	const ImageSimilarityStore store = make_clustered_store(rng, data, true);
+
+	std::mt19937 plain_rng(19);
+	std::vector<ImageSimilarityData> plain_data;
+	const ImageSimilarityStore plain = make_clustered_store(plain_rng, plain_data);
+
+	for (const guint32 radius : {0u, 5000u, 20000u, 60000u})
+		{
+		gsize rejected = 0;
+		gsize pairs = 0;
+
+		for (gsize a = 0; a < data.size(); a++)
+			{
+			for (gsize b = 0; b < a; b++)
+				{
+				const bool reject = store.prefilter_distance(a, b, 0) > radius;
+
+				ASSERT_TRUE(!reject || full_distance(data[a], data[b]) > radius) << "a = " << a << " b = " << b;
+				rejected += reject;
+				pairs++;
+				}
+			}
+
+		if (radius <= 20000) EXPECT_GT(rejected, pairs / 2) << "radius = " << radius;
+		}
+
+	EXPECT_LT(store.memory_size(), plain.memory_size() * 3 / 2);
+}
+
+TEST(ImageSimilarityData, AllocatedFromSlabs)
+{
+	std::vector<std::unique_ptr<ImageSimilarityData>> signatures;
+	std::set<ImageSimilarityData *> addresses;
+	ImageSimilarityData *first = nullptr;
+
+	for (gint round = 0; round < 2; round++)
+		{
+		for (gint n = 0; n < 1000; n++)
+			{
+			signatures.push_back(std::make_unique<ImageSimilarityData>());
+			signatures.back()->avg_r.fill(n & 0xff);
+			signatures.back()->avg_b.fill(n >> 8);
+			addresses.insert(signatures.back().get());
+			}
+
+		ASSERT_EQ(1000u, addresses.size());
+
+		/* the first slab stays when all are freed, and is used first again */
+		if (!first) first = signatures.front().get();
+		ASSERT_EQ(first, signatures.front().get());
+
+		for (gint n = 0; n < 1000; n++)
+			{
+			ASSERT_EQ(n & 0xff, signatures[n]->avg_r.back());
+			ASSERT_EQ(n >> 8, signatures[n]->avg_b.front());
+			}
+
+		/* free every other one, then all, so that slots are reused and the other slabs released */
+		for (gint n = 0; n < 1000; n += 2) signatures[n].reset();
+		signatures.clear();
+		addresses.clear();
+		}
+}
+
+}  // anonymous namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Test fixture for the unit tests that work on files
+ *
+ */
+
+#ifndef TESTS_TEMP_DIR_FIXTURE_H
+#define TESTS_TEMP_DIR_FIXTURE_H
+
+#include "gtest/gtest.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+
+#include <glib.h>
+
+/**
+ * @brief Gives each test an empty folder, removed with its files after the test
+ */
+class TempDirTest : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		gchar tmpl[] = "/tmp/geeqie-test-XXXXXX";
+		ASSERT_NE(mkdtemp(tmpl), nullptr);
+		dir = tmpl;
+	}
+
+	void TearDown() override
+	{
+		g_autoptr(GDir) d = g_dir_open(dir.c_str(), 0, nullptr);
+		if (!d) return;
+
+		const gchar *name;
+		while ((name = g_dir_read_name(d)))
+			{
+			unlink(path_of(name).c_str());
+			}
+		rmdir(dir.c_str());
+	}
+
+	std::string path_of(const gchar *name) const
+	{
+		return dir + "/" + name;
+	}
+
+	/** @returns The path of the file */
+	std::string write_file(const gchar *name, const void *data, gsize size) const
+	{
+		std::string path = path_of(name);
+		EXPECT_TRUE(g_file_set_contents(path.c_str(), static_cast<const gchar *>(data), size, nullptr));
+		return path;
+	}
+
+	std::string write_file(const gchar *name, const std::string &contents) const
+	{
+		return write_file(name, contents.data(), contents.size());
+	}
+
+	static gsize file_size(const std::string &file)
+	{
+		struct stat st;
+		return stat(file.c_str(), &st) == 0 ? st.st_size : 0;
+	}
+
+	/**
+	 * @brief Flips the bits of the byte offset bytes after the first marker in file, as a torn write would
+	 * @returns The size of the file, 0 if the byte is not in it
+	 */
+	static gsize damage_file(const std::string &file, const gchar *marker, gsize offset)
+	{
+		g_autofree gchar *contents = nullptr;
+		gsize size;
+		if (!g_file_get_contents(file.c_str(), &contents, &size, nullptr)) return 0;
+
+		const gsize at = std::string(contents, size).find(marker);
+		if (at == std::string::npos || at + offset >= size) return 0;
+
+		contents[at + offset] ^= 0x55;
+		if (!g_file_set_contents(file.c_str(), contents, size, nullptr)) return 0;
+
+		return size;
+	}
+
+	std::string dir;
+};
+
+#endif /* TESTS_TEMP_DIR_FIXTURE_H */
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2026 The Geeqie Team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ *
+ *
+ * Unit tests for union-find.cc
+ *
+ */
+
+#include "gtest/gtest.h"
+
+#include "union-find.h"
+
+namespace {
+
+TEST(UnionFindTest, SingleSets)
+{
+	UnionFind sets;
+	sets.reset(4);
+
+	ASSERT_EQ(sets.count(), 4u);
+	for (guint i = 0; i < 4; i++)
+		{
+		ASSERT_EQ(sets.find(i), i);
+		ASSERT_EQ(sets.size(i), 1u);
+		}
+}
+
+TEST(UnionFindTest, Unite)
+{
+	UnionFind sets;
+	sets.reset(6);
+
+	ASSERT_TRUE(sets.unite(0, 1));
+	ASSERT_TRUE(sets.unite(2, 3));
+	ASSERT_TRUE(sets.unite(3, 1));
+	ASSERT_FALSE(sets.unite(0, 2));
+
+	ASSERT_EQ(sets.find(0), sets.find(3));
+	ASSERT_EQ(sets.size(2), 4u);
+	ASSERT_NE(sets.find(4), sets.find(0));
+	ASSERT_EQ(sets.size(5), 1u);
+
+	sets.reset(6);
+	ASSERT_NE(sets.find(0), sets.find(1));
+}
+
+TEST(UnionFindTest, LongChain)
+{
+	constexpr guint count = 100000;
+	UnionFind sets;
+	sets.reset(count);
+
+	for (guint i = 1; i < count; i++)
+		{
+		sets.unite(i - 1, i);
+		}
+
+	ASSERT_EQ(sets.size(0), count);
+	ASSERT_EQ(sets.find(0), sets.find(count - 1));
+}
+
+} // namespace
+
+/* vim: set shiftwidth=8 softtabstop=0 cindent cinoptions={1s: */